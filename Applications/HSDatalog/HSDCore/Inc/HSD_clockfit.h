@@ -0,0 +1,72 @@
+/**
+  ******************************************************************************
+  * @file    HSD_clockfit.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Online linear fit between a counter (sensor clock, sample count)
+  *          and the timebase of the data stream
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_CLOCKFIT_H
+#define __HSD_CLOCKFIT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#include "HSDCoreConfig.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define HSD_CLOCKFIT_MIN_PAIRS          4U    /* pairs before the fitted slope replaces the nominal one */
+#define HSD_CLOCKFIT_SHIFT              6U    /* memory of the fit: 2^HSD_CLOCKFIT_SHIFT pairs */
+#define HSD_CLOCKFIT_OUTLIER_GAIN       8.0f  /* pairs off by more than GAIN * (mean residual + nominal slope)
+                                                 are skipped */
+#define HSD_CLOCKFIT_MAX_OUTLIERS       8U    /* consecutive outliers that restart the fit */
+#define HSD_CLOCKFIT_FLOAT_SPAN         65536 /* counts further from x0 are mapped in double */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  float nominalSlope;         /* timebase units per count, until the fit is locked */
+  uint64_t x0;                /* origin of the fit, moved to the weighted mean of the counts */
+  HSD_TimeStamp_t y0;         /* origin of the fit, moved to the weighted mean of the timebase */
+  float mx;                   /* weighted mean of x - x0 */
+  float my;                   /* weighted mean of y - y0 */
+  float cxx;                  /* weighted variance of x */
+  float cxy;                  /* weighted covariance of x, y */
+  float slope;                /* timebase units per count */
+  float meanResidual;         /* weighted mean of |y - fit(x)| of the accepted pairs */
+  float meanSquareResidual;   /* weighted mean of (y - fit(x))^2 of the accepted pairs, once locked */
+  float maxResidual;          /* largest |y - fit(x)| once locked, outliers included */
+  uint32_t nPairs;            /* pairs since the (re)start of the fit */
+  uint32_t nOutliersTotal;
+  uint8_t nOutliers;          /* consecutive outliers */
+} HSD_ClockFit_t;
+
+/* Exported functions --------------------------------------------------------*/
+void HSD_CLOCKFIT_Init(HSD_ClockFit_t *pFit, double nominalSlope);
+uint8_t HSD_CLOCKFIT_Add(HSD_ClockFit_t *pFit, uint64_t x, HSD_TimeStamp_t y);
+HSD_TimeStamp_t HSD_CLOCKFIT_Map(const HSD_ClockFit_t *pFit, uint64_t x);
+uint8_t HSD_CLOCKFIT_Is_Locked(const HSD_ClockFit_t *pFit);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_CLOCKFIT_H */
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    HSD_codec.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Lossless codec for int16 sensor streams
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_CODEC_H
+#define __HSD_CODEC_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+
+/* Exported constants --------------------------------------------------------*/
+/*
+ * Encoded block layout (little endian), each block decodes on its own:
+ *   uint16_t nFrames          number of frames (one sample for each channel) in the block
+ *   uint16_t nBytes           size of what follows; bit 15 set: nFrames raw interleaved int16 frames
+ *   uint8_t  param[nChannels] bits 0..4: Rice parameter k, bits 5..6: predictor order (0, 1 or 2)
+ *   bitstream                 LSB first, channel after channel:
+ *                             - the first "order" samples, 16 bits each
+ *                             - the residuals e = x[n] - (0 | x[n-1] | 2*x[n-1] - x[n-2]) of the others,
+ *                               zigzag mapped (u = 2e or -2e-1) and Rice coded:
+ *                               q = u >> k ones, a zero, then the k low bits of u;
+ *                               if q >= HSD_CODEC_ESCAPE: HSD_CODEC_ESCAPE ones, then u on HSD_CODEC_ESCAPE_BITS
+ *                             the last byte is zero padded
+ */
+#define HSD_CODEC_HEADER_SIZE   4U
+#define HSD_CODEC_RAW_FLAG      0x8000U
+#define HSD_CODEC_ESCAPE        16U
+#define HSD_CODEC_ESCAPE_BITS   18U /* the zigzag of a 2nd order residual of int16 data fits in 18 bits */
+#define HSD_CODEC_MAX_K         15U
+#define HSD_CODEC_MAX_FRAMES    4096U
+
+/* Size of the buffer needed to encode a block: the encoder gives up one channel past the raw size */
+#define HSD_CODEC_OUT_SIZE(nFrames, nChannels)  (HSD_CODEC_HEADER_SIZE + (nChannels) + 2U * (nFrames) * (nChannels) \
+                                                 + ((nFrames) * (HSD_CODEC_ESCAPE + HSD_CODEC_ESCAPE_BITS) + 7U) / 8U)
+
+/* Exported functions --------------------------------------------------------*/
+uint32_t HSD_Codec_Encode(const int16_t *src, uint32_t nFrames, uint32_t nChannels, uint8_t *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_CODEC_H */
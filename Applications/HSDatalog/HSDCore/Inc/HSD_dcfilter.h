@@ -0,0 +1,54 @@
+/**
+  ******************************************************************************
+  * @file    HSD_dcfilter.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   DC removal filter of microphone PCM blocks
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_DCFILTER_H
+#define __HSD_DCFILTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCoreConfig.h"
+#include "stdint.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Pole of the high-pass filter in Q14 (0xFC / 0xFF) */
+#define HSD_DCFILTER_COEFF        16191
+#define HSD_DCFILTER_SHIFT        14
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  int32_t lastIn;
+  int32_t lastOut;
+} HSD_DCFilter_t;
+
+/* Exported functions --------------------------------------------------------*/
+void HSD_DCFILTER_Reset(HSD_DCFilter_t *pFilter);
+void HSD_DCFILTER_Process(HSD_DCFilter_t *pFilter, int16_t *buf, uint32_t nSamples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_DCFILTER_H */
@@ -0,0 +1,51 @@
+/**
+  ******************************************************************************
+  * @file    HSD_decimator.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Polyphase FIR decimator of subsensor data
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_DECIMATOR_H
+#define __HSD_DECIMATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCoreConfig.h"
+#include "stdint.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define HSD_DECIM_MAX_FACTOR      64U
+#define HSD_DECIM_MAX_TAPS        1024U
+
+/* Filter quality: taps per polyphase branch */
+#define HSD_DECIM_QUALITY_LOW     0U  /* 8 taps per phase, passband up to 0.16 x output ODR */
+#define HSD_DECIM_QUALITY_MEDIUM  1U  /* 16 taps per phase, passband up to 0.33 x output ODR */
+#define HSD_DECIM_QUALITY_HIGH    2U  /* 32 taps per phase, passband up to 0.41 x output ODR */
+
+/* Exported functions --------------------------------------------------------*/
+uint8_t HSD_DECIM_Process(uint8_t sensorId, uint8_t subSensorId, uint8_t *buf, uint16_t *size,
+                          HSD_TimeStamp_t *timeStamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_DECIMATOR_H */
@@ -0,0 +1,65 @@
+/**
+  ******************************************************************************
+  * @file    HSD_features.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Rolling time-domain features of a subsensor, published as a
+  *          virtual sensor
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_FEATURES_H
+#define __HSD_FEATURES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCoreConfig.h"
+#include "stdint.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Features of one axis, in the order they are sent: one sample for each axis of the source
+ * (source dimensions samples per window), followed by the timestamp of the last sample of the window */
+#define HSD_FEATURES_MEAN       0U
+#define HSD_FEATURES_RMS        1U
+#define HSD_FEATURES_P2P        2U
+#define HSD_FEATURES_CREST      3U
+#define HSD_FEATURES_SKEWNESS   4U
+#define HSD_FEATURES_KURTOSIS   5U
+#define HSD_FEATURES_N          6U
+
+#define HSD_FEATURES_MAX_AXES   3U
+#define HSD_FEATURES_MAX_HOPS   4U
+
+#if (HSD_FEATURES_WINDOW_HOPS < 1) || (HSD_FEATURES_WINDOW_HOPS > HSD_FEATURES_MAX_HOPS)
+#error "HSD_FEATURES_WINDOW_HOPS must be between 1 and HSD_FEATURES_MAX_HOPS"
+#endif
+
+/* Exported functions --------------------------------------------------------*/
+uint8_t HSD_FEATURES_Create_Sensor(const uint8_t *sourceSensorId, const uint8_t *sourceSubSensorId, uint8_t nSources);
+uint8_t HSD_FEATURES_Get_Id(void);
+uint8_t HSD_FEATURES_Is_Source(uint8_t sensorId, uint8_t subSensorId);
+void HSD_FEATURES_Process(uint8_t sensorId, uint8_t subSensorId, const uint8_t *buf, uint16_t size,
+                          HSD_TimeStamp_t timeStamp);
+void HSD_FEATURES_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_FEATURES_H */
@@ -0,0 +1,95 @@
+/**
+  ******************************************************************************
+  * @file    HSD_fifo_demux.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Demultiplexer of tagged FIFO words (LSM6DSOX, ISM330DHCX)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_FIFO_DEMUX_H
+#define __HSD_FIFO_DEMUX_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* A FIFO word is a TAG byte followed by 6 bytes of data */
+#define HSD_FIFO_WORD_SIZE              7U
+#define HSD_FIFO_WORD_DATA_SIZE         6U
+
+/* TAG_SENSOR field, bits [7:3] of the TAG byte */
+#define HSD_FIFO_N_TAGS                 32U
+#define HSD_FIFO_TAG_GYRO_NC            0x01U
+#define HSD_FIFO_TAG_XL_NC              0x02U
+#define HSD_FIFO_TAG_TEMPERATURE        0x03U
+#define HSD_FIFO_TAG_TIMESTAMP          0x04U
+#define HSD_FIFO_TAG_CFG_CHANGE         0x05U
+#define HSD_FIFO_TAG_XL_NC_T_2          0x06U
+#define HSD_FIFO_TAG_XL_NC_T_1          0x07U
+#define HSD_FIFO_TAG_XL_2XC             0x08U
+#define HSD_FIFO_TAG_XL_3XC             0x09U
+#define HSD_FIFO_TAG_GYRO_NC_T_2        0x0AU
+#define HSD_FIFO_TAG_GYRO_NC_T_1        0x0BU
+#define HSD_FIFO_TAG_GYRO_2XC           0x0CU
+#define HSD_FIFO_TAG_GYRO_3XC           0x0DU
+#define HSD_FIFO_TAG_SENSORHUB_SLAVE0   0x0EU
+#define HSD_FIFO_TAG_SENSORHUB_SLAVE1   0x0FU
+#define HSD_FIFO_TAG_SENSORHUB_SLAVE2   0x10U
+#define HSD_FIFO_TAG_SENSORHUB_SLAVE3   0x11U
+#define HSD_FIFO_TAG_STEP_COUNTER       0x12U
+#define HSD_FIFO_TAG_SENSORHUB_NACK     0x19U
+
+#define HSD_FIFO_MAX_SINKS              4U  /* unrolled in HSD_fifo_demux.c */
+#define HSD_FIFO_SINK_NONE              0xFFU
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t *dst;         /* current output span, NULL to drop the samples */
+  uint16_t room;        /* samples that still fit in the span */
+  uint16_t written;     /* samples written in the span */
+  uint16_t nSamples;    /* samples of the sink in the batch */
+  uint8_t nHalfWords;   /* payload copied per sample, in 16-bit words */
+} HSD_FIFO_Sink_t;
+
+typedef struct
+{
+  uint8_t tagToSink[HSD_FIFO_N_TAGS];
+  HSD_FIFO_Sink_t sink[HSD_FIFO_MAX_SINKS];
+  uint16_t dropped[HSD_FIFO_N_TAGS];  /* words of each TAG not routed to a sink, in the batch */
+  const uint8_t *fifo;
+  uint16_t nWords;
+  uint16_t word;                      /* next word to be parsed */
+  uint8_t single;                     /* sink of all the words of the batch, if any */
+} HSD_FIFO_Demux_t;
+
+/* Exported functions --------------------------------------------------------*/
+void HSD_FIFO_DEMUX_Init(HSD_FIFO_Demux_t *pDemux);
+void HSD_FIFO_DEMUX_Route(HSD_FIFO_Demux_t *pDemux, uint8_t tag, uint8_t sinkId, uint8_t nBytes);
+void HSD_FIFO_DEMUX_Start(HSD_FIFO_Demux_t *pDemux, const uint8_t *fifo, uint16_t nWords);
+void HSD_FIFO_DEMUX_Set_Span(HSD_FIFO_Demux_t *pDemux, uint8_t sinkId, uint8_t *dst, uint16_t nSamples);
+uint8_t HSD_FIFO_DEMUX_Run(HSD_FIFO_Demux_t *pDemux);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_FIFO_DEMUX_H */
@@ -0,0 +1,68 @@
+/**
+  ******************************************************************************
+  * @file    HSD_fifo_ts.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Sample timing from the timestamp words batched in the sensor FIFO
+  *          (LSM6DSOX, ISM330DHCX)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_FIFO_TS_H
+#define __HSD_FIFO_TS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#include "HSDCoreConfig.h"
+#include "HSD_clockfit.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define HSD_FIFO_TS_MAX_SUBSENSORS      2U
+#define HSD_FIFO_TS_FREQ                40000.0f  /* nominal frequency of the sensor timestamp counter */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint8_t tag;              /* TAG_SENSOR of the subsensor words */
+  uint32_t ticksPerSample;  /* sample period in sensor timestamp ticks */
+  uint32_t epoch;           /* timestamp word preceding the latest sample, 0 if none */
+  uint64_t ref;             /* sensor time of that word */
+  uint16_t after;           /* samples since that word */
+} HSD_FIFO_TS_Sub_t;
+
+typedef struct
+{
+  HSD_FIFO_TS_Sub_t sub[HSD_FIFO_TS_MAX_SUBSENSORS];
+  uint64_t sensorTime;      /* latest timestamp word, extended to 64 bits */
+  uint32_t epoch;           /* timestamp words decoded so far, 0 until the first one */
+  HSD_ClockFit_t fit;       /* sensor ticks -> timebase, over the pairs (latest sample, FIFO IRQ timestamp) */
+} HSD_FIFO_TS_t;
+
+/* Exported functions --------------------------------------------------------*/
+void HSD_FIFO_TS_Init(HSD_FIFO_TS_t *pTs, double timebaseFreq);
+void HSD_FIFO_TS_Set_Subsensor(HSD_FIFO_TS_t *pTs, uint8_t subSensorId, uint8_t tag, float odr);
+void HSD_FIFO_TS_Process(HSD_FIFO_TS_t *pTs, const uint8_t *fifo, uint16_t nWords, HSD_TimeStamp_t irqTimeStamp,
+                         HSD_TimeStamp_t *pTimeStamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_FIFO_TS_H */
@@ -55,17 +55,20 @@ int32_t HSD_JSON_serialize_Sensor(COM_Sensor_t *Sensor, char **SerializedJSON);
 int32_t HSD_JSON_serialize_SensorDescriptor(COM_SensorDescriptor_t *SensorDescriptor, char **SerializedJSON);
 int32_t HSD_JSON_serialize_SensorStatus(uint8_t sensorId, COM_SensorStatus_t *SensorStatus, char **SerializedJSON);
 int32_t HSD_JSON_serialize_SubSensorDescriptor(COM_SubSensorDescriptor_t *SubSensorDescriptor, char **SerializedJSON);
-int32_t HSD_JSON_serialize_SubSensorStatus(COM_SubSensorStatus_t *SubSensorStatus, char **SerializedJSON);
+int32_t HSD_JSON_serialize_SubSensorStatus(uint8_t sensorId, uint8_t subSensorId,
+                                           COM_SubSensorStatus_t *SubSensorStatus, char **SerializedJSON);
 
 int32_t HSD_JSON_serialize_RefreshSensorStatus(uint8_t sensorId, COM_SensorStatus_t *SensorStatus,
                                                char **SerializedJSON);
 int32_t HSD_JSON_serialize_FWStatus_Performance(char **SerializedJSON, char *chrgState, uint32_t mV, uint32_t level,
-                                                uint16_t cpu_usage);
+                                                uint16_t cpu_usage, uint8_t detailed);
 int32_t HSD_JSON_serialize_FWStatus_Logging(char **SerializedJSON, uint8_t sdDetected, uint8_t isLoggingActive);
 int32_t HSD_JSON_serialize_FWStatus_Network(char **SerializedJSON, char *ssid, char *password, char *ip);
 
 int32_t HSD_JSON_serialize_Acquisition(COM_AcquisitionDescriptor_t *AcquisitionDescriptor, char **SerializedJSON,
                                        uint8_t pretty);
+int32_t HSD_JSON_serialize_AcquisitionInfo(COM_AcquisitionDescriptor_t *AcquisitionDescriptor, COM_SDStats_t *SDStats,
+                                           char **SerializedJSON, uint8_t pretty);
 
 int32_t HSD_JSON_parse_Device(char *SerializedJSON, COM_Device_t *Device);
 int32_t HSD_JSON_parse_Status(char *SerializedJSON, COM_SensorStatus_t *SensorStatus);
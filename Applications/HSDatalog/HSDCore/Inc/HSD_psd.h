@@ -0,0 +1,73 @@
+/**
+  ******************************************************************************
+  * @file    HSD_psd.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Periodogram kernel of the Welch PSD
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_PSD_H
+#define __HSD_PSD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCoreConfig.h"
+#include "stdint.h"
+
+/* Exported constants --------------------------------------------------------*/
+/* Largest segment length, sizes the window, work buffer and twiddle tables */
+#ifndef HSD_PSD_MAX_FFT_LEN
+#define HSD_PSD_MAX_FFT_LEN       256U
+#endif /* HSD_PSD_MAX_FFT_LEN */
+/* Set to 1 to use arm_rfft_fast_f32 from CMSIS-DSP instead of the portable FFT */
+#ifndef HSD_PSD_USE_CMSIS_DSP
+#define HSD_PSD_USE_CMSIS_DSP     0
+#endif /* HSD_PSD_USE_CMSIS_DSP */
+
+#if (HSD_PSD_USE_CMSIS_DSP == 1)
+#include "arm_math.h"
+#endif /* (HSD_PSD_USE_CMSIS_DSP == 1) */
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint32_t fftLen;
+  float windowPower;                              /* sum of w[n]^2 */
+  float window[HSD_PSD_MAX_FFT_LEN];              /* Hann */
+  float work[HSD_PSD_MAX_FFT_LEN];
+#if (HSD_PSD_USE_CMSIS_DSP == 1)
+  arm_rfft_fast_instance_f32 rfft;
+  float spectrum[HSD_PSD_MAX_FFT_LEN];
+#else
+  float cosTable[HSD_PSD_MAX_FFT_LEN / 2U + 1U];  /* W_N^k = cos - j sin, k = 0..N/2 */
+  float sinTable[HSD_PSD_MAX_FFT_LEN / 2U + 1U];
+#endif /* (HSD_PSD_USE_CMSIS_DSP == 1) */
+} HSD_PSD_t;
+
+/* Exported functions --------------------------------------------------------*/
+uint8_t HSD_PSD_Init(HSD_PSD_t *pPsd, uint32_t fftLen);
+void HSD_PSD_Accumulate(HSD_PSD_t *pPsd, const int16_t *x, float *acc);
+float HSD_PSD_Get_Scale(const HSD_PSD_t *pPsd, uint32_t nSegments, float fs);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_PSD_H */
@@ -0,0 +1,75 @@
+/**
+  ******************************************************************************
+  * @file    HSD_trigger.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Trigger of event-based SD logging
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_TRIGGER_H
+#define __HSD_TRIGGER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCoreConfig.h"
+#include "stdint.h"
+
+/* Exported types ------------------------------------------------------------*/
+typedef enum
+{
+  HSD_TRIGGER_MODE_NONE = 0,  /* continuous logging */
+  HSD_TRIGGER_MODE_LEVEL,     /* |sample| of the axis reaches the threshold */
+  HSD_TRIGGER_MODE_RMS,       /* RMS of the axis over rmsWindow samples reaches the threshold */
+  HSD_TRIGGER_MODE_CLASS      /* value of the axis changes (i.e.: MLC class) */
+} HSD_Trigger_Mode_t;
+
+typedef struct
+{
+  HSD_Trigger_Mode_t mode;
+  uint8_t sensorId;       /* subsensor watched by the trigger */
+  uint8_t subSensorId;
+  uint8_t axis;           /* HSD_TRIGGER_ANY_AXIS: any axis (LEVEL, CLASS) or vector magnitude (RMS) */
+  float threshold;        /* in sensor units, sensitivity applied */
+  uint32_t rmsWindow;     /* RMS window [samples] */
+  uint32_t preTriggerMs;  /* history logged before the trigger */
+  uint32_t postTriggerMs; /* data logged after the (latest) trigger */
+} HSD_Trigger_Config_t;
+
+/* Exported constants --------------------------------------------------------*/
+#define HSD_TRIGGER_ANY_AXIS    0xFFU
+#define HSD_TRIGGER_MAX_AXES    8U      /* MLC outputs of LSM6DSOX and ISM330DHCX */
+
+/* Exported functions --------------------------------------------------------*/
+void HSD_TRIGGER_Set_Config(const HSD_Trigger_Config_t *config);
+HSD_Trigger_Config_t *HSD_TRIGGER_Get_Config(void);
+uint8_t HSD_TRIGGER_Is_Enabled(void);
+void HSD_TRIGGER_Reset(void);
+void HSD_TRIGGER_Process(uint8_t sensorId, uint8_t subSensorId, const uint8_t *buf, uint16_t size,
+                         HSD_TimeStamp_t timeStamp);
+uint32_t HSD_TRIGGER_Get_Sequence(void);
+uint8_t HSD_TRIGGER_Is_Recording(HSD_TimeStamp_t timeStamp);
+uint32_t HSD_TRIGGER_Get_nEvents(void);
+int32_t HSD_TRIGGER_Get_Event(uint32_t idx, double *start, double *end);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_TRIGGER_H */
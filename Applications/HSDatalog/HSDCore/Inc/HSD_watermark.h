@@ -0,0 +1,63 @@
+/**
+  ******************************************************************************
+  * @file    HSD_watermark.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   FIFO watermark policy and bus slack shared by the sensors
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __HSD_WATERMARK_H
+#define __HSD_WATERMARK_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#include "HSDCoreConfig.h"
+
+/* Exported constants --------------------------------------------------------*/
+#define HSD_WTM_BUS_SPI1                0U
+#define HSD_WTM_BUS_SPI3                1U
+#define HSD_WTM_BUS_I2C1                2U
+#define HSD_WTM_BUS_I2C3                3U
+#define HSD_WTM_N_BUS                   4U
+
+/* Exported types ------------------------------------------------------------*/
+typedef struct
+{
+  uint16_t depth;           /* FIFO depth [words], 0 for sensors read once per sample */
+  uint16_t minLevel;        /* smallest watermark [words] */
+  uint16_t maxLevel;        /* largest watermark [words]: watermark register and read buffer */
+  uint8_t bytesPerWord;     /* bytes read per FIFO word, or per sample */
+  uint8_t subSensorMask;    /* subsensors stored in the FIFO */
+  uint8_t wordPerSubSensor; /* 1: a word per subsensor sample (tagged FIFO), 0: a word holds all the subsensors */
+  uint8_t bus;              /* HSD_WTM_BUS_xxx */
+  uint8_t tsDecimation;     /* tagged FIFO: a timestamp word every tsDecimation sample sets, 0 if not batched */
+} HSD_WTM_Fifo_t;
+
+/* Exported functions --------------------------------------------------------*/
+void HSD_WTM_Register(uint8_t sId, const HSD_WTM_Fifo_t *pFifo);
+uint16_t HSD_WTM_Get_Level(uint8_t sId);
+uint32_t HSD_WTM_Get_Slack(uint8_t sId, uint16_t level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __HSD_WATERMARK_H */
@@ -26,6 +26,8 @@
 /* Includes ------------------------------------------------------------------*/
 #include "stdint.h"
 #include "ff.h"
+#include "HSDCoreConfig.h"
+#include "HSD_clockfit.h"
 
 /* Package Version only numbers 0->9 */
 #define HSD_JSON_VERSION_MAJOR '1'
@@ -34,7 +36,11 @@
 
 /* Version of acquisition file format */
 #define HSD_DATA_FILE_EXTENSION       ".dat"
+#if (HSD_COMPACT_TIMESTAMPS == 1)
+#define HSD_DATA_FILE_FORMAT          "HSD_2.0.0"
+#else
 #define HSD_DATA_FILE_FORMAT          "HSD_1.0.0"
+#endif /* HSD_COMPACT_TIMESTAMPS */
 
 #define COM_MAX_SENSORS 10
 
@@ -46,6 +52,7 @@
 #define COM_TYPE_HUM    6
 #define COM_TYPE_MIC    7
 #define COM_TYPE_MLC    8
+#define COM_TYPE_PSD    9
 
 #define N_MAX_DIM_LABELS                    8U
 #define DIM_LABELS_LENGTH                   3U
@@ -53,6 +60,15 @@
 #define N_MAX_SENSOR_COMBO                  4U
 #define N_MAX_SUPPORTED_ODR                 16U
 #define N_MAX_SUPPORTED_FS                  16U
+#define COM_MAX_BYTES_PER_SAMPLE            16U
+#define COM_LATENCY_BUCKETS                 20U
+
+/* Sensor buses, same order as HSD_WTM_BUS_xxx */
+#define COM_BUS_SPI1                        0U
+#define COM_BUS_SPI3                        1U
+#define COM_BUS_I2C1                        2U
+#define COM_BUS_I2C3                        3U
+#define COM_N_BUS                           4U
 
 #define HSD_DEVICE_ALIAS_LENGTH             16U
 #define HSD_DEVICE_PNUMBER_LENGTH           17U
@@ -132,6 +148,7 @@
 #define COM_REQUEST_TAG_CONFIG          (uint8_t)(0x0E)
 #define COM_REQUEST_MLC_CONFIG          (uint8_t)(0x0F)
 #define COM_REQUEST_SENSORREFRESH       (uint8_t)(0x10)
+#define COM_REQUEST_STATUS_PERF_FULL    (uint8_t)(0x20) /* performance status with the latency histograms */
 
 #define CMD_TYPE_NETWORK                (uint8_t)(0x00)
 #define CMD_TYPE_PERFORMANCE            (uint8_t)(0x01)
@@ -143,21 +160,96 @@
 /* Context is only used in the firmware, it's not written into DeviceConfiG.json */
 typedef struct
 {
-  float n_samples_acc;
-  double old_time_stamp;
+  uint64_t n_samples_total;      /* samples received after the first (discarded) batch */
+  HSD_ClockFit_t clock_fit;      /* n_samples_total -> timestamp of the latest sample */
+  HSD_TimeStamp_t old_time_stamp;
   uint16_t n_samples_to_timestamp;
   uint8_t first_dataReady;
   uint8_t *sd_write_buffer;
   uint32_t sd_write_buffer_idx;
+  volatile uint32_t sd_commit_seg;
+  volatile uint32_t sd_write_seg;
+  uint32_t sd_overrun_count;
+  uint32_t sd_dropped_bytes;
+  HSD_TimeStamp_t batch_time_stamp;
+  uint16_t batch_samples_left;
+  uint8_t sd_wrap_staged;
+  uint8_t sd_batch_dropped; /* arena exhausted during a zero-copy batch: its remaining samples are dropped */
+  uint8_t sd_wrap_sample[COM_MAX_BYTES_PER_SAMPLE];
+  uint32_t sd_ring_hwm;
+  uint32_t sd_block_data_size;
+  uint8_t *codec_buffer;
+  uint32_t codec_buffer_idx;
+  uint64_t codec_in_bytes;
+  uint64_t codec_out_bytes;
+  uint64_t codec_cycles;
+  uint8_t *event_ring;        /* pre-trigger history, NULL if the subsensor is logged continuously */
+  uint32_t event_ring_size;   /* whole number of event_period */
+  uint32_t event_period;      /* bytes of samplesPerTimestamp samples and their timestamp */
+  uint32_t event_ring_bytes;  /* bytes written in the history since the last event */
+  uint32_t event_live_bytes;  /* bytes written on SD card in the current event, modulo event_period */
+  uint32_t event_seq;         /* last event written */
+  uint8_t event_live;
   FIL file_handler;
 } COM_SubSensorContext_t;
 
+/* Latency histogram: bucket[k] counts the calls that took [2^k, 2^(k+1)) us,
+ * bucket[0] also counts the ones under 1 us, the last bucket the longer ones */
+typedef struct
+{
+  uint32_t bucket[COM_LATENCY_BUCKETS];
+  uint32_t count;
+  uint32_t max_us;
+} COM_LatencyHistogram_t;
+
+/* SD logging statistics, reset at the beginning of each acquisition */
+typedef struct
+{
+  COM_LatencyHistogram_t writeBuffer;
+  COM_LatencyHistogram_t flushBuffer;
+  COM_LatencyHistogram_t diskWrite;
+  COM_LatencyHistogram_t cardWrite;
+  uint64_t bytesWritten;
+  uint32_t queuePeak;
+  uint32_t preallocatedFiles; /* files opened with a contiguous pre-allocated region */
+  uint32_t preallocFailures;  /* files that fell back to cluster by cluster allocation */
+  uint32_t writeErrors;       /* failed card writes, reported to FatFs by a later call */
+  uint32_t writeErrorSector;  /* first sector of the last failed write */
+  uint32_t writeErrorCount;   /* sectors of the last failed write */
+} COM_SDStats_t;
+
+/* Sensor bus statistics, reset at the beginning of each acquisition */
+typedef struct
+{
+  COM_LatencyHistogram_t queueDelay; /* request to start of the transaction */
+  uint32_t transactions;
+  uint32_t deadlineMisses;   /* transactions started after the deadline of their request */
+  uint32_t coalesced;        /* transactions served ahead of an earlier deadline, after one to the same device */
+  uint32_t pendingPeak;      /* most requests waiting for the bus at once */
+  uint32_t errors;           /* transactions the HAL refused to start or that ended with a bus error */
+  COM_LatencyHistogram_t transfer; /* SPI: chip select low to chip select high */
+  uint64_t setupTicks;       /* SPI: CPU time from chip select low to the start of the DMA, in TIM5 ticks */
+  uint64_t endTicks;         /* SPI: CPU time in the DMA complete interrupt after chip select high, in TIM5 ticks */
+  uint32_t splitTransfers;   /* SPI: transactions sent as a DMA of the address byte followed by a DMA of the data */
+} COM_BusStats_t;
+
+/* Bus transaction slots statistics, reset at the beginning of each acquisition */
+typedef struct
+{
+  uint32_t overflowAllocs;   /* requests made while the reserved slot of their sensor was in use */
+  uint32_t overflowPeak;     /* most overflow slots in use at once */
+  uint32_t allocFailures;    /* requests failed: reserved slot in use and no free overflow slot */
+} COM_SlotStats_t;
+
 typedef struct
 {
   uint8_t isActive;
   float ODR;
   float measuredODR;
   float initialOffset;
+  float timestampJitter;     /* RMS deviation of the batch timestamps from the clock model [s] */
+  float timestampJitterMax;  /* largest deviation of a batch timestamp from the clock model [s] */
+  uint32_t timestampOutliers; /* batch timestamps too far from the clock model to be used */
   uint16_t samplesPerTimestamp;
   float FS;
   float sensitivity;
@@ -166,6 +258,9 @@ typedef struct
   uint32_t wifiDataPacketSize;
   int16_t comChannelNumber;
   uint8_t ucfLoaded;
+  uint8_t compression; /* 0: raw samples, 1: HSD_codec blocks (int16 subsensors, SD card only) */
+  uint8_t decimation; /* 0 or 1: off, else HSD_decimator factor: data are sent at ODR / decimation */
+  uint8_t decimationQuality; /* HSD_DECIM_QUALITY_xxx */
   COM_SubSensorContext_t context;
 } COM_SubSensorStatus_t;
 
@@ -214,6 +309,8 @@ typedef struct
   char dataFileFormat[HSD_DEVICE_DATA_FILE_FORMAT_LENGTH];
   uint32_t nSensor;
   char bleMacAddress[HSD_BLE_MAC_ADDRESS_LENGTH];
+  uint32_t tsFrequency; /* timestamp tick frequency [Hz], 0 if timestamps are in seconds */
+  uint32_t chunkTsFrequency; /* chunk header tick frequency [Hz], 0 if chunk headers are not used */
 } COM_DeviceDescriptor_t;
 
 typedef struct
@@ -278,6 +375,10 @@ COM_SubSensorStatus_t *COM_GetSubSensorStatus(uint8_t sID, uint8_t ssID);
 COM_SubSensorContext_t *COM_GetSubSensorContext(uint8_t sID, uint8_t ssID);
 COM_TagList_t *COM_GetTagList(void);
 COM_AcquisitionDescriptor_t *COM_GetAcquisitionDescriptor(void);
+COM_SDStats_t *COM_GetSDStats(void);
+COM_BusStats_t *COM_GetBusStats(uint8_t bus);
+COM_LatencyHistogram_t *COM_GetIrqLatency(void);
+COM_SlotStats_t *COM_GetSlotStats(void);
 
 uint8_t COM_GetSubSensorNumber(uint8_t sID);
 
@@ -286,8 +387,14 @@ void COM_SetDeviceAlias(char *alias);
 void COM_SetBleMacAddress(uint8_t *bleMacAddress);
 void COM_ResetSubSensorContext(uint8_t sID, uint8_t ssID);
 void COM_GenerateAcquisitionUUID(void);
+void COM_ResetSDStats(void);
+void COM_ResetBusStats(void);
+void COM_CountContextSwitch(void);
+uint32_t COM_GetContextSwitches(void);
+void COM_AddLatencySample(COM_LatencyHistogram_t *hist, uint32_t latency_us);
 
 uint32_t COM_GetnBytesPerSample(uint8_t sID, uint8_t ssID);
+float COM_GetEffectiveODR(COM_SubSensorStatus_t *pSubSensorStatus);
 uint8_t COM_IsFsLegal(float value, uint8_t sID, uint8_t ssID);
 uint8_t COM_IsOdrLegal(float value, uint8_t sID, uint8_t ssID);
 
@@ -40,15 +40,17 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId HTS221_Thread_Id;
 extern SM_Init_Param_t HTS221_Init_Param;
 extern EXTI_HandleTypeDef hts221_exti;
 
 /* Exported functions ------------------------------------------------------- */
 void HTS221_Peripheral_Init(void);
 void HTS221_OS_Init(void);
-void HTS221_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void HTS221_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void HTS221_Start(void);
 void HTS221_Stop(void);
+SM_Sensor_State_t HTS221_Get_State(void);
 uint8_t HTS221_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t HTS221_Get_Id(void);
 
@@ -50,7 +50,7 @@ extern SM_Init_Param_t IIS2DH_Init_Param;
 /* Exported functions ------------------------------------------------------- */
 void IIS2DH_Peripheral_Init(void);
 void IIS2DH_OS_Init(void);
-void IIS2DH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void IIS2DH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void IIS2DH_Set_ODR(float newODR);
 void IIS2DH_Set_FS(float newFS1, float newFS2);
 void IIS2DH_Start(void);
@@ -51,7 +51,7 @@ extern SM_Init_Param_t IIS2MDC_Init_Param;
 /* Exported functions ------------------------------------------------------- */
 void IIS2MDC_Peripheral_Init(void);
 void IIS2MDC_OS_Init(void);
-void IIS2MDC_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void IIS2MDC_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void IIS2MDC_Set_ODR(float newODR);
 void IIS2MDC_Set_FS(float newFS1, float newFS2);
 void IIS2MDC_Start(void);
@@ -39,6 +39,7 @@ extern "C" {
 #define IIS3DWB_MAX_WTM_LEVEL             (256)
 #endif /* IIS3DWB_MAX_DRDY_PERIOD */
 #define IIS3DWB_MIN_WTM_LEVEL             (16)
+#define IIS3DWB_FIFO_DEPTH                (438)    /* words: 3 kbyte / 7 */
 #define IIS3DWB_MAX_SAMPLES_PER_IT        (IIS3DWB_MAX_WTM_LEVEL)
 
 #define IIS3DWB_SPI_CS_Pin GPIO_PIN_5
@@ -51,6 +52,16 @@ extern "C" {
 #define OVLP_AXL                (float)(0.25)
 #define N_AVERAGE_AXL           (int)(4)
 
+/* Welch PSD of x, y, z published as subsensor 1: each spectrum is made of
+ * IIS3DWB_PSD_BINS samples (one bin of the 3 axes each), followed by its timestamp */
+#ifndef IIS3DWB_PSD_ENABLE
+#define IIS3DWB_PSD_ENABLE      1
+#endif /* IIS3DWB_PSD_ENABLE */
+/* The FFT kernel is HSD_psd.c, HSD_PSD_USE_CMSIS_DSP selects CMSIS-DSP instead of the portable FFT */
+#define IIS3DWB_PSD_BINS        (FFT_LEN_AXL / 2U + 1U)
+#define IIS3DWB_PSD_OVERLAP     ((uint32_t)(FFT_LEN_AXL * OVLP_AXL))
+#define IIS3DWB_PSD_HOP         (FFT_LEN_AXL - IIS3DWB_PSD_OVERLAP)
+
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
 extern osThreadId IIS3DWB_Thread_Id;
@@ -60,7 +71,7 @@ extern SM_Init_Param_t IIS3DWB_Init_Param;
 /* Exported functions ------------------------------------------------------- */
 void IIS3DWB_Peripheral_Init(void);
 void IIS3DWB_OS_Init(void);
-void IIS3DWB_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void IIS3DWB_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void IIS3DWB_Set_ODR(float newODR);
 void IIS3DWB_Set_FS(float newFS1, float newFS2);
 void IIS3DWB_Start(void);
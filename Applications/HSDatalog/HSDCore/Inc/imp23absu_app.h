@@ -49,7 +49,7 @@ extern SM_Init_Param_t IMP23ABSU_Init_Param;
 /* Exported functions ------------------------------------------------------- */
 void IMP23ABSU_Peripheral_Init(void);
 void IMP23ABSU_OS_Init(void);
-void IMP23ABSU_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void IMP23ABSU_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void IMP23ABSU_Set_ODR(float newODR);
 void IMP23ABSU_Set_FS(float newFS1, float newFS2);
 void IMP23ABSU_Start(void);
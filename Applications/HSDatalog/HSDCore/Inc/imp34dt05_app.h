@@ -68,7 +68,7 @@ extern SM_Init_Param_t IMP34DT05_Init_Param;
 /* Exported functions ------------------------------------------------------- */
 void IMP34DT05_Peripheral_Init(void);
 void IMP34DT05_OS_Init(void);
-void IMP34DT05_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void IMP34DT05_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void IMP34DT05_Set_ODR(float newODR);
 void IMP34DT05_Set_FS(float newFS1, float newFS2);
 void IMP34DT05_Start(void);
@@ -42,6 +42,7 @@ extern "C"
 #endif /* ISM330DHCX_MAX_WTM_LEVEL */
 
 #define ISM330DHCX_MIN_WTM_LEVEL             (16)     /* samples */
+#define ISM330DHCX_FIFO_DEPTH                (512)    /* words, watermark register range */
 #define ISM330DHCX_MAX_SAMPLES_PER_IT        (ISM330DHCX_MAX_WTM_LEVEL)
 
 #define ISM330DHCX_SPI_CS_Pin                GPIO_PIN_13
@@ -70,7 +71,7 @@ extern sensor_handle_t ism330dhcx_hdl_instance;
 /* Exported functions ------------------------------------------------------- */
 void ISM330DHCX_Peripheral_Init(void);
 void ISM330DHCX_OS_Init(void);
-void ISM330DHCX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void ISM330DHCX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void ISM330DHCX_Set_ODR(float newODR);
 void ISM330DHCX_Set_FS(float newFS1, float newFS2);
 void ISM330DHCX_Start(void);
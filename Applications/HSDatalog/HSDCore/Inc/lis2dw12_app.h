@@ -52,17 +52,19 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId LIS2DW12_Thread_Id;
 extern SM_Init_Param_t LIS2DW12_Init_Param;
 extern EXTI_HandleTypeDef lis2dw12_exti;
 
 /* Exported functions ------------------------------------------------------- */
 void LIS2DW12_Peripheral_Init(void);
 void LIS2DW12_OS_Init(void);
-void LIS2DW12_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void LIS2DW12_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void LIS2DW12_Set_ODR(float newODR);
 void LIS2DW12_Set_FS(float newFS1, float newFS2);
 void LIS2DW12_Start(void);
 void LIS2DW12_Stop(void);
+SM_Sensor_State_t LIS2DW12_Get_State(void);
 uint8_t LIS2DW12_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t LIS2DW12_Get_Id(void);
 
@@ -44,16 +44,18 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId LIS2MDL_Thread_Id;
 extern SM_Init_Param_t LIS2MDL_Init_Param;
 
 /* Exported functions ------------------------------------------------------- */
 void LIS2MDL_Peripheral_Init(void);
 void LIS2MDL_OS_Init(void);
-void LIS2MDL_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void LIS2MDL_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void LIS2MDL_Set_ODR(float newODR);
 void LIS2MDL_Set_FS(float newFS1, float newFS2);
 void LIS2MDL_Start(void);
 void LIS2MDL_Stop(void);
+SM_Sensor_State_t LIS2MDL_Get_State(void);
 uint8_t LIS2MDL_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t LIS2MDL_Get_Id(void);
 
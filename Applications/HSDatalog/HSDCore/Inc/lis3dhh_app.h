@@ -52,17 +52,19 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId LIS3DHH_Thread_Id;
 extern SM_Init_Param_t LIS3DHH_Init_Param;
 extern EXTI_HandleTypeDef lis3dhh_exti;
 
 /* Exported functions ------------------------------------------------------- */
 void LIS3DHH_Peripheral_Init(void);
 void LIS3DHH_OS_Init(void);
-void LIS3DHH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void LIS3DHH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void LIS3DHH_Set_ODR(float newODR);
 void LIS3DHH_Set_FS(float newFS1, float newFS2);
 void LIS3DHH_Start(void);
 void LIS3DHH_Stop(void);
+SM_Sensor_State_t LIS3DHH_Get_State(void);
 uint8_t LIS3DHH_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t LIS3DHH_Get_Id(void);
 
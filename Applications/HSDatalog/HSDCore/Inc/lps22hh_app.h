@@ -40,15 +40,17 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId LPS22HH_Thread_Id;
 extern SM_Init_Param_t LPS22HH_Init_Param;
 extern EXTI_HandleTypeDef lps22hh_exti;
 
 /* Exported functions ------------------------------------------------------- */
 void LPS22HH_Peripheral_Init(void);
 void LPS22HH_OS_Init(void);
-void LPS22HH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void LPS22HH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void LPS22HH_Start(void);
 void LPS22HH_Stop(void);
+SM_Sensor_State_t LPS22HH_Get_State(void);
 uint8_t LPS22HH_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t LPS22HH_Get_Id(void);
 
@@ -39,6 +39,7 @@ extern "C"
 #endif /*LSM6DSOX_MAX_WTM_LEVEL */
 
 #define LSM6DSOX_MIN_WTM_LEVEL             (16)     /* samples */
+#define LSM6DSOX_FIFO_DEPTH                (512)    /* words, watermark register range */
 #define LSM6DSOX_MAX_SAMPLES_PER_IT        (LSM6DSOX_MAX_WTM_LEVEL)
 
 #define LSM6DSOX_SPI_CS_Pin                GPIO_PIN_12
@@ -65,6 +66,7 @@ extern "C"
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId LSM6DSOX_Thread_Id;
 extern EXTI_HandleTypeDef lsm6dsox_exti;
 extern EXTI_HandleTypeDef mlc_exti;
 extern SM_Init_Param_t LSM6DSOX_Init_Param;
@@ -73,11 +75,15 @@ extern sensor_handle_t lsm6dsox_hdl_instance;
 /* Exported functions ------------------------------------------------------- */
 void LSM6DSOX_Peripheral_Init(void);
 void LSM6DSOX_OS_Init(void);
-void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
+uint8_t LSM6DSOX_Data_Begin(uint8_t subSensorId, uint16_t nSamples, HSD_TimeStamp_t timeStamp);
+uint8_t *LSM6DSOX_Data_Reserve(uint8_t subSensorId, uint16_t *nSamples);
+void LSM6DSOX_Data_Commit(uint8_t subSensorId, uint16_t nSamples);
 void LSM6DSOX_Set_ODR(float newODR);
 void LSM6DSOX_Set_FS(float newFS1, float newFS2);
 void LSM6DSOX_Start(void);
 void LSM6DSOX_Stop(void);
+SM_Sensor_State_t LSM6DSOX_Get_State(void);
 uint8_t LSM6DSOX_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t LSM6DSOX_Get_Id(void);
 
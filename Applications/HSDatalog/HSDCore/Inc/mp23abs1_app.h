@@ -40,17 +40,19 @@ extern "C" {
 
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId MP23ABS1_Thread_Id;
 extern DMA_HandleTypeDef hdma_dfsdm1_flt1;
 extern SM_Init_Param_t MP23ABS1_Init_Param;
 
 /* Exported functions ------------------------------------------------------- */
 void MP23ABS1_Peripheral_Init(void);
 void MP23ABS1_OS_Init(void);
-void MP23ABS1_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void MP23ABS1_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void MP23ABS1_Set_ODR(float newODR);
 void MP23ABS1_Set_FS(float newFS1, float newFS2);
 void MP23ABS1_Start(void);
 void MP23ABS1_Stop(void);
+SM_Sensor_State_t MP23ABS1_Get_State(void);
 uint8_t MP23ABS1_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t MP23ABS1_Get_Id(void);
 
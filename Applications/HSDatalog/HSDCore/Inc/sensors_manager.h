@@ -26,6 +26,32 @@ extern "C" {
 
 #include "stm32l4xx_hal.h"
 #include "cmsis_os.h"
+#include "HSDCoreConfig.h"
+
+/* Timestamp of sensor data, see HSD_TIMESTAMP_TICKS */
+#if (HSD_TIMESTAMP_TICKS == 1)
+#define SM_GetSensorTimeStamp()           SM_GetTicks()
+#define SM_GetSensorTimeStamp_fromISR()   SM_GetTicks_fromISR()
+#define SM_SENSOR_TIMESTAMP_FREQ          ((double) SystemCoreClock)
+#else
+#define SM_GetSensorTimeStamp()           SM_GetTimeStamp()
+#define SM_GetSensorTimeStamp_fromISR()   SM_GetTimeStamp_fromISR()
+#define SM_SENSOR_TIMESTAMP_FREQ          (1.0)
+#endif /* HSD_TIMESTAMP_TICKS */
+
+/* Bus clocks set in SM_SPIx_Init / SM_I2Cx_Init */
+#define SM_SPI_BITRATE                    (SystemCoreClock / 16U)  /* SPI_BAUDRATEPRESCALER_16 */
+#define SM_I2C_BITRATE                    (400000U)
+
+/* Convert a (short) interval measured with SM_GetTicks() into us */
+#define SM_TICKS_TO_US(ticks)             ((uint32_t)(ticks) / (SystemCoreClock / 1000000U))
+
+/* Direct to task notification bits of the sensor threads, see SM_Notify and SM_Wait */
+#define SM_NOTIFY_DATA_READY              (0x00000001U)  /* data ready or FIFO interrupt of the sensor */
+#define SM_NOTIFY_READ_CPLT               (0x00000002U)  /* end of a bus transaction requested by the thread */
+#define SM_NOTIFY_STATE_CHANGE            (0x00000004U)  /* new SM_Sensor_State_t set for the thread */
+#define SM_NOTIFY_BUS_ERROR               (0x00000008U)  /* with SM_NOTIFY_READ_CPLT: the transaction failed */
+#define SM_NOTIFY_APP                     (0x00000100U)  /* first bit free for the sensor apps */
 
 typedef enum
 {
@@ -60,24 +86,39 @@ extern DMA_HandleTypeDef hdma_i2c3_tx;
 
 extern TIM_HandleTypeDef htim5;
 
+/* Notifications of a sensor thread */
 typedef struct
 {
-  uint8_t WhoAmI;
-  uint8_t I2C_address;
-  GPIO_TypeDef *GPIOx;
-  uint16_t GPIO_Pin;
-  osSemaphoreId *sem;
-} sensor_handle_t;
+  osThreadId *thread;
+  uint32_t pending;          /* bits received by the thread and not returned yet by SM_Wait */
+  volatile uint32_t irqTime; /* SM_GetTicks() of the last SM_NOTIFY_DATA_READY, truncated to 32 bits */
+} SM_Notifier_t;
 
-typedef struct
+typedef struct SM_Message_s
 {
-  sensor_handle_t *sensorHandler;
+  struct sensor_handle_s *sensorHandler;
   uint8_t isRead;
   uint8_t *dataPtr;
   uint8_t regAddr;
   uint16_t readSize;
+  uint32_t requestTime; /* SM_GetTicks(), truncated to 32 bits */
+  uint32_t deadline;    /* requestTime + slack of the sensor */
+  osThreadId requester; /* notified with SM_NOTIFY_READ_CPLT at the end of the transaction */
+  struct SM_Message_s *next; /* link in the request lists of the bus */
 } SM_Message_t;
 
+typedef struct sensor_handle_s
+{
+  uint8_t WhoAmI;
+  uint8_t I2C_address;
+  GPIO_TypeDef *GPIOx;
+  uint16_t GPIO_Pin;
+  SM_Notifier_t *notifier;
+  uint32_t slackUs;     /* time its requests can wait for the bus [us], 0: SM_BUS_DEFAULT_SLACK_US */
+  SM_Message_t slot;    /* transaction reserved to the sensor, see HSD_BUS_OVERFLOW_SLOTS */
+  volatile uint8_t slotBusy;
+} sensor_handle_t;
+
 /**SPI1 GPIO Configuration
  PE13     ------> SPI1_SCK
  PE14     ------> SPI1_MISO
@@ -167,6 +208,12 @@ void SM_TIM_Start(void);
 void SM_TIM_Stop(void);
 double SM_GetTimeStamp(void);
 double SM_GetTimeStamp_fromISR(void);
+uint64_t SM_GetTicks(void);
+uint64_t SM_GetTicks_fromISR(void);
+
+void SM_Notify(SM_Notifier_t *pNotifier, uint32_t bits);
+void SM_Notify_fromISR(SM_Notifier_t *pNotifier, uint32_t bits);
+uint32_t SM_Wait(SM_Notifier_t *pNotifier, uint32_t bits);
 
 int32_t SM_SPI1_Read(void *handle, uint8_t reg, uint8_t *data, uint16_t len);
 int32_t SM_SPI1_Write(void *handle, uint8_t reg, uint8_t *data, uint16_t len);
@@ -191,6 +238,9 @@ int32_t SM_I2C3_Write_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 uint8_t SM_StopSensorAcquisition(void);
 uint8_t SM_StartSensorThread(uint8_t sensorId);
 uint8_t SM_StopSensorThread(uint8_t sensorId);
+uint8_t SM_WaitSensorAcquisitionStopped(uint32_t timeout);
+SM_Sensor_State_t SM_GetSensorThreadState(uint8_t sensorId);
+int32_t SM_GetSensorStackFree(uint8_t sensorId);
 
 #ifdef __cplusplus
 }
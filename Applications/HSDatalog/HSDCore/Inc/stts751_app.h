@@ -33,14 +33,16 @@ extern "C" {
 /* Exported constants --------------------------------------------------------*/
 /* Exported macro ------------------------------------------------------------*/
 /* Exported variables --------------------------------------------------------*/
+extern osThreadId STTS751_Thread_Id;
 extern SM_Init_Param_t STTS751_Init_Param;
 
 /* Exported functions ------------------------------------------------------- */
 void STTS751_Peripheral_Init(void);
 void STTS751_OS_Init(void);
-void STTS751_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp);
+void STTS751_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp);
 void STTS751_Start(void);
 void STTS751_Stop(void);
+SM_Sensor_State_t STTS751_Get_State(void);
 uint8_t STTS751_Create_Sensor(const SM_Init_Param_t *pxParams);
 uint8_t STTS751_Get_Id(void);
 
@@ -0,0 +1,211 @@
+/**
+  ******************************************************************************
+  * @file    HSD_clockfit.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Online linear fit between a counter (sensor clock, sample count)
+  *          and the timebase of the data stream.
+  *          y = y0 + my + slope * (x - x0 - mx): means and covariance are
+  *          updated with centered values, and the origin (x0, y0) follows the
+  *          means, so the fit runs in float without double arithmetic per pair
+  *          (software emulated on Cortex-M4) and stays accurate over long
+  *          acquisitions. The first 2^HSD_CLOCKFIT_SHIFT pairs have the same
+  *          weight (least squares), then the weight of older pairs decays
+  *          exponentially to follow the drift of the clocks.
+  *          Pairs far from the fit (e.g. IRQs served late) are skipped; the fit
+  *          restarts when they keep coming (e.g. samples lost, counter reset).
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_clockfit.h"
+#include "string.h"
+#include "math.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static void HSD_CLOCKFIT_Recenter(HSD_ClockFit_t *pFit);
+#if (HSD_TIMESTAMP_TICKS == 1)
+static HSD_TimeStamp_t HSD_CLOCKFIT_Offset(const HSD_ClockFit_t *pFit, int64_t dy);
+#endif /* HSD_TIMESTAMP_TICKS */
+
+/**
+  * @brief  Reset the fit and its statistics
+  * @param  pFit: fit
+  * @param  nominalSlope: expected timebase units per count
+  * @retval None
+  */
+void HSD_CLOCKFIT_Init(HSD_ClockFit_t *pFit, double nominalSlope)
+{
+  HSD_memset(pFit, 0, sizeof(HSD_ClockFit_t));
+  pFit->nominalSlope = (float) nominalSlope;
+  pFit->slope = (float) nominalSlope;
+}
+
+/**
+  * @brief  Add a pair (count, timebase) to the fit
+  * @param  pFit: fit
+  * @param  x: count
+  * @param  y: timebase
+  * @retval 0 if the pair is used, 1 if it is skipped as an outlier
+  */
+uint8_t HSD_CLOCKFIT_Add(HSD_ClockFit_t *pFit, uint64_t x, HSD_TimeStamp_t y)
+{
+  float dx;
+  float dy;
+  float residual;
+  float alpha;
+
+  if (pFit->nPairs == 0U)
+  {
+    pFit->x0 = x;
+    pFit->y0 = y;
+    pFit->mx = 0.0f;
+    pFit->my = 0.0f;
+    pFit->cxx = 0.0f;
+    pFit->cxy = 0.0f;
+    pFit->slope = pFit->nominalSlope;
+    pFit->meanResidual = 0.0f;
+    pFit->nOutliers = 0;
+    pFit->nPairs = 1;
+    return 0;
+  }
+
+  dx = (float)(int64_t)(x - pFit->x0);
+#if (HSD_TIMESTAMP_TICKS == 1)
+  dy = (float)(int64_t)(y - pFit->y0);
+#else
+  dy = (float)(y - pFit->y0);
+#endif /* HSD_TIMESTAMP_TICKS */
+  residual = dy - (pFit->my + pFit->slope * (dx - pFit->mx));
+
+  if (HSD_CLOCKFIT_Is_Locked(pFit))
+  {
+    if (fabsf(residual) > pFit->maxResidual)
+    {
+      pFit->maxResidual = fabsf(residual);
+    }
+    if (fabsf(residual) > HSD_CLOCKFIT_OUTLIER_GAIN * (pFit->meanResidual + fabsf(pFit->nominalSlope)))
+    {
+      pFit->nOutliersTotal++;
+      if (++pFit->nOutliers >= HSD_CLOCKFIT_MAX_OUTLIERS)
+      {
+        pFit->nPairs = 0;
+        (void) HSD_CLOCKFIT_Add(pFit, x, y);
+      }
+      return 1;
+    }
+  }
+  pFit->nOutliers = 0;
+
+  pFit->nPairs++;
+  alpha = (pFit->nPairs < (1UL << HSD_CLOCKFIT_SHIFT)) ? 1.0f / (float) pFit->nPairs
+          : 1.0f / (float)(1UL << HSD_CLOCKFIT_SHIFT);
+  dx -= pFit->mx;
+  dy -= pFit->my;
+  pFit->mx += alpha * dx;
+  pFit->my += alpha * dy;
+  pFit->cxx = (1.0f - alpha) * (pFit->cxx + alpha * dx * dx);
+  pFit->cxy = (1.0f - alpha) * (pFit->cxy + alpha * dx * dy);
+  pFit->meanResidual += alpha * (fabsf(residual) - pFit->meanResidual);
+  HSD_CLOCKFIT_Recenter(pFit);
+
+  if (HSD_CLOCKFIT_Is_Locked(pFit))
+  {
+    if (pFit->cxx > 0.0f)
+    {
+      pFit->slope = pFit->cxy / pFit->cxx;
+    }
+    pFit->meanSquareResidual += alpha * (residual * residual - pFit->meanSquareResidual);
+  }
+  return 0;
+}
+
+/**
+  * @brief  Map a count to the timebase. Counts close to the origin of the fit, as the
+  *         latest samples, are mapped in float; the others (e.g. the initial offset) in double.
+  * @param  pFit: fit, with at least one pair
+  * @param  x: count
+  * @retval timebase
+  */
+HSD_TimeStamp_t HSD_CLOCKFIT_Map(const HSD_ClockFit_t *pFit, uint64_t x)
+{
+  int64_t dx = (int64_t)(x - pFit->x0);
+  double y;
+
+  if (dx > -HSD_CLOCKFIT_FLOAT_SPAN && dx < HSD_CLOCKFIT_FLOAT_SPAN)
+  {
+#if (HSD_TIMESTAMP_TICKS == 1)
+    return HSD_CLOCKFIT_Offset(pFit, llroundf(pFit->my + pFit->slope * ((float) dx - pFit->mx)));
+#else
+    return pFit->y0 + (pFit->my + pFit->slope * ((float) dx - pFit->mx));
+#endif /* HSD_TIMESTAMP_TICKS */
+  }
+
+  y = (double) pFit->my + (double) pFit->slope * ((double) dx - (double) pFit->mx);
+#if (HSD_TIMESTAMP_TICKS == 1)
+  return HSD_CLOCKFIT_Offset(pFit, llround(y));
+#else
+  return pFit->y0 + y;
+#endif /* HSD_TIMESTAMP_TICKS */
+}
+
+/**
+  * @brief  Check if the slope comes from the fit
+  * @param  pFit: fit
+  * @retval 1 if the fit has at least HSD_CLOCKFIT_MIN_PAIRS pairs, 0 otherwise
+  */
+uint8_t HSD_CLOCKFIT_Is_Locked(const HSD_ClockFit_t *pFit)
+{
+  return (pFit->nPairs >= HSD_CLOCKFIT_MIN_PAIRS) ? 1U : 0U;
+}
+
+/**
+  * @brief  Move the origin of the fit to the weighted means, so that the deviations of the next
+  *         pairs stay small in float. Means and covariance do not depend on the origin.
+  * @param  pFit: fit
+  * @retval None
+  */
+static void HSD_CLOCKFIT_Recenter(HSD_ClockFit_t *pFit)
+{
+  int64_t shift = llroundf(pFit->mx);
+
+  pFit->x0 += (uint64_t) shift;
+  pFit->mx -= (float) shift;
+#if (HSD_TIMESTAMP_TICKS == 1)
+  shift = llroundf(pFit->my);
+  pFit->y0 += (uint64_t) shift;
+  pFit->my -= (float) shift;
+#else
+  pFit->y0 += pFit->my;
+  pFit->my = 0.0f;
+#endif /* HSD_TIMESTAMP_TICKS */
+}
+
+#if (HSD_TIMESTAMP_TICKS == 1)
+/**
+  * @brief  Add an offset to the origin of the fit, without going before the start of the timebase
+  * @param  pFit: fit
+  * @param  dy: offset in ticks
+  * @retval timebase
+  */
+static HSD_TimeStamp_t HSD_CLOCKFIT_Offset(const HSD_ClockFit_t *pFit, int64_t dy)
+{
+  if (dy < 0 && (uint64_t)(-dy) > pFit->y0)
+  {
+    return 0;
+  }
+  return pFit->y0 + (uint64_t) dy;
+}
+#endif /* HSD_TIMESTAMP_TICKS */
@@ -0,0 +1,230 @@
+/**
+  ******************************************************************************
+  * @file    HSD_codec.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Lossless codec for int16 sensor streams: fixed linear prediction
+  *          and Rice coding, with predictor and parameter chosen for each block
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_codec.h"
+#include "HSDCoreConfig.h"
+#include "string.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t *p;
+  uint32_t acc;
+  uint32_t n;
+} HSD_BitWriter_t;
+
+/* Private function prototypes -----------------------------------------------*/
+static inline void HSD_Codec_Put(HSD_BitWriter_t *bw, uint32_t value, uint32_t nBits);
+static uint32_t HSD_Codec_Predictor(const int16_t *x, uint32_t nFrames, uint32_t stride, uint32_t *k);
+static void HSD_Codec_Encode_Channel(HSD_BitWriter_t *bw, const int16_t *x, uint32_t nFrames, uint32_t stride,
+                                     uint32_t order, uint32_t k);
+
+/**
+  * @brief  Encode a block of interleaved int16 frames
+  * @param  src: nFrames * nChannels samples
+  * @param  nFrames: number of frames, up to HSD_CODEC_MAX_FRAMES
+  * @param  nChannels: number of samples in each frame
+  * @param  dst: output buffer, at least HSD_CODEC_OUT_SIZE(nFrames, nChannels) bytes
+  * @retval size of the encoded block
+  */
+uint32_t HSD_Codec_Encode(const int16_t *src, uint32_t nFrames, uint32_t nChannels, uint8_t *dst)
+{
+  uint32_t rawSize = 2U * nFrames * nChannels;
+  uint8_t *pParam = &dst[HSD_CODEC_HEADER_SIZE];
+  uint32_t size = 0;
+  uint32_t ch;
+  uint32_t order;
+  uint32_t k;
+  HSD_BitWriter_t bw;
+
+  bw.p = pParam + nChannels;
+  bw.acc = 0;
+  bw.n = 0;
+
+  for (ch = 0; ch < nChannels; ch++)
+  {
+    order = HSD_Codec_Predictor(&src[ch], nFrames, nChannels, &k);
+    pParam[ch] = (uint8_t)(k | (order << 5));
+    HSD_Codec_Encode_Channel(&bw, &src[ch], nFrames, nChannels, order, k);
+    if ((uint32_t)(bw.p - pParam) >= rawSize)
+    {
+      break;
+    }
+  }
+  if (bw.n != 0)
+  {
+    *bw.p++ = (uint8_t) bw.acc;
+  }
+  size = (uint32_t)(bw.p - pParam);
+
+  /* incompressible block (e.g. white noise): store it as it is */
+  if (size >= rawSize)
+  {
+    HSD_memcpy(pParam, src, rawSize);
+    size = rawSize | HSD_CODEC_RAW_FLAG;
+  }
+
+  dst[0] = (uint8_t) nFrames;
+  dst[1] = (uint8_t)(nFrames >> 8);
+  dst[2] = (uint8_t) size;
+  dst[3] = (uint8_t)(size >> 8);
+  return HSD_CODEC_HEADER_SIZE + (size & ~HSD_CODEC_RAW_FLAG);
+}
+
+/**
+  * @brief  Append bits to the output stream
+  * @param  bw: bit writer
+  * @param  value: bits to be written, already masked
+  * @param  nBits: number of bits, up to 24
+  * @retval None
+  */
+static inline void HSD_Codec_Put(HSD_BitWriter_t *bw, uint32_t value, uint32_t nBits)
+{
+  bw->acc |= value << bw->n;
+  bw->n += nBits;
+  while (bw->n >= 8U)
+  {
+    *bw->p++ = (uint8_t) bw->acc;
+    bw->acc >>= 8;
+    bw->n -= 8U;
+  }
+}
+
+/**
+  * @brief  Choose the predictor with the smallest residuals and the matching Rice parameter
+  * @param  x: first sample of the channel
+  * @param  nFrames: number of samples of the channel
+  * @param  stride: distance between two samples of the channel
+  * @param  k: [out] Rice parameter
+  * @retval predictor order
+  */
+static uint32_t HSD_Codec_Predictor(const int16_t *x, uint32_t nFrames, uint32_t stride, uint32_t *k)
+{
+  uint32_t sum0 = 0;
+  uint32_t sum1 = 0;
+  uint32_t sum2 = 0;
+  uint32_t sum;
+  uint32_t order;
+  uint32_t count;
+  uint32_t i;
+  int32_t x1;
+  int32_t x2;
+  int32_t v;
+  int32_t e;
+
+  if (nFrames < 3U)
+  {
+    *k = HSD_CODEC_MAX_K;
+    return 0;
+  }
+
+  x2 = x[0];
+  x1 = x[stride];
+  for (i = 2; i < nFrames; i++)
+  {
+    v = x[i * stride];
+    sum0 += (uint32_t)((v < 0) ? -v : v);
+    e = v - x1;
+    sum1 += (uint32_t)((e < 0) ? -e : e);
+    e -= x1 - x2;
+    sum2 += (uint32_t)((e < 0) ? -e : e);
+    x2 = x1;
+    x1 = v;
+  }
+
+  order = 0;
+  sum = sum0;
+  if (sum1 < sum)
+  {
+    order = 1;
+    sum = sum1;
+  }
+  if (sum2 < sum)
+  {
+    order = 2;
+    sum = sum2;
+  }
+
+  /* the mean of the zigzag residuals is about 2^(k+1): k = floor(log2(mean |e|)) */
+  count = nFrames - 2U;
+  *k = 0;
+  while (*k < HSD_CODEC_MAX_K && (count << (*k + 1U)) <= sum)
+  {
+    (*k)++;
+  }
+  return order;
+}
+
+/**
+  * @brief  Write the warm-up samples and the Rice coded residuals of a channel
+  * @param  bw: bit writer
+  * @param  x: first sample of the channel
+  * @param  nFrames: number of samples of the channel
+  * @param  stride: distance between two samples of the channel
+  * @param  order: predictor order
+  * @param  k: Rice parameter
+  * @retval None
+  */
+static void HSD_Codec_Encode_Channel(HSD_BitWriter_t *bw, const int16_t *x, uint32_t nFrames, uint32_t stride,
+                                     uint32_t order, uint32_t k)
+{
+  /* prediction is a1 * x[n-1] + a2 * x[n-2] */
+  int32_t a1 = (int32_t) order;
+  int32_t a2 = (order == 2U) ? -1 : 0;
+  int32_t x1 = 0;
+  int32_t x2 = 0;
+  int32_t v;
+  int32_t e;
+  uint32_t mask = (1U << k) - 1U;
+  uint32_t u;
+  uint32_t q;
+  uint32_t i;
+
+  for (i = 0; i < order && i < nFrames; i++)
+  {
+    x2 = x1;
+    x1 = x[i * stride];
+    HSD_Codec_Put(bw, (uint16_t) x1, 16);
+  }
+
+  for (; i < nFrames; i++)
+  {
+    v = x[i * stride];
+    e = v - (a1 * x1 + a2 * x2);
+    x2 = x1;
+    x1 = v;
+
+    u = ((uint32_t) e << 1) ^ (uint32_t)(e >> 31);
+    q = u >> k;
+    if (q < HSD_CODEC_ESCAPE)
+    {
+      HSD_Codec_Put(bw, (1U << q) - 1U, q + 1U);
+      HSD_Codec_Put(bw, u & mask, k);
+    }
+    else
+    {
+      HSD_Codec_Put(bw, (1U << HSD_CODEC_ESCAPE) - 1U, HSD_CODEC_ESCAPE);
+      HSD_Codec_Put(bw, u, HSD_CODEC_ESCAPE_BITS);
+    }
+  }
+}
@@ -0,0 +1,119 @@
+/**
+  ******************************************************************************
+  * @file    HSD_dcfilter.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   DC removal filter of microphone PCM blocks:
+  *          y[n] = sat16((a * (x[n] - x[n-1] + y[n-1])) >> 14)
+  *          Samples come already scaled to 16 bit by the DFSDM right bit shift and are
+  *          filtered in place. On cores with the DSP extension two samples are processed
+  *          per iteration with dual 16-bit MACs; the C version gives the same output.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_dcfilter.h"
+
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1)
+#include "stm32l4xx.h"
+#define HSD_DCFILTER_SIMD         1
+#else
+#define HSD_DCFILTER_SIMD         0
+#endif /* __ARM_FEATURE_DSP */
+
+/* Private function prototypes -----------------------------------------------*/
+static inline int32_t HSD_DCFILTER_Sample(HSD_DCFilter_t *pFilter, int32_t in);
+
+/**
+  * @brief  Clear the filter history, to be called when an acquisition starts
+  * @param  pFilter: filter state
+  * @retval None
+  */
+void HSD_DCFILTER_Reset(HSD_DCFilter_t *pFilter)
+{
+  pFilter->lastIn = 0;
+  pFilter->lastOut = 0;
+}
+
+/**
+  * @brief  Filter in place a block of 16-bit PCM samples
+  * @param  pFilter: filter state, carried over from the previous block
+  * @param  buf: samples
+  * @param  nSamples: number of samples
+  * @retval None
+  */
+void HSD_DCFILTER_Process(HSD_DCFilter_t *pFilter, int16_t *buf, uint32_t nSamples)
+{
+#if (HSD_DCFILTER_SIMD == 1)
+  const uint32_t coeff = ((uint32_t) HSD_DCFILTER_COEFF << 16) | (uint32_t) HSD_DCFILTER_COEFF;
+  uint32_t *pPair;
+  uint32_t in;
+  uint32_t prev;
+  int32_t lastOut;
+  int32_t out0;
+  int32_t out1;
+
+  /* Pairs are read as words */
+  if ((((uintptr_t) buf) & 0x3U) != 0U && nSamples > 0U)
+  {
+    *buf = (int16_t) HSD_DCFILTER_Sample(pFilter, *buf);
+    buf++;
+    nSamples--;
+  }
+
+  pPair = (uint32_t *) buf;
+  prev = (uint32_t) pFilter->lastIn << 16;
+  lastOut = pFilter->lastOut;
+
+  for (; nSamples >= 2U; nSamples -= 2U)
+  {
+    in = *pPair;
+    /* a * x0 - a * x[-1] + a * y[-1] */
+    out0 = __SSAT(((int32_t) __SMLSD(coeff, __PKHBT(in, prev, 0), (uint32_t)(HSD_DCFILTER_COEFF * lastOut)))
+                  >> HSD_DCFILTER_SHIFT, 16);
+    /* a * x1 - a * x0 + a * y0 */
+    out1 = __SSAT(((int32_t) __SMLSDX(coeff, in, (uint32_t)(HSD_DCFILTER_COEFF * out0))) >> HSD_DCFILTER_SHIFT, 16);
+    *pPair++ = __PKHBT((uint32_t) out0, (uint32_t) out1, 16);
+    prev = in;
+    lastOut = out1;
+  }
+
+  buf = (int16_t *) pPair;
+  pFilter->lastIn = (int16_t)(prev >> 16);
+  pFilter->lastOut = lastOut;
+#endif /* HSD_DCFILTER_SIMD */
+
+  for (; nSamples > 0U; nSamples--)
+  {
+    *buf = (int16_t) HSD_DCFILTER_Sample(pFilter, *buf);
+    buf++;
+  }
+}
+
+/**
+  * @brief  Filter one sample
+  * @param  pFilter: filter state
+  * @param  in: input sample
+  * @retval output sample, saturated to 16 bit
+  */
+static inline int32_t HSD_DCFILTER_Sample(HSD_DCFilter_t *pFilter, int32_t in)
+{
+  int32_t out = (HSD_DCFILTER_COEFF * (in - pFilter->lastIn + pFilter->lastOut)) >> HSD_DCFILTER_SHIFT;
+
+  out = HSD_MAX(HSD_MIN(out, INT16_MAX), INT16_MIN);
+  pFilter->lastIn = in;
+  pFilter->lastOut = out;
+  return out;
+}
@@ -0,0 +1,330 @@
+/**
+  ******************************************************************************
+  * @file    HSD_decimator.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Polyphase FIR decimator of subsensor data. A Blackman-windowed sinc
+  *          low-pass filter of decimation x taps-per-phase taps is evaluated only
+  *          at the output instants, i.e. nTaps / decimation MACs per input sample.
+  *          Data are decimated in place, in the data type of the subsensor.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCore.h"
+#include "HSD_decimator.h"
+#include "com_manager.h"
+#include "sensors_manager.h"
+#include "string.h"
+#include "math.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t factor;
+  uint32_t nTaps;
+  uint32_t nChannels;
+  uint8_t quality;
+  uint32_t phase;   /* inputs since the last output */
+  uint32_t idx;     /* write position in the delay lines */
+  float *taps;      /* nTaps, symmetric */
+  float *delay;     /* nChannels lines of 2 x nTaps: each input is written twice, so the
+                     * latest nTaps inputs are always contiguous from idx */
+} HSD_DECIM_State_t;
+
+/* Private define ------------------------------------------------------------*/
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Private variables ---------------------------------------------------------*/
+static HSD_DECIM_State_t *s_pxState[COM_MAX_SENSORS][N_MAX_SENSOR_COMBO];
+
+static const uint32_t s_nTapsPerPhase[] = {8U, 16U, 32U};
+
+/* Private function prototypes -----------------------------------------------*/
+static HSD_DECIM_State_t *HSD_DECIM_Init(uint8_t sensorId, uint8_t subSensorId);
+static void HSD_DECIM_Free(uint8_t sensorId, uint8_t subSensorId);
+static void HSD_DECIM_Design(float *taps, uint32_t nTaps, uint32_t factor);
+static inline float HSD_DECIM_Read(const uint8_t *buf, uint8_t dataType);
+static inline void HSD_DECIM_Write(uint8_t *buf, uint8_t dataType, float value);
+
+/**
+  * @brief  Decimate in place a batch of a subsensor with decimation > 1 in its status.
+  *         The filter is set up on the first batch of each acquisition.
+  * @param  sensorId: sensor id
+  * @param  subSensorId: subsensor id
+  * @param  buf: batch of samples, replaced by the decimated samples
+  * @param  size: [in] batch size, [out] size of the decimated batch [bytes]
+  * @param  timeStamp: [in] time of the latest input sample, [out] time of the latest output sample,
+  *         filter delay included
+  * @retval 0: ok, 1: decimator not available (data are not modified)
+  */
+uint8_t HSD_DECIM_Process(uint8_t sensorId, uint8_t subSensorId, uint8_t *buf, uint16_t *size,
+                          HSD_TimeStamp_t *timeStamp)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
+  uint8_t dataType = COM_GetSubSensorDescriptor(sensorId, subSensorId)->dataType;
+  uint32_t nBytesPerSample = COM_GetnBytesPerSample(sensorId, subSensorId);
+  HSD_DECIM_State_t *pState = s_pxState[sensorId][subSensorId];
+  uint32_t nBytesPerValue;
+  uint32_t nSamples;
+  uint32_t nOut = 0;
+  uint32_t i;
+  uint32_t k;
+  uint32_t ch;
+  uint32_t lastOut = 0;
+  float *line;
+  float acc;
+  float delay;
+
+  if (pSubSensorStatus->decimation < 2U || nBytesPerSample == 0)
+  {
+    return 1;
+  }
+
+  if (pState == NULL || COM_GetSubSensorContext(sensorId, subSensorId)->first_dataReady
+      || pState->factor != pSubSensorStatus->decimation || pState->quality != pSubSensorStatus->decimationQuality)
+  {
+    pState = HSD_DECIM_Init(sensorId, subSensorId);
+    if (pState == NULL)
+    {
+      return 1;
+    }
+  }
+
+  nBytesPerValue = nBytesPerSample / pState->nChannels;
+  nSamples = *size / nBytesPerSample;
+
+  for (i = 0; i < nSamples; i++)
+  {
+    for (ch = 0; ch < pState->nChannels; ch++)
+    {
+      line = &pState->delay[ch * 2U * pState->nTaps];
+      line[pState->idx] = line[pState->idx + pState->nTaps]
+                          = HSD_DECIM_Read(&buf[i * nBytesPerSample + ch * nBytesPerValue], dataType);
+    }
+    if (++pState->idx == pState->nTaps)
+    {
+      pState->idx = 0;
+    }
+
+    if (++pState->phase == pState->factor)
+    {
+      pState->phase = 0;
+      /* output sample nOut never overlaps input samples still to be read (nOut <= i) */
+      for (ch = 0; ch < pState->nChannels; ch++)
+      {
+        line = &pState->delay[ch * 2U * pState->nTaps + pState->idx];
+        acc = 0.0f;
+        for (k = 0; k < pState->nTaps; k++)
+        {
+          acc += pState->taps[k] * line[k];
+        }
+        HSD_DECIM_Write(&buf[nOut * nBytesPerSample + ch * nBytesPerValue], dataType, acc);
+      }
+      nOut++;
+      lastOut = i;
+    }
+  }
+
+  /* the latest output is the center of the filter window ending at input lastOut */
+  delay = (float)(nSamples - 1U - lastOut) + (float)(pState->nTaps - 1U) / 2.0f;
+  if (pSubSensorStatus->ODR > 0.0f)
+  {
+#if (HSD_TIMESTAMP_TICKS == 1)
+    *timeStamp -= (uint64_t)(delay * ((float) SystemCoreClock / pSubSensorStatus->ODR));
+#else
+    *timeStamp -= (double) delay / (double) pSubSensorStatus->ODR;
+#endif /* HSD_TIMESTAMP_TICKS */
+  }
+  *size = (uint16_t)(nOut * nBytesPerSample);
+
+  return 0;
+}
+
+/**
+  * @brief  Release the decimator of a subsensor
+  * @param  sensorId: sensor id
+  * @param  subSensorId: subsensor id
+  * @retval None
+  */
+static void HSD_DECIM_Free(uint8_t sensorId, uint8_t subSensorId)
+{
+  if (s_pxState[sensorId][subSensorId] != NULL)
+  {
+    HSD_free(s_pxState[sensorId][subSensorId]);
+    s_pxState[sensorId][subSensorId] = NULL;
+  }
+}
+
+/**
+  * @brief  Allocate and design the decimator of a subsensor from its status.
+  *         If it can't be allocated, decimation is turned off in the status.
+  * @param  sensorId: sensor id
+  * @param  subSensorId: subsensor id
+  * @retval decimator, NULL on error
+  */
+static HSD_DECIM_State_t *HSD_DECIM_Init(uint8_t sensorId, uint8_t subSensorId)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
+  uint32_t nChannels = COM_GetSubSensorDescriptor(sensorId, subSensorId)->dimensions;
+  HSD_DECIM_State_t *pState;
+  uint32_t factor;
+  uint32_t nTaps;
+  uint32_t size;
+
+  HSD_DECIM_Free(sensorId, subSensorId);
+
+  if (pSubSensorStatus->decimation > HSD_DECIM_MAX_FACTOR)
+  {
+    pSubSensorStatus->decimation = HSD_DECIM_MAX_FACTOR;
+  }
+  if (pSubSensorStatus->decimationQuality > HSD_DECIM_QUALITY_HIGH)
+  {
+    pSubSensorStatus->decimationQuality = HSD_DECIM_QUALITY_HIGH;
+  }
+  factor = pSubSensorStatus->decimation;
+  nTaps = HSD_MIN(factor * s_nTapsPerPhase[pSubSensorStatus->decimationQuality], HSD_DECIM_MAX_TAPS);
+
+  size = sizeof(HSD_DECIM_State_t) + (nTaps + nChannels * 2U * nTaps) * sizeof(float);
+  pState = HSD_malloc(size);
+  if (pState == NULL)
+  {
+    HSD_PRINTF("Mem alloc error [%ld]: %d@%s\r\n", size, __LINE__, __FILE__);
+    pSubSensorStatus->decimation = 1;
+    return NULL;
+  }
+
+  pState->factor = factor;
+  pState->nTaps = nTaps;
+  pState->nChannels = nChannels;
+  pState->quality = pSubSensorStatus->decimationQuality;
+  pState->phase = 0;
+  pState->idx = 0;
+  pState->taps = (float *) &pState[1];
+  pState->delay = &pState->taps[nTaps];
+  memset(pState->delay, 0, nChannels * 2U * nTaps * sizeof(float));
+  HSD_DECIM_Design(pState->taps, nTaps, factor);
+
+  s_pxState[sensorId][subSensorId] = pState;
+  return pState;
+}
+
+/**
+  * @brief  Blackman-windowed sinc low-pass with unity DC gain. The cutoff is set so that
+  *         the stopband (-74 dB) starts at the output Nyquist frequency.
+  * @param  taps: [out] filter taps
+  * @param  nTaps: number of taps
+  * @param  factor: decimation factor
+  * @retval None
+  */
+static void HSD_DECIM_Design(float *taps, uint32_t nTaps, uint32_t factor)
+{
+  double fc = (0.5 - 2.75 * (double) factor / (double) nTaps) / (double) factor; /* cycles/sample */
+  double center = ((double) nTaps - 1.0) / 2.0;
+  double sum = 0.0;
+  double t;
+  double w;
+  double h;
+  uint32_t n;
+
+  if (fc < 0.1 / (double) factor)
+  {
+    fc = 0.1 / (double) factor; /* very short filters (HSD_DECIM_MAX_TAPS reached) */
+  }
+
+  for (n = 0; n < nTaps; n++)
+  {
+    t = (double) n - center;
+    h = (t == 0.0) ? 2.0 * fc : sin(2.0 * M_PI * fc * t) / (M_PI * t);
+    w = 0.42 - 0.5 * cos(2.0 * M_PI * (double) n / (double)(nTaps - 1U))
+        + 0.08 * cos(4.0 * M_PI * (double) n / (double)(nTaps - 1U));
+    taps[n] = (float)(h * w);
+    sum += h * w;
+  }
+  for (n = 0; n < nTaps; n++)
+  {
+    taps[n] = (float)((double) taps[n] / sum);
+  }
+}
+
+/**
+  * @brief  Read one value of a sample
+  * @param  buf: pointer to the value
+  * @param  dataType: DATA_TYPE_xxx of the subsensor
+  * @retval value
+  */
+static inline float HSD_DECIM_Read(const uint8_t *buf, uint8_t dataType)
+{
+  switch (dataType)
+  {
+    case DATA_TYPE_INT16:
+      return (float) * (const int16_t *) buf;
+    case DATA_TYPE_FLOAT:
+      return * (const float *) buf;
+    case DATA_TYPE_UINT16:
+      return (float) * (const uint16_t *) buf;
+    case DATA_TYPE_INT32:
+      return (float) * (const int32_t *) buf;
+    case DATA_TYPE_UINT32:
+      return (float) * (const uint32_t *) buf;
+    case DATA_TYPE_INT8:
+      return (float) * (const int8_t *) buf;
+    default:
+      return (float) * buf;
+  }
+}
+
+/**
+  * @brief  Write one value of a sample, rounded and saturated to the data type
+  * @param  buf: pointer to the value
+  * @param  dataType: DATA_TYPE_xxx of the subsensor
+  * @param  value: value
+  * @retval None
+  */
+static inline void HSD_DECIM_Write(uint8_t *buf, uint8_t dataType, float value)
+{
+  float v;
+
+  if (dataType == DATA_TYPE_FLOAT)
+  {
+    * (float *) buf = value;
+    return;
+  }
+
+  v = roundf(value);
+  switch (dataType)
+  {
+    case DATA_TYPE_INT16:
+      * (int16_t *) buf = (int16_t) HSD_MAX(HSD_MIN(v, 32767.0f), -32768.0f);
+      break;
+    case DATA_TYPE_UINT16:
+      * (uint16_t *) buf = (uint16_t) HSD_MAX(HSD_MIN(v, 65535.0f), 0.0f);
+      break;
+    case DATA_TYPE_INT32:
+      * (int32_t *) buf = (int32_t) HSD_MAX(HSD_MIN(v, 2147483520.0f), -2147483648.0f);
+      break;
+    case DATA_TYPE_UINT32:
+      * (uint32_t *) buf = (uint32_t) HSD_MAX(HSD_MIN(v, 4294967040.0f), 0.0f);
+      break;
+    case DATA_TYPE_INT8:
+      * (int8_t *) buf = (int8_t) HSD_MAX(HSD_MIN(v, 127.0f), -128.0f);
+      break;
+    default:
+      * buf = (uint8_t) HSD_MAX(HSD_MIN(v, 255.0f), 0.0f);
+      break;
+  }
+}
@@ -0,0 +1,416 @@
+/**
+  ******************************************************************************
+  * @file    HSD_features.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Rolling time-domain features (mean, RMS, peak-to-peak, crest factor,
+  *          skewness, kurtosis) computed in a single pass over tumbling or
+  *          hopping windows and published as a virtual sensor
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCore.h"
+#include "HSD_features.h"
+#include "main.h"
+#include "com_manager.h"
+#include "string.h"
+#include "math.h"
+
+/* Private typedef -----------------------------------------------------------*/
+/* Running central moments of one axis (Welford / Pebay update) */
+typedef struct
+{
+  float mean;
+  float m2;
+  float m3;
+  float m4;
+  float min;
+  float max;
+} HSD_FEATURES_Moments_t;
+
+/* Windows of a source start every hop samples, HSD_FEATURES_WINDOW_HOPS of them are open at a time */
+typedef struct
+{
+  uint8_t sensorId;
+  uint8_t subSensorId;
+  uint8_t nAxes;
+  uint8_t nOpen;
+  uint32_t hop;
+  uint32_t hopIdx;
+  uint32_t n[HSD_FEATURES_MAX_HOPS];
+  HSD_FEATURES_Moments_t moments[HSD_FEATURES_MAX_HOPS][HSD_FEATURES_MAX_AXES];
+  float out[HSD_FEATURES_MAX_AXES * HSD_FEATURES_N];
+} HSD_FEATURES_Source_t;
+
+/* Private variables ---------------------------------------------------------*/
+static int32_t s_nFeatures_id = -1;
+static HSD_FEATURES_Source_t s_xSources[N_MAX_SENSOR_COMBO];
+
+static const float s_fWindowRates[] = {1.0f, 2.0f, 5.0f, 10.0f, 25.0f};
+
+/* Private function prototypes -----------------------------------------------*/
+static void HSD_FEATURES_Reset(HSD_FEATURES_Source_t *pSource, uint8_t ssID);
+static inline float HSD_FEATURES_Read(const uint8_t *buf, uint8_t dataType);
+static inline void HSD_FEATURES_Update(HSD_FEATURES_Moments_t *pMoments, uint32_t n, float x);
+static void HSD_FEATURES_Emit(HSD_FEATURES_Source_t *pSource, uint8_t ssID, uint32_t window,
+                              HSD_TimeStamp_t timeStamp);
+
+/**
+  * @brief  Create the virtual sensor: subsensor i holds the features of source i.
+  *         The window rate is ODR / source dimensions, a window lasts HSD_FEATURES_WINDOW_HOPS
+  *         window periods (1: tumbling windows). A source must be active to feed its features.
+  * @param  sourceSensorId: sensor id of each source
+  * @param  sourceSubSensorId: subsensor id of each source
+  * @param  nSources: number of sources, up to N_MAX_SENSOR_COMBO
+  * @retval 0: ok, 1: error
+  */
+uint8_t HSD_FEATURES_Create_Sensor(const uint8_t *sourceSensorId, const uint8_t *sourceSubSensorId, uint8_t nSources)
+{
+  COM_Sensor_t *pSensor;
+  COM_SubSensorDescriptor_t *pDescriptor;
+  COM_SubSensorDescriptor_t *pSourceDescriptor;
+  COM_SubSensorStatus_t *pStatus;
+  uint32_t ii;
+  uint32_t jj;
+  uint32_t nAxes;
+
+  if (nSources > N_MAX_SENSOR_COMBO)
+  {
+    return 1;
+  }
+
+  s_nFeatures_id = COM_AddSensor();
+  if (s_nFeatures_id == -1)
+  {
+    return 1; /* error */
+  }
+
+  pSensor = COM_GetSensor(s_nFeatures_id);
+
+  /* SENSOR DESCRIPTOR */
+  strcpy(pSensor->sensorDescriptor.name, "FEATURES");
+  pSensor->sensorDescriptor.nSubSensors = nSources;
+
+  for (ii = 0; ii < nSources; ii++)
+  {
+    pSourceDescriptor = COM_GetSubSensorDescriptor(sourceSensorId[ii], sourceSubSensorId[ii]);
+    nAxes = HSD_MIN(pSourceDescriptor->dimensions, HSD_FEATURES_MAX_AXES);
+
+    s_xSources[ii].sensorId = sourceSensorId[ii];
+    s_xSources[ii].subSensorId = sourceSubSensorId[ii];
+    s_xSources[ii].nAxes = (uint8_t) nAxes;
+
+    /* SUBSENSOR DESCRIPTOR */
+    pDescriptor = &pSensor->sensorDescriptor.subSensorDescriptor[ii];
+    pDescriptor->id = ii;
+    pDescriptor->sensorType = pSourceDescriptor->sensorType;
+    pDescriptor->dataType = DATA_TYPE_FLOAT;
+    pDescriptor->dimensions = HSD_FEATURES_N;
+    strcpy(pDescriptor->dimensionsLabel[HSD_FEATURES_MEAN], "avg");
+    strcpy(pDescriptor->dimensionsLabel[HSD_FEATURES_RMS], "rms");
+    strcpy(pDescriptor->dimensionsLabel[HSD_FEATURES_P2P], "p2p");
+    strcpy(pDescriptor->dimensionsLabel[HSD_FEATURES_CREST], "crs");
+    strcpy(pDescriptor->dimensionsLabel[HSD_FEATURES_SKEWNESS], "skw");
+    strcpy(pDescriptor->dimensionsLabel[HSD_FEATURES_KURTOSIS], "krt");
+    strcpy(pDescriptor->unit, pSourceDescriptor->unit);
+    for (jj = 0; jj < sizeof(s_fWindowRates) / sizeof(s_fWindowRates[0]); jj++)
+    {
+      pDescriptor->ODR[jj] = s_fWindowRates[jj] * (float) nAxes;
+    }
+    pDescriptor->ODR[jj] = COM_END_OF_LIST_FLOAT;  /* Terminate list */
+    pDescriptor->FS[0] = COM_END_OF_LIST_FLOAT;
+    pDescriptor->samplesPerTimestamp[0] = 0;
+    pDescriptor->samplesPerTimestamp[1] = 1000;
+
+    /* SUBSENSOR STATUS */
+    pStatus = &pSensor->sensorStatus.subSensorStatus[ii];
+    pStatus->isActive = 0;
+    pStatus->ODR = pDescriptor->ODR[0];
+    pStatus->FS = 0.0f;
+    pStatus->sensitivity = 1.0f;
+    pStatus->measuredODR = 0.0f;
+    pStatus->initialOffset = 0.0f;
+    pStatus->samplesPerTimestamp = (uint16_t) nAxes;
+    pStatus->usbDataPacketSize = (uint16_t)(nAxes * HSD_FEATURES_N * sizeof(float));
+    pStatus->sdWriteBufferSize = 4096;
+    pStatus->comChannelNumber = -1;
+    pStatus->ucfLoaded = 0;
+  }
+
+  return 0;
+}
+
+/**
+  * @brief Get Sensor ID
+  * @param None
+  * @retval Sensor ID
+  */
+uint8_t HSD_FEATURES_Get_Id(void)
+{
+  return (uint8_t) s_nFeatures_id;
+}
+
+/**
+  * @brief  Check if the features of a subsensor are being computed
+  * @param  sensorId: sensor id
+  * @param  subSensorId: subsensor id
+  * @retval 1 if an active features subsensor is fed by the subsensor, else 0
+  */
+uint8_t HSD_FEATURES_Is_Source(uint8_t sensorId, uint8_t subSensorId)
+{
+  uint32_t ii;
+
+  if (s_nFeatures_id == -1 || sensorId == (uint8_t) s_nFeatures_id)
+  {
+    return 0;
+  }
+
+  for (ii = 0; ii < COM_GetSensorDescriptor(s_nFeatures_id)->nSubSensors; ii++)
+  {
+    if (s_xSources[ii].sensorId == sensorId && s_xSources[ii].subSensorId == subSensorId
+        && COM_GetSubSensorStatus(s_nFeatures_id, ii)->isActive)
+    {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Feed the features of a subsensor with a new batch. Samples are read in place,
+  *         each one updates the moments of all the open windows.
+  * @param  sensorId: sensor id of the source
+  * @param  subSensorId: subsensor id of the source
+  * @param  buf: batch of samples
+  * @param  size: batch size [bytes]
+  * @param  timeStamp: timestamp of the latest sample of the batch
+  * @retval None
+  */
+void HSD_FEATURES_Process(uint8_t sensorId, uint8_t subSensorId, const uint8_t *buf, uint16_t size,
+                          HSD_TimeStamp_t timeStamp)
+{
+  HSD_FEATURES_Source_t *pSource;
+  uint8_t dataType = COM_GetSubSensorDescriptor(sensorId, subSensorId)->dataType;
+  uint32_t nBytesPerSample = COM_GetnBytesPerSample(sensorId, subSensorId);
+  uint32_t nBytesPerValue;
+  uint32_t nSamples;
+  uint32_t ii;
+  uint32_t i;
+  uint32_t w;
+  uint32_t axis;
+  float x;
+
+  if (nBytesPerSample == 0 || HSD_FEATURES_Is_Source(sensorId, subSensorId) == 0)
+  {
+    return;
+  }
+  nBytesPerValue = nBytesPerSample / COM_GetSubSensorDescriptor(sensorId, subSensorId)->dimensions;
+  nSamples = size / nBytesPerSample;
+
+  for (ii = 0; ii < COM_GetSensorDescriptor(s_nFeatures_id)->nSubSensors; ii++)
+  {
+    pSource = &s_xSources[ii];
+    if (pSource->sensorId != sensorId || pSource->subSensorId != subSensorId
+        || COM_GetSubSensorStatus(s_nFeatures_id, ii)->isActive == 0)
+    {
+      continue;
+    }
+
+    /* the first batch of the source is discarded, as in SENSOR_Generic_Data_Ready */
+    if (COM_GetSubSensorContext(sensorId, subSensorId)->first_dataReady)
+    {
+      HSD_FEATURES_Reset(pSource, ii);
+      continue;
+    }
+
+    for (i = 0; i < nSamples; i++)
+    {
+      for (axis = 0; axis < pSource->nAxes; axis++)
+      {
+        x = HSD_FEATURES_Read(&buf[i * nBytesPerSample + axis * nBytesPerValue], dataType);
+        for (w = 0; w < pSource->nOpen; w++)
+        {
+          HSD_FEATURES_Update(&pSource->moments[w][axis], pSource->n[w] + 1U, x);
+        }
+      }
+      for (w = 0; w < pSource->nOpen; w++)
+      {
+        pSource->n[w]++;
+      }
+
+      if (++pSource->hopIdx == pSource->hop)
+      {
+        pSource->hopIdx = 0;
+        for (w = 0; w < pSource->nOpen; w++)
+        {
+          if (pSource->n[w] == pSource->hop * HSD_FEATURES_WINDOW_HOPS)
+          {
+            HSD_FEATURES_Emit(pSource, ii, w, timeStamp);
+            pSource->n[w] = 0;
+          }
+        }
+        /* open the next staggered window */
+        if (pSource->nOpen < HSD_FEATURES_WINDOW_HOPS)
+        {
+          pSource->n[pSource->nOpen++] = 0;
+        }
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Restart the windows of a source, the hop is taken from the current ODRs
+  * @param  pSource: source
+  * @param  ssID: features subsensor id
+  * @retval None
+  */
+static void HSD_FEATURES_Reset(HSD_FEATURES_Source_t *pSource, uint8_t ssID)
+{
+  float sourceODR = COM_GetEffectiveODR(COM_GetSubSensorStatus(pSource->sensorId, pSource->subSensorId));
+  float windowRate = COM_GetSubSensorStatus(s_nFeatures_id, ssID)->ODR / (float) pSource->nAxes;
+
+  pSource->hop = (windowRate > 0.0f) ? (uint32_t)(sourceODR / windowRate + 0.5f) : 0U;
+  if (pSource->hop == 0)
+  {
+    pSource->hop = 1;
+  }
+  pSource->hopIdx = 0;
+  pSource->nOpen = 1;
+  pSource->n[0] = 0;
+}
+
+/**
+  * @brief  Read one value of a sample
+  * @param  buf: pointer to the value
+  * @param  dataType: DATA_TYPE_xxx of the source
+  * @retval value
+  */
+static inline float HSD_FEATURES_Read(const uint8_t *buf, uint8_t dataType)
+{
+  switch (dataType)
+  {
+    case DATA_TYPE_INT16:
+      return (float) * (const int16_t *) buf;
+    case DATA_TYPE_FLOAT:
+      return * (const float *) buf;
+    case DATA_TYPE_UINT16:
+      return (float) * (const uint16_t *) buf;
+    case DATA_TYPE_INT32:
+      return (float) * (const int32_t *) buf;
+    case DATA_TYPE_UINT32:
+      return (float) * (const uint32_t *) buf;
+    case DATA_TYPE_INT8:
+      return (float) * (const int8_t *) buf;
+    default:
+      return (float) * buf;
+  }
+}
+
+/**
+  * @brief  Add a value to the running moments of a window
+  * @param  pMoments: moments of the window
+  * @param  n: number of values including the new one
+  * @param  x: new value
+  * @retval None
+  */
+static inline void HSD_FEATURES_Update(HSD_FEATURES_Moments_t *pMoments, uint32_t n, float x)
+{
+  float fn = (float) n;
+  float delta;
+  float delta_n;
+  float delta_n2;
+  float term1;
+
+  if (n == 1U)
+  {
+    pMoments->mean = x;
+    pMoments->m2 = 0.0f;
+    pMoments->m3 = 0.0f;
+    pMoments->m4 = 0.0f;
+    pMoments->min = x;
+    pMoments->max = x;
+    return;
+  }
+
+  delta = x - pMoments->mean;
+  delta_n = delta / fn;
+  delta_n2 = delta_n * delta_n;
+  term1 = delta * delta_n * (fn - 1.0f);
+
+  pMoments->mean += delta_n;
+  pMoments->m4 += term1 * delta_n2 * (fn * fn - 3.0f * fn + 3.0f) + 6.0f * delta_n2 * pMoments->m2
+                  - 4.0f * delta_n * pMoments->m3;
+  pMoments->m3 += term1 * delta_n * (fn - 2.0f) - 3.0f * delta_n * pMoments->m2;
+  pMoments->m2 += term1;
+
+  if (x < pMoments->min)
+  {
+    pMoments->min = x;
+  }
+  if (x > pMoments->max)
+  {
+    pMoments->max = x;
+  }
+}
+
+/**
+  * @brief  Compute the features of a complete window and send them
+  * @param  pSource: source
+  * @param  ssID: features subsensor id
+  * @param  window: index of the complete window
+  * @param  timeStamp: timestamp of the latest sample of the current batch
+  * @retval None
+  */
+static void HSD_FEATURES_Emit(HSD_FEATURES_Source_t *pSource, uint8_t ssID, uint32_t window,
+                              HSD_TimeStamp_t timeStamp)
+{
+  HSD_FEATURES_Moments_t *pMoments;
+  float sensitivity = COM_GetSubSensorStatus(pSource->sensorId, pSource->subSensorId)->sensitivity;
+  float fn = (float) pSource->n[window];
+  float *out;
+  float variance;
+  float rms;
+  float peak;
+  uint32_t axis;
+
+  for (axis = 0; axis < pSource->nAxes; axis++)
+  {
+    pMoments = &pSource->moments[window][axis];
+    out = &pSource->out[axis * HSD_FEATURES_N];
+
+    variance = pMoments->m2 / fn;
+    rms = sqrtf(pMoments->mean * pMoments->mean + variance);
+    peak = (fabsf(pMoments->min) > fabsf(pMoments->max)) ? fabsf(pMoments->min) : fabsf(pMoments->max);
+
+    out[HSD_FEATURES_MEAN] = pMoments->mean * sensitivity;
+    out[HSD_FEATURES_RMS] = rms * sensitivity;
+    out[HSD_FEATURES_P2P] = (pMoments->max - pMoments->min) * sensitivity;
+    out[HSD_FEATURES_CREST] = (rms > 0.0f) ? peak / rms : 0.0f;
+    out[HSD_FEATURES_SKEWNESS] = (variance > 0.0f) ? (pMoments->m3 / fn) / (variance * sqrtf(variance)) : 0.0f;
+    out[HSD_FEATURES_KURTOSIS] = (variance > 0.0f) ? (pMoments->m4 / fn) / (variance * variance) : 0.0f;
+  }
+
+  /* the window ends with the current sample: the timestamp of the batch is close enough
+   * at the low rates of this subsensor */
+  HSD_FEATURES_Data_Ready(ssID, (uint8_t *) pSource->out, pSource->nAxes * HSD_FEATURES_N * sizeof(float),
+                          timeStamp);
+}
+
+__weak void HSD_FEATURES_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
+{
+
+}
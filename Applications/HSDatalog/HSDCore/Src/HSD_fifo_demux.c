@@ -0,0 +1,326 @@
+/**
+  ******************************************************************************
+  * @file    HSD_fifo_demux.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Demultiplexer of tagged FIFO words (LSM6DSOX, ISM330DHCX).
+  *          A table maps each TAG to a sink (a subsensor) or drops it. A batch is
+  *          parsed once: HSD_FIFO_DEMUX_Start counts the samples of each sink, then
+  *          HSD_FIFO_DEMUX_Run copies the payload of every word into the output
+  *          span of its sink, stopping only when a span is full so that the
+  *          caller can provide the next one.
+  *          A sink span may be the FIFO buffer itself: the payload is compacted
+  *          in place, as the write position never passes the read position.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_fifo_demux.h"
+#include "HSDCoreConfig.h"
+#include "string.h"
+
+/* Private function prototypes -----------------------------------------------*/
+static inline int16_t *HSD_FIFO_DEMUX_Copy(int16_t *dst, const uint8_t *pTag, uint8_t nHalfWords);
+
+/**
+  * @brief  Reset the demultiplexer: all the TAGS are dropped
+  * @param  pDemux: demultiplexer
+  * @retval None
+  */
+void HSD_FIFO_DEMUX_Init(HSD_FIFO_Demux_t *pDemux)
+{
+  HSD_memset(pDemux, 0, sizeof(HSD_FIFO_Demux_t));
+  HSD_memset(pDemux->tagToSink, HSD_FIFO_SINK_NONE, sizeof(pDemux->tagToSink));
+}
+
+/**
+  * @brief  Send the words of a TAG to a sink
+  * @param  pDemux: demultiplexer
+  * @param  tag: TAG_SENSOR value
+  * @param  sinkId: sink, HSD_FIFO_SINK_NONE to drop the TAG
+  * @param  nBytes: payload bytes copied per sample (even, up to HSD_FIFO_WORD_DATA_SIZE)
+  * @retval None
+  */
+void HSD_FIFO_DEMUX_Route(HSD_FIFO_Demux_t *pDemux, uint8_t tag, uint8_t sinkId, uint8_t nBytes)
+{
+  if (tag >= HSD_FIFO_N_TAGS || (sinkId >= HSD_FIFO_MAX_SINKS && sinkId != HSD_FIFO_SINK_NONE))
+  {
+    return;
+  }
+
+  pDemux->tagToSink[tag] = sinkId;
+  if (sinkId != HSD_FIFO_SINK_NONE)
+  {
+    pDemux->sink[sinkId].nHalfWords = HSD_MIN(nBytes, HSD_FIFO_WORD_DATA_SIZE) / 2U;
+  }
+}
+
+/**
+  * @brief  Start the parsing of a batch of FIFO words: count the samples of each sink
+  *         (sink[].nSamples) and the dropped words of each TAG (dropped[]). Spans are cleared.
+  * @param  pDemux: demultiplexer
+  * @param  fifo: FIFO words
+  * @param  nWords: number of words
+  * @retval None
+  */
+void HSD_FIFO_DEMUX_Start(HSD_FIFO_Demux_t *pDemux, const uint8_t *fifo, uint16_t nWords)
+{
+  const uint8_t *pTag = fifo;
+  const uint8_t *pEnd = &fifo[nWords * HSD_FIFO_WORD_SIZE];
+  /* Per sink counters in registers: dropped[] is updated only for the TAGS without a sink */
+  uint16_t n0 = 0;
+  uint16_t n1 = 0;
+  uint16_t n2 = 0;
+  uint16_t n3 = 0;
+  uint16_t run;
+  uint8_t tag;
+  uint32_t i;
+
+  HSD_memset(pDemux->dropped, 0, sizeof(pDemux->dropped));
+
+  /* Leading run of the first TAG: the whole batch when only one subsensor is in the FIFO */
+  tag = (nWords > 0U) ? (*pTag) >> 3 : 0U;
+  while (pTag < pEnd && ((*pTag) >> 3) == tag)
+  {
+    pTag += HSD_FIFO_WORD_SIZE;
+  }
+  run = (uint16_t)((pTag - fifo) / HSD_FIFO_WORD_SIZE);
+
+  for (; pTag < pEnd; pTag += HSD_FIFO_WORD_SIZE)
+  {
+    switch (pDemux->tagToSink[(*pTag) >> 3])
+    {
+      case 0:
+        n0++;
+        break;
+      case 1:
+        n1++;
+        break;
+      case 2:
+        n2++;
+        break;
+      case 3:
+        n3++;
+        break;
+      default:
+        pDemux->dropped[(*pTag) >> 3]++;
+        break;
+    }
+  }
+
+  pDemux->sink[0].nSamples = n0;
+  pDemux->sink[1].nSamples = n1;
+  pDemux->sink[2].nSamples = n2;
+  pDemux->sink[3].nSamples = n3;
+  if (pDemux->tagToSink[tag] != HSD_FIFO_SINK_NONE)
+  {
+    pDemux->sink[pDemux->tagToSink[tag]].nSamples += run;
+  }
+  else
+  {
+    pDemux->dropped[tag] += run;
+  }
+
+  pDemux->single = HSD_FIFO_SINK_NONE;
+  for (i = 0; i < HSD_FIFO_MAX_SINKS; i++)
+  {
+    if (nWords > 0U && pDemux->sink[i].nSamples == nWords)
+    {
+      pDemux->single = (uint8_t) i;
+    }
+    pDemux->sink[i].dst = NULL;
+    pDemux->sink[i].room = 0;
+    pDemux->sink[i].written = 0;
+  }
+
+  pDemux->fifo = fifo;
+  pDemux->nWords = nWords;
+  pDemux->word = 0;
+}
+
+/**
+  * @brief  Set the output span of a sink
+  * @param  pDemux: demultiplexer
+  * @param  sinkId: sink
+  * @param  dst: span, NULL to drop the next samples of the sink
+  * @param  nSamples: samples that fit in the span
+  * @retval None
+  */
+void HSD_FIFO_DEMUX_Set_Span(HSD_FIFO_Demux_t *pDemux, uint8_t sinkId, uint8_t *dst, uint16_t nSamples)
+{
+  HSD_FIFO_Sink_t *pSink = &pDemux->sink[sinkId];
+
+  pSink->dst = dst;
+  pSink->room = nSamples;
+  pSink->written = 0;
+}
+
+/**
+  * @brief  Copy the payload of the next FIFO words into the spans of their sinks
+  * @param  pDemux: demultiplexer
+  * @retval HSD_FIFO_SINK_NONE when the batch is complete, otherwise the sink whose span
+  *         is full: set its next span (sink[].written samples are in the current one)
+  *         and call again
+  */
+uint8_t HSD_FIFO_DEMUX_Run(HSD_FIFO_Demux_t *pDemux)
+{
+  const uint8_t *pTag = &pDemux->fifo[pDemux->word * HSD_FIFO_WORD_SIZE];
+  const uint8_t *pEnd = &pDemux->fifo[pDemux->nWords * HSD_FIFO_WORD_SIZE];
+  /* One cursor per sink, so that they stay in registers across the payload stores */
+  int16_t *dst0 = (int16_t *) pDemux->sink[0].dst;
+  int16_t *dst1 = (int16_t *) pDemux->sink[1].dst;
+  int16_t *dst2 = (int16_t *) pDemux->sink[2].dst;
+  int16_t *dst3 = (int16_t *) pDemux->sink[3].dst;
+  int16_t *end[HSD_FIFO_MAX_SINKS];
+  uint8_t nHalfWords[HSD_FIFO_MAX_SINKS];
+  uint8_t tagToSink[HSD_FIFO_N_TAGS];
+  uint8_t sinkId = HSD_FIFO_SINK_NONE;
+  HSD_FIFO_Sink_t *pSink;
+  uint32_t i;
+  uint16_t n;
+
+  for (i = 0; i < HSD_FIFO_MAX_SINKS; i++)
+  {
+    pSink = &pDemux->sink[i];
+    nHalfWords[i] = pSink->nHalfWords;
+    end[i] = (pSink->dst != NULL) ? (int16_t *) pSink->dst + pSink->room * pSink->nHalfWords : NULL;
+  }
+  /* The sinks without a span drop their samples */
+  for (i = 0; i < HSD_FIFO_N_TAGS; i++)
+  {
+    sinkId = pDemux->tagToSink[i];
+    tagToSink[i] = (sinkId != HSD_FIFO_SINK_NONE && end[sinkId] == NULL) ? HSD_FIFO_SINK_NONE : sinkId;
+  }
+  sinkId = HSD_FIFO_SINK_NONE;
+
+  /* All the words belong to the same sink (e.g. one subsensor active): no TAG lookup */
+  if (pDemux->single != HSD_FIFO_SINK_NONE && end[pDemux->single] != NULL)
+  {
+    pSink = &pDemux->sink[pDemux->single];
+    n = HSD_MIN(pSink->room, pDemux->nWords - pDemux->word);
+    dst0 = (int16_t *) pSink->dst;
+    for (i = 0; i < n; i++)
+    {
+      dst0 = HSD_FIFO_DEMUX_Copy(dst0, pTag, nHalfWords[pDemux->single]);
+      pTag += HSD_FIFO_WORD_SIZE;
+    }
+    pSink->dst = (uint8_t *) dst0;
+    pSink->room -= n;
+    pSink->written += n;
+    pDemux->word += n;
+    return (pDemux->word < pDemux->nWords) ? pDemux->single : HSD_FIFO_SINK_NONE;
+  }
+
+  while (pTag < pEnd)
+  {
+    switch (tagToSink[(*pTag) >> 3])
+    {
+      case 0:
+        if (dst0 == end[0])
+        {
+          sinkId = 0;
+        }
+        else
+        {
+          dst0 = HSD_FIFO_DEMUX_Copy(dst0, pTag, nHalfWords[0]);
+        }
+        break;
+      case 1:
+        if (dst1 == end[1])
+        {
+          sinkId = 1;
+        }
+        else
+        {
+          dst1 = HSD_FIFO_DEMUX_Copy(dst1, pTag, nHalfWords[1]);
+        }
+        break;
+      case 2:
+        if (dst2 == end[2])
+        {
+          sinkId = 2;
+        }
+        else
+        {
+          dst2 = HSD_FIFO_DEMUX_Copy(dst2, pTag, nHalfWords[2]);
+        }
+        break;
+      case 3:
+        if (dst3 == end[3])
+        {
+          sinkId = 3;
+        }
+        else
+        {
+          dst3 = HSD_FIFO_DEMUX_Copy(dst3, pTag, nHalfWords[3]);
+        }
+        break;
+      default:
+        break;
+    }
+    if (sinkId != HSD_FIFO_SINK_NONE)
+    {
+      break;
+    }
+    pTag += HSD_FIFO_WORD_SIZE;
+  }
+
+  pDemux->word = (uint16_t)((pTag - pDemux->fifo) / HSD_FIFO_WORD_SIZE);
+  end[0] = dst0;
+  end[1] = dst1;
+  end[2] = dst2;
+  end[3] = dst3;
+  for (i = 0; i < HSD_FIFO_MAX_SINKS; i++)
+  {
+    pSink = &pDemux->sink[i];
+    if (pSink->dst != NULL && pSink->nHalfWords > 0U)
+    {
+      n = (uint16_t)((end[i] - (int16_t *) pSink->dst) / pSink->nHalfWords);
+      pSink->dst = (uint8_t *) end[i];
+      pSink->room -= n;
+      pSink->written += n;
+    }
+  }
+  return sinkId;
+}
+
+/**
+  * @brief  Copy the payload of a FIFO word. The payload is read before it is written, so it is safe
+  *         when compacting in place. The payload is at an odd address: the fixed size copies compile to
+  *         unaligned loads on Cortex-M4.
+  * @param  dst: destination
+  * @param  pTag: FIFO word
+  * @param  nHalfWords: payload size in 16-bit words
+  * @retval next destination
+  */
+static inline int16_t *HSD_FIFO_DEMUX_Copy(int16_t *dst, const uint8_t *pTag, uint8_t nHalfWords)
+{
+  int16_t payload[HSD_FIFO_WORD_DATA_SIZE / 2U];
+  uint8_t i;
+
+  if (nHalfWords == 3U)
+  {
+    HSD_memcpy(payload, pTag + 1, HSD_FIFO_WORD_DATA_SIZE);
+    HSD_memcpy(dst, payload, HSD_FIFO_WORD_DATA_SIZE);
+    return dst + 3;
+  }
+
+  for (i = 0; i < nHalfWords; i++)
+  {
+    HSD_memcpy(&payload[0], pTag + 1U + 2U * i, 2U);
+    *dst++ = payload[0];
+  }
+  return dst;
+}
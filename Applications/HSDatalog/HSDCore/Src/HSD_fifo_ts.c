@@ -0,0 +1,170 @@
+/**
+  ******************************************************************************
+  * @file    HSD_fifo_ts.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Sample timing from the timestamp words batched in the sensor FIFO
+  *          (LSM6DSOX, ISM330DHCX).
+  *          The time of the latest sample of each subsensor is taken from the
+  *          sensor clock: the last timestamp word preceding it plus the samples
+  *          batched since, at the nominal period in sensor ticks (ODR and
+  *          timestamp counter come from the same oscillator).
+  *          Sensor time is mapped to the timebase of the data stream (TIM5) by an
+  *          online linear fit of the pairs (sensor time of the latest sample,
+  *          FIFO IRQ timestamp), so IRQ latency and jitter are averaged out
+  *          instead of being carried by each batch.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_fifo_ts.h"
+#include "HSD_fifo_demux.h"
+#include "string.h"
+
+/**
+  * @brief  Reset sensor time and fit
+  * @param  pTs: FIFO timing
+  * @param  timebaseFreq: frequency of the data stream timebase (units of HSD_TimeStamp_t per second)
+  * @retval None
+  */
+void HSD_FIFO_TS_Init(HSD_FIFO_TS_t *pTs, double timebaseFreq)
+{
+  HSD_memset(pTs, 0, sizeof(HSD_FIFO_TS_t));
+  HSD_CLOCKFIT_Init(&pTs->fit, timebaseFreq / (double) HSD_FIFO_TS_FREQ);
+}
+
+/**
+  * @brief  Set the TAG and the sample period of a subsensor
+  * @param  pTs: FIFO timing
+  * @param  subSensorId: subsensor, up to HSD_FIFO_TS_MAX_SUBSENSORS - 1
+  * @param  tag: TAG_SENSOR of the subsensor words
+  * @param  odr: nominal ODR [Hz], 0 if the subsensor is not batched
+  * @retval None
+  */
+void HSD_FIFO_TS_Set_Subsensor(HSD_FIFO_TS_t *pTs, uint8_t subSensorId, uint8_t tag, float odr)
+{
+  HSD_FIFO_TS_Sub_t *pSub;
+  uint32_t period = 6U;
+
+  if (subSensorId >= HSD_FIFO_TS_MAX_SUBSENSORS)
+  {
+    return;
+  }
+  pSub = &pTs->sub[subSensorId];
+
+  /* ODRs are 6667 Hz / 2^n: 6 << n ticks of the 40 kHz timestamp counter */
+  while (odr > 0.0f && (float) period * odr * 1.5f < HSD_FIFO_TS_FREQ)
+  {
+    period <<= 1;
+  }
+  pSub->tag = tag;
+  pSub->ticksPerSample = (odr > 0.0f) ? period : 0U;
+  pSub->epoch = 0;
+  pSub->after = 0;
+}
+
+/**
+  * @brief  Decode the timestamp words of a FIFO batch and compute the time of the latest
+  *         sample of each subsensor in the batch
+  * @param  pTs: FIFO timing
+  * @param  fifo: FIFO words, HSD_FIFO_WORD_SIZE bytes each
+  * @param  nWords: number of words
+  * @param  irqTimeStamp: timestamp of the FIFO watermark IRQ
+  * @param  pTimeStamp: [out] timestamp of the latest sample of each subsensor; irqTimeStamp
+  *         until the sensor time is known
+  * @retval None
+  */
+void HSD_FIFO_TS_Process(HSD_FIFO_TS_t *pTs, const uint8_t *fifo, uint16_t nWords, HSD_TimeStamp_t irqTimeStamp,
+                         HSD_TimeStamp_t *pTimeStamp)
+{
+  const uint8_t *pTag = fifo;
+  HSD_FIFO_TS_Sub_t *pSub;
+  uint64_t latest[HSD_FIFO_TS_MAX_SUBSENSORS];
+  uint64_t batchTime = 0;
+  uint64_t t;
+  uint8_t inBatch[HSD_FIFO_TS_MAX_SUBSENSORS] = {0};
+  uint8_t timed = 0;
+  uint8_t tag;
+  uint16_t i;
+  uint8_t s;
+
+  for (i = 0; i < nWords; i++)
+  {
+    tag = (*pTag) >> 3;
+    if (tag == HSD_FIFO_TAG_TIMESTAMP)
+    {
+      /* 32-bit counter in the first 4 data bytes, extended to 64 bits */
+      t = (pTs->sensorTime & 0xFFFFFFFF00000000ULL) | ((uint32_t) pTag[1] | ((uint32_t) pTag[2] << 8)
+                                                          | ((uint32_t) pTag[3] << 16) | ((uint32_t) pTag[4] << 24));
+      if (pTs->epoch != 0U && t < pTs->sensorTime)
+      {
+        t += 0x100000000ULL;
+      }
+      pTs->sensorTime = t;
+      pTs->epoch++;
+    }
+    else
+    {
+      for (s = 0; s < HSD_FIFO_TS_MAX_SUBSENSORS; s++)
+      {
+        pSub = &pTs->sub[s];
+        if (tag == pSub->tag && pSub->ticksPerSample != 0U)
+        {
+          if (pSub->epoch != pTs->epoch)
+          {
+            pSub->epoch = pTs->epoch;
+            pSub->after = 0;
+            pSub->ref = pTs->sensorTime;
+          }
+          pSub->after++;
+          inBatch[s] = 1;
+          break;
+        }
+      }
+    }
+    pTag += HSD_FIFO_WORD_SIZE;
+  }
+
+  /* Latest sample of each subsensor, and of the batch */
+  for (s = 0; s < HSD_FIFO_TS_MAX_SUBSENSORS; s++)
+  {
+    pSub = &pTs->sub[s];
+    pTimeStamp[s] = irqTimeStamp;
+    if (inBatch[s] && pSub->epoch != 0U)
+    {
+      latest[s] = pSub->ref + (uint64_t)(pSub->after - 1U) * pSub->ticksPerSample;
+      batchTime = (timed && batchTime > latest[s]) ? batchTime : latest[s];
+      timed = 1;
+    }
+    else
+    {
+      inBatch[s] = 0;
+    }
+  }
+  if (!timed)
+  {
+    return;
+  }
+
+  /* The watermark IRQ comes with the latest sample of the batch */
+  (void) HSD_CLOCKFIT_Add(&pTs->fit, batchTime, irqTimeStamp);
+  for (s = 0; s < HSD_FIFO_TS_MAX_SUBSENSORS; s++)
+  {
+    if (inBatch[s])
+    {
+      pTimeStamp[s] = HSD_CLOCKFIT_Map(&pTs->fit, latest[s]);
+    }
+  }
+}
@@ -23,6 +23,9 @@
 #include "HSDCore.h"
 #include "HSD_json.h"
 #include "parson.h"
+#include "HSD_trigger.h"
+#include "sensors_manager.h"
+#include "math.h"
 
 /* Private variables ---------------------------------------------------------*/
 static void (*JSON_free_function)(void *);
@@ -40,7 +43,8 @@ static int32_t get_JSON_from_SubSensorDescriptor(COM_SubSensorDescriptor_t *sub_
                                                  char **serialized_string);
 static int32_t get_JSON_from_SubSensorStatus(COM_SubSensorStatus_t *sub_sensor_status, char **serialized_string);
 static int32_t get_JSON_from_AcquisitionDescriptor(COM_AcquisitionDescriptor_t *acquisition_descriptor,
-                                                   char **serialized_string, uint8_t pretty);
+                                                   COM_SDStats_t *sd_stats, char **serialized_string,
+                                                   uint8_t pretty);
 
 static int32_t parse_Device_from_JSON(char *SerializedJSON, COM_Device_t *Device);
 static int32_t parse_Command_from_JSON(char *SerializedJSON, COM_Command_t *outCommand);
@@ -65,15 +69,24 @@ static void create_JSON_SensorDescriptor(COM_SensorDescriptor_t *sensor_descript
 static void create_JSON_SensorStatus(uint8_t sensorId, COM_SensorStatus_t *sensor_status, JSON_Value *tempJSON);
 static void create_JSON_SubSensorDescriptor(COM_SubSensorDescriptor_t *sub_sensor_descriptor, JSON_Value *tempJSON);
 static void create_JSON_SubSensorStatus(COM_SubSensorStatus_t *sub_sensor_status, JSON_Value *tempJSON);
+static void update_SubSensorStatus_ClockStats(uint8_t sensorId, uint8_t subSensorId);
 static void create_JSON_RefreshSensorStatus(JSON_Value *tempJSON, uint8_t sensorId, COM_SensorStatus_t *sensor_status);
 static void create_JSON_PerformanceStatus(JSON_Value *tempJSON, char *chrgState, uint32_t mV, uint32_t level,
-                                          uint16_t cpu_usage);
+                                          uint16_t cpu_usage, uint8_t detailed);
 static void create_JSON_LoggingStatus(JSON_Value *tempJSON, uint8_t sdDetected, uint8_t isLoggingActive);
 static void create_JSON_NetworkStatus(JSON_Value *tempJSON, char *ssid, char *password, char *ip);
 static void create_JSON_DeviceHWTag(uint8_t id, const COM_HwTag_t *hwTag, JSON_Value *tempJSON);
 static void create_JSON_DeviceSWTag(uint8_t id, char *label, JSON_Value *tempJSON);
 static void create_JSON_AcquisitionDescriptor(COM_AcquisitionDescriptor_t *acquisition_descriptor,
                                               JSON_Value *tempJSON);
+static void create_JSON_SDStats(JSON_Object *JSON_Obj, const char *name, COM_SDStats_t *sd_stats, uint8_t detailed);
+static void create_JSON_LatencyHistogram(JSON_Object *JSON_Obj, const char *name, COM_LatencyHistogram_t *hist,
+                                         uint8_t detailed);
+static void create_JSON_RuntimeStats(JSON_Object *JSON_Obj, uint8_t detailed);
+static void create_JSON_BusStats(JSON_Object *JSON_Obj, const char *name, uint8_t detailed);
+static void create_JSON_SlotStats(JSON_Object *JSON_Obj, const char *name, COM_SlotStats_t *slot_stats);
+static void create_JSON_Events(JSON_Object *JSON_Obj, const char *name);
+static void create_JSON_StackFree(JSON_Object *JSON_Obj, const char *name, uint8_t detailed);
 
 /* Public function -----------------------------------------------------------*/
 
@@ -137,15 +150,23 @@ int32_t HSD_JSON_serialize_SubSensorDescriptor(COM_SubSensorDescriptor_t *SubSen
   return get_JSON_from_SubSensorDescriptor(SubSensorDescriptor, SerializedJSON);
 }
 
-int32_t HSD_JSON_serialize_SubSensorStatus(COM_SubSensorStatus_t *SubSensorStatus, char **SerializedJSON)
+int32_t HSD_JSON_serialize_SubSensorStatus(uint8_t sensorId, uint8_t subSensorId,
+                                           COM_SubSensorStatus_t *SubSensorStatus, char **SerializedJSON)
 {
+  update_SubSensorStatus_ClockStats(sensorId, subSensorId);
   return get_JSON_from_SubSensorStatus(SubSensorStatus, SerializedJSON);
 }
 
 int32_t HSD_JSON_serialize_Acquisition(COM_AcquisitionDescriptor_t *AcquisitionDescriptor, char **SerializedJSON,
                                        uint8_t pretty)
 {
-  return get_JSON_from_AcquisitionDescriptor(AcquisitionDescriptor, SerializedJSON, pretty);
+  return get_JSON_from_AcquisitionDescriptor(AcquisitionDescriptor, NULL, SerializedJSON, pretty);
+}
+
+int32_t HSD_JSON_serialize_AcquisitionInfo(COM_AcquisitionDescriptor_t *AcquisitionDescriptor, COM_SDStats_t *SDStats,
+                                           char **SerializedJSON, uint8_t pretty)
+{
+  return get_JSON_from_AcquisitionDescriptor(AcquisitionDescriptor, SDStats, SerializedJSON, pretty);
 }
 
 int32_t HSD_JSON_serialize_RefreshSensorStatus(uint8_t sensorId, COM_SensorStatus_t *SensorStatus,
@@ -167,13 +188,13 @@ int32_t HSD_JSON_serialize_RefreshSensorStatus(uint8_t sensorId, COM_SensorStatu
 }
 
 int32_t HSD_JSON_serialize_FWStatus_Performance(char **SerializedJSON, char *chrgState, uint32_t mV, uint32_t level,
-                                                uint16_t cpu_usage)
+                                                uint16_t cpu_usage, uint8_t detailed)
 {
   int32_t size = 0;
 
   JSON_Value *tempJSON = json_value_init_object();
 
-  create_JSON_PerformanceStatus(tempJSON, chrgState, mV, level, cpu_usage);
+  create_JSON_PerformanceStatus(tempJSON, chrgState, mV, level, cpu_usage, detailed);
 
   /* convert to a json string and write as string */
   *SerializedJSON = json_serialize_to_string(tempJSON);
@@ -299,6 +320,16 @@ static int32_t get_JSON_from_Device(COM_Device_t *device, char **serialized_stri
   json_object_dotset_string(JSON_Device, "device.deviceInfo.dataFileFormat", device->deviceDescriptor.dataFileFormat);
   json_object_dotset_number(JSON_Device, "device.deviceInfo.nSensor", device->deviceDescriptor.nSensor);
   json_object_dotset_string(JSON_Device, "device.deviceInfo.bleMacAddress", device->deviceDescriptor.bleMacAddress);
+  if (device->deviceDescriptor.tsFrequency != 0)
+  {
+    json_object_dotset_number(JSON_Device, "device.deviceInfo.timestampFrequency",
+                              device->deviceDescriptor.tsFrequency);
+  }
+  if (device->deviceDescriptor.chunkTsFrequency != 0)
+  {
+    json_object_dotset_number(JSON_Device, "device.deviceInfo.chunkTimestampFrequency",
+                              device->deviceDescriptor.chunkTsFrequency);
+  }
 
   json_object_dotset_value(JSON_Device, "device.sensor", json_value_init_array());
   JSON_SensorArray = json_object_dotget_array(JSON_Device, "device.sensor");
@@ -470,7 +501,8 @@ static int32_t get_JSON_from_SubSensorStatus(COM_SubSensorStatus_t *sub_sensor_s
 }
 
 static int32_t get_JSON_from_AcquisitionDescriptor(COM_AcquisitionDescriptor_t *acquisition_descriptor,
-                                                   char **serialized_string, uint8_t pretty)
+                                                   COM_SDStats_t *sd_stats, char **serialized_string,
+                                                   uint8_t pretty)
 {
   int32_t size = 0;
 
@@ -478,6 +510,17 @@ static int32_t get_JSON_from_AcquisitionDescriptor(COM_AcquisitionDescriptor_t *
 
   create_JSON_AcquisitionDescriptor(acquisition_descriptor, tempJSON);
 
+  if (sd_stats != NULL)
+  {
+    create_JSON_SDStats(json_value_get_object(tempJSON), "SDStats", sd_stats, 1);
+    json_object_set_value(json_value_get_object(tempJSON), "PerformanceStats", json_value_init_object());
+    create_JSON_RuntimeStats(json_object_get_object(json_value_get_object(tempJSON), "PerformanceStats"), 1);
+    if (HSD_TRIGGER_Is_Enabled())
+    {
+      create_JSON_Events(json_value_get_object(tempJSON), "Events");
+    }
+  }
+
   /* convert to a json string and write to file */
   if (pretty == 1)
   {
@@ -662,6 +705,10 @@ static int32_t parse_Command_from_JSON(char *SerializedJSON, COM_Command_t *outC
     {
       outCommand->request = COM_REQUEST_TAG_CONFIG;
     }
+    else if (strcmp(json_object_dotget_string(JSON_ParseHandler, "request"), "performance") == 0)
+    {
+      outCommand->request = COM_REQUEST_STATUS_PERF_FULL;
+    }
     else if (strcmp(json_object_dotget_string(JSON_ParseHandler, "request"), "log_status") == 0)
     {
       outCommand->request = COM_REQUEST_STATUS_LOGGING;
@@ -767,6 +814,18 @@ static int32_t parse_Status_from_JSON(char *SerializedJSON, COM_SensorStatus_t *
       {
         sensorStatus->subSensorStatus[subid].samplesPerTimestamp = (uint16_t) json_object_dotget_number(JSON_subSensorObj, "samplesPerTs");
       }
+      if (json_object_dothas_value(JSON_subSensorObj, "compression"))
+      {
+        sensorStatus->subSensorStatus[subid].compression = (uint8_t) json_object_dotget_number(JSON_subSensorObj, "compression");
+      }
+      if (json_object_dothas_value(JSON_subSensorObj, "decimation"))
+      {
+        sensorStatus->subSensorStatus[subid].decimation = (uint8_t) json_object_dotget_number(JSON_subSensorObj, "decimation");
+      }
+      if (json_object_dothas_value(JSON_subSensorObj, "decimationQuality"))
+      {
+        sensorStatus->subSensorStatus[subid].decimationQuality = (uint8_t) json_object_dotget_number(JSON_subSensorObj, "decimationQuality");
+      }
       if (json_object_dothas_value(JSON_subSensorObj, "FS"))
       {
         sensorStatus->subSensorStatus[subid].FS = json_object_dotget_number(JSON_subSensorObj, "FS");
@@ -1108,6 +1167,15 @@ static void create_JSON_DeviceInfo(COM_DeviceDescriptor_t *device_descriptor, JS
   json_object_dotset_string(JSON_DeviceHandler, "deviceInfo.dataFileFormat", device_descriptor->dataFileFormat);
   json_object_dotset_number(JSON_DeviceHandler, "deviceInfo.nSensor", device_descriptor->nSensor);
   json_object_dotset_string(JSON_DeviceHandler, "deviceInfo.bleMacAddress", device_descriptor->bleMacAddress);
+  if (device_descriptor->tsFrequency != 0)
+  {
+    json_object_dotset_number(JSON_DeviceHandler, "deviceInfo.timestampFrequency", device_descriptor->tsFrequency);
+  }
+  if (device_descriptor->chunkTsFrequency != 0)
+  {
+    json_object_dotset_number(JSON_DeviceHandler, "deviceInfo.chunkTimestampFrequency",
+                              device_descriptor->chunkTsFrequency);
+  }
 }
 
 static void create_JSON_TagList(COM_TagList_t *tagList, JSON_Value *tempJSON)
@@ -1191,6 +1259,7 @@ static void create_JSON_SensorStatus(uint8_t sensorId, COM_SensorStatus_t *senso
   for (ii = 0; ii < pSensorDescriptor->nSubSensors; ii++)
   {
     tempJSON2 = json_value_init_object();
+    update_SubSensorStatus_ClockStats(sensorId, ii);
     create_JSON_SubSensorStatus(&sensor_status->subSensorStatus[ii], tempJSON2);
     json_array_append_value(JSON_SensorArray2, tempJSON2);
   }
@@ -1232,6 +1301,9 @@ static void create_JSON_SubSensorDescriptor(COM_SubSensorDescriptor_t *sub_senso
     case COM_TYPE_MLC:
       json_object_dotset_string(JSON_SubSensorDescriptor, "sensorType", "MLC");
       break;
+    case COM_TYPE_PSD:
+      json_object_dotset_string(JSON_SubSensorDescriptor, "sensorType", "PSD");
+      break;
     default:
       json_object_dotset_string(JSON_SubSensorDescriptor, "sensorType", "NA");
       break;
@@ -1312,6 +1384,9 @@ static void create_JSON_SubSensorStatus(COM_SubSensorStatus_t *sub_sensor_status
   json_object_dotset_number(JSON_SubSensorStatus, "ODR", sub_sensor_status->ODR);
   json_object_dotset_number(JSON_SubSensorStatus, "ODRMeasured", sub_sensor_status->measuredODR);
   json_object_dotset_number(JSON_SubSensorStatus, "initialOffset", PRECISION6(sub_sensor_status->initialOffset));
+  json_object_dotset_number(JSON_SubSensorStatus, "timestampJitter", sub_sensor_status->timestampJitter);
+  json_object_dotset_number(JSON_SubSensorStatus, "timestampJitterMax", sub_sensor_status->timestampJitterMax);
+  json_object_dotset_number(JSON_SubSensorStatus, "timestampOutliers", sub_sensor_status->timestampOutliers);
   json_object_dotset_number(JSON_SubSensorStatus, "FS", sub_sensor_status->FS);
   json_object_dotset_number(JSON_SubSensorStatus, "sensitivity", PRECISION6(sub_sensor_status->sensitivity));
   json_object_dotset_boolean(JSON_SubSensorStatus, "isActive", sub_sensor_status->isActive);
@@ -1321,6 +1396,37 @@ static void create_JSON_SubSensorStatus(COM_SubSensorStatus_t *sub_sensor_status
   json_object_dotset_number(JSON_SubSensorStatus, "wifiDataPacketSize", sub_sensor_status->wifiDataPacketSize);
   json_object_dotset_number(JSON_SubSensorStatus, "comChannelNumber", sub_sensor_status->comChannelNumber);
   json_object_dotset_boolean(JSON_SubSensorStatus, "ucfLoaded", sub_sensor_status->ucfLoaded);
+  json_object_dotset_number(JSON_SubSensorStatus, "compression", sub_sensor_status->compression);
+  json_object_dotset_number(JSON_SubSensorStatus, "decimation", sub_sensor_status->decimation);
+  json_object_dotset_number(JSON_SubSensorStatus, "decimationQuality", sub_sensor_status->decimationQuality);
+  json_object_dotset_number(JSON_SubSensorStatus, "ODREffective", COM_GetEffectiveODR(sub_sensor_status));
+}
+
+/**
+  * @brief  Take the initial offset and the timestamp jitter of a subsensor from its clock model,
+  *         only when they are serialized. The fit is copied in a critical section: the sensor
+  *         thread moves its origin at every batch.
+  * @param  sensorId: sensor id
+  * @param  subSensorId: subsensor id
+  * @retval None
+  */
+static void update_SubSensorStatus_ClockStats(uint8_t sensorId, uint8_t subSensorId)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
+  HSD_ClockFit_t fit;
+
+  taskENTER_CRITICAL();
+  fit = COM_GetSubSensorContext(sensorId, subSensorId)->clock_fit;
+  taskEXIT_CRITICAL();
+
+  /* no data received yet */
+  if (fit.nPairs == 0U)
+  {
+    return;
+  }
+  pSubSensorStatus->timestampJitter = (float)(sqrtf(fit.meanSquareResidual) / SM_SENSOR_TIMESTAMP_FREQ);
+  pSubSensorStatus->timestampJitterMax = (float)(fit.maxResidual / SM_SENSOR_TIMESTAMP_FREQ);
+  pSubSensorStatus->initialOffset = (float)((double) HSD_CLOCKFIT_Map(&fit, 0) / SM_SENSOR_TIMESTAMP_FREQ);
 }
 
 static void create_JSON_RefreshSensorStatus(JSON_Value *tempJSON, uint8_t sensorId, COM_SensorStatus_t *sensor_status)
@@ -1337,7 +1443,7 @@ static void create_JSON_RefreshSensorStatus(JSON_Value *tempJSON, uint8_t sensor
 }
 
 static void create_JSON_PerformanceStatus(JSON_Value *tempJSON, char *chrgState, uint32_t mV, uint32_t level,
-                                          uint16_t cpu_usage)
+                                          uint16_t cpu_usage, uint8_t detailed)
 {
   JSON_Object *JSON_PerfStatus = json_value_get_object(tempJSON);
 
@@ -1347,6 +1453,264 @@ static void create_JSON_PerformanceStatus(JSON_Value *tempJSON, char *chrgState,
   json_object_dotset_string(JSON_PerfStatus, "batteryState", chrgState);
   json_object_dotset_number(JSON_PerfStatus, "batteryVoltage", mV);
   json_object_dotset_number(JSON_PerfStatus, "batteryLevel", level);
+  create_JSON_SDStats(JSON_PerfStatus, "sdStats", COM_GetSDStats(), detailed);
+  create_JSON_RuntimeStats(JSON_PerfStatus, detailed);
+}
+
+/* Bus, scheduling and stack statistics: counts and max only unless detailed (periodic BLE status) */
+static void create_JSON_RuntimeStats(JSON_Object *JSON_Obj, uint8_t detailed)
+{
+  create_JSON_BusStats(JSON_Obj, "busStats", detailed);
+  json_object_dotset_number(JSON_Obj, "contextSwitches", COM_GetContextSwitches());
+  create_JSON_LatencyHistogram(JSON_Obj, "irqToThread", COM_GetIrqLatency(), detailed);
+  create_JSON_SlotStats(JSON_Obj, "transactionSlots", COM_GetSlotStats());
+  create_JSON_StackFree(JSON_Obj, "stackFree", detailed);
+}
+
+static void create_JSON_SDStats(JSON_Object *JSON_Obj, const char *name, COM_SDStats_t *sd_stats, uint8_t detailed)
+{
+  JSON_Object *JSON_SDStats;
+  JSON_Array *tmp_array;
+  JSON_Value *tmp_value;
+  JSON_Object *tmp_obj;
+  COM_Device_t *device = COM_GetDevice();
+  COM_SubSensorStatus_t *sub_sensor_status;
+  uint32_t overruns = 0;
+  uint32_t dropped_bytes = 0;
+  uint32_t ii;
+  uint32_t jj;
+
+  json_object_set_value(JSON_Obj, name, json_value_init_object());
+  JSON_SDStats = json_object_get_object(JSON_Obj, name);
+
+  json_object_dotset_number(JSON_SDStats, "bytesWritten", (double) sd_stats->bytesWritten);
+  json_object_dotset_number(JSON_SDStats, "queuePeak", sd_stats->queuePeak);
+  json_object_dotset_number(JSON_SDStats, "preallocatedFiles", sd_stats->preallocatedFiles);
+  json_object_dotset_number(JSON_SDStats, "preallocationFailures", sd_stats->preallocFailures);
+  json_object_dotset_number(JSON_SDStats, "writeErrors", sd_stats->writeErrors);
+  if (sd_stats->writeErrors != 0)
+  {
+    json_object_dotset_number(JSON_SDStats, "lastWriteError.sector", sd_stats->writeErrorSector);
+    json_object_dotset_number(JSON_SDStats, "lastWriteError.count", sd_stats->writeErrorCount);
+  }
+  create_JSON_LatencyHistogram(JSON_SDStats, "writeBuffer", &sd_stats->writeBuffer, detailed);
+  create_JSON_LatencyHistogram(JSON_SDStats, "flushBuffer", &sd_stats->flushBuffer, detailed);
+  create_JSON_LatencyHistogram(JSON_SDStats, "diskWrite", &sd_stats->diskWrite, detailed);
+  create_JSON_LatencyHistogram(JSON_SDStats, "cardWrite", &sd_stats->cardWrite, detailed);
+
+  if (!detailed)
+  {
+    /* totals over the active subsensors */
+    for (ii = 0; ii < device->deviceDescriptor.nSensor; ii++)
+    {
+      for (jj = 0; jj < device->sensors[ii]->sensorDescriptor.nSubSensors; jj++)
+      {
+        sub_sensor_status = &device->sensors[ii]->sensorStatus.subSensorStatus[jj];
+        if (sub_sensor_status->isActive)
+        {
+          overruns += sub_sensor_status->context.sd_overrun_count;
+          dropped_bytes += sub_sensor_status->context.sd_dropped_bytes;
+        }
+      }
+    }
+    json_object_dotset_number(JSON_SDStats, "overruns", overruns);
+    json_object_dotset_number(JSON_SDStats, "droppedBytes", dropped_bytes);
+    return;
+  }
+
+  /* one item for each active subsensor */
+  json_object_dotset_value(JSON_SDStats, "subSensors", json_value_init_array());
+  tmp_array = json_object_dotget_array(JSON_SDStats, "subSensors");
+
+  for (ii = 0; ii < device->deviceDescriptor.nSensor; ii++)
+  {
+    for (jj = 0; jj < device->sensors[ii]->sensorDescriptor.nSubSensors; jj++)
+    {
+      sub_sensor_status = &device->sensors[ii]->sensorStatus.subSensorStatus[jj];
+      if (sub_sensor_status->isActive)
+      {
+        tmp_value = json_value_init_object();
+        tmp_obj = json_value_get_object(tmp_value);
+
+        json_object_dotset_number(tmp_obj, "sensorId", ii);
+        json_object_dotset_number(tmp_obj, "subSensorId", jj);
+        json_object_dotset_number(tmp_obj, "ringHighWater", sub_sensor_status->context.sd_ring_hwm);
+        json_object_dotset_number(tmp_obj, "overruns", sub_sensor_status->context.sd_overrun_count);
+        json_object_dotset_number(tmp_obj, "droppedBytes", sub_sensor_status->context.sd_dropped_bytes);
+        if (sub_sensor_status->context.codec_in_bytes != 0)
+        {
+          /* 2 bytes per int16 sample: cycles are TIM5 ticks, TIM5 runs at SystemCoreClock */
+          json_object_dotset_number(tmp_obj, "codec.inBytes", (double) sub_sensor_status->context.codec_in_bytes);
+          json_object_dotset_number(tmp_obj, "codec.outBytes", (double) sub_sensor_status->context.codec_out_bytes);
+          json_object_dotset_number(tmp_obj, "codec.cyclesPerSample",
+                                    PRECISION6(2.0 * (double) sub_sensor_status->context.codec_cycles
+                                               / (double) sub_sensor_status->context.codec_in_bytes));
+        }
+
+        json_array_append_value(tmp_array, tmp_value);
+      }
+    }
+  }
+}
+
+static void create_JSON_BusStats(JSON_Object *JSON_Obj, const char *name, uint8_t detailed)
+{
+  static const char *const bus_names[COM_N_BUS] = {"SPI1", "SPI3", "I2C1", "I2C3"};
+  JSON_Array *tmp_array;
+  JSON_Value *tmp_value;
+  JSON_Object *tmp_obj;
+  COM_BusStats_t *bus_stats;
+  uint8_t ii;
+
+  /* one item for each bus that served a request */
+  json_object_set_value(JSON_Obj, name, json_value_init_array());
+  tmp_array = json_object_get_array(JSON_Obj, name);
+
+  for (ii = 0; ii < COM_N_BUS; ii++)
+  {
+    bus_stats = COM_GetBusStats(ii);
+    if (bus_stats->transactions != 0U)
+    {
+      tmp_value = json_value_init_object();
+      tmp_obj = json_value_get_object(tmp_value);
+
+      json_object_dotset_string(tmp_obj, "bus", bus_names[ii]);
+      json_object_dotset_number(tmp_obj, "transactions", bus_stats->transactions);
+      json_object_dotset_number(tmp_obj, "deadlineMisses", bus_stats->deadlineMisses);
+      json_object_dotset_number(tmp_obj, "coalesced", bus_stats->coalesced);
+      json_object_dotset_number(tmp_obj, "pendingPeak", bus_stats->pendingPeak);
+      json_object_dotset_number(tmp_obj, "errors", bus_stats->errors);
+      create_JSON_LatencyHistogram(tmp_obj, "queueDelay", &bus_stats->queueDelay, detailed);
+      if (bus_stats->transfer.count != 0U)
+      {
+        /* TIM5 runs at the core clock: average CPU cycles to start and to end a transaction, with the build mode
+         * and the transactions that did not fit the single DMA, so that the figures of two builds can be compared */
+        json_object_dotset_number(tmp_obj, "singleDma", HSD_SPI_SINGLE_DMA);
+        json_object_dotset_number(tmp_obj, "splitTransfers", bus_stats->splitTransfers);
+        json_object_dotset_number(tmp_obj, "setupCycles", (double) bus_stats->setupTicks / bus_stats->transfer.count);
+        json_object_dotset_number(tmp_obj, "endCycles", (double) bus_stats->endTicks / bus_stats->transfer.count);
+        create_JSON_LatencyHistogram(tmp_obj, "transfer", &bus_stats->transfer, detailed);
+      }
+
+      json_array_append_value(tmp_array, tmp_value);
+    }
+  }
+}
+
+static void create_JSON_StackFree(JSON_Object *JSON_Obj, const char *name, uint8_t detailed)
+{
+  COM_Device_t *device = COM_GetDevice();
+  JSON_Array *tmp_array;
+  JSON_Value *tmp_value;
+  JSON_Object *tmp_obj;
+  int32_t stack_free;
+  int32_t min_free = -1;
+  uint8_t min_id = 0;
+  uint8_t ii;
+
+  if (!detailed)
+  {
+    /* only the sensor thread closest to its stack limit */
+    for (ii = 0; ii < device->deviceDescriptor.nSensor; ii++)
+    {
+      stack_free = SM_GetSensorStackFree(ii);
+      if (stack_free >= 0 && (min_free < 0 || stack_free < min_free))
+      {
+        min_free = stack_free;
+        min_id = ii;
+      }
+    }
+    if (min_free >= 0)
+    {
+      json_object_set_value(JSON_Obj, name, json_value_init_object());
+      tmp_obj = json_object_get_object(JSON_Obj, name);
+      json_object_dotset_string(tmp_obj, "sensor", device->sensors[min_id]->sensorDescriptor.name);
+      json_object_dotset_number(tmp_obj, "bytes", min_free);
+    }
+    return;
+  }
+
+  /* one item for each sensor thread: lowest free stack seen since boot */
+  json_object_set_value(JSON_Obj, name, json_value_init_array());
+  tmp_array = json_object_get_array(JSON_Obj, name);
+
+  for (ii = 0; ii < device->deviceDescriptor.nSensor; ii++)
+  {
+    stack_free = SM_GetSensorStackFree(ii);
+    if (stack_free >= 0)
+    {
+      tmp_value = json_value_init_object();
+      tmp_obj = json_value_get_object(tmp_value);
+
+      json_object_dotset_string(tmp_obj, "sensor", device->sensors[ii]->sensorDescriptor.name);
+      json_object_dotset_number(tmp_obj, "bytes", stack_free);
+
+      json_array_append_value(tmp_array, tmp_value);
+    }
+  }
+}
+
+static void create_JSON_SlotStats(JSON_Object *JSON_Obj, const char *name, COM_SlotStats_t *slot_stats)
+{
+  JSON_Object *JSON_SlotStats;
+
+  json_object_set_value(JSON_Obj, name, json_value_init_object());
+  JSON_SlotStats = json_object_get_object(JSON_Obj, name);
+
+  json_object_dotset_number(JSON_SlotStats, "overflowSlots", HSD_BUS_OVERFLOW_SLOTS);
+  json_object_dotset_number(JSON_SlotStats, "overflowAllocs", slot_stats->overflowAllocs);
+  json_object_dotset_number(JSON_SlotStats, "overflowPeak", slot_stats->overflowPeak);
+  json_object_dotset_number(JSON_SlotStats, "allocFailures", slot_stats->allocFailures);
+}
+
+static void create_JSON_LatencyHistogram(JSON_Object *JSON_Obj, const char *name, COM_LatencyHistogram_t *hist,
+                                         uint8_t detailed)
+{
+  JSON_Object *JSON_Hist;
+  JSON_Array *tmp_array;
+  uint32_t ii;
+
+  json_object_set_value(JSON_Obj, name, json_value_init_object());
+  JSON_Hist = json_object_get_object(JSON_Obj, name);
+
+  json_object_dotset_number(JSON_Hist, "count", hist->count);
+  json_object_dotset_number(JSON_Hist, "max_us", hist->max_us);
+  if (!detailed)
+  {
+    return;
+  }
+
+  /* histogram_us[k]: number of calls that took [2^k, 2^(k+1)) us */
+  json_object_dotset_value(JSON_Hist, "histogram_us", json_value_init_array());
+  tmp_array = json_object_dotget_array(JSON_Hist, "histogram_us");
+  for (ii = 0; ii < COM_LATENCY_BUCKETS; ii++)
+  {
+    json_array_append_number(tmp_array, hist->bucket[ii]);
+  }
+}
+
+static void create_JSON_Events(JSON_Object *JSON_Obj, const char *name)
+{
+  JSON_Array *tmp_array;
+  JSON_Value *tmp_value;
+  JSON_Object *tmp_obj;
+  double start;
+  double end;
+  uint32_t ii;
+
+  /* Events of event-based logging: trigger time and end of the post-trigger interval [s] */
+  json_object_set_value(JSON_Obj, name, json_value_init_array());
+  tmp_array = json_object_get_array(JSON_Obj, name);
+  for (ii = 0; HSD_TRIGGER_Get_Event(ii, &start, &end) == 0; ii++)
+  {
+    tmp_value = json_value_init_object();
+    tmp_obj = json_value_get_object(tmp_value);
+
+    json_object_dotset_number(tmp_obj, "t", start);
+    json_object_dotset_number(tmp_obj, "t_end", end);
+
+    json_array_append_value(tmp_array, tmp_value);
+  }
 }
 
 static void create_JSON_LoggingStatus(JSON_Value *tempJSON, uint8_t sdDetected, uint8_t isLoggingActive)
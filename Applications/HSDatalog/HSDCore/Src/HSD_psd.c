@@ -0,0 +1,222 @@
+/**
+  ******************************************************************************
+  * @file    HSD_psd.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Periodogram kernel of the Welch PSD: each segment of fftLen samples
+  *          is made zero mean, Hann windowed and transformed, then |X[k]|^2 is
+  *          added to the caller accumulator (fftLen / 2 + 1 bins).
+  *          The portable version computes the real FFT of N points through a
+  *          radix-2 complex FFT of N/2 points followed by a split step.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_psd.h"
+#include <math.h>
+
+/* Private function prototypes -----------------------------------------------*/
+#if (HSD_PSD_USE_CMSIS_DSP == 0)
+static void HSD_PSD_FFT(HSD_PSD_t *pPsd, float *buf, uint32_t nComplex);
+#endif /* (HSD_PSD_USE_CMSIS_DSP == 0) */
+
+/**
+  * @brief  Build the Hann window and the FFT tables
+  * @param  pPsd: PSD instance
+  * @param  fftLen: segment length, power of 2 between 8 and HSD_PSD_MAX_FFT_LEN
+  * @retval 0: no error, 1: unsupported length
+  */
+uint8_t HSD_PSD_Init(HSD_PSD_t *pPsd, uint32_t fftLen)
+{
+  uint32_t i;
+
+  if (fftLen < 8U || fftLen > HSD_PSD_MAX_FFT_LEN || (fftLen & (fftLen - 1U)) != 0U)
+  {
+    return 1;
+  }
+
+  pPsd->fftLen = fftLen;
+  pPsd->windowPower = 0.0f;
+  for (i = 0; i < fftLen; i++)
+  {
+    pPsd->window[i] = 0.5f - 0.5f * cosf(2.0f * (float) M_PI * (float) i / (float) fftLen);
+    pPsd->windowPower += pPsd->window[i] * pPsd->window[i];
+  }
+
+#if (HSD_PSD_USE_CMSIS_DSP == 1)
+  if (arm_rfft_fast_init_f32(&pPsd->rfft, (uint16_t) fftLen) != ARM_MATH_SUCCESS)
+  {
+    return 1;
+  }
+#else
+  for (i = 0; i <= fftLen / 2U; i++)
+  {
+    pPsd->cosTable[i] = cosf(2.0f * (float) M_PI * (float) i / (float) fftLen);
+    pPsd->sinTable[i] = sinf(2.0f * (float) M_PI * (float) i / (float) fftLen);
+  }
+#endif /* (HSD_PSD_USE_CMSIS_DSP == 1) */
+
+  return 0;
+}
+
+/**
+  * @brief  Window a segment, compute its FFT and accumulate |X[k]|^2
+  * @param  pPsd: PSD instance
+  * @param  x: fftLen input samples
+  * @param  acc: fftLen / 2 + 1 accumulated bins
+  * @retval None
+  */
+void HSD_PSD_Accumulate(HSD_PSD_t *pPsd, const int16_t *x, float *acc)
+{
+  const uint32_t n = pPsd->fftLen;
+  float *work = pPsd->work;
+  float mean = 0.0f;
+  uint32_t i;
+  uint32_t k;
+
+  /* remove the mean so that gravity does not leak in the first bins */
+  for (i = 0; i < n; i++)
+  {
+    mean += (float) x[i];
+  }
+  mean /= (float) n;
+  for (i = 0; i < n; i++)
+  {
+    work[i] = ((float) x[i] - mean) * pPsd->window[i];
+  }
+
+#if (HSD_PSD_USE_CMSIS_DSP == 1)
+  {
+    float *s = pPsd->spectrum;
+
+    arm_rfft_fast_f32(&pPsd->rfft, work, s, 0);
+    /* packed output: X[0] and X[N/2] are real and share the first complex slot */
+    acc[0] += s[0] * s[0];
+    acc[n / 2U] += s[1] * s[1];
+    for (k = 1; k < n / 2U; k++)
+    {
+      acc[k] += s[2U * k] * s[2U * k] + s[2U * k + 1U] * s[2U * k + 1U];
+    }
+  }
+#else
+  {
+    /* real FFT of N points through a complex FFT of N/2 points: z[n] = x[2n] + j x[2n+1] */
+    const uint32_t half = n / 2U;
+    float zr, zi, cr, ci;
+    float evenRe, evenIm, oddRe, oddIm;
+
+    HSD_PSD_FFT(pPsd, work, half);
+
+    acc[0] += (work[0] + work[1]) * (work[0] + work[1]);
+    acc[half] += (work[0] - work[1]) * (work[0] - work[1]);
+    for (k = 1; k < half; k++)
+    {
+      zr = work[2U * k];
+      zi = work[2U * k + 1U];
+      cr = work[2U * (half - k)];
+      ci = -work[2U * (half - k) + 1U];
+      /* even part E = (Z[k] + conj(Z[N/2-k])) / 2, odd part O = (Z[k] - conj(Z[N/2-k])) / 2j */
+      evenRe = 0.5f * (zr + cr);
+      evenIm = 0.5f * (zi + ci);
+      oddRe = 0.5f * (zi - ci);
+      oddIm = -0.5f * (zr - cr);
+      /* X[k] = E + W_N^k O */
+      zr = evenRe + pPsd->cosTable[k] * oddRe + pPsd->sinTable[k] * oddIm;
+      zi = evenIm + pPsd->cosTable[k] * oddIm - pPsd->sinTable[k] * oddRe;
+      acc[k] += zr * zr + zi * zi;
+    }
+  }
+#endif /* (HSD_PSD_USE_CMSIS_DSP == 1) */
+}
+
+/**
+  * @brief  Factor that turns the accumulated |X[k]|^2 into a two-sided density
+  *         (interior bins of a one-sided PSD take twice this value)
+  * @param  pPsd: PSD instance
+  * @param  nSegments: number of accumulated segments
+  * @param  fs: sampling frequency [Hz]
+  * @retval scale factor [1/Hz]
+  */
+float HSD_PSD_Get_Scale(const HSD_PSD_t *pPsd, uint32_t nSegments, float fs)
+{
+  return 1.0f / ((float) nSegments * fs * pPsd->windowPower);
+}
+
+#if (HSD_PSD_USE_CMSIS_DSP == 0)
+/**
+  * @brief  In place radix-2 complex FFT
+  * @param  pPsd: PSD instance, provides the twiddle tables
+  * @param  buf: nComplex interleaved re, im values
+  * @param  nComplex: FFT length, power of 2, fftLen / 2 at most
+  * @retval None
+  */
+static void HSD_PSD_FFT(HSD_PSD_t *pPsd, float *buf, uint32_t nComplex)
+{
+  uint32_t i;
+  uint32_t j;
+  uint32_t k;
+  uint32_t len;
+  uint32_t step;
+  uint32_t a;
+  uint32_t b;
+  float tr;
+  float ti;
+  float wr;
+  float wi;
+
+  /* bit reversal permutation */
+  for (i = 1, j = 0; i < nComplex; i++)
+  {
+    k = nComplex >> 1;
+    while (j & k)
+    {
+      j ^= k;
+      k >>= 1;
+    }
+    j |= k;
+    if (i < j)
+    {
+      tr = buf[2U * i];
+      ti = buf[2U * i + 1U];
+      buf[2U * i] = buf[2U * j];
+      buf[2U * i + 1U] = buf[2U * j + 1U];
+      buf[2U * j] = tr;
+      buf[2U * j + 1U] = ti;
+    }
+  }
+
+  /* butterflies, W_len^m = W_N^(m * N / len) */
+  for (len = 2; len <= nComplex; len <<= 1)
+  {
+    step = pPsd->fftLen / len;
+    for (i = 0; i < nComplex; i += len)
+    {
+      for (k = 0; k < len / 2U; k++)
+      {
+        wr = pPsd->cosTable[k * step];
+        wi = -pPsd->sinTable[k * step];
+        a = 2U * (i + k);
+        b = 2U * (i + k + len / 2U);
+        tr = buf[b] * wr - buf[b + 1U] * wi;
+        ti = buf[b] * wi + buf[b + 1U] * wr;
+        buf[b] = buf[a] - tr;
+        buf[b + 1U] = buf[a + 1U] - ti;
+        buf[a] += tr;
+        buf[a + 1U] += ti;
+      }
+    }
+  }
+}
+#endif /* (HSD_PSD_USE_CMSIS_DSP == 0) */
@@ -0,0 +1,394 @@
+/**
+  ******************************************************************************
+  * @file    HSD_trigger.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Trigger of event-based SD logging. The watched subsensor is checked
+  *          in its data ready callback; each event lasts from the trigger until
+  *          postTriggerMs after the latest retrigger, and is listed in
+  *          AcquisitionInfo.json. The SD card manager keeps preTriggerMs of
+  *          history of every subsensor in RAM and writes it when an event starts.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCore.h"
+#include "HSD_trigger.h"
+#include "com_manager.h"
+#include "sensors_manager.h"
+#include "math.h"
+#include "string.h"
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  HSD_TimeStamp_t start;
+  HSD_TimeStamp_t end;
+} HSD_Trigger_Event_t;
+
+/* Private variables ---------------------------------------------------------*/
+static HSD_Trigger_Config_t s_xConfig =
+{
+  .mode = HSD_TRIGGER_MODE_NONE,
+  .axis = HSD_TRIGGER_ANY_AXIS,
+  .rmsWindow = 1,
+};
+
+static HSD_Trigger_Event_t s_xEvents[HSD_TRIGGER_MAX_EVENTS];
+static volatile uint32_t s_nEvents = 0;
+static volatile uint32_t s_nSequence = 0;
+static HSD_TimeStamp_t s_tEnd = 0;
+static uint8_t s_bEventListed = 0; /* the current event fit in s_xEvents */
+
+/* detector state */
+static float s_fSumSquares = 0.0f;
+static uint32_t s_nRmsSamples = 0;
+static float s_fLastValue[HSD_TRIGGER_MAX_AXES]; /* CLASS mode: previous value of each axis */
+static uint8_t s_bHasLastValue = 0;
+
+/* Private function prototypes -----------------------------------------------*/
+static inline float HSD_TRIGGER_Read(const uint8_t *buf, uint8_t dataType);
+static uint8_t HSD_TRIGGER_Check_Sample(const uint8_t *sample, uint32_t nAxes, uint32_t nBytesPerValue,
+                                        uint8_t dataType, float sensitivity);
+static void HSD_TRIGGER_Fire(HSD_TimeStamp_t timeStamp);
+
+/**
+  * @brief  Set the trigger configuration, used from the next acquisition
+  * @param  config: new configuration
+  * @retval None
+  */
+void HSD_TRIGGER_Set_Config(const HSD_Trigger_Config_t *config)
+{
+  s_xConfig = *config;
+  if (s_xConfig.rmsWindow == 0)
+  {
+    s_xConfig.rmsWindow = 1;
+  }
+}
+
+/**
+  * @brief  Get the trigger configuration
+  * @param  None
+  * @retval trigger configuration
+  */
+HSD_Trigger_Config_t *HSD_TRIGGER_Get_Config(void)
+{
+  return &s_xConfig;
+}
+
+/**
+  * @brief  Check if SD logging is event-based
+  * @param  None
+  * @retval 1 if a trigger is configured, 0 for continuous logging
+  */
+uint8_t HSD_TRIGGER_Is_Enabled(void)
+{
+#if (HSD_TRIGGER_ENABLE == 1)
+  return (s_xConfig.mode != HSD_TRIGGER_MODE_NONE) ? 1U : 0U;
+#else
+  return 0;
+#endif /* (HSD_TRIGGER_ENABLE == 1) */
+}
+
+/**
+  * @brief  Clear the events and the detector, called at the start of each acquisition
+  * @param  None
+  * @retval None
+  */
+void HSD_TRIGGER_Reset(void)
+{
+  taskENTER_CRITICAL();
+  s_nEvents = 0;
+  s_nSequence = 0;
+  s_tEnd = 0;
+  s_bEventListed = 0;
+  taskEXIT_CRITICAL();
+
+  s_fSumSquares = 0.0f;
+  s_nRmsSamples = 0;
+  memset(s_fLastValue, 0, sizeof(s_fLastValue));
+  s_bHasLastValue = 0;
+}
+
+/**
+  * @brief  Check a new batch of the watched subsensor
+  * @param  sensorId: sensor id
+  * @param  subSensorId: subsensor id
+  * @param  buf: batch of samples
+  * @param  size: batch size [bytes]
+  * @param  timeStamp: timestamp of the latest sample of the batch
+  * @retval None
+  */
+void HSD_TRIGGER_Process(uint8_t sensorId, uint8_t subSensorId, const uint8_t *buf, uint16_t size,
+                         HSD_TimeStamp_t timeStamp)
+{
+  COM_SubSensorDescriptor_t *pSubSensorDescriptor;
+  COM_SubSensorStatus_t *pSubSensorStatus;
+  uint32_t nBytesPerSample;
+  uint32_t nSamples;
+  uint32_t i;
+  float measuredODR;
+
+  if (HSD_TRIGGER_Is_Enabled() == 0 || sensorId != s_xConfig.sensorId || subSensorId != s_xConfig.subSensorId
+      || COM_GetSubSensorContext(sensorId, subSensorId)->first_dataReady)
+  {
+    return;
+  }
+
+  pSubSensorDescriptor = COM_GetSubSensorDescriptor(sensorId, subSensorId);
+  pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
+  nBytesPerSample = COM_GetnBytesPerSample(sensorId, subSensorId);
+  if (nBytesPerSample == 0)
+  {
+    return;
+  }
+  nSamples = size / nBytesPerSample;
+
+  for (i = 0; i < nSamples; i++)
+  {
+    if (HSD_TRIGGER_Check_Sample(&buf[i * nBytesPerSample], pSubSensorDescriptor->dimensions,
+                                 nBytesPerSample / pSubSensorDescriptor->dimensions, pSubSensorDescriptor->dataType,
+                                 pSubSensorStatus->sensitivity))
+    {
+      /* time of the sample that fired the trigger */
+      measuredODR = pSubSensorStatus->measuredODR;
+      if (measuredODR == 0.0f)
+      {
+        HSD_TRIGGER_Fire(timeStamp);
+      }
+      else
+      {
+#if (HSD_TIMESTAMP_TICKS == 1)
+        HSD_TRIGGER_Fire(timeStamp - (uint64_t)((float)(nSamples - 1U - i) * ((float) SystemCoreClock / measuredODR)));
+#else
+        HSD_TRIGGER_Fire(timeStamp - ((1.0 / (double) measuredODR) * (nSamples - 1U - i)));
+#endif /* HSD_TIMESTAMP_TICKS */
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Get the number of events started so far: a subsensor starts logging
+  *         when the sequence number differs from the last one it served
+  * @param  None
+  * @retval sequence number
+  */
+uint32_t HSD_TRIGGER_Get_Sequence(void)
+{
+  return s_nSequence;
+}
+
+/**
+  * @brief  Check if a time falls before the end of the latest event
+  * @param  timeStamp: time to be checked
+  * @retval 1 if data at timeStamp belong to the latest event, else 0
+  */
+uint8_t HSD_TRIGGER_Is_Recording(HSD_TimeStamp_t timeStamp)
+{
+  HSD_TimeStamp_t end;
+
+  taskENTER_CRITICAL();
+  end = s_tEnd;
+  taskEXIT_CRITICAL();
+
+  return (s_nSequence != 0 && timeStamp <= end) ? 1U : 0U;
+}
+
+/**
+  * @brief  Get the number of events of the acquisition
+  * @param  None
+  * @retval number of events
+  */
+uint32_t HSD_TRIGGER_Get_nEvents(void)
+{
+  return s_nEvents;
+}
+
+/**
+  * @brief  Get the time interval of an event
+  * @param  idx: event index
+  * @param  start: [out] trigger time [s]
+  * @param  end: [out] end of the post-trigger interval [s]
+  * @retval 0: ok, -1: no such event
+  */
+int32_t HSD_TRIGGER_Get_Event(uint32_t idx, double *start, double *end)
+{
+  if (idx >= s_nEvents)
+  {
+    return -1;
+  }
+
+  taskENTER_CRITICAL();
+#if (HSD_TIMESTAMP_TICKS == 1)
+  *start = (double) s_xEvents[idx].start / (double) SystemCoreClock;
+  *end = (double) s_xEvents[idx].end / (double) SystemCoreClock;
+#else
+  *start = (double) s_xEvents[idx].start;
+  *end = (double) s_xEvents[idx].end;
+#endif /* HSD_TIMESTAMP_TICKS */
+  taskEXIT_CRITICAL();
+
+  return 0;
+}
+
+/**
+  * @brief  Read one value of a sample
+  * @param  buf: pointer to the value
+  * @param  dataType: DATA_TYPE_xxx of the subsensor
+  * @retval value
+  */
+static inline float HSD_TRIGGER_Read(const uint8_t *buf, uint8_t dataType)
+{
+  switch (dataType)
+  {
+    case DATA_TYPE_INT16:
+      return (float) * (const int16_t *) buf;
+    case DATA_TYPE_FLOAT:
+      return * (const float *) buf;
+    case DATA_TYPE_UINT16:
+      return (float) * (const uint16_t *) buf;
+    case DATA_TYPE_INT32:
+      return (float) * (const int32_t *) buf;
+    case DATA_TYPE_UINT32:
+      return (float) * (const uint32_t *) buf;
+    case DATA_TYPE_INT8:
+      return (float) * (const int8_t *) buf;
+    default:
+      return (float) * buf;
+  }
+}
+
+/**
+  * @brief  Run the detector on one sample
+  * @param  sample: pointer to the sample
+  * @param  nAxes: dimensions of the subsensor
+  * @param  nBytesPerValue: size of one axis
+  * @param  dataType: DATA_TYPE_xxx of the subsensor
+  * @param  sensitivity: sensitivity of the subsensor
+  * @retval 1 if the sample fires the trigger, else 0
+  */
+static uint8_t HSD_TRIGGER_Check_Sample(const uint8_t *sample, uint32_t nAxes, uint32_t nBytesPerValue,
+                                        uint8_t dataType, float sensitivity)
+{
+  uint32_t axis;
+  uint32_t first = 0;
+  uint32_t last = nAxes;
+  uint8_t fired = 0;
+  float x;
+  float rms;
+
+  if (s_xConfig.axis != HSD_TRIGGER_ANY_AXIS)
+  {
+    if (s_xConfig.axis >= nAxes)
+    {
+      return 0;
+    }
+    first = s_xConfig.axis;
+    last = first + 1U;
+  }
+
+  switch (s_xConfig.mode)
+  {
+    case HSD_TRIGGER_MODE_LEVEL:
+      for (axis = first; axis < last; axis++)
+      {
+        x = HSD_TRIGGER_Read(&sample[axis * nBytesPerValue], dataType) * sensitivity;
+        if (fabsf(x) >= s_xConfig.threshold)
+        {
+          fired = 1;
+        }
+      }
+      break;
+
+    case HSD_TRIGGER_MODE_RMS:
+      /* tumbling windows: with HSD_TRIGGER_ANY_AXIS the RMS of the vector magnitude */
+      for (axis = first; axis < last; axis++)
+      {
+        x = HSD_TRIGGER_Read(&sample[axis * nBytesPerValue], dataType) * sensitivity;
+        s_fSumSquares += x * x;
+      }
+      if (++s_nRmsSamples == s_xConfig.rmsWindow)
+      {
+        rms = sqrtf(s_fSumSquares / (float) s_nRmsSamples);
+        fired = (rms >= s_xConfig.threshold) ? 1U : 0U;
+        s_fSumSquares = 0.0f;
+        s_nRmsSamples = 0;
+      }
+      break;
+
+    case HSD_TRIGGER_MODE_CLASS:
+      /* each axis is compared with its own previous value */
+      last = HSD_MIN(last, HSD_TRIGGER_MAX_AXES);
+      for (axis = first; axis < last; axis++)
+      {
+        x = HSD_TRIGGER_Read(&sample[axis * nBytesPerValue], dataType);
+        if (s_bHasLastValue && x != s_fLastValue[axis])
+        {
+          fired = 1;
+        }
+        s_fLastValue[axis] = x;
+      }
+      s_bHasLastValue = 1;
+      break;
+
+    default:
+      break;
+  }
+
+  return fired;
+}
+
+/**
+  * @brief  Start a new event, or extend the current one
+  * @param  timeStamp: time of the sample that fired the trigger
+  * @retval None
+  */
+static void HSD_TRIGGER_Fire(HSD_TimeStamp_t timeStamp)
+{
+#if (HSD_TIMESTAMP_TICKS == 1)
+  HSD_TimeStamp_t end = timeStamp + (uint64_t) s_xConfig.postTriggerMs * (SystemCoreClock / 1000U);
+#else
+  HSD_TimeStamp_t end = timeStamp + (double) s_xConfig.postTriggerMs / 1000.0;
+#endif /* HSD_TIMESTAMP_TICKS */
+
+  taskENTER_CRITICAL();
+  if (s_nSequence != 0 && timeStamp <= s_tEnd)
+  {
+    /* retrigger: the event goes on */
+    s_tEnd = end;
+    if (s_bEventListed)
+    {
+      s_xEvents[s_nEvents - 1U].end = end;
+    }
+  }
+  else
+  {
+    s_tEnd = end;
+    if (s_nEvents < HSD_TRIGGER_MAX_EVENTS)
+    {
+      s_xEvents[s_nEvents].start = timeStamp;
+      s_xEvents[s_nEvents].end = end;
+      s_nEvents++;
+      s_bEventListed = 1;
+    }
+    else
+    {
+      s_bEventListed = 0;
+    }
+    s_nSequence++;
+  }
+  taskEXIT_CRITICAL();
+}
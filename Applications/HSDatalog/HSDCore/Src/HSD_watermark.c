@@ -0,0 +1,261 @@
+/**
+  ******************************************************************************
+  * @file    HSD_watermark.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   FIFO watermark policy shared by the sensors.
+  *          Each sensor registers how it is read (FIFO depth, watermark range,
+  *          bytes per word, bus) and, at each acquisition start, asks for its
+  *          watermark. The levels are computed from the whole current
+  *          configuration, so that:
+  *          - the sensor threads wake up HSD_WTM_TARGET_WAKEUPS times per second
+  *            in total, sensors read once per sample included, with the same
+  *            batch period for all the FIFOs when they allow it;
+  *          - no sample waits more than HSD_WTM_LATENCY_MS in a FIFO;
+  *          - each FIFO keeps room for the samples arriving while its IRQ waits
+  *            for the bursts of all the sensors on the same bus, longer as the
+  *            bus gets busier.
+  *          Sensors whose watermark is capped wake up more often, the others
+  *          share what is left of the wake-up budget.
+  *          The same description gives the slack of each sensor, the time its
+  *          reads can wait for the bus, used by the bus scheduler.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_watermark.h"
+#include "com_manager.h"
+#include "sensors_manager.h"
+
+/* Private define ------------------------------------------------------------*/
+#define HSD_WTM_MAX_BUS_LOAD            0.9f  /* bus occupancy used for the queueing delay is capped here */
+
+/* Private variables ---------------------------------------------------------*/
+static const HSD_WTM_Fifo_t *HSD_WTM_Fifo[COM_MAX_SENSORS];
+
+/* Private function prototypes -----------------------------------------------*/
+static float HSD_WTM_Bus_ByteRate(uint8_t bus);
+static float HSD_WTM_Word_Rate(uint8_t sId);
+
+/**
+  * @brief  Register how a sensor is read
+  * @param  sId: sensor id
+  * @param  pFifo: FIFO description, must stay valid (static)
+  * @retval None
+  */
+void HSD_WTM_Register(uint8_t sId, const HSD_WTM_Fifo_t *pFifo)
+{
+  if (sId < COM_MAX_SENSORS)
+  {
+    HSD_WTM_Fifo[sId] = pFifo;
+  }
+}
+
+/**
+  * @brief  Watermark of a sensor for the current configuration
+  * @param  sId: sensor id, registered with a FIFO
+  * @retval Watermark [words], 0 if the sensor is not registered
+  */
+uint16_t HSD_WTM_Get_Level(uint8_t sId)
+{
+  float rate[COM_MAX_SENSORS];
+  float cap[COM_MAX_SENSORS];
+  uint8_t capped[COM_MAX_SENSORS];
+  float busLoad[HSD_WTM_N_BUS] = {0.0f};
+  float busBurst[HSD_WTM_N_BUS] = {0.0f};
+  float latency = (float) HSD_WTM_LATENCY_MS / 1000.0f;
+  float budget = (float) HSD_WTM_TARGET_WAKEUPS;
+  float period = latency;
+  float level;
+  const HSD_WTM_Fifo_t *pFifo;
+  uint8_t nSensors = COM_GetDevice()->deviceDescriptor.nSensor;
+  uint8_t i;
+  uint8_t pass;
+
+  if ((sId >= nSensors) || (HSD_WTM_Fifo[sId] == NULL) || (HSD_WTM_Fifo[sId]->depth == 0U))
+  {
+    return 0;
+  }
+
+  /* Word rates, bus occupancy and longest bursts */
+  for (i = 0; i < nSensors; i++)
+  {
+    pFifo = HSD_WTM_Fifo[i];
+    rate[i] = (pFifo != NULL) ? HSD_WTM_Word_Rate(i) : 0.0f;
+    capped[i] = 0;
+
+    if (rate[i] > 0.0f)
+    {
+      float burst = (float) pFifo->bytesPerWord * ((pFifo->depth != 0U) ? (float) pFifo->maxLevel : 1.0f);
+
+      busLoad[pFifo->bus] += rate[i] * (float) pFifo->bytesPerWord / HSD_WTM_Bus_ByteRate(pFifo->bus);
+      busBurst[pFifo->bus] += (burst + 1.0f) / HSD_WTM_Bus_ByteRate(pFifo->bus);
+
+      if (pFifo->depth == 0U)
+      {
+        budget -= rate[i]; /* read once per sample */
+      }
+    }
+  }
+
+  /* Largest watermark of each FIFO: register, buffer, latency and room for the samples arriving during the read */
+  for (i = 0; i < nSensors; i++)
+  {
+    pFifo = HSD_WTM_Fifo[i];
+
+    if ((rate[i] > 0.0f) && (pFifo->depth != 0U))
+    {
+      float load = HSD_MIN(busLoad[pFifo->bus], HSD_WTM_MAX_BUS_LOAD);
+      float service = ((float) HSD_WTM_SERVICE_MS / 1000.0f + busBurst[pFifo->bus]) / (1.0f - load);
+
+      cap[i] = HSD_MIN((float) pFifo->maxLevel, (float) pFifo->depth - rate[i] * service);
+      cap[i] = HSD_MIN(cap[i], rate[i] * latency);
+      cap[i] = HSD_MAX((float)(int32_t) cap[i], 1.0f);
+    }
+  }
+
+  /* Common batch period: the FIFOs that cannot hold it are capped and their wake-ups leave the budget */
+  for (pass = 0; pass < nSensors; pass++)
+  {
+    float cappedRate = 0.0f;
+    uint8_t nFree = 0;
+    uint8_t changed = 0;
+
+    for (i = 0; i < nSensors; i++)
+    {
+      if ((rate[i] > 0.0f) && (HSD_WTM_Fifo[i]->depth != 0U))
+      {
+        if (capped[i])
+        {
+          cappedRate += rate[i] / cap[i];
+        }
+        else
+        {
+          nFree++;
+        }
+      }
+    }
+
+    if (nFree == 0U)
+    {
+      break;
+    }
+
+    period = (budget - cappedRate > 0.0f) ? ((float) nFree / (budget - cappedRate)) : latency;
+    period = HSD_MIN(period, latency);
+
+    for (i = 0; i < nSensors; i++)
+    {
+      if ((rate[i] > 0.0f) && (HSD_WTM_Fifo[i]->depth != 0U) && !capped[i] && (rate[i] * period > cap[i]))
+      {
+        capped[i] = 1;
+        changed = 1;
+      }
+    }
+
+    if (!changed)
+    {
+      break;
+    }
+  }
+
+  pFifo = HSD_WTM_Fifo[sId];
+
+  if (rate[sId] <= 0.0f)
+  {
+    return pFifo->minLevel;
+  }
+
+  level = capped[sId] ? cap[sId] : HSD_MAX(rate[sId] * period + 0.5f, (float) pFifo->minLevel);
+  level = HSD_MIN(level, cap[sId]);
+
+  return (uint16_t) level;
+}
+
+/**
+  * @brief  Time a sensor can wait for the bus once its watermark is reached, before its FIFO overflows
+  * @param  sId: sensor id
+  * @param  level: watermark in use [words], not used for the sensors read once per sample
+  * @retval Slack [us], 0 if unknown (sensor not registered or not active)
+  */
+uint32_t HSD_WTM_Get_Slack(uint8_t sId, uint16_t level)
+{
+  const HSD_WTM_Fifo_t *pFifo;
+  float rate;
+  float free;
+
+  if ((sId >= COM_MAX_SENSORS) || (HSD_WTM_Fifo[sId] == NULL))
+  {
+    return 0;
+  }
+
+  pFifo = HSD_WTM_Fifo[sId];
+  rate = HSD_WTM_Word_Rate(sId);
+
+  if (rate <= 0.0f)
+  {
+    return 0;
+  }
+
+  /* A sensor read once per sample must be read before the next sample */
+  free = (pFifo->depth != 0U) ? (float)(pFifo->depth - HSD_MIN(level, pFifo->depth)) : 1.0f;
+
+  return (uint32_t)(1000000.0f * free / rate);
+}
+
+/**
+  * @brief  Bytes per second of a bus
+  * @param  bus: HSD_WTM_BUS_xxx
+  * @retval Byte rate
+  */
+static float HSD_WTM_Bus_ByteRate(uint8_t bus)
+{
+  if ((bus == HSD_WTM_BUS_SPI1) || (bus == HSD_WTM_BUS_SPI3))
+  {
+    return (float) SM_SPI_BITRATE / 8.0f;
+  }
+  return (float) SM_I2C_BITRATE / 9.0f; /* 8 bits + ACK */
+}
+
+/**
+  * @brief  Words per second written in the FIFO of a sensor (samples per second if read once per sample),
+  *         timestamp words included
+  * @param  sId: sensor id, registered
+  * @retval Word rate, 0 if none of its FIFO subsensors is active
+  */
+static float HSD_WTM_Word_Rate(uint8_t sId)
+{
+  const HSD_WTM_Fifo_t *pFifo = HSD_WTM_Fifo[sId];
+  float rate = 0.0f;
+  float maxOdr = 0.0f;
+  uint8_t ssId;
+
+  for (ssId = 0; ssId < COM_GetSubSensorNumber(sId); ssId++)
+  {
+    COM_SubSensorStatus_t *pStatus = COM_GetSubSensorStatus(sId, ssId);
+
+    if (((pFifo->subSensorMask & (1U << ssId)) != 0U) && pStatus->isActive)
+    {
+      rate = pFifo->wordPerSubSensor ? (rate + pStatus->ODR) : HSD_MAX(rate, pStatus->ODR);
+      maxOdr = HSD_MAX(maxOdr, pStatus->ODR);
+    }
+  }
+  /* the timestamp is decimated on the fastest subsensor */
+  if (pFifo->tsDecimation > 0U)
+  {
+    rate += maxOdr / (float) pFifo->tsDecimation;
+  }
+  return rate;
+}
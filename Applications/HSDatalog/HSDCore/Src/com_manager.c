@@ -29,6 +29,11 @@
 volatile COM_Device_t COM_device = {{0, 0, 0, 0}};
 volatile COM_AcquisitionDescriptor_t COM_acquisition_descriptor;
 volatile uint8_t com_status = HS_DATALOG_IDLE;
+COM_SDStats_t COM_sd_stats;
+COM_BusStats_t COM_bus_stats[COM_N_BUS];
+volatile uint32_t COM_context_switches;
+COM_LatencyHistogram_t COM_irq_latency;
+COM_SlotStats_t COM_slot_stats;
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
@@ -237,12 +242,146 @@ COM_SubSensorContext_t *COM_GetSubSensorContext(uint8_t sID, uint8_t ssID)
   */
 void COM_ResetSubSensorContext(uint8_t sID, uint8_t ssID)
 {
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sID, ssID);
   COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
 
-  pSubSensorContext->n_samples_acc = 0.0f;
-  pSubSensorContext->old_time_stamp = 0.0;
+  pSubSensorStatus->timestampJitter = 0.0f;
+  pSubSensorStatus->timestampJitterMax = 0.0f;
+  pSubSensorStatus->timestampOutliers = 0;
+  pSubSensorContext->n_samples_total = 0;
+  pSubSensorContext->old_time_stamp = 0;
   pSubSensorContext->first_dataReady = 1;
   pSubSensorContext->n_samples_to_timestamp = 0;
+  pSubSensorContext->batch_time_stamp = 0;
+  pSubSensorContext->batch_samples_left = 0;
+  pSubSensorContext->sd_wrap_staged = 0;
+  pSubSensorContext->sd_batch_dropped = 0;
+}
+
+/**
+  * @brief Get SD logging statistics
+  * @param None
+  * @retval SD logging statistics
+  */
+COM_SDStats_t *COM_GetSDStats(void)
+{
+  return &COM_sd_stats;
+}
+
+/**
+  * @brief Get sensor bus statistics
+  * @param bus COM_BUS_xxx
+  * @retval Bus statistics
+  */
+COM_BusStats_t *COM_GetBusStats(uint8_t bus)
+{
+  return &COM_bus_stats[bus];
+}
+
+/**
+  * @brief Get the histogram of the time from a sensor data ready interrupt to the run of its thread
+  * @param None
+  * @retval Interrupt to thread latency
+  */
+COM_LatencyHistogram_t *COM_GetIrqLatency(void)
+{
+  return &COM_irq_latency;
+}
+
+/**
+  * @brief Get the statistics of the bus transaction slots
+  * @param None
+  * @retval Transaction slots statistics
+  */
+COM_SlotStats_t *COM_GetSlotStats(void)
+{
+  return &COM_slot_stats;
+}
+
+/**
+  * @brief Reset sensor bus statistics, transaction slots statistics, the interrupt to thread latency and the context
+  *        switch count
+  * @param None
+  * @retval None
+  */
+void COM_ResetBusStats(void)
+{
+  memset(COM_bus_stats, 0, sizeof(COM_bus_stats));
+  memset(&COM_slot_stats, 0, sizeof(COM_slot_stats));
+  memset(&COM_irq_latency, 0, sizeof(COM_irq_latency));
+  COM_context_switches = 0;
+}
+
+/**
+  * @brief Count a context switch, called by the FreeRTOS trace hook
+  * @param None
+  * @retval None
+  */
+void COM_CountContextSwitch(void)
+{
+  COM_context_switches++;
+}
+
+/**
+  * @brief Get the number of context switches since the last COM_ResetBusStats
+  * @param None
+  * @retval Context switches
+  */
+uint32_t COM_GetContextSwitches(void)
+{
+  return COM_context_switches;
+}
+
+/**
+  * @brief Reset SD logging statistics, including the per SubSensor counters
+  * @param None
+  * @retval None
+  */
+void COM_ResetSDStats(void)
+{
+  COM_SubSensorContext_t *pSubSensorContext;
+  uint32_t ii;
+  uint32_t jj;
+
+  memset(&COM_sd_stats, 0, sizeof(COM_SDStats_t));
+
+  for (ii = 0; ii < COM_device.deviceDescriptor.nSensor; ii++)
+  {
+    for (jj = 0; jj < COM_device.sensors[ii]->sensorDescriptor.nSubSensors; jj++)
+    {
+      pSubSensorContext = COM_GetSubSensorContext(ii, jj);
+      pSubSensorContext->sd_overrun_count = 0;
+      pSubSensorContext->sd_dropped_bytes = 0;
+      pSubSensorContext->sd_ring_hwm = 0;
+      pSubSensorContext->codec_in_bytes = 0;
+      pSubSensorContext->codec_out_bytes = 0;
+      pSubSensorContext->codec_cycles = 0;
+    }
+  }
+}
+
+/**
+  * @brief Add a sample to a latency histogram
+  * @param hist histogram to be updated
+  * @param latency_us measured latency in us
+  * @retval None
+  */
+void COM_AddLatencySample(COM_LatencyHistogram_t *hist, uint32_t latency_us)
+{
+  uint32_t k = 0;
+
+  /* k = floor(log2(latency_us)), saturated to the last bucket */
+  while ((k < COM_LATENCY_BUCKETS - 1U) && ((latency_us >> (k + 1U)) != 0U))
+  {
+    k++;
+  }
+
+  hist->bucket[k]++;
+  hist->count++;
+  if (latency_us > hist->max_us)
+  {
+    hist->max_us = latency_us;
+  }
 }
 
 /**
@@ -328,6 +467,22 @@ uint32_t COM_GetnBytesPerSample(uint8_t sID, uint8_t ssID)
   }
 }
 
+/**
+  * @brief Get the rate of the data sent by a subsensor, decimation included
+  * @param pSubSensorStatus: subsensor status
+  * @retval ODR of the data sent
+  */
+float COM_GetEffectiveODR(COM_SubSensorStatus_t *pSubSensorStatus)
+{
+#if (HSD_DECIMATOR_ENABLE == 1)
+  if (pSubSensorStatus->decimation > 1U)
+  {
+    return pSubSensorStatus->ODR / (float) pSubSensorStatus->decimation;
+  }
+#endif /* (HSD_DECIMATOR_ENABLE == 1) */
+  return pSubSensorStatus->ODR;
+}
+
 uint8_t COM_IsOdrLegal(float value, uint8_t sID, uint8_t ssID)
 {
   uint16_t i = 0;
@@ -94,6 +94,16 @@ void set_device_description(HSD_DeviceDescriptor_Init_t *init)
   strcpy(pDeviceDescriptor->dataFileExt, HSD_DATA_FILE_EXTENSION);
   strcpy(pDeviceDescriptor->dataFileFormat, HSD_DATA_FILE_FORMAT);
   strcpy(pDeviceDescriptor->bleMacAddress, init->bleMacAddress);
+#if (HSD_TIMESTAMP_TICKS == 1)
+  pDeviceDescriptor->tsFrequency = SystemCoreClock;
+#else
+  pDeviceDescriptor->tsFrequency = 0;
+#endif /* HSD_TIMESTAMP_TICKS */
+#if (HSD_COMPACT_TIMESTAMPS == 1)
+  pDeviceDescriptor->chunkTsFrequency = SystemCoreClock >> HSD_COMPACT_TS_SHIFT;
+#else
+  pDeviceDescriptor->chunkTsFrequency = 0;
+#endif /* HSD_COMPACT_TIMESTAMPS */
 }
 
 void update_sensorStatus(COM_SensorStatus_t *oldSensorStatus, COM_SensorStatus_t *newSensorStatus, uint8_t sID)
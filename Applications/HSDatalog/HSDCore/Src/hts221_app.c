@@ -22,6 +22,7 @@
 #include "main.h"
 #include "hts221_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include "device_description.h"
 
 /* Private includes ----------------------------------------------------------*/
@@ -36,7 +37,12 @@
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nHTS221_id = -1;
 
-static volatile double TimeStamp_hts221;
+static const HSD_WTM_Fifo_t hts221_wtm_fifo =
+{
+  0, 0, 0, 4, 0x03U, 0, HSD_WTM_BUS_I2C1, 0
+};
+
+static volatile HSD_TimeStamp_t TimeStamp_hts221;
 
 static float x0_t = 0, y0_t = 0, x1_t = 0, y1_t = 0;
 static float x0_h = 0, y0_h = 0, x1_h = 0, y1_h = 0;
@@ -46,13 +52,13 @@ SM_Sensor_State_t HTS221_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
 EXTI_HandleTypeDef hts221_exti;
 
-/* Semaphore used to wait on component interrupt */
-static osSemaphoreId hts221_drdy_sem_id;
-static osSemaphoreDef(hts221_drdy_sem);
+osThreadId HTS221_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId hts221_read_cplt_sem_id;
-static osSemaphoreDef(hts221_read_cplt_sem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t hts221_notifier =
+{
+  &HTS221_Thread_Id
+};
 
 static sensor_handle_t hts221_hdl_instance =
 {
@@ -60,7 +66,7 @@ static sensor_handle_t hts221_hdl_instance =
   HTS221_I2C_ADDRESS,
   NULL,
   0,
-  &hts221_read_cplt_sem_id
+  &hts221_notifier
 };
 static stmdev_ctx_t hts221_ctx_instance =
 {
@@ -72,7 +78,6 @@ static stmdev_ctx_t hts221_ctx_instance =
 
 /* Private function prototypes -----------------------------------------------*/
 
-osThreadId HTS221_Thread_Id;
 static void HTS221_Thread(void const *argument);
 
 static void HTS221_Int_Callback(void);
@@ -114,16 +119,8 @@ void HTS221_Peripheral_Init(void)
   */
 void HTS221_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  hts221_read_cplt_sem_id = osSemaphoreCreate(osSemaphore(hts221_read_cplt_sem), 1);
-  osSemaphoreWait(hts221_read_cplt_sem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  hts221_drdy_sem_id = osSemaphoreCreate(osSemaphore(hts221_drdy_sem), 1);
-  osSemaphoreWait(hts221_drdy_sem_id, osWaitForever);
-
   /* Thread definition: read data */
-  osThreadDef(HTS221_Acquisition_Thread, HTS221_Thread, HSD_HTS221_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(HTS221_Acquisition_Thread, HTS221_Thread, HSD_HTS221_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   HTS221_Thread_Id = osThreadCreate(osThread(HTS221_Acquisition_Thread), NULL);
 }
@@ -136,6 +133,7 @@ void HTS221_OS_Init(void)
 static void HTS221_Thread(void const *argument)
 {
   (void) argument;
+  uint32_t events;
 
 #if (HSD_USE_DUMMY_DATA == 1)
   static uint16_t dummyDataCounter_hum = 0;
@@ -162,9 +160,10 @@ static void HTS221_Thread(void const *argument)
       float hts221_temp_f;
       float hts221_hum_f;
 
-      osSemaphoreWait(hts221_drdy_sem_id, osWaitForever);
+      events = SM_Wait(&hts221_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (HTS221_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (HTS221_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
         hts221_temperature_raw_get(&hts221_ctx_instance, &data_raw_temperature.i16bit);
 
@@ -301,13 +300,16 @@ static void HTS221_Sensor_Init(void)
 
   /* Power Up */
   hts221_power_on_set(&hts221_ctx_instance, PROPERTY_ENABLE);
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  hts221_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nHTS221_id, 0);
 }
 
 /* Data Ready */
 static void HTS221_Int_Callback(void)
 {
-  TimeStamp_hts221 = SM_GetTimeStamp_fromISR();
-  osSemaphoreRelease(hts221_drdy_sem_id);
+  TimeStamp_hts221 = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&hts221_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void HTS221_Set_State(SM_Sensor_State_t state)
@@ -315,6 +317,11 @@ void HTS221_Set_State(SM_Sensor_State_t state)
   HTS221_Sensor_State = state;
 }
 
+SM_Sensor_State_t HTS221_Get_State(void)
+{
+  return HTS221_Sensor_State;
+}
+
 void HTS221_Start(void)
 {
   HTS221_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -324,9 +331,10 @@ void HTS221_Start(void)
 void HTS221_Stop(void)
 {
   HTS221_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&hts221_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void HTS221_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void HTS221_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -357,6 +365,8 @@ uint8_t HTS221_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nHTS221_id, &hts221_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nHTS221_id);
 
   /* SENSOR DESCRIPTOR */
@@ -46,28 +46,27 @@ static int32_t s_nIIS2DH_id = 0;
 static uint8_t iis2dh_mem[32 * 7];
 
 static uint16_t taskDelay = DEFAULT_TASK_DELAY;
-static volatile double TimeStamp_iis2dh;
+static volatile HSD_TimeStamp_t TimeStamp_iis2dh;
 volatile uint8_t testWTM = 0;
 
 SM_Init_Param_t IIS2DH_Init_Param;
 SM_Sensor_State_t IIS2DH_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
-/* Semaphore used to wait on component interrupt */
-osSemaphoreId  iis2dh_DreadySem_id;
-osSemaphoreDef(iis2dh_DreadySem);
+osThreadId IIS2DH_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-osSemaphoreId  iis2dhReadSem_id;
-osSemaphoreDef(iis2dhReadSem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t iis2dh_notifier =
+{
+  &IIS2DH_Thread_Id
+};
 
 static sensor_handle_t iis2dh_hdl_instance = {IIS2DH_ID, 0, IIS2DH_SPI_CS_GPIO_Port, IIS2DH_SPI_CS_Pin,
-                                              &iis2dhReadSem_id
+                                              &iis2dh_notifier
                                              };
 static stmdev_ctx_t iis2dh_ctx_instance = {SM_SPI_Write_Os, SM_SPI_Read_Os, & iis2dh_hdl_instance};
 
 /* Private function prototypes -----------------------------------------------*/
 
-osThreadId IIS2DH_Thread_Id;
 static void IIS2DH_Thread(void const *argument);
 
 EXTI_HandleTypeDef iis2dh_exti;
@@ -117,14 +116,6 @@ void IIS2DH_Peripheral_Init(void)
 
 void IIS2DH_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  iis2dhReadSem_id = osSemaphoreCreate(osSemaphore(iis2dhReadSem), 1);
-  osSemaphoreWait(iis2dhReadSem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  iis2dh_DreadySem_id = osSemaphoreCreate(osSemaphore(iis2dh_DreadySem), 1);
-  osSemaphoreWait(iis2dh_DreadySem_id,  osWaitForever);
-
   /* Thread 1 definition */
   osThreadDef(IIS2DH_RD_USR_THREAD, IIS2DH_Thread, HSD_IIS2DH_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
   /* Start thread 1 */
@@ -166,7 +157,7 @@ static void IIS2DH_Thread(void const *argument)
 
         /* This needs to be after iis2dh_fifo_data_level_get to be
             closer to the real acquisition of the last item in FIFO */
-        TimeStamp_iis2dh = SM_GetTimeStamp();
+        TimeStamp_iis2dh = SM_GetSensorTimeStamp();
 
         iis2dh_read_reg(& iis2dh_ctx_instance, IIS2DH_OUT_X_L, (uint8_t *) iis2dh_mem, testWTM * 6);
 
@@ -298,7 +289,7 @@ static void IIS2DH_Sensor_Init(void)
 
 static void IIS2DH_Int_Callback(void)
 {
-  osSemaphoreRelease(iis2dh_DreadySem_id);
+  SM_Notify_fromISR(&iis2dh_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void IIS2DH_Set_State(SM_Sensor_State_t state)
@@ -317,7 +308,7 @@ void IIS2DH_Stop(void)
   IIS2DH_Set_State(SM_SENSOR_STATE_SUSPENDING);
 }
 
-__weak void IIS2DH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void IIS2DH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
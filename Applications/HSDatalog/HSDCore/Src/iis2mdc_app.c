@@ -36,25 +36,24 @@
 static int32_t s_nIIS2MDC_id = 0;
 
 static uint8_t iis2mdc_mem[6];
-static volatile double TimeStamp_iis2mdc;
+static volatile HSD_TimeStamp_t TimeStamp_iis2mdc;
 
 SM_Init_Param_t IIS2MDC_Init_Param;
 SM_Sensor_State_t IIS2MDC_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
-/* Semaphore used to wait on component interrupt */
-static osSemaphoreId iis2mdc_data_ready_sem_id;
-static osSemaphoreDef(iis2mdc_data_ready_sem);
+osThreadId IIS2MDC_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId iis2mdc_data_read_cmplt_sem_id;
-static osSemaphoreDef(iis2mdc_data_read_cmplt_sem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t iis2mdc_notifier =
+{
+  &IIS2MDC_Thread_Id
+};
 
-static sensor_handle_t iis2mdc_hdl_instance = {0, IIS2MDC_I2C_ADD, NULL, 0, &iis2mdc_data_read_cmplt_sem_id};
+static sensor_handle_t iis2mdc_hdl_instance = {0, IIS2MDC_I2C_ADD, NULL, 0, &iis2mdc_notifier};
 static stmdev_ctx_t iis2mdc_ctx_instance = {SM_I2C_Write_Os, SM_I2C_Read_Os, &iis2mdc_hdl_instance};
 
 /* Private function prototypes -----------------------------------------------*/
 
-osThreadId IIS2MDC_Thread_Id;
 static void IIS2MDC_Thread(void const *argument);
 
 EXTI_HandleTypeDef iis2mdc_exti;
@@ -95,14 +94,6 @@ void IIS2MDC_Peripheral_Init(void)
   */
 void IIS2MDC_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  iis2mdc_data_read_cmplt_sem_id = osSemaphoreCreate(osSemaphore(iis2mdc_data_read_cmplt_sem), 1);
-  osSemaphoreWait(iis2mdc_data_read_cmplt_sem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  iis2mdc_data_ready_sem_id = osSemaphoreCreate(osSemaphore(iis2mdc_data_ready_sem), 1);
-  osSemaphoreWait(iis2mdc_data_ready_sem_id,  osWaitForever);
-
   /* Thread definition: read data */
   osThreadDef(IIS2MDC_Acquisition_Thread, IIS2MDC_Thread, HSD_IIS2MDC_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
   /* Start thread 1 */
@@ -113,6 +104,7 @@ void IIS2MDC_OS_Init(void)
 static void IIS2MDC_Thread(void const *argument)
 {
   (void) argument;
+  uint32_t events;
 
 #if (configUSE_APPLICATION_TASK_TAG == 1 && defined(HSD_TASK_IIS2MDC_DEBUG_PIN))
   vTaskSetApplicationTaskTag(NULL, (TaskHookFunction_t)HSD_TASK_IIS2MDC_DEBUG_PIN);
@@ -134,9 +126,10 @@ static void IIS2MDC_Thread(void const *argument)
     }
     else if (IIS2MDC_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      osSemaphoreWait(iis2mdc_data_ready_sem_id,  osWaitForever);
+      events = SM_Wait(&iis2mdc_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (IIS2MDC_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (IIS2MDC_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
         iis2mdc_magnetic_raw_get(&iis2mdc_ctx_instance, (int16_t *)iis2mdc_mem);
 
@@ -200,8 +193,8 @@ static void IIS2MDC_Sensor_Init(void)
 
 static void IIS2MDC_Int_Callback(void)
 {
-  TimeStamp_iis2mdc = SM_GetTimeStamp_fromISR();
-  osSemaphoreRelease(iis2mdc_data_ready_sem_id);
+  TimeStamp_iis2mdc = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&iis2mdc_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void IIS2MDC_Set_State(SM_Sensor_State_t state)
@@ -218,9 +211,10 @@ void IIS2MDC_Start(void)
 void IIS2MDC_Stop(void)
 {
   IIS2MDC_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&iis2mdc_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void IIS2MDC_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void IIS2MDC_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -25,45 +25,75 @@
 #include "main.h"
 #include "iis3dwb_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include <string.h>
+#include <math.h>
+#if (IIS3DWB_PSD_ENABLE == 1)
+#include "HSD_psd.h"
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
 
 /* Private includes ----------------------------------------------------------*/
 #define WRITE_BUFFER_SIZE_IIS3DWB        (uint32_t)(32768)
 
 /* Private typedef -----------------------------------------------------------*/
 /* Private define ------------------------------------------------------------*/
+#if (FFT_LEN_AXL & (FFT_LEN_AXL - 1U)) != 0 || (FFT_LEN_AXL < 8U)
+#error "FFT_LEN_AXL must be a power of 2"
+#endif
+#if (IIS3DWB_PSD_ENABLE == 1) && (FFT_LEN_AXL > HSD_PSD_MAX_FFT_LEN)
+#error "FFT_LEN_AXL exceeds HSD_PSD_MAX_FFT_LEN"
+#endif
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nIIS3DWB_id = 0;
 
 static uint8_t iis3dwb_mem[IIS3DWB_MAX_SAMPLES_PER_IT * 7];
-static volatile double TimeStamp_iis3dwb;
+static volatile HSD_TimeStamp_t TimeStamp_iis3dwb;
 uint16_t iis3dwb_samples_per_it;
 
+static const HSD_WTM_Fifo_t iis3dwb_wtm_fifo =
+{
+  IIS3DWB_FIFO_DEPTH, IIS3DWB_MIN_WTM_LEVEL, IIS3DWB_MAX_WTM_LEVEL, 7, 0x01U, 1, HSD_WTM_BUS_SPI1, 0
+};
+
 SM_Init_Param_t IIS3DWB_Init_Param;
 SM_Sensor_State_t IIS3DWB_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
-/* Semaphore used to wait on component interrupt */
-static osSemaphoreId iis3dwb_data_ready_sem_id;
-static osSemaphoreDef(iis3dwb_data_ready_sem);
+#if (IIS3DWB_PSD_ENABLE == 1)
+/* Welch PSD: segments of FFT_LEN_AXL samples overlapped by IIS3DWB_PSD_OVERLAP, N_AVERAGE_AXL segments each */
+static int16_t psd_segment[3][FFT_LEN_AXL];
+static uint32_t psd_segment_idx;
+static uint32_t psd_segment_count;
+static HSD_PSD_t psd_kernel;
+static float psd_acc[3][IIS3DWB_PSD_BINS];
+static float psd_out[IIS3DWB_PSD_BINS * 3];
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
+
+osThreadId IIS3DWB_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId iis3dwb_data_read_cmplt_sem_id;
-static osSemaphoreDef(iis3dwb_data_read_cmplt_sem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t iis3dwb_notifier =
+{
+  &IIS3DWB_Thread_Id
+};
 
 sensor_handle_t iis3dwb_hdl_instance = {IIS3DWB_ID, 0, IIS3DWB_SPI_CS_GPIO_Port, IIS3DWB_SPI_CS_Pin,
-                                        &iis3dwb_data_read_cmplt_sem_id
+                                        &iis3dwb_notifier
                                        };
 stmdev_ctx_t iis3dwb_ctx_instance = {SM_SPI_Write_Os, SM_SPI_Read_Os, &iis3dwb_hdl_instance};
 
 /* Private function prototypes -----------------------------------------------*/
 
-osThreadId IIS3DWB_Thread_Id;
 static void IIS3DWB_Thread(void const *argument);
 
 EXTI_HandleTypeDef iis3dwb_exti;
 static void IIS3DWB_Int_Callback(void);
 static void IIS3DWB_Sensor_Init(void);
+#if (IIS3DWB_PSD_ENABLE == 1)
+static void IIS3DWB_PSD_Init(void);
+static void IIS3DWB_PSD_Process(const int16_t *p16, uint16_t nSamples, HSD_TimeStamp_t timeStamp);
+static void IIS3DWB_PSD_Publish(HSD_TimeStamp_t timeStamp);
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
 
 
 
@@ -111,21 +141,8 @@ void IIS3DWB_Peripheral_Init(void)
   */
 void IIS3DWB_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  iis3dwb_data_read_cmplt_sem_id = osSemaphoreCreate(osSemaphore(iis3dwb_data_read_cmplt_sem), 1);
-  vQueueAddToRegistry(iis3dwb_data_read_cmplt_sem_id, "iis3dwb_data_read_cmplt_sem_id");
-
-  osSemaphoreWait(iis3dwb_data_read_cmplt_sem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  iis3dwb_data_ready_sem_id = osSemaphoreCreate(osSemaphore(iis3dwb_data_ready_sem), 1);
-  vQueueAddToRegistry(iis3dwb_data_ready_sem_id, "iis3dwb_data_ready_sem_id");
-
-  osSemaphoreWait(iis3dwb_data_ready_sem_id,  osWaitForever);
-
-
   /* Thread definition: read data */
-  osThreadDef(IIS3DWB_Acquisition_Thread, IIS3DWB_Thread, HSD_IIS3DWB_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(IIS3DWB_Acquisition_Thread, IIS3DWB_Thread, HSD_IIS3DWB_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread 1 */
   IIS3DWB_Thread_Id = osThreadCreate(osThread(IIS3DWB_Acquisition_Thread), NULL);
 
@@ -135,6 +152,7 @@ void IIS3DWB_OS_Init(void)
 static void IIS3DWB_Thread(void const *argument)
 {
   (void) argument;
+  uint32_t events;
 
 #if (configUSE_APPLICATION_TASK_TAG == 1 && defined(HSD_TASK_IIS3DWB_DEBUG_PIN))
   vTaskSetApplicationTaskTag(NULL, (TaskHookFunction_t)HSD_TASK_IIS3DWB_DEBUG_PIN);
@@ -159,9 +177,10 @@ static void IIS3DWB_Thread(void const *argument)
     }
     else if (IIS3DWB_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      osSemaphoreWait(iis3dwb_data_ready_sem_id,  osWaitForever);
+      events = SM_Wait(&iis3dwb_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (IIS3DWB_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (IIS3DWB_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
         /* Check FIFO_WTM_IA anf fifo level. We do not use PID in order to avoid reading one register twice */;
         iis3dwb_read_reg(&iis3dwb_ctx_instance, IIS3DWB_FIFO_STATUS1, reg, 2);
@@ -195,7 +214,18 @@ static void IIS3DWB_Thread(void const *argument)
             *p16dest++ = *p16src++;
           }
 #endif /* HSD_USE_DUMMY_DATA == 1 */
+#if (IIS3DWB_PSD_ENABLE == 1)
+          if (IIS3DWB_Init_Param.subSensorActive[1])
+          {
+            IIS3DWB_PSD_Process((int16_t *)iis3dwb_mem, iis3dwb_samples_per_it, TimeStamp_iis3dwb);
+          }
+          if (IIS3DWB_Init_Param.subSensorActive[0])
+          {
+            IIS3DWB_Data_Ready(0, (uint8_t *)iis3dwb_mem, iis3dwb_samples_per_it * 6, TimeStamp_iis3dwb);
+          }
+#else
           IIS3DWB_Data_Ready(0, (uint8_t *)iis3dwb_mem, iis3dwb_samples_per_it * 6, TimeStamp_iis3dwb);
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
         }
       }
     }
@@ -226,6 +256,9 @@ static void IIS3DWB_Sensor_Init(void)
   iis3dwb_write_reg(&iis3dwb_ctx_instance, IIS3DWB_CTRL1_XL, (uint8_t *)&reg0, 1);
 
   /* Calculation of watermark and samples per int*/
+#if (HSD_WTM_ADAPTIVE == 1)
+  iis3dwb_wtm_level = HSD_WTM_Get_Level(s_nIIS3DWB_id);
+#else
   iis3dwb_wtm_level = ((uint16_t)IIS3DWB_Init_Param.ODR[0] * (uint16_t)IIS3DWB_MAX_DRDY_PERIOD);
   if (iis3dwb_wtm_level > IIS3DWB_MAX_WTM_LEVEL)
   {
@@ -235,6 +268,7 @@ static void IIS3DWB_Sensor_Init(void)
   {
     iis3dwb_wtm_level = IIS3DWB_MIN_WTM_LEVEL;
   }
+#endif /* (HSD_WTM_ADAPTIVE == 1) */
 
   iis3dwb_samples_per_it = iis3dwb_wtm_level;
 
@@ -273,14 +307,107 @@ static void IIS3DWB_Sensor_Init(void)
   /*Enable writing to FIFO*/
   iis3dwb_fifo_xl_batch_set(&iis3dwb_ctx_instance, IIS3DWB_XL_BATCHED_AT_26k7Hz);
 
+#if (IIS3DWB_PSD_ENABLE == 1)
+  IIS3DWB_PSD_Init();
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
+
   HAL_NVIC_EnableIRQ(IIS3DWB_INT1_EXTI_IRQn);
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  iis3dwb_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nIIS3DWB_id, iis3dwb_samples_per_it);
+}
+
+#if (IIS3DWB_PSD_ENABLE == 1)
+/**
+  * @brief  Reset the Welch PSD state and build the Hann window and the FFT tables
+  * @param  None
+  * @retval None
+  */
+static void IIS3DWB_PSD_Init(void)
+{
+  psd_segment_idx = 0;
+  psd_segment_count = 0;
+  memset(psd_acc, 0, sizeof(psd_acc));
+  (void) HSD_PSD_Init(&psd_kernel, FFT_LEN_AXL);
 }
 
+/**
+  * @brief  Feed the Welch PSD with a batch of x, y, z samples
+  * @param  p16: interleaved samples
+  * @param  nSamples: number of samples for each axis
+  * @param  timeStamp: timestamp of the latest sample of the batch
+  * @retval None
+  */
+static void IIS3DWB_PSD_Process(const int16_t *p16, uint16_t nSamples, HSD_TimeStamp_t timeStamp)
+{
+  uint32_t i;
+  uint32_t axis;
+  uint32_t samplesAfter;
+
+  for (i = 0; i < nSamples; i++)
+  {
+    psd_segment[0][psd_segment_idx] = *p16++;
+    psd_segment[1][psd_segment_idx] = *p16++;
+    psd_segment[2][psd_segment_idx] = *p16++;
+
+    if (++psd_segment_idx == FFT_LEN_AXL)
+    {
+      for (axis = 0; axis < 3U; axis++)
+      {
+        HSD_PSD_Accumulate(&psd_kernel, psd_segment[axis], psd_acc[axis]);
+        memmove(&psd_segment[axis][0], &psd_segment[axis][IIS3DWB_PSD_HOP], IIS3DWB_PSD_OVERLAP * sizeof(int16_t));
+      }
+      psd_segment_idx = IIS3DWB_PSD_OVERLAP;
+
+      if (++psd_segment_count == (uint32_t) N_AVERAGE_AXL)
+      {
+        /* the spectrum is timestamped with its last input sample */
+        samplesAfter = nSamples - 1U - i;
+#if (HSD_TIMESTAMP_TICKS == 1)
+        IIS3DWB_PSD_Publish(timeStamp - (HSD_TimeStamp_t)((float) samplesAfter * (float) SystemCoreClock
+                                                          / IIS3DWB_Init_Param.ODR[0]));
+#else
+        IIS3DWB_PSD_Publish(timeStamp - (HSD_TimeStamp_t)((float) samplesAfter / IIS3DWB_Init_Param.ODR[0]));
+#endif /* HSD_TIMESTAMP_TICKS */
+        psd_segment_count = 0;
+      }
+    }
+  }
+}
+
+/**
+  * @brief  Scale the averaged spectra to one-sided PSD [g^2/Hz] and send them as subsensor 1
+  * @param  timeStamp: timestamp of the last input sample
+  * @retval None
+  */
+static void IIS3DWB_PSD_Publish(HSD_TimeStamp_t timeStamp)
+{
+  float sensitivity = COM_GetSubSensorStatus(s_nIIS3DWB_id, 0)->sensitivity;
+  float scale = sensitivity * sensitivity
+                * HSD_PSD_Get_Scale(&psd_kernel, (uint32_t) N_AVERAGE_AXL, IIS3DWB_Init_Param.ODR[0]);
+  float binScale;
+  uint32_t axis;
+  uint32_t k;
+
+  for (k = 0; k < IIS3DWB_PSD_BINS; k++)
+  {
+    binScale = (k == 0 || k == IIS3DWB_PSD_BINS - 1U) ? scale : 2.0f * scale;
+    for (axis = 0; axis < 3U; axis++)
+    {
+      psd_out[3U * k + axis] = psd_acc[axis][k] * binScale;
+      psd_acc[axis][k] = 0.0f;
+    }
+  }
+
+  IIS3DWB_Data_Ready(1, (uint8_t *)psd_out, sizeof(psd_out), timeStamp);
+}
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
+
 /* Data Ready */
 static void IIS3DWB_Int_Callback(void)
 {
-  TimeStamp_iis3dwb = SM_GetTimeStamp_fromISR();
-  osSemaphoreRelease(iis3dwb_data_ready_sem_id);
+  TimeStamp_iis3dwb = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&iis3dwb_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void IIS3DWB_Set_State(SM_Sensor_State_t state)
@@ -297,10 +424,11 @@ void IIS3DWB_Start(void)
 void IIS3DWB_Stop(void)
 {
   IIS3DWB_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&iis3dwb_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
 
-__weak void IIS3DWB_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void IIS3DWB_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -331,11 +459,17 @@ uint8_t IIS3DWB_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nIIS3DWB_id, &iis3dwb_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nIIS3DWB_id);
 
   /* SENSOR DESCRIPTOR */
   strcpy(pSensor->sensorDescriptor.name, "IIS3DWB");
+#if (IIS3DWB_PSD_ENABLE == 1)
+  pSensor->sensorDescriptor.nSubSensors = 2;
+#else
   pSensor->sensorDescriptor.nSubSensors = 1;
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
 
   /* SUBSENSOR 0 DESCRIPTOR */
   pSensor->sensorDescriptor.subSensorDescriptor[0].id = 0;
@@ -378,9 +512,51 @@ uint8_t IIS3DWB_Create_Sensor(const SM_Init_Param_t *pxParams)
   pSensor->sensorStatus.subSensorStatus[0].comChannelNumber = -1;
   pSensor->sensorStatus.subSensorStatus[0].ucfLoaded = 0;
 
+#if (IIS3DWB_PSD_ENABLE == 1)
+  /* SUBSENSOR 1 DESCRIPTOR */
+  pSensor->sensorDescriptor.subSensorDescriptor[1].id = 1;
+  pSensor->sensorDescriptor.subSensorDescriptor[1].sensorType = COM_TYPE_PSD;
+  pSensor->sensorDescriptor.subSensorDescriptor[1].dataType = DATA_TYPE_FLOAT;
+  /* bins per second: one spectrum every N_AVERAGE_AXL hops */
+  pSensor->sensorDescriptor.subSensorDescriptor[1].ODR[0] = 26667.0f * (float) IIS3DWB_PSD_BINS
+                                                            / (float)(IIS3DWB_PSD_HOP * N_AVERAGE_AXL);
+  pSensor->sensorDescriptor.subSensorDescriptor[1].ODR[1] = COM_END_OF_LIST_FLOAT;  /* Terminate list */
+  pSensor->sensorDescriptor.subSensorDescriptor[1].samplesPerTimestamp[0] = 0;
+  pSensor->sensorDescriptor.subSensorDescriptor[1].samplesPerTimestamp[1] = 1000;
+  pSensor->sensorDescriptor.subSensorDescriptor[1].dimensions = 3;
+  strcpy(pSensor->sensorDescriptor.subSensorDescriptor[1].dimensionsLabel[0], "x");
+  strcpy(pSensor->sensorDescriptor.subSensorDescriptor[1].dimensionsLabel[1], "y");
+  strcpy(pSensor->sensorDescriptor.subSensorDescriptor[1].dimensionsLabel[2], "z");
+  strcpy(pSensor->sensorDescriptor.subSensorDescriptor[1].unit, "g^2/Hz");
+  pSensor->sensorDescriptor.subSensorDescriptor[1].FS[0] = COM_END_OF_LIST_FLOAT;
+
+  /* SUBSENSOR 1 STATUS */
+  if (pxParams != NULL)
+  {
+    pSensor->sensorStatus.subSensorStatus[1].isActive = pxParams->subSensorActive[1];
+  }
+  else
+  {
+    pSensor->sensorStatus.subSensorStatus[1].isActive = 0;
+  }
+  pSensor->sensorStatus.subSensorStatus[1].FS = 0.0f;
+  pSensor->sensorStatus.subSensorStatus[1].ODR = pSensor->sensorDescriptor.subSensorDescriptor[1].ODR[0];
+  pSensor->sensorStatus.subSensorStatus[1].sensitivity = 1.0f;
+  pSensor->sensorStatus.subSensorStatus[1].measuredODR = 0.0f;
+  pSensor->sensorStatus.subSensorStatus[1].initialOffset = 0.0f;
+  pSensor->sensorStatus.subSensorStatus[1].samplesPerTimestamp = IIS3DWB_PSD_BINS;
+  pSensor->sensorStatus.subSensorStatus[1].usbDataPacketSize = IIS3DWB_PSD_BINS * 12U;
+  pSensor->sensorStatus.subSensorStatus[1].sdWriteBufferSize = WRITE_BUFFER_SIZE_IIS3DWB;
+  pSensor->sensorStatus.subSensorStatus[1].comChannelNumber = -1;
+  pSensor->sensorStatus.subSensorStatus[1].ucfLoaded = 0;
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
+
   IIS3DWB_Init_Param.ODR[0] = pSensor->sensorStatus.subSensorStatus[0].ODR;
   IIS3DWB_Init_Param.FS[0] = pSensor->sensorStatus.subSensorStatus[0].FS;
   IIS3DWB_Init_Param.subSensorActive[0] = pSensor->sensorStatus.subSensorStatus[0].isActive;
+#if (IIS3DWB_PSD_ENABLE == 1)
+  IIS3DWB_Init_Param.subSensorActive[1] = pSensor->sensorStatus.subSensorStatus[1].isActive;
+#endif /* (IIS3DWB_PSD_ENABLE == 1) */
 
   return 0;
 }
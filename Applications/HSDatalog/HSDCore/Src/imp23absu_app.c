@@ -25,6 +25,7 @@
 #include "main.h"
 #include "sensors_manager.h"
 #include "com_manager.h"
+#include "HSD_dcfilter.h"
 #include <string.h>
 
 /* Private typedef -----------------------------------------------------------*/
@@ -37,7 +38,8 @@ static int32_t s_nIMP23ABSU_id = 0;
 
 SM_Init_Param_t IMP23ABSU_Init_Param;
 SM_Sensor_State_t IMP23ABSU_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
-static uint32_t amic_mem[((IMP23ABSU_MAX_SAMPLING_FREQUENCY / 1000) * IMP23ABSU_MS * 2)];
+static uint32_t amic_mem[((IMP23ABSU_MAX_SAMPLING_FREQUENCY / 1000) * IMP23ABSU_MS)]; /* 16-bit samples, 2 per word */
+static HSD_DCFilter_t s_xDCFilter;
 
 DFSDM_Filter_HandleTypeDef hdfsdm1_filter1;
 DFSDM_Channel_HandleTypeDef hdfsdm1_channel0;
@@ -45,12 +47,16 @@ DMA_HandleTypeDef hdma_dfsdm1_flt1;
 
 osThreadId IMP23ABSU_Thread_Id;
 
-osMessageQId amicDreadyQueue_id;
-osMessageQDef(amicdreadyqueue, 1, int);
+/* Notifications of the thread: half buffer ready (DFSDM DMA interrupt) and state change */
+static SM_Notifier_t imp23absu_notifier =
+{
+  &IMP23ABSU_Thread_Id
+};
+static void *volatile amic_data_ptr; /* half of amic_mem filled by the last DMA interrupt */
 
 static volatile uint32_t tim_value = 0, tim_value_old = 0, period = 0;
 static volatile uint64_t ts_imp23absu;
-static volatile double TimeStamp_imp23absu;
+static volatile HSD_TimeStamp_t TimeStamp_imp23absu;
 /* Private function prototypes -----------------------------------------------*/
 
 static void IMP23ABSU_ADC_Init(void);
@@ -89,8 +95,6 @@ void IMP23ABSU_OS_Init(void)
   osThreadDef(IMP23ABSU_RD_USR_THREAD, IMP23ABSU_Thread, HSD_IMP23ABSU_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
   /* Start thread */
   IMP23ABSU_Thread_Id = osThreadCreate(osThread(IMP23ABSU_RD_USR_THREAD), NULL);
-
-  amicDreadyQueue_id = osMessageCreate(osMessageQ(amicdreadyqueue), NULL);
 }
 
 
@@ -106,7 +110,7 @@ static void IMP23ABSU_Thread(void const *argument)
   static uint16_t dummyDataCounter = 0;
 #endif /* HSD_USE_DUMMY_DATA == 1 */
 
-  osEvent evt;
+  uint32_t events;
 
   /* Suspend thread */
   osThreadSuspend(IMP23ABSU_Thread_Id);
@@ -115,39 +119,36 @@ static void IMP23ABSU_Thread(void const *argument)
   {
     if (IMP23ABSU_Sensor_State == SM_SENSOR_STATE_INITIALIZING)
     {
+      HSD_DCFILTER_Reset(&s_xDCFilter);
       tim_value_old = 0;
       HAL_ADC_Start(&ADC1_Handle);
 
-      HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter1, (int32_t *)amic_mem,
-                                       ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2);
+      HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter1, (int16_t *)amic_mem,
+                                          ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2);
       IMP23ABSU_Sensor_State = SM_SENSOR_STATE_RUNNING;
     }
     else if (IMP23ABSU_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      evt = osMessageGet(amicDreadyQueue_id, osWaitForever);
+      events = SM_Wait(&imp23absu_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (IMP23ABSU_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (IMP23ABSU_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
-        void *data_ptr = evt.value.p;  /* void since it is independent from data format*/
+        void *data_ptr = amic_data_ptr;  /* void since it is independent from data format*/
         /* Do something */
-        uint16_t idx = 0;
 
-#if (HSD_USE_DUMMY_DATA != 1)
-        static int32_t oldIn = 0;
-        static int32_t oldOut = 0;
-        int32_t *p32 = (int32_t *)data_ptr;
-#endif /* HSD_USE_DUMMY_DATA != 1 */
-        int16_t *p16 = (int16_t *)data_ptr;
+#if (HSD_USE_DUMMY_DATA == 1)
+        uint16_t idx = 0;
+        uint16_t *p16 = (uint16_t *)data_ptr;
 
-        for (idx = 0; idx < (((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS) ; idx++)
+        for (idx = 0; idx < (((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS); idx++)
         {
-#if (HSD_USE_DUMMY_DATA == 1)
           *p16++ = dummyDataCounter++;
+        }
 #else
-          *p16++ = oldOut = (0xFC * (oldOut + ((*p32) >> 12) - oldIn)) / 0xFF;
-          oldIn = (*p32 ++) >> 12;
+        HSD_DCFILTER_Process(&s_xDCFilter, (int16_t *)data_ptr,
+                             ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS);
 #endif /* HSD_USE_DUMMY_DATA == 1 */
-        }
 
         IMP23ABSU_Data_Ready(0, (uint8_t *)data_ptr, ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2,
                              TimeStamp_imp23absu);
@@ -214,28 +215,29 @@ static void IMP23ABSU_DFSDM_Init(void)
   hdfsdm1_channel0.Init.Input.Pins = DFSDM_CHANNEL_SAME_CHANNEL_PINS;
   hdfsdm1_channel0.Init.SerialInterface.Type = DFSDM_CHANNEL_SPI_FALLING;
 
+  /* The shift leaves the 16-bit PCM sample in the 16 MSB of the data register, read by the DMA */
   switch ((uint32_t)IMP23ABSU_Init_Param.ODR[0])
   {
     case 8000 :
-      hdfsdm1_channel0.Init.RightBitShift = 0x09;
+      hdfsdm1_channel0.Init.RightBitShift = 0x05;
       break;
     case 16000 :
-      hdfsdm1_channel0.Init.RightBitShift = 0x07;
+      hdfsdm1_channel0.Init.RightBitShift = 0x03;
       break;
     case 32000 :
-      hdfsdm1_channel0.Init.RightBitShift = 0x05;
+      hdfsdm1_channel0.Init.RightBitShift = 0x01;
       break;
     case 48000 :
-      hdfsdm1_channel0.Init.RightBitShift = 0x0A;
+      hdfsdm1_channel0.Init.RightBitShift = 0x06;
       break;
     case 96000 :
-      hdfsdm1_channel0.Init.RightBitShift = 0x07;
+      hdfsdm1_channel0.Init.RightBitShift = 0x03;
       break;
     case 192000 :
-      hdfsdm1_channel0.Init.RightBitShift = 0x08;
+      hdfsdm1_channel0.Init.RightBitShift = 0x04;
       break;
     default :
-      hdfsdm1_channel0.Init.RightBitShift = 0x08;
+      hdfsdm1_channel0.Init.RightBitShift = 0x04;
       break;
   }
 
@@ -355,8 +357,8 @@ void IMP23ABSU_DFSDM_FilterMspInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   hdma_dfsdm1_flt1.Init.Direction = DMA_PERIPH_TO_MEMORY;
   hdma_dfsdm1_flt1.Init.PeriphInc = DMA_PINC_DISABLE;
   hdma_dfsdm1_flt1.Init.MemInc = DMA_MINC_ENABLE;
-  hdma_dfsdm1_flt1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
-  hdma_dfsdm1_flt1.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_dfsdm1_flt1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_dfsdm1_flt1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
   hdma_dfsdm1_flt1.Init.Mode = DMA_CIRCULAR;
   hdma_dfsdm1_flt1.Init.Priority = DMA_PRIORITY_HIGH;
 
@@ -386,12 +388,12 @@ void IMP23ABSU_DFSDM_FilterMspInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   */
 void DFSDM_Filter_1_Complete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
 {
-  TimeStamp_imp23absu = SM_GetTimeStamp_fromISR();
+  TimeStamp_imp23absu = SM_GetSensorTimeStamp_fromISR();
 
   if (hdfsdm_filter == &hdfsdm1_filter1) /* Analog Mic */
   {
-    osMessagePut(amicDreadyQueue_id, (uint32_t)(&amic_mem[(((uint32_t)IMP23ABSU_Init_Param.ODR[0]
-                                                            / 1000) * IMP23ABSU_MS)]), osWaitForever);
+    amic_data_ptr = &((int16_t *)amic_mem)[(((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS)];
+    SM_Notify_fromISR(&imp23absu_notifier, SM_NOTIFY_DATA_READY);
   }
 }
 
@@ -402,11 +404,12 @@ void DFSDM_Filter_1_Complete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   */
 void DFSDM_Filter_1_HalfComplete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
 {
-  TimeStamp_imp23absu = SM_GetTimeStamp_fromISR();
+  TimeStamp_imp23absu = SM_GetSensorTimeStamp_fromISR();
 
   if (hdfsdm_filter == &hdfsdm1_filter1) /* Analog Mic */
   {
-    osMessagePut(amicDreadyQueue_id, (uint32_t)(amic_mem), osWaitForever);
+    amic_data_ptr = amic_mem;
+    SM_Notify_fromISR(&imp23absu_notifier, SM_NOTIFY_DATA_READY);
   }
 }
 
@@ -429,8 +432,8 @@ void IMP23ABSU_updateConfig(void)
 
 void IMP23ABSU_StartAcquisition(void)
 {
-  HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter1, (int32_t *)amic_mem,
-                                   ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2);
+  HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter1, (int16_t *)amic_mem,
+                                      ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2);
 }
 
 void IMP23ABSU_StopAcquisition(void)
@@ -445,8 +448,8 @@ void IMP23ABSU_PauseAcquisition(void)
 
 void IMP23ABSU_ResumeAcquisition(void)
 {
-  HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter1, (int32_t *)amic_mem,
-                                   ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2);
+  HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter1, (int16_t *)amic_mem,
+                                      ((uint32_t)IMP23ABSU_Init_Param.ODR[0] / 1000) * IMP23ABSU_MS * 2);
 }
 
 void IMP23ABSU_Set_State(SM_Sensor_State_t state)
@@ -463,9 +466,10 @@ void IMP23ABSU_Start(void)
 void IMP23ABSU_Stop(void)
 {
   IMP23ABSU_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&imp23absu_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void IMP23ABSU_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void IMP23ABSU_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -24,6 +24,7 @@
 #include "imp34dt05_app.h"
 #include "main.h"
 #include "com_manager.h"
+#include "HSD_dcfilter.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -38,19 +39,23 @@ static int32_t s_nIMP34DT05_id = 0;
 SM_Init_Param_t IMP34DT05_Init_Param;
 SM_Sensor_State_t IMP34DT05_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
-/* Semaphore used to wait on component interrupt */
-osMessageQId dmicDreadyQueue_id;
-static osMessageQDef(dmicdreadyqueue, 1, int);
+osThreadId IMP34DT05_Thread_Id;
+
+/* Notifications of the thread: half buffer ready (DFSDM DMA interrupt) and state change */
+static SM_Notifier_t imp34dt05_notifier =
+{
+  &IMP34DT05_Thread_Id
+};
+static void *volatile dmic_data_ptr; /* half of dmic_mem filled by the last DMA interrupt */
 
 
-static uint32_t dmic_mem[((IMP34DT05_MAX_SAMPLING_FREQUENCY / 1000) * IMP34DT05_MS * 2)];
+static uint32_t dmic_mem[((IMP34DT05_MAX_SAMPLING_FREQUENCY / 1000) * IMP34DT05_MS)]; /* 16-bit samples, 2 per word */
+static HSD_DCFilter_t s_xDCFilter;
 
 uint16_t newDataIdxDMic;
 uint16_t oldDataLenDMic;
 uint16_t newDataLenDMic;
 
-osThreadId IMP34DT05_Thread_Id;
-
 DFSDM_Filter_HandleTypeDef hdfsdm1_filter0;
 DFSDM_Channel_HandleTypeDef hdfsdm1_channel5;
 DMA_HandleTypeDef hdma_dfsdm1_flt0;
@@ -58,7 +63,7 @@ DMA_HandleTypeDef hdma_dfsdm1_flt0;
 static volatile uint32_t tim_value = 0, tim_value_old = 0, period = 0;
 static volatile uint64_t ts_imp34dt05 = 0;
 static volatile uint32_t periodCounter = 0;
-static volatile double TimeStamp_imp34dt05a;
+static volatile HSD_TimeStamp_t TimeStamp_imp34dt05a;
 
 /* Private function prototypes -----------------------------------------------*/
 void DFSDM_Filter_0_HalfComplete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter);
@@ -94,8 +99,6 @@ void IMP34DT05_Peripheral_Init(void)
   */
 void IMP34DT05_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  dmicDreadyQueue_id = osMessageCreate(osMessageQ(dmicdreadyqueue), NULL);
   /* Thread definition: read data */
   osThreadDef(IMP34DT05_Acquisition_Thread, IMP34DT05_Thread, HSD_IMP34DT05_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
   /* Start thread */
@@ -115,7 +118,7 @@ static void IMP34DT05_Thread(void const *argument)
   static uint16_t dummyDataCounter = 0;
 #endif /* HSD_USE_DUMMY_DATA == 1 */
 
-  osEvent evt;
+  uint32_t events;
 
   /* Suspend thread */
   osThreadSuspend(IMP34DT05_Thread_Id);
@@ -124,40 +127,35 @@ static void IMP34DT05_Thread(void const *argument)
   {
     if (IMP34DT05_Sensor_State == SM_SENSOR_STATE_INITIALIZING)
     {
+      HSD_DCFILTER_Reset(&s_xDCFilter);
       ts_imp34dt05 = 0;
       tim_value_old = 0;
 
-      HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter0, (int32_t *)dmic_mem,
-                                       ((uint32_t)IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS * 2);
+      HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter0, (int16_t *)dmic_mem,
+                                          ((uint32_t)IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS * 2);
       IMP34DT05_Sensor_State = SM_SENSOR_STATE_RUNNING;
     }
     else if (IMP34DT05_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      evt = osMessageGet(dmicDreadyQueue_id, osWaitForever);
+      events = SM_Wait(&imp34dt05_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (IMP34DT05_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (IMP34DT05_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
-        uint16_t idx = 0;
-        void *data_ptr = evt.value.p;  /* void since it is independent from data format */
+        void *data_ptr = dmic_data_ptr;  /* void since it is independent from data format */
 
-#if (HSD_USE_DUMMY_DATA != 1)
-        static int32_t oldIn = 0;
-        static int32_t oldOut = 0;
-        int32_t *p32 = (int32_t *)data_ptr;
-        int16_t *p16 = (int16_t *)data_ptr;
-#else
+#if (HSD_USE_DUMMY_DATA == 1)
+        uint16_t idx = 0;
         uint16_t *p16 = (uint16_t *)data_ptr;
-#endif /* HSD_USE_DUMMY_DATA != 1 */
 
-        for (idx = 0; idx < ((IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS) ; idx++)
+        for (idx = 0; idx < (((uint32_t)IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS); idx++)
         {
-#if (HSD_USE_DUMMY_DATA == 1)
           *p16++ = dummyDataCounter++;
+        }
 #else
-          *p16++ = oldOut = (0xFC * (oldOut + ((*p32) >> 11) - oldIn)) / 0xFF;
-          oldIn = (*p32 ++) >> 11;
+        HSD_DCFILTER_Process(&s_xDCFilter, (int16_t *)data_ptr,
+                             ((uint32_t)IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS);
 #endif /* HSD_USE_DUMMY_DATA == 1 */
-        }
 
         IMP34DT05_Data_Ready(0, (uint8_t *)data_ptr, ((uint32_t)IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS * 2,
                              TimeStamp_imp34dt05a);
@@ -193,27 +191,28 @@ static void IMP34DT05_DFSDM_Init(void)
   hdfsdm1_channel5.Init.Input.Pins = DFSDM_CHANNEL_SAME_CHANNEL_PINS;
   hdfsdm1_channel5.Init.SerialInterface.Type = DFSDM_CHANNEL_SPI_FALLING;
 
+  /* The shift leaves the 16-bit PCM sample in the 16 MSB of the data register, read by the DMA */
   switch ((uint32_t)IMP34DT05_Init_Param.ODR[0])
   {
     case 8000 :
       hdfsdm1_channel5.Init.OutputClock.Divider = 4;
-      hdfsdm1_channel5.Init.RightBitShift = 0x0E;
+      hdfsdm1_channel5.Init.RightBitShift = 0x09;
       break;
     case 16000 :
       hdfsdm1_channel5.Init.OutputClock.Divider = 4;
-      hdfsdm1_channel5.Init.RightBitShift = 0x0A;
+      hdfsdm1_channel5.Init.RightBitShift = 0x05;
       break;
     case 32000 :
       hdfsdm1_channel5.Init.OutputClock.Divider = 4;
-      hdfsdm1_channel5.Init.RightBitShift = 0x0D;
+      hdfsdm1_channel5.Init.RightBitShift = 0x08;
       break;
     case 48000 :
       hdfsdm1_channel5.Init.OutputClock.Divider = 4;
-      hdfsdm1_channel5.Init.RightBitShift = 0x0A;
+      hdfsdm1_channel5.Init.RightBitShift = 0x05;
       break;
     default:
       hdfsdm1_channel5.Init.OutputClock.Divider = 4;
-      hdfsdm1_channel5.Init.RightBitShift = 0x0A;
+      hdfsdm1_channel5.Init.RightBitShift = 0x05;
       break;
   }
 
@@ -301,8 +300,8 @@ void IMP34DT05_DFSDM_FilterMspInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   hdma_dfsdm1_flt0.Init.Direction = DMA_PERIPH_TO_MEMORY;
   hdma_dfsdm1_flt0.Init.PeriphInc = DMA_PINC_DISABLE;
   hdma_dfsdm1_flt0.Init.MemInc = DMA_MINC_ENABLE;
-  hdma_dfsdm1_flt0.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
-  hdma_dfsdm1_flt0.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_dfsdm1_flt0.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_dfsdm1_flt0.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
   hdma_dfsdm1_flt0.Init.Mode = DMA_CIRCULAR;
   hdma_dfsdm1_flt0.Init.Priority = DMA_PRIORITY_HIGH;
   hdma_dfsdm1_flt0.Init.Request = IMP34DT05_DFSDM_RX_DMA_REQUEST;
@@ -356,9 +355,10 @@ void DFSDM_Filter_0_HalfComplete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_fil
   tickCounter = HAL_GetTick();
   callbackCounter++;
 
-  TimeStamp_imp34dt05a = SM_GetTimeStamp_fromISR();
+  TimeStamp_imp34dt05a = SM_GetSensorTimeStamp_fromISR();
 
-  osMessagePut(dmicDreadyQueue_id, (uint32_t)(dmic_mem), osWaitForever);
+  dmic_data_ptr = dmic_mem;
+  SM_Notify_fromISR(&imp34dt05_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void DFSDM_Filter_0_Complete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
@@ -366,10 +366,10 @@ void DFSDM_Filter_0_Complete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   tickCounter = HAL_GetTick();
   callbackCounter++;
 
-  TimeStamp_imp34dt05a = SM_GetTimeStamp_fromISR();
+  TimeStamp_imp34dt05a = SM_GetSensorTimeStamp_fromISR();
 
-  osMessagePut(dmicDreadyQueue_id, (uint32_t)(&dmic_mem[(((uint32_t)IMP34DT05_Init_Param.ODR[0]
-                                                          / 1000) * IMP34DT05_MS)]), osWaitForever);
+  dmic_data_ptr = &((int16_t *)dmic_mem)[(((uint32_t)IMP34DT05_Init_Param.ODR[0] / 1000) * IMP34DT05_MS)];
+  SM_Notify_fromISR(&imp34dt05_notifier, SM_NOTIFY_DATA_READY);
 }
 
 
@@ -403,9 +403,10 @@ void IMP34DT05_Start(void)
 void IMP34DT05_Stop(void)
 {
   IMP34DT05_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&imp34dt05_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void IMP34DT05_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void IMP34DT05_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
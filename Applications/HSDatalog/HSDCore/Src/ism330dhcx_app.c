@@ -28,6 +28,9 @@
 #include "com_manager.h"
 #include "device_description.h"
 #include "ism330dhcx_reg.h"
+#include "HSD_fifo_demux.h"
+#include "HSD_fifo_ts.h"
+#include "HSD_watermark.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -38,30 +41,39 @@
 #define WRITE_BUFFER_SIZE_ISM330DHCX_MLC (uint32_t)(1024)
 
 #define ISM330DHCX_SAMPLE_SIZE  (7)
-#define ISM330DHCX_TAG_ACC      (0x02)
 
-#define MLC_CONFIG              (0x00000001)
-#define DHCX_INIT               (0x00000010)
-#define DHCX_FIFO               (0x00000011)
-#define DHCX_MLC                (0x00000100)
-#define DHCX_SUSPEND            (0x00000101)
+/* Thread notifications besides SM_NOTIFY_xxx: MLC interrupt, new UCF to be programmed and FIFO batch left behind.
+ * FIFO_REARM is served as SM_NOTIFY_DATA_READY but without an interrupt time, so it is not a latency sample. */
+#define DHCX_MLC                (SM_NOTIFY_APP)
+#define MLC_CONFIG              (SM_NOTIFY_APP << 1)
+#define FIFO_REARM              (SM_NOTIFY_APP << 2)
 
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nISM330DHCX_id = 0;
 
-static volatile double TimeStamp_ism330dhcx;
+static volatile HSD_TimeStamp_t TimeStamp_ism330dhcx;
 static uint8_t ism330dhcx_mem[ISM330DHCX_MAX_SAMPLES_PER_IT * 7];
 static uint8_t ism330dhcx_mem_app[ISM330DHCX_MAX_SAMPLES_PER_IT / 2 * 6]; /*without Tag*/
+static HSD_FIFO_Demux_t ism330dhcx_fifo_demux;
+#if (HSD_FIFO_TIMESTAMP == 1)
+static HSD_FIFO_TS_t ism330dhcx_fifo_ts;
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
 uint16_t ism330dhcx_samples_per_it;
 
+static const HSD_WTM_Fifo_t ism330dhcx_wtm_fifo =
+{
+  ISM330DHCX_FIFO_DEPTH, ISM330DHCX_MIN_WTM_LEVEL, ISM330DHCX_MAX_WTM_LEVEL, 7, 0x03U, 1, HSD_WTM_BUS_SPI1,
+  HSD_FIFO_TS_DECIMATION
+};
+
 #if (HSD_USE_DUMMY_DATA == 1)
 static int16_t dummyDataCounter_acc = 0;
 static int16_t dummyDataCounter_gyro = 0;
 #endif /* HSD_USE_DUMMY_DATA == 1 */
 
-static volatile double TimeStamp_mlc;
+static volatile HSD_TimeStamp_t TimeStamp_mlc;
 static uint8_t mlc_mem[8];
 ism330dhcx_mlc_status_mainpage_t mlc_status;
 
@@ -75,19 +87,17 @@ SM_Init_Param_t ISM330DHCX_Init_Param;
 SM_Sensor_State_t ISM330DHCX_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 volatile static uint32_t MLC_Data_Ready = 0;
 
-/* Semaphore used to wait on component interrupt */
-osSemaphoreId ism330dhcx_DreadySem_id;
-osSemaphoreDef(ism330dhcx_DreadySem);
-
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-osSemaphoreId ism330dhcxReadSem_id;
-osSemaphoreDef(ism330dhcxReadSem);
+osThreadId ISM330DHCX_Thread_Id;
 
-osMessageQId ism330dhcxThreadQueue_id;
-osMessageQDef(ism330dhcxThreadQueue, 100, int);
+/* Notifications of the thread: FIFO and MLC interrupts, bus read complete (managed by lower layer),
+ * state change and new UCF */
+static SM_Notifier_t ism330dhcx_notifier =
+{
+  &ISM330DHCX_Thread_Id
+};
 
 sensor_handle_t ism330dhcx_hdl_instance = {0, 0, ISM330DHCX_SPI_CS_GPIO_Port, ISM330DHCX_SPI_CS_Pin,
-                                           &ism330dhcxReadSem_id
+                                           &ism330dhcx_notifier
                                           };
 stmdev_ctx_t ism330dhcx_ctx_instance = {SM_SPI_Write_Os, SM_SPI_Read_Os, &ism330dhcx_hdl_instance};
 
@@ -95,7 +105,6 @@ EXTI_HandleTypeDef mlc_exti;
 EXTI_HandleTypeDef ism330dhcx_exti;
 
 /* Private function prototypes -----------------------------------------------*/
-osThreadId ISM330DHCX_Thread_Id;
 static void ISM330DHCX_Thread(void const *argument);
 static void HSD_MLC_Int_Config(void);
 static void ISM330DHCX_Program_MLC(uint32_t size, char *buffer);
@@ -118,7 +127,6 @@ static void ISM330DHCX_Int_Callback(void);
 static void ISM330DHCX_Sensor_Init(void);
 static void ISM330DHCX_MLC_Int_Callback(void);
 
-void ISM330DHCX_sendCMD(uint32_t cmd);
 static uint8_t ISM330DHCX_updateSensorStatus(void);
 
 
@@ -174,17 +182,6 @@ void ISM330DHCX_Peripheral_Init(void)
 
 void ISM330DHCX_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  ism330dhcxReadSem_id = osSemaphoreCreate(osSemaphore(ism330dhcxReadSem), 1);
-  osSemaphoreWait(ism330dhcxReadSem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  ism330dhcx_DreadySem_id = osSemaphoreCreate(osSemaphore(ism330dhcx_DreadySem), 1);
-  osSemaphoreWait(ism330dhcx_DreadySem_id,  osWaitForever);
-
-  ism330dhcxThreadQueue_id = osMessageCreate(osMessageQ(ism330dhcxThreadQueue), NULL);
-  vQueueAddToRegistry(ism330dhcxThreadQueue_id, "ism330dhcxThreadQueue_id");
-
   /* Thread 1 definition */
   osThreadDef(ISM330_RD_USR_THREAD, ISM330DHCX_Thread, HSD_ISM330DHCX_THREAD_PRIO, 1, 8000 / 4);
   /* Start thread 1 */
@@ -195,7 +192,7 @@ void ISM330DHCX_OS_Init(void)
 static void ISM330DHCX_Thread(void const *argument)
 {
   (void) argument;
-  osEvent evt;
+  uint32_t events;
 
 #if (configUSE_APPLICATION_TASK_TAG == 1 && defined(HSD_TASK_ISM330DHCX_DEBUG_PIN))
   vTaskSetApplicationTaskTag(NULL, (TaskHookFunction_t)HSD_TASK_ISM330DHCX_DEBUG_PIN);
@@ -205,53 +202,40 @@ static void ISM330DHCX_Thread(void const *argument)
 
   for (;;)
   {
-    evt = osMessageGet(ism330dhcxThreadQueue_id, osWaitForever);
+    events = SM_Wait(&ism330dhcx_notifier,
+                     SM_NOTIFY_DATA_READY | FIFO_REARM | SM_NOTIFY_STATE_CHANGE | DHCX_MLC | MLC_CONFIG);
 
-    if (evt.status == osEventMessage)
+    if ((events & MLC_CONFIG) != 0U)
     {
-      switch (evt.value.v)
+      ISM330DHCX_Program_MLC((uint32_t) UCFSize, (char *) UCFData);
+      HSD_free((void *) UCFData);
+      if (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_MLC_CONFIG)
       {
-        case MLC_CONFIG:
-        {
-          ISM330DHCX_Program_MLC((uint32_t)UCFSize, (char *)UCFData);
-          HSD_free((void *)UCFData);
-          ISM330DHCX_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
-          break;
-        }
-        case DHCX_INIT:
-        {
-          ISM330DHCX_Init();
-          ISM330DHCX_Sensor_State = SM_SENSOR_STATE_RUNNING;
-          break;
-        }
-        case DHCX_FIFO:
-        {
-          if (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_RUNNING)
-          {
-            ISM330DHCX_Read_Data();
-          }
-          break;
-        }
-        case DHCX_MLC:
-        {
-          if (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_RUNNING)
-          {
-            ISM330DHCX_Read_MLC();
-          }
-          break;
-        }
-        case DHCX_SUSPEND:
-        {
-          ISM330DHCX_Suspend();
-          ISM330DHCX_Sensor_State = SM_SENSOR_STATE_SUSPENDED;
-          break;
-        }
-        default :
-        {
-          break;
-        }
+        ISM330DHCX_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
       }
     }
+    if ((events & SM_NOTIFY_STATE_CHANGE) != 0U)
+    {
+      /* Only the last state set by ISM330DHCX_Start or ISM330DHCX_Stop is served */
+      if (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_INITIALIZING)
+      {
+        ISM330DHCX_Init();
+        ISM330DHCX_Sensor_State = SM_SENSOR_STATE_RUNNING;
+      }
+      else if (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_SUSPENDING)
+      {
+        ISM330DHCX_Suspend();
+        ISM330DHCX_Sensor_State = SM_SENSOR_STATE_SUSPENDED;
+      }
+    }
+    if (((events & (SM_NOTIFY_DATA_READY | FIFO_REARM)) != 0U) && (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_RUNNING))
+    {
+      ISM330DHCX_Read_Data();
+    }
+    if (((events & DHCX_MLC) != 0U) && (ISM330DHCX_Sensor_State == SM_SENSOR_STATE_RUNNING))
+    {
+      ISM330DHCX_Read_MLC();
+    }
   }
 }
 
@@ -268,6 +252,26 @@ static void ISM330DHCX_Init(void)
     /* Route int pins for MLC */
     HSD_MLC_Int_Config();
   }
+
+  /* ACC and GYRO words go to subsensors 0 and 1, any other TAG is dropped */
+  HSD_FIFO_DEMUX_Init(&ism330dhcx_fifo_demux);
+  if (ISM330DHCX_Init_Param.subSensorActive[0])
+  {
+    HSD_FIFO_DEMUX_Route(&ism330dhcx_fifo_demux, HSD_FIFO_TAG_XL_NC, 0, 6);
+  }
+  if (ISM330DHCX_Init_Param.subSensorActive[1])
+  {
+    HSD_FIFO_DEMUX_Route(&ism330dhcx_fifo_demux, HSD_FIFO_TAG_GYRO_NC, 1, 6);
+  }
+
+#if (HSD_FIFO_TIMESTAMP == 1)
+  HSD_FIFO_TS_Init(&ism330dhcx_fifo_ts, SM_SENSOR_TIMESTAMP_FREQ);
+  HSD_FIFO_TS_Set_Subsensor(&ism330dhcx_fifo_ts, 0, HSD_FIFO_TAG_XL_NC,
+                            ISM330DHCX_Init_Param.subSensorActive[0] ? ISM330DHCX_Init_Param.ODR[0] : 0.0f);
+  HSD_FIFO_TS_Set_Subsensor(&ism330dhcx_fifo_ts, 1, HSD_FIFO_TAG_GYRO_NC,
+                            ISM330DHCX_Init_Param.subSensorActive[1] ? ISM330DHCX_Init_Param.ODR[1] : 0.0f);
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
+
   ism330dhcx_fifo_mode_set(&ism330dhcx_ctx_instance, ISM330DHCX_STREAM_MODE);
   HAL_NVIC_EnableIRQ(ISM330DHCX_INT1_EXTI_IRQn);
 }
@@ -283,12 +287,22 @@ static void ISM330DHCX_Read_Data(void)
   if ((reg[1]) & 0x80  && (fifo_level >= ism330dhcx_samples_per_it))
   {
     ISM330DHCX_Read_Data_From_FIFO();
+
+    /* Interrupts coalesced while the thread was busy: serve the next batch at once, the interrupt line stays high */
+    if (fifo_level >= 2U * ism330dhcx_samples_per_it)
+    {
+      ism330dhcx_notifier.pending |= FIFO_REARM;
+    }
   }
 }
 
 static void ISM330DHCX_Read_Data_From_FIFO(void)
 {
-  uint16_t i = 0;
+  HSD_FIFO_Demux_t *pDemux = &ism330dhcx_fifo_demux;
+  HSD_TimeStamp_t timeStamp[2];
+  uint8_t *pData[2];
+  uint8_t subSensorId;
+
   /* Read sensor data from FIFO */
   ism330dhcx_read_reg(&ism330dhcx_ctx_instance, ISM330DHCX_FIFO_DATA_OUT_TAG, (uint8_t *)ism330dhcx_mem,
                       ism330dhcx_samples_per_it * 7);
@@ -297,80 +311,41 @@ static void ISM330DHCX_Read_Data_From_FIFO(void)
   ISM330DHCX_CreateDummyData();
 #endif /* HSD_USE_DUMMY_DATA == 1 */
 
-  if (ISM330DHCX_Init_Param.subSensorActive[0]
-      && ISM330DHCX_Init_Param.subSensorActive[1])     /* Read both ACC and GYRO */
-  {
-    uint32_t ODR_Acc  = (uint32_t)COM_GetSubSensorStatus(ISM330DHCX_Get_Id(), 0)->ODR;
-    uint32_t ODR_Gyro = (uint32_t)COM_GetSubSensorStatus(ISM330DHCX_Get_Id(), 1)->ODR;
-    uint32_t gyroSamplesCount = 0;
-    uint32_t accSamplesCount = 0;
+#if (HSD_FIFO_TIMESTAMP == 1)
+  HSD_FIFO_TS_Process(&ism330dhcx_fifo_ts, ism330dhcx_mem, ism330dhcx_samples_per_it, TimeStamp_ism330dhcx,
+                      timeStamp);
+#else
+  timeStamp[0] = TimeStamp_ism330dhcx;
+  timeStamp[1] = TimeStamp_ism330dhcx;
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
 
-    int16_t *p16src = (int16_t *)ism330dhcx_mem;
-    int16_t *pAcc;
-    int16_t *pGyro;
+  HSD_FIFO_DEMUX_Start(pDemux, ism330dhcx_mem, ism330dhcx_samples_per_it);
 
-    if (ODR_Acc > ODR_Gyro) /* Acc is faster than Gyro */
-    {
-      pAcc  = (int16_t *)ism330dhcx_mem;
-      pGyro = (int16_t *)ism330dhcx_mem_app;
-    }
-    else
-    {
-      pAcc  = (int16_t *)ism330dhcx_mem_app;
-      pGyro = (int16_t *)ism330dhcx_mem;
-    }
+  /* The subsensor with more samples is compacted in place in ism330dhcx_mem, the other one in ism330dhcx_mem_app */
+  if (pDemux->sink[1].nSamples > pDemux->sink[0].nSamples)
+  {
+    pData[0] = ism330dhcx_mem_app;
+    pData[1] = ism330dhcx_mem;
+  }
+  else
+  {
+    pData[0] = ism330dhcx_mem;
+    pData[1] = ism330dhcx_mem_app;
+  }
+  for (subSensorId = 0; subSensorId < 2; subSensorId++)
+  {
+    HSD_FIFO_DEMUX_Set_Span(pDemux, subSensorId, pData[subSensorId], pDemux->sink[subSensorId].nSamples);
+  }
 
-    uint8_t *pTag = (uint8_t *)p16src;
+  /* The spans hold the whole batch: a single pass on the FIFO words */
+  (void)HSD_FIFO_DEMUX_Run(pDemux);
 
-    for (i = 0; i < ism330dhcx_samples_per_it; i++)
-    {
-      if (((*pTag) >> 3) == ISM330DHCX_TAG_ACC)
-      {
-        p16src = (int16_t *)(pTag + 1);
-        *pAcc++ = *p16src++;
-        *pAcc++ = *p16src++;
-        *pAcc++ = *p16src++;
-        accSamplesCount++;
-      }
-      else
-      {
-        p16src = (int16_t *)(pTag + 1);
-        *pGyro++ = *p16src++;
-        *pGyro++ = *p16src++;
-        *pGyro++ = *p16src++;
-        gyroSamplesCount++;
-      }
-      pTag += 7;
-    }
-    if (ODR_Acc > ODR_Gyro) /* Acc is faster than Gyro */
-    {
-      ISM330DHCX_Data_Ready(0, (uint8_t *)ism330dhcx_mem, accSamplesCount * 6, TimeStamp_ism330dhcx);
-      ISM330DHCX_Data_Ready(1, (uint8_t *)ism330dhcx_mem_app, gyroSamplesCount * 6, TimeStamp_ism330dhcx);
-    }
-    else
-    {
-      ISM330DHCX_Data_Ready(0, (uint8_t *)ism330dhcx_mem_app, accSamplesCount * 6, TimeStamp_ism330dhcx);
-      ISM330DHCX_Data_Ready(1, (uint8_t *)ism330dhcx_mem, gyroSamplesCount * 6, TimeStamp_ism330dhcx);
-    }
-  }
-  else /* 1 subsensor active only --> simply drop TAGS */
+  for (subSensorId = 0; subSensorId < 2; subSensorId++)
   {
-    int16_t *p16src = (int16_t *)ism330dhcx_mem;
-    int16_t *p16dest = (int16_t *)ism330dhcx_mem;
-    for (i = 0; i < ism330dhcx_samples_per_it; i++)
-    {
-      p16src = (int16_t *) & ((uint8_t *)(p16src))[1];
-      *p16dest++ = *p16src++;
-      *p16dest++ = *p16src++;
-      *p16dest++ = *p16src++;
-    }
-    if (ISM330DHCX_Init_Param.subSensorActive[0]) /* Acc only */
-    {
-      ISM330DHCX_Data_Ready(0, (uint8_t *)ism330dhcx_mem, ism330dhcx_samples_per_it * 6, TimeStamp_ism330dhcx);
-    }
-    else if (ISM330DHCX_Init_Param.subSensorActive[1]) /* Gyro only */
+    if (pDemux->sink[subSensorId].written > 0)
     {
-      ISM330DHCX_Data_Ready(1, (uint8_t *)ism330dhcx_mem, ism330dhcx_samples_per_it * 6, TimeStamp_ism330dhcx);
+      ISM330DHCX_Data_Ready(subSensorId, pData[subSensorId], pDemux->sink[subSensorId].written * 6,
+                            timeStamp[subSensorId]);
     }
   }
 }
@@ -384,13 +359,13 @@ static void ISM330DHCX_CreateDummyData(void)
   for (i = 0; i < ism330dhcx_samples_per_it; i++)
   {
     p16 = (int16_t *)(&ism330dhcx_mem[i * 7] + 1);
-    if ((ism330dhcx_mem[i * 7] >> 3) == ISM330DHCX_TAG_ACC)
+    if ((ism330dhcx_mem[i * 7] >> 3) == HSD_FIFO_TAG_XL_NC)
     {
       *p16++ = dummyDataCounter_acc++;
       *p16++ = dummyDataCounter_acc++;
       *p16++ = dummyDataCounter_acc++;
     }
-    else
+    else if ((ism330dhcx_mem[i * 7] >> 3) == HSD_FIFO_TAG_GYRO_NC)
     {
       *p16++ = dummyDataCounter_gyro++;
       *p16++ = dummyDataCounter_gyro++;
@@ -428,14 +403,6 @@ static void ISM330DHCX_Suspend(void)
 }
 
 
-void ISM330DHCX_sendCMD(uint32_t cmd)
-{
-  if (osMessagePut(ism330dhcxThreadQueue_id, cmd, 0) != osOK)
-  {
-    while (1);
-  }
-}
-
 
 static uint8_t ISM330DHCX_updateSensorStatus(void)
 {
@@ -719,8 +686,10 @@ static void ISM330DHCX_Sensor_Init(void)
 {
   uint8_t reg0;
   uint16_t ism330dhcx_wtm_level = 0;
+#if (HSD_WTM_ADAPTIVE == 0)
   uint16_t ism330dhcx_wtm_level_acc;
   uint16_t ism330dhcx_wtm_level_gyro;
+#endif /* (HSD_WTM_ADAPTIVE == 0) */
   ism330dhcx_odr_xl_t ism330dhcx_odr_xl = ISM330DHCX_XL_ODR_OFF;
   ism330dhcx_bdr_xl_t ism330dhcx_bdr_xl = ISM330DHCX_XL_NOT_BATCHED;
   ism330dhcx_odr_g_t ism330dhcx_odr_g = ISM330DHCX_GY_ODR_OFF;
@@ -898,7 +867,16 @@ static void ISM330DHCX_Sensor_Init(void)
     ism330dhcx_fifo_gy_batch_set(&ism330dhcx_ctx_instance, ISM330DHCX_GY_NOT_BATCHED);
   }
 
+#if (HSD_FIFO_TIMESTAMP == 1)
+  /* Batch the timestamp counter every 8 sample sets */
+  ism330dhcx_timestamp_set(&ism330dhcx_ctx_instance, PROPERTY_ENABLE);
+  ism330dhcx_fifo_timestamp_decimation_set(&ism330dhcx_ctx_instance, ISM330DHCX_DEC_8);
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
+
   /* Calculation of watermark and samples per int*/
+#if (HSD_WTM_ADAPTIVE == 1)
+  ism330dhcx_wtm_level = HSD_WTM_Get_Level(s_nISM330DHCX_id);
+#else
   ism330dhcx_wtm_level_acc = ((uint16_t)ISM330DHCX_Init_Param.ODR[0] * (uint16_t)ISM330DHCX_MAX_DRDY_PERIOD);
   ism330dhcx_wtm_level_gyro = ((uint16_t)ISM330DHCX_Init_Param.ODR[1] * (uint16_t)ISM330DHCX_MAX_DRDY_PERIOD);
 
@@ -934,6 +912,7 @@ static void ISM330DHCX_Sensor_Init(void)
   {
     ism330dhcx_wtm_level = ISM330DHCX_MIN_WTM_LEVEL;
   }
+#endif /* (HSD_WTM_ADAPTIVE == 1) */
   ism330dhcx_samples_per_it = ism330dhcx_wtm_level;
 
   /* Setup int for FIFO */
@@ -942,6 +921,9 @@ static void ISM330DHCX_Sensor_Init(void)
   ism330dhcx_pin_int1_route_t int1_route = {0};
   int1_route.int1_ctrl.int1_fifo_th = 1;
   ism330dhcx_pin_int1_route_set(&ism330dhcx_ctx_instance, &int1_route);
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  ism330dhcx_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nISM330DHCX_id, ism330dhcx_samples_per_it);
 }
 
 static void HSD_MLC_Int_Config(void)
@@ -1039,15 +1021,15 @@ int32_t ISM330DHCX_GetUCF_FromBuffer(char *buffer_in, uint32_t size_in, char *bu
 
 static void ISM330DHCX_MLC_Int_Callback(void)
 {
-  TimeStamp_mlc = SM_GetTimeStamp_fromISR();
+  TimeStamp_mlc = SM_GetSensorTimeStamp_fromISR();
   MLC_Data_Ready = 1;
-  ISM330DHCX_sendCMD(DHCX_MLC);
+  SM_Notify_fromISR(&ism330dhcx_notifier, DHCX_MLC);
 }
 
 static void ISM330DHCX_Int_Callback(void)
 {
-  TimeStamp_ism330dhcx = SM_GetTimeStamp_fromISR();
-  ISM330DHCX_sendCMD(DHCX_FIFO);
+  TimeStamp_ism330dhcx = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&ism330dhcx_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void ISM330DHCX_Set_State(SM_Sensor_State_t state)
@@ -1058,7 +1040,7 @@ void ISM330DHCX_Set_State(SM_Sensor_State_t state)
 void ISM330DHCX_Start(void)
 {
   ISM330DHCX_Set_State(SM_SENSOR_STATE_INITIALIZING);
-  ISM330DHCX_sendCMD(DHCX_INIT);
+  SM_Notify(&ism330dhcx_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
 void ISM330DHCX_SetUCF(uint32_t mlcConfigSize, char *mlcConfigData)
@@ -1066,16 +1048,16 @@ void ISM330DHCX_SetUCF(uint32_t mlcConfigSize, char *mlcConfigData)
   UCFSize = mlcConfigSize;
   UCFData = mlcConfigData;
   ISM330DHCX_Set_State(SM_SENSOR_STATE_MLC_CONFIG);
-  ISM330DHCX_sendCMD(MLC_CONFIG);
+  SM_Notify(&ism330dhcx_notifier, MLC_CONFIG);
 }
 
 void ISM330DHCX_Stop(void)
 {
   ISM330DHCX_Set_State(SM_SENSOR_STATE_SUSPENDING);
-  ISM330DHCX_sendCMD(DHCX_SUSPEND);
+  SM_Notify(&ism330dhcx_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void ISM330DHCX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void ISM330DHCX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -1106,6 +1088,8 @@ uint8_t ISM330DHCX_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nISM330DHCX_id, &ism330dhcx_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nISM330DHCX_id);
 
   /* SENSOR DESCRIPTOR */
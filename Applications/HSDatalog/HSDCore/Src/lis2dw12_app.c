@@ -22,6 +22,7 @@
 #include "main.h"
 #include "lis2dw12_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -29,30 +30,37 @@
 /* Private define ------------------------------------------------------------*/
 #define WRITE_BUFFER_SIZE_LIS2DW12         ( ( uint32_t ) 8192 )
 
-#define WTM_LEVEL                          ( 16 )
-
-#define SAMPLES_PER_IT                     ( WTM_LEVEL )
+#define WTM_LEVEL                          ( 16 )  /* watermark if HSD_WTM_ADAPTIVE is disabled */
+#define MIN_WTM_LEVEL                      ( 4 )
+#define MAX_WTM_LEVEL                      ( 31 )
+#define FIFO_DEPTH                         ( 32 )
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nLIS2DW12_id = -1;
 
-static volatile double TimeStamp_lis2dw12;
+static const HSD_WTM_Fifo_t lis2dw12_wtm_fifo =
+{
+  FIFO_DEPTH, MIN_WTM_LEVEL, MAX_WTM_LEVEL, 6, 0x01U, 0, HSD_WTM_BUS_SPI1, 0
+};
+
+static volatile HSD_TimeStamp_t TimeStamp_lis2dw12;
 
-static int8_t lis2dw12_mem[SAMPLES_PER_IT * 6];
+static int8_t lis2dw12_mem[MAX_WTM_LEVEL * 6];
+static uint16_t lis2dw12_samples_per_it = WTM_LEVEL;
 
 SM_Init_Param_t LIS2DW12_Init_Param;
 SM_Sensor_State_t LIS2DW12_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
 EXTI_HandleTypeDef lis2dw12_exti;
 
-/* Semaphore used to wait on component interrupt */
-static osSemaphoreId lis2dw12_drdy_sem_id;
-static osSemaphoreDef(lis2dw12_drdy_sem);
+osThreadId LIS2DW12_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId lis2dw12_read_cplt_sem_id;
-static osSemaphoreDef(lis2dw12_read_cplt_sem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t lis2dw12_notifier =
+{
+  &LIS2DW12_Thread_Id
+};
 
 static sensor_handle_t lis2dw12_hdl_instance =
 {
@@ -60,7 +68,7 @@ static sensor_handle_t lis2dw12_hdl_instance =
   0,
   LIS2DW12_SPI_CS_GPIO_Port,
   LIS2DW12_SPI_CS_Pin,
-  &lis2dw12_read_cplt_sem_id
+  &lis2dw12_notifier
 };
 static stmdev_ctx_t lis2dw12_ctx_instance =
 {
@@ -71,7 +79,6 @@ static stmdev_ctx_t lis2dw12_ctx_instance =
 };
 
 /* Private function prototypes -----------------------------------------------*/
-osThreadId LIS2DW12_Thread_Id;
 static void LIS2DW12_Thread(void const *argument);
 
 static void LIS2DW12_Int_Callback(void);
@@ -124,16 +131,8 @@ void LIS2DW12_Peripheral_Init(void)
   */
 void LIS2DW12_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  lis2dw12_read_cplt_sem_id = osSemaphoreCreate(osSemaphore(lis2dw12_read_cplt_sem), 1);
-  osSemaphoreWait(lis2dw12_read_cplt_sem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  lis2dw12_drdy_sem_id = osSemaphoreCreate(osSemaphore(lis2dw12_drdy_sem), 1);
-  osSemaphoreWait(lis2dw12_drdy_sem_id, osWaitForever);
-
   /* Thread definition: read data */
-  osThreadDef(LIS2DW12_Aquisition_Thread, LIS2DW12_Thread, HSD_LIS2DW12_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(LIS2DW12_Aquisition_Thread, LIS2DW12_Thread, HSD_LIS2DW12_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   LIS2DW12_Thread_Id = osThreadCreate(osThread(LIS2DW12_Aquisition_Thread), NULL);
 }
@@ -146,6 +145,7 @@ void LIS2DW12_OS_Init(void)
 static void LIS2DW12_Thread(void const *argument)
 {
   (void) argument;
+  uint32_t events;
 
 #if (HSD_USE_DUMMY_DATA == 1)
   static uint16_t dummyDataCounter = 0;
@@ -163,9 +163,10 @@ static void LIS2DW12_Thread(void const *argument)
     }
     else if (LIS2DW12_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      osSemaphoreWait(lis2dw12_drdy_sem_id, osWaitForever);
+      events = SM_Wait(&lis2dw12_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (LIS2DW12_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (LIS2DW12_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
         uint8_t wtmFlag = 0;
         uint8_t wtmLevel = 0;
@@ -174,15 +175,16 @@ static void LIS2DW12_Thread(void const *argument)
         lis2dw12_fifo_wtm_flag_get(&lis2dw12_ctx_instance, &wtmFlag);
         lis2dw12_fifo_data_level_get(&lis2dw12_ctx_instance, &wtmLevel);
 
-        if ((wtmFlag != 0) && (wtmLevel >= SAMPLES_PER_IT))
+        if ((wtmFlag != 0) && (wtmLevel >= lis2dw12_samples_per_it))
         {
-          lis2dw12_read_reg(&lis2dw12_ctx_instance, LIS2DW12_OUT_X_L, (uint8_t *) lis2dw12_mem, SAMPLES_PER_IT * 6);
+          lis2dw12_read_reg(&lis2dw12_ctx_instance, LIS2DW12_OUT_X_L, (uint8_t *) lis2dw12_mem,
+                            lis2dw12_samples_per_it * 6);
 
           uint8_t i = 0;
           int16_t *p16_src = (int16_t *) lis2dw12_mem;
           int16_t *p16_dest = (int16_t *) lis2dw12_mem;
 
-          for (i = 0; i < SAMPLES_PER_IT; i++)
+          for (i = 0; i < lis2dw12_samples_per_it; i++)
           {
             *p16_dest++ = *p16_src++ / 4;
             *p16_dest++ = *p16_src++ / 4;
@@ -192,7 +194,7 @@ static void LIS2DW12_Thread(void const *argument)
           uint16_t ii = 0;
           int16_t *p16 = (int16_t *) lis2dw12_mem;
 
-          for (ii = 0; ii < SAMPLES_PER_IT; ii++)
+          for (ii = 0; ii < lis2dw12_samples_per_it; ii++)
           {
             *p16++ = dummyDataCounter++;
             *p16++ = dummyDataCounter++;
@@ -200,7 +202,7 @@ static void LIS2DW12_Thread(void const *argument)
           }
 #endif /* (HSD_USE_DUMMY_DATA == 1) */
 
-          LIS2DW12_Data_Ready(0, (uint8_t *) lis2dw12_mem, SAMPLES_PER_IT * 6, TimeStamp_lis2dw12);
+          LIS2DW12_Data_Ready(0, (uint8_t *) lis2dw12_mem, lis2dw12_samples_per_it * 6, TimeStamp_lis2dw12);
         }
       }
     }
@@ -248,7 +250,12 @@ static void LIS2DW12_Sensor_Init(void)
   lis2dw12_fifo_mode_set(&lis2dw12_ctx_instance, LIS2DW12_STREAM_MODE);
 
   /* Set watermark */
-  lis2dw12_fifo_watermark_set(&lis2dw12_ctx_instance, WTM_LEVEL);
+#if (HSD_WTM_ADAPTIVE == 1)
+  lis2dw12_samples_per_it = HSD_WTM_Get_Level(s_nLIS2DW12_id);
+#else
+  lis2dw12_samples_per_it = WTM_LEVEL;
+#endif /* (HSD_WTM_ADAPTIVE == 1) */
+  lis2dw12_fifo_watermark_set(&lis2dw12_ctx_instance, (uint8_t) lis2dw12_samples_per_it);
 
   /* FIFO_WTM routing on pin INT2 */
   lis2dw12_ctrl5_int2_pad_ctrl_t reg5 =
@@ -328,13 +335,16 @@ static void LIS2DW12_Sensor_Init(void)
     lis2dw12_power_mode_set(&lis2dw12_ctx_instance, LIS2DW12_HIGH_PERFORMANCE_LOW_NOISE);
     lis2dw12_data_rate_set(&lis2dw12_ctx_instance, LIS2DW12_XL_ODR_1k6Hz);
   }
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  lis2dw12_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nLIS2DW12_id, lis2dw12_samples_per_it);
 }
 
 /* Data Ready */
 static void LIS2DW12_Int_Callback(void)
 {
-  TimeStamp_lis2dw12 = SM_GetTimeStamp_fromISR();
-  osSemaphoreRelease(lis2dw12_drdy_sem_id);
+  TimeStamp_lis2dw12 = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&lis2dw12_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void LIS2DW12_Set_State(SM_Sensor_State_t state)
@@ -342,6 +352,11 @@ void LIS2DW12_Set_State(SM_Sensor_State_t state)
   LIS2DW12_Sensor_State = state;
 }
 
+SM_Sensor_State_t LIS2DW12_Get_State(void)
+{
+  return LIS2DW12_Sensor_State;
+}
+
 void LIS2DW12_Start(void)
 {
   LIS2DW12_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -351,9 +366,10 @@ void LIS2DW12_Start(void)
 void LIS2DW12_Stop(void)
 {
   LIS2DW12_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&lis2dw12_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void LIS2DW12_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void LIS2DW12_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -384,6 +400,8 @@ uint8_t LIS2DW12_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nLIS2DW12_id, &lis2dw12_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nLIS2DW12_id);
 
   /* SENSOR DESCRIPTOR */
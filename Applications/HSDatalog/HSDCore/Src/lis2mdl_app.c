@@ -22,6 +22,7 @@
 #include "main.h"
 #include "lis2mdl_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -33,7 +34,12 @@
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nLIS2MDL_id = -1;
 
-static volatile double TimeStamp_lis2mdl;
+static const HSD_WTM_Fifo_t lis2mdl_wtm_fifo =
+{
+  0, 0, 0, 6, 0x01U, 0, HSD_WTM_BUS_SPI3, 0
+};
+
+static volatile HSD_TimeStamp_t TimeStamp_lis2mdl;
 
 static uint8_t lis2mdl_mem[6];
 
@@ -42,9 +48,13 @@ SM_Sensor_State_t LIS2MDL_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
 static uint16_t taskDelay = 1000;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId lis2mdl_read_cplt_sem_id;
-static osSemaphoreDef(lis2mdl_read_cplt_sem);
+osThreadId LIS2MDL_Thread_Id;
+
+/* Notifications of the thread: bus read complete, managed by lower layer */
+static SM_Notifier_t lis2mdl_notifier =
+{
+  &LIS2MDL_Thread_Id
+};
 
 static sensor_handle_t lis2mdl_hdl_instance =
 {
@@ -52,7 +62,7 @@ static sensor_handle_t lis2mdl_hdl_instance =
   0,
   LIS2MDL_SPI_CS_GPIO_Port,
   LIS2MDL_SPI_CS_Pin,
-  &lis2mdl_read_cplt_sem_id
+  &lis2mdl_notifier
 };
 static stmdev_ctx_t lis2mdl_ctx_instance =
 {
@@ -63,7 +73,6 @@ static stmdev_ctx_t lis2mdl_ctx_instance =
 };
 
 /* Private function prototypes -----------------------------------------------*/
-osThreadId LIS2MDL_Thread_Id;
 static void LIS2MDL_Thread(void const *argument);
 
 static void LIS2MDL_Sensor_Init(void);
@@ -101,12 +110,8 @@ void LIS2MDL_Peripheral_Init(void)
   */
 void LIS2MDL_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  lis2mdl_read_cplt_sem_id = osSemaphoreCreate(osSemaphore(lis2mdl_read_cplt_sem), 1);
-  osSemaphoreWait(lis2mdl_read_cplt_sem_id, osWaitForever);
-
   /* Thread definition: read data */
-  osThreadDef(LIS2MDL_Acquisition_Thread, LIS2MDL_Thread, HSD_LIS2MDL_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(LIS2MDL_Acquisition_Thread, LIS2MDL_Thread, HSD_LIS2MDL_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   LIS2MDL_Thread_Id = osThreadCreate(osThread(LIS2MDL_Acquisition_Thread), NULL);
 }
@@ -140,7 +145,7 @@ static void LIS2MDL_Thread(void const *argument)
 
       if (LIS2MDL_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
       {
-        TimeStamp_lis2mdl = SM_GetTimeStamp();
+        TimeStamp_lis2mdl = SM_GetSensorTimeStamp();
 
         lis2mdl_magnetic_raw_get(&lis2mdl_ctx_instance, (int16_t *) lis2mdl_mem);
 
@@ -214,6 +219,9 @@ static void LIS2MDL_Sensor_Init(void)
   }
 
   lis2mdl_operating_mode_set(&lis2mdl_ctx_instance, LIS2MDL_CONTINUOUS_MODE);
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  lis2mdl_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nLIS2MDL_id, 0);
 }
 
 void LIS2MDL_Set_State(SM_Sensor_State_t state)
@@ -221,6 +229,11 @@ void LIS2MDL_Set_State(SM_Sensor_State_t state)
   LIS2MDL_Sensor_State = state;
 }
 
+SM_Sensor_State_t LIS2MDL_Get_State(void)
+{
+  return LIS2MDL_Sensor_State;
+}
+
 void LIS2MDL_Start(void)
 {
   LIS2MDL_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -232,7 +245,7 @@ void LIS2MDL_Stop(void)
   LIS2MDL_Set_State(SM_SENSOR_STATE_SUSPENDING);
 }
 
-__weak void LIS2MDL_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void LIS2MDL_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -263,6 +276,8 @@ uint8_t LIS2MDL_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nLIS2MDL_id, &lis2mdl_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nLIS2MDL_id);
 
   /* SENSOR DESCRIPTOR */
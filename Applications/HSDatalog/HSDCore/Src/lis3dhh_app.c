@@ -22,6 +22,7 @@
 #include "main.h"
 #include "lis3dhh_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -29,30 +30,37 @@
 /* Private define ------------------------------------------------------------*/
 #define WRITE_BUFFER_SIZE_LIS3DHH       ( ( uint32_t ) 32768 )
 
-#define WTM_LEVEL                          ( 16 )
-
-#define SAMPLES_PER_IT                     ( WTM_LEVEL )
+#define WTM_LEVEL                          ( 16 )  /* watermark if HSD_WTM_ADAPTIVE is disabled */
+#define MIN_WTM_LEVEL                      ( 4 )
+#define MAX_WTM_LEVEL                      ( 31 )
+#define FIFO_DEPTH                         ( 32 )
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nLIS3DHH_id = -1;
 
-static volatile double TimeStamp_lis3dhh;
+static const HSD_WTM_Fifo_t lis3dhh_wtm_fifo =
+{
+  FIFO_DEPTH, MIN_WTM_LEVEL, MAX_WTM_LEVEL, 6, 0x01U, 0, HSD_WTM_BUS_SPI1, 0
+};
+
+static volatile HSD_TimeStamp_t TimeStamp_lis3dhh;
 
-static uint8_t lis3dhh_mem[SAMPLES_PER_IT * 6];
+static uint8_t lis3dhh_mem[MAX_WTM_LEVEL * 6];
+static uint16_t lis3dhh_samples_per_it = WTM_LEVEL;
 
 SM_Init_Param_t LIS3DHH_Init_Param;
 SM_Sensor_State_t LIS3DHH_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
 EXTI_HandleTypeDef lis3dhh_exti;
 
-/* Semaphore used to wait on component interrupt */
-static osSemaphoreId lis3dhh_drdy_sem_id;
-static osSemaphoreDef(lis3dhh_drdy_sem);
+osThreadId LIS3DHH_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId lis3dhh_read_cplt_sem_id;
-static osSemaphoreDef(lis3dhh_read_cplt_sem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t lis3dhh_notifier =
+{
+  &LIS3DHH_Thread_Id
+};
 
 static sensor_handle_t lis3dhh_hdl_instance =
 {
@@ -60,7 +68,7 @@ static sensor_handle_t lis3dhh_hdl_instance =
   0,
   LIS3DHH_SPI_CS_GPIO_Port,
   LIS3DHH_SPI_CS_Pin,
-  &lis3dhh_read_cplt_sem_id
+  &lis3dhh_notifier
 };
 static stmdev_ctx_t lis3dhh_ctx_instance =
 {
@@ -71,7 +79,6 @@ static stmdev_ctx_t lis3dhh_ctx_instance =
 };
 
 /* Private function prototypes -----------------------------------------------*/
-osThreadId LIS3DHH_Thread_Id;
 static void LIS3DHH_Thread(void const *argument);
 
 static void LIS3DHH_Int_Callback(void);
@@ -124,16 +131,8 @@ void LIS3DHH_Peripheral_Init(void)
   */
 void LIS3DHH_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  lis3dhh_read_cplt_sem_id = osSemaphoreCreate(osSemaphore(lis3dhh_read_cplt_sem), 1);
-  osSemaphoreWait(lis3dhh_read_cplt_sem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  lis3dhh_drdy_sem_id = osSemaphoreCreate(osSemaphore(lis3dhh_drdy_sem), 1);
-  osSemaphoreWait(lis3dhh_drdy_sem_id, osWaitForever);
-
   /* Thread definition: read data */
-  osThreadDef(LIS3DHH_Acquisition_Thread, LIS3DHH_Thread, HSD_LIS3DHH_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(LIS3DHH_Acquisition_Thread, LIS3DHH_Thread, HSD_LIS3DHH_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   LIS3DHH_Thread_Id = osThreadCreate(osThread(LIS3DHH_Acquisition_Thread), NULL);
 }
@@ -146,6 +145,7 @@ void LIS3DHH_OS_Init(void)
 static void LIS3DHH_Thread(void const *argument)
 {
   (void) argument;
+  uint32_t events;
 
 #if (HSD_USE_DUMMY_DATA == 1)
   static uint16_t dummyDataCounter = 0;
@@ -163,24 +163,26 @@ static void LIS3DHH_Thread(void const *argument)
     }
     else if (LIS3DHH_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      osSemaphoreWait(lis3dhh_drdy_sem_id, osWaitForever);
+      events = SM_Wait(&lis3dhh_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (LIS3DHH_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (LIS3DHH_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
         lis3dhh_fifo_src_t fifo_src_reg;
 
         /* Check FIFO_WTM_IA anf fifo level */
         lis3dhh_fifo_status_get(&lis3dhh_ctx_instance, &fifo_src_reg);
 
-        if ((fifo_src_reg.fth != 0) && (fifo_src_reg.fss >= SAMPLES_PER_IT))
+        if ((fifo_src_reg.fth != 0) && (fifo_src_reg.fss >= lis3dhh_samples_per_it))
         {
-          lis3dhh_read_reg(&lis3dhh_ctx_instance, LIS3DHH_OUT_X_L_XL, (uint8_t *) lis3dhh_mem, SAMPLES_PER_IT * 6);
+          lis3dhh_read_reg(&lis3dhh_ctx_instance, LIS3DHH_OUT_X_L_XL, (uint8_t *) lis3dhh_mem,
+                           lis3dhh_samples_per_it * 6);
 
 #if (HSD_USE_DUMMY_DATA == 1)
           uint16_t i = 0;
           int16_t *p16 = (int16_t *) lis3dhh_mem;
 
-          for (i = 0; i < SAMPLES_PER_IT; i++)
+          for (i = 0; i < lis3dhh_samples_per_it; i++)
           {
             *p16++ = dummyDataCounter++;
             *p16++ = dummyDataCounter++;
@@ -188,7 +190,7 @@ static void LIS3DHH_Thread(void const *argument)
           }
 #endif /* (HSD_USE_DUMMY_DATA == 1) */
 
-          LIS3DHH_Data_Ready(0, (uint8_t *) lis3dhh_mem, SAMPLES_PER_IT * 6, TimeStamp_lis3dhh);
+          LIS3DHH_Data_Ready(0, (uint8_t *) lis3dhh_mem, lis3dhh_samples_per_it * 6, TimeStamp_lis3dhh);
         }
       }
     }
@@ -231,7 +233,12 @@ static void LIS3DHH_Sensor_Init(void)
   lis3dhh_fifo_mode_set(&lis3dhh_ctx_instance, LIS3DHH_DYNAMIC_STREAM_MODE);
 
   /* Set watermark */
-  lis3dhh_fifo_watermark_set(&lis3dhh_ctx_instance, WTM_LEVEL);
+#if (HSD_WTM_ADAPTIVE == 1)
+  lis3dhh_samples_per_it = HSD_WTM_Get_Level(s_nLIS3DHH_id);
+#else
+  lis3dhh_samples_per_it = WTM_LEVEL;
+#endif /* (HSD_WTM_ADAPTIVE == 1) */
+  lis3dhh_fifo_watermark_set(&lis3dhh_ctx_instance, (uint8_t) lis3dhh_samples_per_it);
 
   /* FIFO_WTM routing on pin INT2 */
   lis3dhh_fifo_threshold_on_int2_set(&lis3dhh_ctx_instance, PROPERTY_ENABLE);
@@ -241,13 +248,16 @@ static void LIS3DHH_Sensor_Init(void)
 
   /* Enable sensor */
   lis3dhh_data_rate_set(&lis3dhh_ctx_instance, LIS3DHH_1kHz1);
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  lis3dhh_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nLIS3DHH_id, lis3dhh_samples_per_it);
 }
 
 /* Data Ready */
 static void LIS3DHH_Int_Callback(void)
 {
-  TimeStamp_lis3dhh = SM_GetTimeStamp_fromISR();
-  osSemaphoreRelease(lis3dhh_drdy_sem_id);
+  TimeStamp_lis3dhh = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&lis3dhh_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void LIS3DHH_Set_State(SM_Sensor_State_t state)
@@ -255,6 +265,11 @@ void LIS3DHH_Set_State(SM_Sensor_State_t state)
   LIS3DHH_Sensor_State = state;
 }
 
+SM_Sensor_State_t LIS3DHH_Get_State(void)
+{
+  return LIS3DHH_Sensor_State;
+}
+
 void LIS3DHH_Start(void)
 {
   LIS3DHH_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -264,9 +279,10 @@ void LIS3DHH_Start(void)
 void LIS3DHH_Stop(void)
 {
   LIS3DHH_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&lis3dhh_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void LIS3DHH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void LIS3DHH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -297,6 +313,8 @@ uint8_t LIS3DHH_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nLIS3DHH_id, &lis3dhh_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nLIS3DHH_id);
 
   /* SENSOR DESCRIPTOR */
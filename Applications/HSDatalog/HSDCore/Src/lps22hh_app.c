@@ -22,6 +22,7 @@
 #include "main.h"
 #include "lps22hh_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include "device_description.h"
 #include <string.h>
 
@@ -31,32 +32,39 @@
 #define WRITE_BUFFER_SIZE_LPS22HH_P        ( ( uint32_t ) 1024 )
 #define WRITE_BUFFER_SIZE_LPS22HH_T        ( ( uint32_t ) 1024 )
 
-#define WTM_LEVEL                          ( 64 )
-
-#define SAMPLES_PER_IT                     ( WTM_LEVEL )
+#define WTM_LEVEL                          ( 64 )  /* watermark if HSD_WTM_ADAPTIVE is disabled */
+#define MIN_WTM_LEVEL                      ( 4 )
+#define MAX_WTM_LEVEL                      ( 127 )
+#define FIFO_DEPTH                         ( 128 )
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nLPS22HH_id = -1;
 
-static volatile double TimeStamp_lps22hh;
+static const HSD_WTM_Fifo_t lps22hh_wtm_fifo =
+{
+  FIFO_DEPTH, MIN_WTM_LEVEL, MAX_WTM_LEVEL, 5, 0x03U, 0, HSD_WTM_BUS_I2C1, 0
+};
+
+static volatile HSD_TimeStamp_t TimeStamp_lps22hh;
 
-static uint8_t lps22hh_mem[SAMPLES_PER_IT * 2 * 5];
-static float lps22hh_mem_temp_f[SAMPLES_PER_IT * 2];
-static float lps22hh_mem_press_f[SAMPLES_PER_IT * 2];
+static uint8_t lps22hh_mem[MAX_WTM_LEVEL * 5];
+static float lps22hh_mem_temp_f[MAX_WTM_LEVEL];
+static float lps22hh_mem_press_f[MAX_WTM_LEVEL];
+static uint16_t lps22hh_samples_per_it = WTM_LEVEL;
 
 SM_Init_Param_t LPS22HH_Init_Param;
 SM_Sensor_State_t LPS22HH_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
 EXTI_HandleTypeDef lps22hh_exti;
 
-/* Semaphore used to wait on component interrupt */
-static osSemaphoreId lps22hh_drdy_sem_id;
-static osSemaphoreDef(lps22hh_drdy_sem);
+osThreadId LPS22HH_Thread_Id;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId lps22hh_read_cplt_sem_id;
-static osSemaphoreDef(lps22hh_read_cplt_sem);
+/* Notifications of the thread: data ready interrupt, bus read complete (managed by lower layer) and state change */
+static SM_Notifier_t lps22hh_notifier =
+{
+  &LPS22HH_Thread_Id
+};
 
 static sensor_handle_t lps22hh_hdl_instance =
 {
@@ -64,7 +72,7 @@ static sensor_handle_t lps22hh_hdl_instance =
   LPS22HH_I2C_ADD_H,
   NULL,
   0,
-  &lps22hh_read_cplt_sem_id
+  &lps22hh_notifier
 };
 static stmdev_ctx_t lps22hh_ctx_instance =
 {
@@ -75,7 +83,6 @@ static stmdev_ctx_t lps22hh_ctx_instance =
 };
 
 /* Private function prototypes -----------------------------------------------*/
-osThreadId LPS22HH_Thread_Id;
 static void LPS22HH_Thread(void const *argument);
 
 static void LPS22HH_Int_Callback(void);
@@ -117,16 +124,8 @@ void LPS22HH_Peripheral_Init(void)
   */
 void LPS22HH_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  lps22hh_read_cplt_sem_id = osSemaphoreCreate(osSemaphore(lps22hh_read_cplt_sem), 1);
-  osSemaphoreWait(lps22hh_read_cplt_sem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  lps22hh_drdy_sem_id = osSemaphoreCreate(osSemaphore(lps22hh_drdy_sem), 1);
-  osSemaphoreWait(lps22hh_drdy_sem_id, osWaitForever);
-
   /* Thread definition: read data */
-  osThreadDef(LPS22HH_Acquisition_Thread, LPS22HH_Thread, HSD_LPS22HH_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(LPS22HH_Acquisition_Thread, LPS22HH_Thread, HSD_LPS22HH_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   LPS22HH_Thread_Id = osThreadCreate(osThread(LPS22HH_Acquisition_Thread), NULL);
 }
@@ -139,6 +138,7 @@ void LPS22HH_OS_Init(void)
 static void LPS22HH_Thread(void const *argument)
 {
   (void) argument;
+  uint32_t events;
 
 #if (HSD_USE_DUMMY_DATA == 1)
   static uint16_t dummyDataCounter_press = 0;
@@ -157,9 +157,10 @@ static void LPS22HH_Thread(void const *argument)
     }
     else if (LPS22HH_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      osSemaphoreWait(lps22hh_drdy_sem_id, osWaitForever);
+      events = SM_Wait(&lps22hh_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (LPS22HH_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (LPS22HH_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
         uint8_t wtmFlag = 0;
         uint8_t wtmLevel = 0;
@@ -168,14 +169,14 @@ static void LPS22HH_Thread(void const *argument)
         lps22hh_fifo_wtm_flag_get(&lps22hh_ctx_instance, &wtmFlag);
         lps22hh_fifo_data_level_get(&lps22hh_ctx_instance, &wtmLevel);
 
-        if ((wtmFlag != 0) && (wtmLevel >= SAMPLES_PER_IT))
+        if ((wtmFlag != 0) && (wtmLevel >= lps22hh_samples_per_it))
         {
           lps22hh_read_reg(&lps22hh_ctx_instance, LPS22HH_FIFO_DATA_OUT_PRESS_XL, (uint8_t *) lps22hh_mem,
-                           SAMPLES_PER_IT * 5);
+                           lps22hh_samples_per_it * 5);
 
           uint16_t i = 0;
 
-          for (i = 0; i < wtmLevel; i++)
+          for (i = 0; i < lps22hh_samples_per_it; i++)
           {
             uint32_t press = (((uint32_t) lps22hh_mem[5 * i + 0]))
                              | (((uint32_t) lps22hh_mem[5 * i + 1]) << (8 * 1))
@@ -205,7 +206,7 @@ static void LPS22HH_Thread(void const *argument)
           }
 
 #if (HSD_USE_DUMMY_DATA == 1)
-          for (i = 0; i < SAMPLES_PER_IT; i++)
+          for (i = 0; i < lps22hh_samples_per_it; i++)
           {
             lps22hh_mem_press_f[i]  = (float)dummyDataCounter_press++;
             lps22hh_mem_temp_f[i] = (float)dummyDataCounter_temp++;
@@ -214,12 +215,12 @@ static void LPS22HH_Thread(void const *argument)
 
           if (LPS22HH_Init_Param.subSensorActive[0]) /* Pressure Active */
           {
-            LPS22HH_Data_Ready(0, (uint8_t *) lps22hh_mem_press_f, 4 * SAMPLES_PER_IT,
+            LPS22HH_Data_Ready(0, (uint8_t *) lps22hh_mem_press_f, 4 * lps22hh_samples_per_it,
                                TimeStamp_lps22hh); /*Todo check dimension / format...*/
           }
           if (LPS22HH_Init_Param.subSensorActive[1]) /* Temperature Active */
           {
-            LPS22HH_Data_Ready(1, (uint8_t *) lps22hh_mem_temp_f, 4 * SAMPLES_PER_IT,
+            LPS22HH_Data_Ready(1, (uint8_t *) lps22hh_mem_temp_f, 4 * lps22hh_samples_per_it,
                                TimeStamp_lps22hh); /*Todo check dimension / format...*/
           }
         }
@@ -293,7 +294,12 @@ static void LPS22HH_Sensor_Init(void)
   lps22hh_fifo_mode_set(&lps22hh_ctx_instance, LPS22HH_STREAM_MODE);
 
   /* Set watermark */
-  lps22hh_fifo_watermark_set(&lps22hh_ctx_instance, WTM_LEVEL);
+#if (HSD_WTM_ADAPTIVE == 1)
+  lps22hh_samples_per_it = HSD_WTM_Get_Level(s_nLPS22HH_id);
+#else
+  lps22hh_samples_per_it = WTM_LEVEL;
+#endif /* (HSD_WTM_ADAPTIVE == 1) */
+  lps22hh_fifo_watermark_set(&lps22hh_ctx_instance, (uint8_t) lps22hh_samples_per_it);
 
   /* FIFO_WTM routing on pin INT */
   lps22hh_fifo_threshold_on_int_set(&lps22hh_ctx_instance, PROPERTY_ENABLE);
@@ -337,13 +343,16 @@ static void LPS22HH_Sensor_Init(void)
   {
     lps22hh_data_rate_set(&lps22hh_ctx_instance, LPS22HH_200_Hz);
   }
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  lps22hh_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nLPS22HH_id, lps22hh_samples_per_it);
 }
 
 /* Data Ready */
 static void LPS22HH_Int_Callback(void)
 {
-  TimeStamp_lps22hh = SM_GetTimeStamp_fromISR();
-  osSemaphoreRelease(lps22hh_drdy_sem_id);
+  TimeStamp_lps22hh = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&lps22hh_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void LPS22HH_Set_State(SM_Sensor_State_t state)
@@ -351,6 +360,11 @@ void LPS22HH_Set_State(SM_Sensor_State_t state)
   LPS22HH_Sensor_State = state;
 }
 
+SM_Sensor_State_t LPS22HH_Get_State(void)
+{
+  return LPS22HH_Sensor_State;
+}
+
 void LPS22HH_Start(void)
 {
   LPS22HH_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -360,9 +374,10 @@ void LPS22HH_Start(void)
 void LPS22HH_Stop(void)
 {
   LPS22HH_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&lps22hh_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void LPS22HH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void LPS22HH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -393,6 +408,8 @@ uint8_t LPS22HH_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nLPS22HH_id, &lps22hh_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nLPS22HH_id);
 
   /* SENSOR DESCRIPTOR */
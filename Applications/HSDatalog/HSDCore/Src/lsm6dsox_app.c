@@ -25,6 +25,9 @@
 #include "com_manager.h"
 #include "device_description.h"
 #include "lsm6dsox_reg.h"
+#include "HSD_fifo_demux.h"
+#include "HSD_fifo_ts.h"
+#include "HSD_watermark.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -35,29 +38,38 @@
 #define WRITE_BUFFER_SIZE_LSM6DSOX_MLC (uint32_t)(1024)
 
 #define LSM6DSOX_SAMPLE_SIZE  (7)
-#define LSM6DSOX_TAG_ACC      (0x02)
 
-#define MLC_CONFIG              (0x00000001)
-#define DHCX_INIT               (0x00000010)
-#define DHCX_FIFO               (0x00000011)
-#define DHCX_MLC                (0x00000100)
-#define DHCX_SUSPEND            (0x00000101)
+/* Thread notifications besides SM_NOTIFY_xxx: MLC interrupt, new UCF to be programmed and FIFO batch left behind.
+ * FIFO_REARM is served as SM_NOTIFY_DATA_READY but without an interrupt time, so it is not a latency sample. */
+#define DHCX_MLC                (SM_NOTIFY_APP)
+#define MLC_CONFIG              (SM_NOTIFY_APP << 1)
+#define FIFO_REARM              (SM_NOTIFY_APP << 2)
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nLSM6DSOX_id = -1;
 
-static volatile double TimeStamp_lsm6dsox;
+static volatile HSD_TimeStamp_t TimeStamp_lsm6dsox;
 static uint8_t lsm6dsox_mem[LSM6DSOX_MAX_SAMPLES_PER_IT * 7];
 static uint8_t lsm6dsox_mem_app[LSM6DSOX_MAX_SAMPLES_PER_IT / 2 * 6]; /*without Tag*/
+static HSD_FIFO_Demux_t lsm6dsox_fifo_demux;
+#if (HSD_FIFO_TIMESTAMP == 1)
+static HSD_FIFO_TS_t lsm6dsox_fifo_ts;
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
 uint16_t lsm6dsox_samples_per_it;
 
+static const HSD_WTM_Fifo_t lsm6dsox_wtm_fifo =
+{
+  LSM6DSOX_FIFO_DEPTH, LSM6DSOX_MIN_WTM_LEVEL, LSM6DSOX_MAX_WTM_LEVEL, 7, 0x03U, 1, HSD_WTM_BUS_SPI1,
+  HSD_FIFO_TS_DECIMATION
+};
+
 #if (HSD_USE_DUMMY_DATA == 1)
 static int16_t dummyDataCounter_acc = 0;
 static int16_t dummyDataCounter_gyro = 0;
 #endif /* (HSD_USE_DUMMY_DATA == 1) */
 
-static volatile double TimeStamp_mlc;
+static volatile HSD_TimeStamp_t TimeStamp_mlc;
 static uint8_t mlc_mem[8];
 lsm6dsox_mlc_status_mainpage_t mlc_status;
 
@@ -71,16 +83,14 @@ SM_Init_Param_t LSM6DSOX_Init_Param;
 SM_Sensor_State_t LSM6DSOX_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 volatile static uint32_t MLC_Data_Ready = 0;
 
-/* Semaphore used to wait on component interrupt */
-osSemaphoreId lsm6dsox_DreadySem_id;
-osSemaphoreDef(lsm6dsox_DreadySem);
-
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-osSemaphoreId lsm6dsoxReadSem_id;
-osSemaphoreDef(lsm6dsoxReadSem);
+osThreadId LSM6DSOX_Thread_Id;
 
-osMessageQId lsm6dsoxThreadQueue_id;
-osMessageQDef(lsm6dsoxThreadQueue, 100, int);
+/* Notifications of the thread: FIFO and MLC interrupts, bus read complete (managed by lower layer),
+ * state change and new UCF */
+static SM_Notifier_t lsm6dsox_notifier =
+{
+  &LSM6DSOX_Thread_Id
+};
 
 sensor_handle_t lsm6dsox_hdl_instance =
 {
@@ -88,7 +98,7 @@ sensor_handle_t lsm6dsox_hdl_instance =
   0,
   LSM6DSOX_SPI_CS_GPIO_Port,
   LSM6DSOX_SPI_CS_Pin,
-  &lsm6dsoxReadSem_id
+  &lsm6dsox_notifier
 };
 stmdev_ctx_t lsm6dsox_ctx_instance =
 {
@@ -103,7 +113,6 @@ EXTI_HandleTypeDef lsm6dsox_exti;
 TIM_HandleTypeDef htim2;
 
 /* Private function prototypes -----------------------------------------------*/
-osThreadId LSM6DSOX_Thread_Id;
 static void LSM6DSOX_Thread(void const *argument);
 static void HSD_MLC_Int_Config(void);
 static void LSM6DSOX_Program_MLC(uint32_t size, char *buffer);
@@ -111,6 +120,7 @@ static void LSM6DSOX_Init(void);
 static void LSM6DSOX_Read_MLC(void);
 static void LSM6DSOX_Read_Data(void);
 static void LSM6DSOX_Read_Data_From_FIFO(void);
+static void LSM6DSOX_Reserve_FIFO_Span(uint8_t subSensorId, uint16_t nSamples);
 static void LSM6DSOX_Suspend(void);
 #if (HSD_USE_DUMMY_DATA == 1)
 static void LSM6DSOX_CreateDummyData(void);
@@ -125,7 +135,6 @@ static void LSM6DSOX_GY_FS_From_UCF(void);
 static void LSM6DSOX_Sensor_Init(void);
 static void LSM6DSOX_MLC_Int_Callback(void);
 
-void LSM6DSOX_sendCMD(uint32_t cmd);
 static uint8_t LSM6DSOX_updateSensorStatus(void);
 
 static void MX_TIM2_Init(void);
@@ -177,17 +186,6 @@ void LSM6DSOX_Peripheral_Init(void)
 
 void LSM6DSOX_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  lsm6dsoxReadSem_id = osSemaphoreCreate(osSemaphore(lsm6dsoxReadSem), 1);
-  osSemaphoreWait(lsm6dsoxReadSem_id, osWaitForever);
-
-  /* Data ready interrupt semaphore initialization */
-  lsm6dsox_DreadySem_id = osSemaphoreCreate(osSemaphore(lsm6dsox_DreadySem), 1);
-  osSemaphoreWait(lsm6dsox_DreadySem_id, osWaitForever);
-
-  lsm6dsoxThreadQueue_id = osMessageCreate(osMessageQ(lsm6dsoxThreadQueue), NULL);
-  vQueueAddToRegistry(lsm6dsoxThreadQueue_id, "lsm6dsoxThreadQueue_id");
-
   /* Thread 1 definition */
   osThreadDef(ISM330_RD_USR_THREAD, LSM6DSOX_Thread, HSD_LSM6DSOX_THREAD_PRIO, 1, 8000 / 4);
   /* Start thread 1 */
@@ -197,7 +195,7 @@ void LSM6DSOX_OS_Init(void)
 static void LSM6DSOX_Thread(void const *argument)
 {
   (void) argument;
-  osEvent evt;
+  uint32_t events;
 
 #if (configUSE_APPLICATION_TASK_TAG == 1 && defined(HSD_TASK_LSM6DSOX_DEBUG_PIN))
   vTaskSetApplicationTaskTag(NULL, (TaskHookFunction_t)HSD_TASK_LSM6DSOX_DEBUG_PIN);
@@ -207,53 +205,40 @@ static void LSM6DSOX_Thread(void const *argument)
 
   for (;;)
   {
-    evt = osMessageGet(lsm6dsoxThreadQueue_id, osWaitForever);
+    events = SM_Wait(&lsm6dsox_notifier,
+                     SM_NOTIFY_DATA_READY | FIFO_REARM | SM_NOTIFY_STATE_CHANGE | DHCX_MLC | MLC_CONFIG);
 
-    if (evt.status == osEventMessage)
+    if ((events & MLC_CONFIG) != 0U)
     {
-      switch (evt.value.v)
+      LSM6DSOX_Program_MLC((uint32_t) UCFSize, (char *) UCFData);
+      HSD_free((void *) UCFData);
+      if (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_MLC_CONFIG)
       {
-        case MLC_CONFIG:
-        {
-          LSM6DSOX_Program_MLC((uint32_t) UCFSize, (char *) UCFData);
-          HSD_free((void *) UCFData);
-          LSM6DSOX_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
-          break;
-        }
-        case DHCX_INIT:
-        {
-          LSM6DSOX_Init();
-          LSM6DSOX_Sensor_State = SM_SENSOR_STATE_RUNNING;
-          break;
-        }
-        case DHCX_FIFO:
-        {
-          if (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_RUNNING)
-          {
-            LSM6DSOX_Read_Data();
-          }
-          break;
-        }
-        case DHCX_MLC:
-        {
-          if (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_RUNNING)
-          {
-            LSM6DSOX_Read_MLC();
-          }
-          break;
-        }
-        case DHCX_SUSPEND:
-        {
-          LSM6DSOX_Suspend();
-          LSM6DSOX_Sensor_State = SM_SENSOR_STATE_SUSPENDED;
-          break;
-        }
-        default:
-        {
-          break;
-        }
+        LSM6DSOX_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
       }
     }
+    if ((events & SM_NOTIFY_STATE_CHANGE) != 0U)
+    {
+      /* Only the last state set by LSM6DSOX_Start or LSM6DSOX_Stop is served */
+      if (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_INITIALIZING)
+      {
+        LSM6DSOX_Init();
+        LSM6DSOX_Sensor_State = SM_SENSOR_STATE_RUNNING;
+      }
+      else if (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_SUSPENDING)
+      {
+        LSM6DSOX_Suspend();
+        LSM6DSOX_Sensor_State = SM_SENSOR_STATE_SUSPENDED;
+      }
+    }
+    if (((events & (SM_NOTIFY_DATA_READY | FIFO_REARM)) != 0U) && (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_RUNNING))
+    {
+      LSM6DSOX_Read_Data();
+    }
+    if (((events & DHCX_MLC) != 0U) && (LSM6DSOX_Sensor_State == SM_SENSOR_STATE_RUNNING))
+    {
+      LSM6DSOX_Read_MLC();
+    }
   }
 }
 
@@ -270,6 +255,26 @@ static void LSM6DSOX_Init(void)
     /* Route int pins for MLC */
     HSD_MLC_Int_Config();
   }
+
+  /* ACC and GYRO words go to subsensors 0 and 1, any other TAG is dropped */
+  HSD_FIFO_DEMUX_Init(&lsm6dsox_fifo_demux);
+  if (LSM6DSOX_Init_Param.subSensorActive[0])
+  {
+    HSD_FIFO_DEMUX_Route(&lsm6dsox_fifo_demux, HSD_FIFO_TAG_XL_NC, 0, 6);
+  }
+  if (LSM6DSOX_Init_Param.subSensorActive[1])
+  {
+    HSD_FIFO_DEMUX_Route(&lsm6dsox_fifo_demux, HSD_FIFO_TAG_GYRO_NC, 1, 6);
+  }
+
+#if (HSD_FIFO_TIMESTAMP == 1)
+  HSD_FIFO_TS_Init(&lsm6dsox_fifo_ts, SM_SENSOR_TIMESTAMP_FREQ);
+  HSD_FIFO_TS_Set_Subsensor(&lsm6dsox_fifo_ts, 0, HSD_FIFO_TAG_XL_NC,
+                            LSM6DSOX_Init_Param.subSensorActive[0] ? LSM6DSOX_Init_Param.ODR[0] : 0.0f);
+  HSD_FIFO_TS_Set_Subsensor(&lsm6dsox_fifo_ts, 1, HSD_FIFO_TAG_GYRO_NC,
+                            LSM6DSOX_Init_Param.subSensorActive[1] ? LSM6DSOX_Init_Param.ODR[1] : 0.0f);
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
+
   lsm6dsox_fifo_mode_set(&lsm6dsox_ctx_instance, LSM6DSOX_STREAM_MODE);
   HAL_TIM_IC_Start_IT(&htim2, TIM_CHANNEL_3);
 }
@@ -285,12 +290,24 @@ static void LSM6DSOX_Read_Data(void)
   if ((reg[1]) & 0x80 && (fifo_level >= lsm6dsox_samples_per_it))
   {
     LSM6DSOX_Read_Data_From_FIFO();
+
+    /* Interrupts coalesced while the thread was busy: serve the next batch at once, the interrupt line stays high */
+    if (fifo_level >= 2U * lsm6dsox_samples_per_it)
+    {
+      lsm6dsox_notifier.pending |= FIFO_REARM;
+    }
   }
 }
 
 static void LSM6DSOX_Read_Data_From_FIFO(void)
 {
-  uint16_t i = 0;
+  HSD_FIFO_Demux_t *pDemux = &lsm6dsox_fifo_demux;
+  HSD_TimeStamp_t timeStamp[2];
+  uint16_t nSamples[2];
+  uint8_t zeroCopy[2];
+  uint8_t subSensorId;
+  uint8_t inPlace;
+
   /* Read sensor data from FIFO */
   lsm6dsox_read_reg(&lsm6dsox_ctx_instance, LSM6DSOX_FIFO_DATA_OUT_TAG, (uint8_t *) lsm6dsox_mem,
                     lsm6dsox_samples_per_it * 7);
@@ -299,83 +316,76 @@ static void LSM6DSOX_Read_Data_From_FIFO(void)
   LSM6DSOX_CreateDummyData();
 #endif /* (HSD_USE_DUMMY_DATA == 1) */
 
-  if (LSM6DSOX_Init_Param.subSensorActive[0] && LSM6DSOX_Init_Param.subSensorActive[1]) /* Read both ACC and GYRO */
-  {
-    uint32_t ODR_Acc = (uint32_t) COM_GetSubSensorStatus(LSM6DSOX_Get_Id(), 0)->ODR;
-    uint32_t ODR_Gyro = (uint32_t) COM_GetSubSensorStatus(LSM6DSOX_Get_Id(), 1)->ODR;
-    uint32_t gyroSamplesCount = 0;
-    uint32_t accSamplesCount = 0;
-
-    int16_t *p16src = (int16_t *) lsm6dsox_mem;
-    int16_t *pAcc;
-    int16_t *pGyro;
+#if (HSD_FIFO_TIMESTAMP == 1)
+  HSD_FIFO_TS_Process(&lsm6dsox_fifo_ts, lsm6dsox_mem, lsm6dsox_samples_per_it, TimeStamp_lsm6dsox, timeStamp);
+#else
+  timeStamp[0] = TimeStamp_lsm6dsox;
+  timeStamp[1] = TimeStamp_lsm6dsox;
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
 
-    if (ODR_Acc > ODR_Gyro) /* Acc is faster than Gyro */
-    {
-      pAcc = (int16_t *) lsm6dsox_mem;
-      pGyro = (int16_t *) lsm6dsox_mem_app;
-    }
-    else
-    {
-      pAcc = (int16_t *) lsm6dsox_mem_app;
-      pGyro = (int16_t *) lsm6dsox_mem;
-    }
+  HSD_FIFO_DEMUX_Start(pDemux, lsm6dsox_mem, lsm6dsox_samples_per_it);
 
-    uint8_t *pTag = (uint8_t *) p16src;
+  /* On the copy path the subsensor with more samples is compacted in place in lsm6dsox_mem,
+   * the other one in lsm6dsox_mem_app */
+  inPlace = (pDemux->sink[1].nSamples > pDemux->sink[0].nSamples) ? 1 : 0;
 
-    for (i = 0; i < lsm6dsox_samples_per_it; i++)
+  for (subSensorId = 0; subSensorId < 2; subSensorId++)
+  {
+    nSamples[subSensorId] = pDemux->sink[subSensorId].nSamples;
+    zeroCopy[subSensorId] = 0;
+    if (nSamples[subSensorId] == 0)
     {
-      if (((*pTag) >> 3) == LSM6DSOX_TAG_ACC)
-      {
-        p16src = (int16_t *)(pTag + 1);
-        *pAcc++ = *p16src++;
-        *pAcc++ = *p16src++;
-        *pAcc++ = *p16src++;
-        accSamplesCount++;
-      }
-      else
-      {
-        p16src = (int16_t *)(pTag + 1);
-        *pGyro++ = *p16src++;
-        *pGyro++ = *p16src++;
-        *pGyro++ = *p16src++;
-        gyroSamplesCount++;
-      }
-      pTag += 7;
+      continue;
     }
-    if (ODR_Acc > ODR_Gyro) /* Acc is faster than Gyro */
+    if (LSM6DSOX_Data_Begin(subSensorId, nSamples[subSensorId], timeStamp[subSensorId]))
     {
-      LSM6DSOX_Data_Ready(0, (uint8_t *) lsm6dsox_mem, accSamplesCount * 6, TimeStamp_lsm6dsox);
-      LSM6DSOX_Data_Ready(1, (uint8_t *) lsm6dsox_mem_app, gyroSamplesCount * 6, TimeStamp_lsm6dsox);
+      zeroCopy[subSensorId] = 1;
+      LSM6DSOX_Reserve_FIFO_Span(subSensorId, nSamples[subSensorId]);
     }
     else
     {
-      LSM6DSOX_Data_Ready(0, (uint8_t *) lsm6dsox_mem_app, accSamplesCount * 6, TimeStamp_lsm6dsox);
-      LSM6DSOX_Data_Ready(1, (uint8_t *) lsm6dsox_mem, gyroSamplesCount * 6, TimeStamp_lsm6dsox);
+      HSD_FIFO_DEMUX_Set_Span(pDemux, subSensorId, (subSensorId == inPlace) ? lsm6dsox_mem : lsm6dsox_mem_app,
+                              nSamples[subSensorId]);
     }
   }
-  else /* 1 subsensor active only --> simply drop TAGS */
+
+  /* Single pass on the FIFO words, interrupted only when a slot in the SD buffer is full */
+  while ((subSensorId = HSD_FIFO_DEMUX_Run(pDemux)) != HSD_FIFO_SINK_NONE)
   {
-    int16_t *p16src = (int16_t *) lsm6dsox_mem;
-    int16_t *p16dest = (int16_t *) lsm6dsox_mem;
-    for (i = 0; i < lsm6dsox_samples_per_it; i++)
-    {
-      p16src = (int16_t *) & ((uint8_t *)(p16src))[1];
-      *p16dest++ = *p16src++;
-      *p16dest++ = *p16src++;
-      *p16dest++ = *p16src++;
-    }
-    if (LSM6DSOX_Init_Param.subSensorActive[0]) /* Acc only */
+    LSM6DSOX_Data_Commit(subSensorId, pDemux->sink[subSensorId].written);
+    nSamples[subSensorId] -= pDemux->sink[subSensorId].written;
+    LSM6DSOX_Reserve_FIFO_Span(subSensorId, nSamples[subSensorId]);
+  }
+
+  for (subSensorId = 0; subSensorId < 2; subSensorId++)
+  {
+    if (zeroCopy[subSensorId])
     {
-      LSM6DSOX_Data_Ready(0, (uint8_t *) lsm6dsox_mem, lsm6dsox_samples_per_it * 6, TimeStamp_lsm6dsox);
+      LSM6DSOX_Data_Commit(subSensorId, pDemux->sink[subSensorId].written);
     }
-    else if (LSM6DSOX_Init_Param.subSensorActive[1]) /* Gyro only */
+    else if (nSamples[subSensorId] > 0)
     {
-      LSM6DSOX_Data_Ready(1, (uint8_t *) lsm6dsox_mem, lsm6dsox_samples_per_it * 6, TimeStamp_lsm6dsox);
+      LSM6DSOX_Data_Ready(subSensorId, (subSensorId == inPlace) ? lsm6dsox_mem : lsm6dsox_mem_app,
+                          nSamples[subSensorId] * 6, timeStamp[subSensorId]);
     }
   }
 }
 
+/**
+  * @brief  Reserve the next slot in the SD buffer for the FIFO samples of a subsensor.
+  *         Without a slot (SD buffer full) the demux drops the remaining samples.
+  * @param  subSensorId: 0 for ACC, 1 for GYRO
+  * @param  nSamples: samples of the subsensor still to be written
+  * @retval None
+  */
+static void LSM6DSOX_Reserve_FIFO_Span(uint8_t subSensorId, uint16_t nSamples)
+{
+  uint16_t slot = nSamples;
+  uint8_t *dst = LSM6DSOX_Data_Reserve(subSensorId, &slot);
+
+  HSD_FIFO_DEMUX_Set_Span(&lsm6dsox_fifo_demux, subSensorId, dst, slot);
+}
+
 #if (HSD_USE_DUMMY_DATA == 1)
 static void LSM6DSOX_CreateDummyData(void)
 {
@@ -385,13 +395,13 @@ static void LSM6DSOX_CreateDummyData(void)
   for (i = 0; i < lsm6dsox_samples_per_it; i++)
   {
     p16 = (int16_t *)(&lsm6dsox_mem[i * 7] + 1);
-    if ((lsm6dsox_mem[i * 7] >> 3) == LSM6DSOX_TAG_ACC)
+    if ((lsm6dsox_mem[i * 7] >> 3) == HSD_FIFO_TAG_XL_NC)
     {
       *p16++ = dummyDataCounter_acc++;
       *p16++ = dummyDataCounter_acc++;
       *p16++ = dummyDataCounter_acc++;
     }
-    else
+    else if ((lsm6dsox_mem[i * 7] >> 3) == HSD_FIFO_TAG_GYRO_NC)
     {
       *p16++ = dummyDataCounter_gyro++;
       *p16++ = dummyDataCounter_gyro++;
@@ -428,14 +438,6 @@ static void LSM6DSOX_Suspend(void)
   lsm6dsox_fifo_xl_batch_set(&lsm6dsox_ctx_instance, LSM6DSOX_XL_NOT_BATCHED);
 }
 
-void LSM6DSOX_sendCMD(uint32_t cmd)
-{
-  if (osMessagePut(lsm6dsoxThreadQueue_id, cmd, 0) != osOK)
-  {
-    while (1);
-  }
-}
-
 static uint8_t LSM6DSOX_updateSensorStatus(void)
 {
   COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(LSM6DSOX_Get_Id(), 2);
@@ -712,8 +714,10 @@ static void LSM6DSOX_Sensor_Init(void)
 {
   uint8_t reg0;
   uint16_t lsm6dsox_wtm_level = 0;
+#if (HSD_WTM_ADAPTIVE == 0)
   uint16_t lsm6dsox_wtm_level_acc;
   uint16_t lsm6dsox_wtm_level_gyro;
+#endif /* (HSD_WTM_ADAPTIVE == 0) */
   lsm6dsox_odr_xl_t lsm6dsox_odr_xl = LSM6DSOX_XL_ODR_OFF;
   lsm6dsox_bdr_xl_t lsm6dsox_bdr_xl = LSM6DSOX_XL_NOT_BATCHED;
   lsm6dsox_odr_g_t lsm6dsox_odr_g = LSM6DSOX_GY_ODR_OFF;
@@ -886,7 +890,16 @@ static void LSM6DSOX_Sensor_Init(void)
     lsm6dsox_fifo_gy_batch_set(&lsm6dsox_ctx_instance, LSM6DSOX_GY_NOT_BATCHED);
   }
 
+#if (HSD_FIFO_TIMESTAMP == 1)
+  /* Batch the timestamp counter every 8 sample sets */
+  lsm6dsox_timestamp_set(&lsm6dsox_ctx_instance, PROPERTY_ENABLE);
+  lsm6dsox_fifo_timestamp_decimation_set(&lsm6dsox_ctx_instance, LSM6DSOX_DEC_8);
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
+
   /* Calculation of watermark and samples per int*/
+#if (HSD_WTM_ADAPTIVE == 1)
+  lsm6dsox_wtm_level = HSD_WTM_Get_Level(s_nLSM6DSOX_id);
+#else
   lsm6dsox_wtm_level_acc = ((uint16_t) LSM6DSOX_Init_Param.ODR[0] * (uint16_t) LSM6DSOX_MAX_DRDY_PERIOD);
   lsm6dsox_wtm_level_gyro = ((uint16_t) LSM6DSOX_Init_Param.ODR[1] * (uint16_t) LSM6DSOX_MAX_DRDY_PERIOD);
 
@@ -921,6 +934,7 @@ static void LSM6DSOX_Sensor_Init(void)
   {
     lsm6dsox_wtm_level = LSM6DSOX_MIN_WTM_LEVEL;
   }
+#endif /* (HSD_WTM_ADAPTIVE == 1) */
   lsm6dsox_samples_per_it = lsm6dsox_wtm_level;
 
   /* Setup int for FIFO */
@@ -932,6 +946,9 @@ static void LSM6DSOX_Sensor_Init(void)
   };
   int1_route.fifo_th = 1;
   lsm6dsox_pin_int1_route_set(&lsm6dsox_ctx_instance, int1_route);
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  lsm6dsox_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nLSM6DSOX_id, lsm6dsox_samples_per_it);
 }
 
 static void HSD_MLC_Int_Config(void)
@@ -1036,9 +1053,9 @@ int32_t LSM6DSOX_GetUCF_FromBuffer(char *buffer_in, uint32_t size_in, char *buff
 
 static void LSM6DSOX_MLC_Int_Callback(void)
 {
-  TimeStamp_mlc = SM_GetTimeStamp_fromISR();
+  TimeStamp_mlc = SM_GetSensorTimeStamp_fromISR();
   MLC_Data_Ready = 1;
-  LSM6DSOX_sendCMD(DHCX_MLC);
+  SM_Notify_fromISR(&lsm6dsox_notifier, DHCX_MLC);
 }
 
 /*
@@ -1049,8 +1066,8 @@ void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim)
 {
   /* Prevent unused argument(s) compilation warning */
   UNUSED(htim);
-  TimeStamp_lsm6dsox = SM_GetTimeStamp_fromISR();
-  LSM6DSOX_sendCMD(DHCX_FIFO);
+  TimeStamp_lsm6dsox = SM_GetSensorTimeStamp_fromISR();
+  SM_Notify_fromISR(&lsm6dsox_notifier, SM_NOTIFY_DATA_READY);
 }
 
 void LSM6DSOX_Set_State(SM_Sensor_State_t state)
@@ -1058,10 +1075,15 @@ void LSM6DSOX_Set_State(SM_Sensor_State_t state)
   LSM6DSOX_Sensor_State = state;
 }
 
+SM_Sensor_State_t LSM6DSOX_Get_State(void)
+{
+  return LSM6DSOX_Sensor_State;
+}
+
 void LSM6DSOX_Start(void)
 {
   LSM6DSOX_Set_State(SM_SENSOR_STATE_INITIALIZING);
-  LSM6DSOX_sendCMD(DHCX_INIT);
+  SM_Notify(&lsm6dsox_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
 void LSM6DSOX_SetUCF(uint32_t mlcConfigSize, char *mlcConfigData)
@@ -1069,16 +1091,31 @@ void LSM6DSOX_SetUCF(uint32_t mlcConfigSize, char *mlcConfigData)
   UCFSize = mlcConfigSize;
   UCFData = mlcConfigData;
   LSM6DSOX_Set_State(SM_SENSOR_STATE_MLC_CONFIG);
-  LSM6DSOX_sendCMD(MLC_CONFIG);
+  SM_Notify(&lsm6dsox_notifier, MLC_CONFIG);
 }
 
 void LSM6DSOX_Stop(void)
 {
   LSM6DSOX_Set_State(SM_SENSOR_STATE_SUSPENDING);
-  LSM6DSOX_sendCMD(DHCX_SUSPEND);
+  SM_Notify(&lsm6dsox_notifier, SM_NOTIFY_STATE_CHANGE);
+}
+
+__weak void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
+{
+
+}
+
+__weak uint8_t LSM6DSOX_Data_Begin(uint8_t subSensorId, uint16_t nSamples, HSD_TimeStamp_t timeStamp)
+{
+  return 0;
 }
 
-__weak void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak uint8_t *LSM6DSOX_Data_Reserve(uint8_t subSensorId, uint16_t *nSamples)
+{
+  return NULL;
+}
+
+__weak void LSM6DSOX_Data_Commit(uint8_t subSensorId, uint16_t nSamples)
 {
 
 }
@@ -1109,6 +1146,8 @@ uint8_t LSM6DSOX_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nLSM6DSOX_id, &lsm6dsox_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nLSM6DSOX_id);
 
   /* SENSOR DESCRIPTOR */
@@ -22,6 +22,7 @@
 #include "main.h"
 #include "sensors_manager.h"
 #include "com_manager.h"
+#include "HSD_dcfilter.h"
 #include "SensorTile.box_audio.h"
 #include <string.h>
 
@@ -37,7 +38,8 @@ static int32_t s_nMP23ABS1_id = -1;
 
 SM_Init_Param_t MP23ABS1_Init_Param;
 SM_Sensor_State_t MP23ABS1_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
-static uint32_t amic_mem[((MP23ABS1_MAX_SAMPLING_FREQUENCY / 1000) * MP23ABS1_MS * 2)];
+static uint32_t amic_mem[((MP23ABS1_MAX_SAMPLING_FREQUENCY / 1000) * MP23ABS1_MS)]; /* 16-bit samples, 2 per word */
+static HSD_DCFilter_t s_xDCFilter;
 
 DFSDM_Filter_HandleTypeDef hdfsdm1_filter1;
 DFSDM_Channel_HandleTypeDef hdfsdm1_channel0;
@@ -45,12 +47,16 @@ DMA_HandleTypeDef hdma_dfsdm1_flt1;
 
 osThreadId MP23ABS1_Thread_Id;
 
-osMessageQId amicDreadyQueue_id;
-osMessageQDef(amicdreadyqueue, 1, int);
+/* Notifications of the thread: half buffer ready (DFSDM DMA interrupt) and state change */
+static SM_Notifier_t mp23abs1_notifier =
+{
+  &MP23ABS1_Thread_Id
+};
+static void *volatile amic_data_ptr; /* half of amic_mem filled by the last DMA interrupt */
 
 static volatile uint32_t tim_value = 0, tim_value_old = 0, period = 0;
 static volatile uint64_t ts_mp23abs1;
-static volatile double TimeStamp_mp23abs1;
+static volatile HSD_TimeStamp_t TimeStamp_mp23abs1;
 /* Private function prototypes -----------------------------------------------*/
 
 static void MP23ABS1_ADC_Init(void);
@@ -84,11 +90,9 @@ void MP23ABS1_Peripheral_Init(void)
 void MP23ABS1_OS_Init(void)
 {
   /* Thread definition */
-  osThreadDef(MP23ABS1_RD_USR_THREAD, MP23ABS1_Thread, HSD_MP23ABS1_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(MP23ABS1_RD_USR_THREAD, MP23ABS1_Thread, HSD_MP23ABS1_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   MP23ABS1_Thread_Id = osThreadCreate(osThread(MP23ABS1_RD_USR_THREAD), NULL);
-
-  amicDreadyQueue_id = osMessageCreate(osMessageQ(amicdreadyqueue), NULL);
 }
 
 static void MP23ABS1_Thread(void const *argument)
@@ -99,7 +103,7 @@ static void MP23ABS1_Thread(void const *argument)
   static uint16_t dummyDataCounter = 0;
 #endif /* (HSD_USE_DUMMY_DATA == 1) */
 
-  osEvent evt;
+  uint32_t events;
 
   /* Suspend thread */
   osThreadSuspend(MP23ABS1_Thread_Id);
@@ -108,39 +112,36 @@ static void MP23ABS1_Thread(void const *argument)
   {
     if (MP23ABS1_Sensor_State == SM_SENSOR_STATE_INITIALIZING)
     {
+      HSD_DCFILTER_Reset(&s_xDCFilter);
       tim_value_old = 0;
       HAL_ADC_Start(&ADC1_Handle);
 
-      HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter1, (int32_t *) amic_mem,
-                                       ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2);
+      HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter1, (int16_t *) amic_mem,
+                                          ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2);
       MP23ABS1_Sensor_State = SM_SENSOR_STATE_RUNNING;
     }
     else if (MP23ABS1_Sensor_State == SM_SENSOR_STATE_RUNNING)
     {
-      evt = osMessageGet(amicDreadyQueue_id, osWaitForever);
+      events = SM_Wait(&mp23abs1_notifier, SM_NOTIFY_DATA_READY | SM_NOTIFY_STATE_CHANGE);
 
-      if (MP23ABS1_Sensor_State == SM_SENSOR_STATE_RUNNING) /* Change of state can happen while task blocked */
+      /* Change of state can happen while task blocked */
+      if (((events & SM_NOTIFY_DATA_READY) != 0U) && (MP23ABS1_Sensor_State == SM_SENSOR_STATE_RUNNING))
       {
-        void *data_ptr = evt.value.p; /* void since it is independent from data format*/
+        void *data_ptr = amic_data_ptr; /* void since it is independent from data format*/
         /* Do something */
-        uint16_t idx = 0;
 
-#if (HSD_USE_DUMMY_DATA != 1)
-        static int32_t oldIn = 0;
-        static int32_t oldOut = 0;
-        int32_t *p32 = (int32_t *) data_ptr;
-#endif /* (HSD_USE_DUMMY_DATA != 1) */
-        int16_t *p16 = (int16_t *) data_ptr;
+#if (HSD_USE_DUMMY_DATA == 1)
+        uint16_t idx = 0;
+        uint16_t *p16 = (uint16_t *) data_ptr;
 
         for (idx = 0; idx < (((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS); idx++)
         {
-#if (HSD_USE_DUMMY_DATA == 1)
           *p16++ = dummyDataCounter++;
+        }
 #else
-          *p16++ = oldOut = (0xFC * (oldOut + ((*p32) >> 12) - oldIn)) / 0xFF;
-          oldIn = (*p32++) >> 12;
+        HSD_DCFILTER_Process(&s_xDCFilter, (int16_t *) data_ptr,
+                             ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS);
 #endif /* (HSD_USE_DUMMY_DATA == 1) */
-        }
 
         MP23ABS1_Data_Ready(0, (uint8_t *) data_ptr, ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2,
                             TimeStamp_mp23abs1);
@@ -208,28 +209,29 @@ static void MP23ABS1_DFSDM_Init(void)
   hdfsdm1_channel0.Init.Input.Pins = DFSDM_CHANNEL_SAME_CHANNEL_PINS;
   hdfsdm1_channel0.Init.SerialInterface.Type = DFSDM_CHANNEL_SPI_FALLING;
 
+  /* The shift leaves the 16-bit PCM sample in the 16 MSB of the data register, read by the DMA */
   switch ((uint32_t) MP23ABS1_Init_Param.ODR[0])
   {
     case 8000:
-      hdfsdm1_channel0.Init.RightBitShift = 0x09;
+      hdfsdm1_channel0.Init.RightBitShift = 0x05;
       break;
     case 16000:
-      hdfsdm1_channel0.Init.RightBitShift = 0x07;
+      hdfsdm1_channel0.Init.RightBitShift = 0x03;
       break;
     case 32000:
-      hdfsdm1_channel0.Init.RightBitShift = 0x05;
+      hdfsdm1_channel0.Init.RightBitShift = 0x01;
       break;
     case 48000:
-      hdfsdm1_channel0.Init.RightBitShift = 0x0A;
+      hdfsdm1_channel0.Init.RightBitShift = 0x06;
       break;
     case 96000:
-      hdfsdm1_channel0.Init.RightBitShift = 0x07;
+      hdfsdm1_channel0.Init.RightBitShift = 0x03;
       break;
     case 192000:
-      hdfsdm1_channel0.Init.RightBitShift = 0x08;
+      hdfsdm1_channel0.Init.RightBitShift = 0x04;
       break;
     default:
-      hdfsdm1_channel0.Init.RightBitShift = 0x08;
+      hdfsdm1_channel0.Init.RightBitShift = 0x04;
       break;
   }
 
@@ -351,8 +353,8 @@ void MP23ABS1_DFSDM_FilterMspInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   hdma_dfsdm1_flt1.Init.Direction = DMA_PERIPH_TO_MEMORY;
   hdma_dfsdm1_flt1.Init.PeriphInc = DMA_PINC_DISABLE;
   hdma_dfsdm1_flt1.Init.MemInc = DMA_MINC_ENABLE;
-  hdma_dfsdm1_flt1.Init.PeriphDataAlignment = DMA_PDATAALIGN_WORD;
-  hdma_dfsdm1_flt1.Init.MemDataAlignment = DMA_MDATAALIGN_WORD;
+  hdma_dfsdm1_flt1.Init.PeriphDataAlignment = DMA_PDATAALIGN_HALFWORD;
+  hdma_dfsdm1_flt1.Init.MemDataAlignment = DMA_MDATAALIGN_HALFWORD;
   hdma_dfsdm1_flt1.Init.Mode = DMA_CIRCULAR;
   hdma_dfsdm1_flt1.Init.Priority = DMA_PRIORITY_HIGH;
 
@@ -381,12 +383,12 @@ void MP23ABS1_DFSDM_FilterMspInit(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   */
 void DFSDM_Filter_1_Complete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
 {
-  TimeStamp_mp23abs1 = SM_GetTimeStamp_fromISR();
+  TimeStamp_mp23abs1 = SM_GetSensorTimeStamp_fromISR();
 
   if (hdfsdm_filter == &hdfsdm1_filter1) /* Analog Mic */
   {
-    osMessagePut(amicDreadyQueue_id, (uint32_t)(&amic_mem[(((uint32_t) MP23ABS1_Init_Param.ODR[0]
-                                                            / 1000) * MP23ABS1_MS)]), osWaitForever);
+    amic_data_ptr = &((int16_t *) amic_mem)[(((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS)];
+    SM_Notify_fromISR(&mp23abs1_notifier, SM_NOTIFY_DATA_READY);
   }
 }
 
@@ -397,11 +399,12 @@ void DFSDM_Filter_1_Complete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
   */
 void DFSDM_Filter_1_HalfComplete_Callback(DFSDM_Filter_HandleTypeDef *hdfsdm_filter)
 {
-  TimeStamp_mp23abs1 = SM_GetTimeStamp_fromISR();
+  TimeStamp_mp23abs1 = SM_GetSensorTimeStamp_fromISR();
 
   if (hdfsdm_filter == &hdfsdm1_filter1) /* Analog Mic */
   {
-    osMessagePut(amicDreadyQueue_id, (uint32_t)(amic_mem), osWaitForever);
+    amic_data_ptr = amic_mem;
+    SM_Notify_fromISR(&mp23abs1_notifier, SM_NOTIFY_DATA_READY);
   }
 }
 
@@ -422,8 +425,8 @@ void MP23ABS1_updateConfig(void)
 
 void MP23ABS1_StartAcquisition(void)
 {
-  HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter1, (int32_t *) amic_mem,
-                                   ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2);
+  HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter1, (int16_t *) amic_mem,
+                                      ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2);
 }
 
 void MP23ABS1_StopAcquisition(void)
@@ -438,8 +441,8 @@ void MP23ABS1_PauseAcquisition(void)
 
 void MP23ABS1_ResumeAcquisition(void)
 {
-  HAL_DFSDM_FilterRegularStart_DMA(&hdfsdm1_filter1, (int32_t *) amic_mem,
-                                   ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2);
+  HAL_DFSDM_FilterRegularMsbStart_DMA(&hdfsdm1_filter1, (int16_t *) amic_mem,
+                                      ((uint32_t) MP23ABS1_Init_Param.ODR[0] / 1000) * MP23ABS1_MS * 2);
 }
 
 void MP23ABS1_Set_State(SM_Sensor_State_t state)
@@ -447,6 +450,11 @@ void MP23ABS1_Set_State(SM_Sensor_State_t state)
   MP23ABS1_Sensor_State = state;
 }
 
+SM_Sensor_State_t MP23ABS1_Get_State(void)
+{
+  return MP23ABS1_Sensor_State;
+}
+
 void MP23ABS1_Start(void)
 {
   MP23ABS1_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -456,9 +464,10 @@ void MP23ABS1_Start(void)
 void MP23ABS1_Stop(void)
 {
   MP23ABS1_Set_State(SM_SENSOR_STATE_SUSPENDING);
+  SM_Notify(&mp23abs1_notifier, SM_NOTIFY_STATE_CHANGE);
 }
 
-__weak void MP23ABS1_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void MP23ABS1_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
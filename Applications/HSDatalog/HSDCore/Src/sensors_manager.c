@@ -22,6 +22,7 @@
 #include "main.h"
 #include "com_manager.h"
 #include "HSD_tags.h"
+#include "string.h"
 
 #include "mp23abs1_app.h"
 #include "lsm6dsox_app.h"
@@ -35,19 +36,55 @@
 /* Private includes ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
 
-typedef struct SM_ThreadParameters_t
-{
-  osSemaphoreId *comThreadSem_id;
-  osMessageQId *comReqQueue_id;
-  osPoolId *comPool_id;
-  void *hcom;
-} SM_ThreadParameters_t;
-
 /* Private define ------------------------------------------------------------*/
 #define SM_I2C_TIMEOUT              ( 1000 )
 #define SM_SPI_TIMEOUT              ( 1000 )
 #define SM_TS_UPDATE_PERIOD_S     (10)
 
+#define SM_BUS_DEFAULT_SLACK_US     ( 100000 )  /* slack of the sensors that do not set one */
+#define SM_BUS_MAX_SLACK_US         ( 1000000 ) /* deadlines are compared on 32 bit ticks */
+
+#define SM_SPI_DMA_BUFFER_SIZE      ( 1 + LSM6DSOX_MAX_SAMPLES_PER_IT * 7 ) /* address byte and largest FIFO read */
+
+typedef struct
+{
+  SM_Message_t *volatile incoming; /* new requests, latest first, pushed lock-free by the requesting threads */
+  volatile uint32_t busy;          /* set while a context starts a transaction and until the transaction ends */
+  SM_Message_t *pending;           /* requests taken from incoming by the bus owner, in arrival order */
+  uint32_t nPending;
+  sensor_handle_t *lastDevice;
+  SM_Message_t *current;           /* transaction in progress */
+} SM_BusScheduler_t;
+
+typedef struct
+{
+#if (HSD_SPI_SINGLE_DMA == 1)
+  uint8_t buffer[SM_SPI_DMA_BUFFER_SIZE]; /* register address followed by the data, DMA source and destination */
+#endif /* HSD_SPI_SINGLE_DMA */
+  uint8_t singleDma;    /* the transaction in progress uses buffer */
+  uint8_t addressPhase; /* split transaction: the DMA in progress sends the address byte, the data DMA follows */
+  uint8_t addressRx;    /* byte clocked in while the address of a split transaction is sent */
+  uint64_t start;       /* SM_GetTicks() when the chip select went low */
+} SM_SPI_Transfer_t;
+
+typedef struct
+{
+  uint8_t addressPhase; /* the interrupt transmit in progress sends the register address, the data DMA follows */
+} SM_I2C_Transfer_t;
+
+typedef struct SM_BusContext_t
+{
+  osThreadId *comThread_id; /* bus served by a thread (start == NULL): notified of new requests */
+  void *hcom;
+  uint8_t bus; /* COM_BUS_xxx */
+  SM_BusScheduler_t sched;
+  SM_SPI_Transfer_t *spiTransfer;
+  SM_I2C_Transfer_t *i2cTransfer;
+  /* start a transaction, ends in an interrupt; HAL_OK if it was started */
+  HAL_StatusTypeDef (*start)(struct SM_BusContext_t *pBus, SM_Message_t *msg);
+  void (*end)(struct SM_BusContext_t *pBus, SM_Message_t *msg);   /* completion work in the interrupt, or NULL */
+} SM_BusContext_t;
+
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
 SPI_HandleTypeDef hspi1;
@@ -70,55 +107,27 @@ DMA_HandleTypeDef hdma_i2c3_tx;
 
 TIM_HandleTypeDef htim5;
 
-osSemaphoreId spi1ThreadSem_id;
-osSemaphoreDef(spi1ThreadSem);
-
-osSemaphoreId spi3ThreadSem_id;
-osSemaphoreDef(spi3ThreadSem);
-
-osSemaphoreId i2c1ThreadSem_id;
-osSemaphoreDef(i2c1ThreadSem);
-
-osSemaphoreId i2c3ThreadSem_id;
-osSemaphoreDef(i2c3ThreadSem);
-
-osMessageQId spi1ReqQueue_id;
-osMessageQDef(spi1reqqueue, 10, int);
-
-osMessageQId spi3ReqQueue_id;
-osMessageQDef(spi3reqqueue, 10, int);
-
-osMessageQId i2c1ReqQueue_id;
-osMessageQDef(i2c1reqqueue, 10, int);
-
-osMessageQId i2c3ReqQueue_id;
-osMessageQDef(i2c3reqqueue, 10, int);
-
-osPoolId spi1Pool_id;
-osPoolDef(spi1Pool, 100, SM_Message_t);
-
-osPoolId spi3Pool_id;
-osPoolDef(spi3Pool, 100, SM_Message_t);
-
-osPoolId i2c1Pool_id;
-osPoolDef(i2c1Pool, 100, SM_Message_t);
+#if( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE )
+osThreadId spi3ThreadId;
+#endif /* ( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE ) */
 
-osPoolId i2c3Pool_id;
-osPoolDef(i2c3Pool, 100, SM_Message_t);
+/* Transactions of the requests made while the reserved slot of their sensor is in use */
+osPoolId overflowPool_id;
+osPoolDef(overflowPool, HSD_BUS_OVERFLOW_SLOTS, SM_Message_t);
+static uint32_t overflowInUse = 0;
 
-SM_ThreadParameters_t i2c1ThreadParams;
-SM_ThreadParameters_t i2c3ThreadParams;
-SM_ThreadParameters_t spi1ThreadParams;
-SM_ThreadParameters_t spi3ThreadParams;
+SM_BusContext_t i2c1Bus;
+SM_BusContext_t i2c3Bus;
+SM_BusContext_t spi1Bus;
+SM_BusContext_t spi3Bus;
 
-osThreadId spi1ThreadId;
-osThreadId spi3ThreadId;
+static SM_SPI_Transfer_t spi1Transfer;
+static SM_SPI_Transfer_t spi3Transfer;
 
-osThreadId i2c1ThreadId;
-osThreadId i2c3ThreadId;
+static SM_I2C_Transfer_t i2c1Transfer;
+static SM_I2C_Transfer_t i2c3Transfer;
 
 uint32_t reg_after_release = 0;
-static int32_t errors = 0;
 
 static volatile uint64_t SM_TimeStamp = 0; /* Sensor Manager global timestamp */
 
@@ -129,21 +138,40 @@ static void SM_I2C1_Init(void);
 static void SM_I2C3_Init(void);
 
 static void SM_I2C_MspInit(I2C_HandleTypeDef *hi2c);
-static void SM_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c);
-static void SM_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c);
+static void SM_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c);
+static void SM_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c);
 static void SM_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c);
+static void SM_I2C_Complete(SM_BusContext_t *pBus);
 
 static void SM_SPI1_Init(void);
 static void SM_SPI3_Init(void);
 
 static void SM_SPI_MspInit(SPI_HandleTypeDef *hspi);
 static void SM_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi);
+static void SM_SPI_ErrorCallback(SPI_HandleTypeDef *hspi);
+static void SM_SPI_DMA_Complete(SM_BusContext_t *pBus);
+static HAL_StatusTypeDef SM_SPI_Start(SM_BusContext_t *pBus, SM_Message_t *msg);
+static void SM_SPI_EndTransfer(SM_BusContext_t *pBus, SM_Message_t *msg);
+
+static HAL_StatusTypeDef SM_I2C_Start(SM_BusContext_t *pBus, SM_Message_t *msg);
 
 static void SM_TIM_Init(void);
 static void SM_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim);
-
-static void i2c_Thread(void const *argument);
-static void spi_Thread(void const *argument);
+static uint64_t SM_ReadTicks(void);
+
+static void SM_Bus_Submit(SM_BusContext_t *pBus, SM_Message_t *msg);
+static void SM_Bus_Kick(SM_BusContext_t *pBus);
+static void SM_Bus_Complete(SM_BusContext_t *pBus, uint32_t error);
+static void SM_Bus_Notify(osThreadId requester, uint32_t bits);
+static void SM_Bus_Push(SM_BusScheduler_t *pSched, SM_Message_t *msg);
+static SM_Message_t *SM_Bus_TakeAll(SM_BusScheduler_t *pSched);
+static uint8_t SM_Bus_Acquire(SM_BusScheduler_t *pSched);
+static void SM_Bus_Release(SM_BusScheduler_t *pSched);
+static void SM_Bus_Stamp(SM_Message_t *msg);
+static SM_Message_t *SM_Bus_Next(SM_BusContext_t *pBus);
+static SM_Message_t *SM_Bus_Alloc(sensor_handle_t *handle);
+static void SM_Bus_Free(SM_Message_t *msg);
+static uint32_t SM_Bus_Duration(uint8_t bus, const SM_Message_t *msg);
 
 #if( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE )
 
@@ -209,6 +237,7 @@ static void SM_SPI1_Init(void)
 
   /* Register SPI DMA complete Callback */
   HAL_SPI_RegisterCallback(&hspi1, HAL_SPI_TX_RX_COMPLETE_CB_ID, SM_SPI_TxRxCpltCallback);
+  HAL_SPI_RegisterCallback(&hspi1, HAL_SPI_ERROR_CB_ID, SM_SPI_ErrorCallback);
 }
 
 #if( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_4_WIRE )
@@ -247,6 +276,7 @@ static void SM_SPI3_Init(void)
 
   /* Register SPI DMA complete Callback */
   HAL_SPI_RegisterCallback(&hspi3, HAL_SPI_TX_RX_COMPLETE_CB_ID, SM_SPI_TxRxCpltCallback);
+  HAL_SPI_RegisterCallback(&hspi3, HAL_SPI_ERROR_CB_ID, SM_SPI_ErrorCallback);
 }
 
 #elif( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE )
@@ -328,8 +358,8 @@ static void SM_I2C1_Init(void)
     SM_Error_Handler();
   }
 
-  HAL_I2C_RegisterCallback(&hi2c1, HAL_I2C_MEM_RX_COMPLETE_CB_ID, SM_I2C_MemRxCpltCallback);
-  HAL_I2C_RegisterCallback(&hi2c1, HAL_I2C_MEM_TX_COMPLETE_CB_ID, SM_I2C_MemTxCpltCallback);
+  HAL_I2C_RegisterCallback(&hi2c1, HAL_I2C_MASTER_RX_COMPLETE_CB_ID, SM_I2C_MasterRxCpltCallback);
+  HAL_I2C_RegisterCallback(&hi2c1, HAL_I2C_MASTER_TX_COMPLETE_CB_ID, SM_I2C_MasterTxCpltCallback);
   HAL_I2C_RegisterCallback(&hi2c1, HAL_I2C_ERROR_CB_ID, SM_I2C_ErrorCallback);
 }
 
@@ -369,8 +399,8 @@ static void SM_I2C3_Init(void)
     SM_Error_Handler();
   }
 
-  HAL_I2C_RegisterCallback(&hi2c3, HAL_I2C_MEM_RX_COMPLETE_CB_ID, SM_I2C_MemRxCpltCallback);
-  HAL_I2C_RegisterCallback(&hi2c3, HAL_I2C_MEM_TX_COMPLETE_CB_ID, SM_I2C_MemTxCpltCallback);
+  HAL_I2C_RegisterCallback(&hi2c3, HAL_I2C_MASTER_RX_COMPLETE_CB_ID, SM_I2C_MasterRxCpltCallback);
+  HAL_I2C_RegisterCallback(&hi2c3, HAL_I2C_MASTER_TX_COMPLETE_CB_ID, SM_I2C_MasterTxCpltCallback);
   HAL_I2C_RegisterCallback(&hi2c3, HAL_I2C_ERROR_CB_ID, SM_I2C_ErrorCallback);
 }
 
@@ -382,163 +412,525 @@ void SM_Error_Handler(void)
 }
 
 /**
-  * @brief  SPI thread: it waits on the SPI request queue, performs SPI transactions in non blocking mode and unlocks
-  *         the thread which made the request at the end of the read.
-  * @param  pvParams : required resources for the thread.
-  * @retval None
+  * @brief  Start a 4-wire SPI transaction, from a requesting thread or from the interrupt of the previous one.
+  *         SM_SPI_EndTransfer completes it in the DMA complete interrupt. Nothing is polled: this may run in an
+  *         interrupt or in a critical section.
+  * @param  pBus: SPI bus
+  * @param  msg: request
+  * @retval HAL status of the DMA start; on error the chip select is raised again and no interrupt follows
   */
-static void spi_Thread(void const *argument)
+static HAL_StatusTypeDef SM_SPI_Start(SM_BusContext_t *pBus, SM_Message_t *msg)
 {
-  SM_ThreadParameters_t *pvParams = (SM_ThreadParameters_t *) argument;
-
-  osEvent evt;
+  SM_SPI_Transfer_t *xfer = pBus->spiTransfer;
+  COM_BusStats_t *bus_stats = COM_GetBusStats(pBus->bus);
+  HAL_StatusTypeDef status;
 
-  for (;;)
+  /**
+    * SPI read is controlled by asserting the MSB of the register address.
+    * This logic can/should be pulled into the individual sensor driver as it
+    * is device-dependent.
+    *
+    **/
+  if (msg->isRead != 0)
   {
-    evt = osMessageGet(*(pvParams->comReqQueue_id), osWaitForever);
+    msg->regAddr |= 0x80;
+  }
 
-    SM_Message_t *msg = evt.value.p;
+  xfer->start = SM_GetTicks_fromISR();
+  HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
+                    ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin, GPIO_PIN_RESET);
 
-    /**
-      * SPI read is controlled by asserting the MSB of the register address.
-      * This logic can/should be pulled into the individual sensor driver as it
-      * is device-dependent.
-      *
-      **/
-    if (msg->isRead != 0)
+#if (HSD_SPI_SINGLE_DMA == 1)
+  if (msg->readSize < SM_SPI_DMA_BUFFER_SIZE)
+  {
+    /* Address and data in one full duplex DMA */
+    xfer->buffer[0] = msg->regAddr;
+    if (msg->isRead == 0)
     {
-      msg->regAddr |= 0x80;
+      HSD_memcpy(&xfer->buffer[1], msg->dataPtr, msg->readSize);
     }
-
-    HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
-                      ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin, GPIO_PIN_RESET);
-
-    HAL_SPI_Transmit((SPI_HandleTypeDef *) pvParams->hcom, &msg->regAddr, 1, 1000);
-    HAL_SPI_TransmitReceive_DMA((SPI_HandleTypeDef *) pvParams->hcom, msg->dataPtr, msg->dataPtr, msg->readSize);
-
-    osSemaphoreWait(*(pvParams->comThreadSem_id), osWaitForever);
-
+    xfer->singleDma = 1;
+    status = HAL_SPI_TransmitReceive_DMA((SPI_HandleTypeDef *) pBus->hcom, xfer->buffer, xfer->buffer,
+                                         msg->readSize + 1U);
+  }
+  else
+#endif /* HSD_SPI_SINGLE_DMA */
+  {
+    /* Address and data in two DMAs, SM_SPI_DMA_Complete chains the second one */
+    xfer->singleDma = 0;
+    xfer->addressPhase = 1;
+    bus_stats->splitTransfers++;
+    status = HAL_SPI_TransmitReceive_DMA((SPI_HandleTypeDef *) pBus->hcom, &msg->regAddr, &xfer->addressRx, 1);
+  }
+  if (status != HAL_OK)
+  {
+    xfer->addressPhase = 0;
     HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
                       ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin, GPIO_PIN_SET);
+  }
+  bus_stats->setupTicks += SM_GetTicks_fromISR() - xfer->start;
+  return status;
+}
 
-    osSemaphoreId *sem = ((sensor_handle_t *) msg->sensorHandler)->sem;
-    osPoolFree(*(pvParams->comPool_id), msg);
-    osSemaphoreRelease(*sem);
+/**
+  * @brief  Start an I2C transaction, from a requesting thread or from the interrupt of the previous one. The register
+  *         address is sent in interrupt mode, without a stop; SM_I2C_Complete then chains the data DMA, after a
+  *         repeated start for a read. Nothing is polled: this may run in an interrupt or in a critical section.
+  * @param  pBus: I2C bus
+  * @param  msg: request
+  * @retval HAL status of the address transmit; on error no interrupt follows
+  */
+static HAL_StatusTypeDef SM_I2C_Start(SM_BusContext_t *pBus, SM_Message_t *msg)
+{
+  /**
+    * HTS221 Auto-Increment is controlled by asserting the MSB of the register
+    * address. This logic can/should be pulled into the individual sensor
+    * driver as it is device-dependent.
+    *
+    **/
+  if ((msg->sensorHandler->WhoAmI == 0xBCU) && (msg->readSize > 1))
+  {
+    msg->regAddr |= 0x80;
   }
+
+  pBus->i2cTransfer->addressPhase = 1;
+  return HAL_I2C_Master_Seq_Transmit_IT((I2C_HandleTypeDef *) pBus->hcom,
+                                        ((sensor_handle_t *) msg->sensorHandler)->I2C_address,
+                                        &msg->regAddr, 1, I2C_FIRST_FRAME);
 }
 
 #if( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE )
 
 /**
-  * @brief  SPI thread: it waits on the SPI request queue, performs SPI transactions in non blocking mode and unlocks
-  *         the thread which made the request at the end of the read.
-  * @param  pvParams : required resources for the thread.
+  * @brief  SPI thread: the 3-wire transfers are polled, so this bus is served by a thread. It waits for new requests,
+  *         serves them earliest deadline first and notifies the thread which made each request at the end of the read.
+  * @param  pBus : SPI bus
   * @retval None
   */
 static void spi3_Thread(void const *argument)
 {
-  SM_ThreadParameters_t *pvParams = (SM_ThreadParameters_t *) argument;
-
-  osEvent evt;
+  SM_BusContext_t *pBus = (SM_BusContext_t *) argument;
+  SM_Message_t *msg;
+  osThreadId requester;
 
   for (; ;)
   {
-    evt = osMessageGet(*(pvParams->comReqQueue_id), osWaitForever);
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
 
-    SM_Message_t *msg = evt.value.p;
+    while ((msg = SM_Bus_Next(pBus)) != NULL)
+    {
+      HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
+                        ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin,
+                        GPIO_PIN_RESET);
 
-    HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
-                      ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin,
-                      GPIO_PIN_RESET);
+      if (msg->isRead != 0)
+      {
+        /**
+          * SPI read is controlled by asserting the MSB of the register address.
+          * This logic can/should be pulled into the individual sensor driver as
+          * it is device-dependent.
+          *
+          **/
+        SM_SPI_3_WIRE_READ((SPI_HandleTypeDef *) pBus->hcom,
+                           (msg->regAddr | 0x80),
+                           msg->dataPtr,
+                           msg->readSize);
+      }
+      else
+      {
+        SM_SPI_3_WIRE_WRITE((SPI_HandleTypeDef *) pBus->hcom,
+                            msg->regAddr,
+                            msg->dataPtr,
+                            msg->readSize);
+      }
+
+      HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
+                        ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin,
+                        GPIO_PIN_SET);
+
+      requester = msg->requester;
+      SM_Bus_Free(msg);
+      xTaskNotify((TaskHandle_t) requester, SM_NOTIFY_READ_CPLT, eSetBits);
+    }
+  }
+}
+
+#endif /* ( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE ) */
+
+/**
+  * @brief  Add a request to a bus. An idle bus starts it at once, otherwise the end of transaction interrupt starts
+  *         it, earliest deadline first, without going through a thread. The start functions poll nothing, so they
+  *         may run in the critical section below.
+  * @param  pBus: bus
+  * @param  msg: request
+  * @retval None
+  */
+static void SM_Bus_Submit(SM_BusContext_t *pBus, SM_Message_t *msg)
+{
+  msg->requester = osThreadGetId();
+  SM_Bus_Stamp(msg);
+  SM_Bus_Push(&pBus->sched, msg);
+
+  if (pBus->start == NULL)
+  {
+    xTaskNotifyGive((TaskHandle_t) *(pBus->comThread_id));
+  }
+  else if (pBus->sched.busy == 0U)
+  {
+    /* The end of a short transaction must not be handled before its HAL start function has returned */
+    taskENTER_CRITICAL();
+    SM_Bus_Kick(pBus);
+    taskEXIT_CRITICAL();
+  }
+}
 
-    if (msg->isRead != 0)
+/**
+  * @brief  Start the next request of a bus, if the bus is idle. Whoever sets sched.busy owns the scheduler until the
+  *         transaction ends; a request pushed while the bus is released is served by this loop or by its requester.
+  *         A request the HAL refuses to start is ended at once with SM_NOTIFY_BUS_ERROR and the next one is tried.
+  * @param  pBus: bus
+  * @retval None
+  */
+static void SM_Bus_Kick(SM_BusContext_t *pBus)
+{
+  SM_BusScheduler_t *pSched = &pBus->sched;
+  SM_Message_t *msg;
+  osThreadId requester;
+
+  while (SM_Bus_Acquire(pSched) != 0U)
+  {
+    msg = SM_Bus_Next(pBus);
+    if (msg != NULL)
     {
-      /**
-        * SPI read is controlled by asserting the MSB of the register address.
-        * This logic can/should be pulled into the individual sensor driver as
-        * it is device-dependent.
-        *
-        **/
-      SM_SPI_3_WIRE_READ((SPI_HandleTypeDef *) pvParams->hcom,
-                         (msg->regAddr | 0x80),
-                         msg->dataPtr,
-                         msg->readSize);
+      pSched->current = msg;
+      if (pBus->start(pBus, msg) == HAL_OK)
+      {
+        return;
+      }
+      pSched->current = NULL;
+      COM_GetBusStats(pBus->bus)->errors++;
+      requester = msg->requester;
+      SM_Bus_Free(msg);
+      SM_Bus_Notify(requester, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR);
     }
-    else
+
+    SM_Bus_Release(pSched);
+    if (pSched->incoming == NULL)
     {
-      SM_SPI_3_WIRE_WRITE((SPI_HandleTypeDef *) pvParams->hcom,
-                          msg->regAddr,
-                          msg->dataPtr,
-                          msg->readSize);
+      return;
     }
+  }
+}
 
-    HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
-                      ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin,
-                      GPIO_PIN_SET);
+/**
+  * @brief  End of transaction, from the bus interrupt: complete it, start the next one and notify the thread which
+  *         made the request. The next transaction is started first, so that the bus does not stay idle meanwhile.
+  * @param  pBus: bus
+  * @param  error: 0, or SM_NOTIFY_BUS_ERROR if the transaction failed
+  * @retval None
+  */
+static void SM_Bus_Complete(SM_BusContext_t *pBus, uint32_t error)
+{
+  SM_Message_t *msg = pBus->sched.current;
+  osThreadId requester;
+  BaseType_t woken = pdFALSE;
 
-    osSemaphoreId *sem = ((sensor_handle_t *) msg->sensorHandler)->sem;
-    osPoolFree(*(pvParams->comPool_id), msg);
-    osSemaphoreRelease(*sem);
+  if (msg == NULL)
+  {
+    return;
+  }
+  requester = msg->requester;
+
+  if (pBus->end != NULL)
+  {
+    pBus->end(pBus, msg);
+  }
+  if (error != 0U)
+  {
+    COM_GetBusStats(pBus->bus)->errors++;
   }
+  pBus->sched.current = NULL;
+  SM_Bus_Release(&pBus->sched);
+  SM_Bus_Kick(pBus);
+
+  SM_Bus_Free(msg);
+  xTaskNotifyFromISR((TaskHandle_t) requester, SM_NOTIFY_READ_CPLT | error, eSetBits, &woken);
+  portYIELD_FROM_ISR(woken);
 }
 
-#endif /* ( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE ) */
+/**
+  * @brief  Notify the thread which made a request, from SM_Bus_Kick: it runs in the bus interrupt or in the critical
+  *         section of SM_Bus_Submit
+  * @param  requester: thread which made the request
+  * @param  bits: SM_NOTIFY_xxx bits to be set
+  * @retval None
+  */
+static void SM_Bus_Notify(osThreadId requester, uint32_t bits)
+{
+  BaseType_t woken = pdFALSE;
+
+  if (__get_IPSR() != 0U)
+  {
+    xTaskNotifyFromISR((TaskHandle_t) requester, bits, eSetBits, &woken);
+    portYIELD_FROM_ISR(woken);
+  }
+  else
+  {
+    xTaskNotify((TaskHandle_t) requester, bits, eSetBits);
+  }
+}
 
 /**
-  * @brief  I2C thread: it waits on the I2C request queue, performs I2C transactions in non blocking mode and
-  *         unlocks the thread which made the request at the end of the read.
-  * @param  pvParams : required resources for the thread.
+  * @brief  Push a request on the incoming stack of a bus, lock-free (exclusive load/store)
+  * @param  pSched: bus scheduler
+  * @param  msg: request
   * @retval None
   */
-static void i2c_Thread(void const *argument)
+static void SM_Bus_Push(SM_BusScheduler_t *pSched, SM_Message_t *msg)
 {
-  SM_ThreadParameters_t *pvParams = (SM_ThreadParameters_t *) argument;
+  do
+  {
+    msg->next = (SM_Message_t *) __LDREXW((volatile uint32_t *) &pSched->incoming);
+  } while (__STREXW((uint32_t) msg, (volatile uint32_t *) &pSched->incoming) != 0U);
+}
 
-  osEvent evt;
+/**
+  * @brief  Take all the requests on the incoming stack of a bus, lock-free
+  * @param  pSched: bus scheduler
+  * @retval Requests, latest first
+  */
+static SM_Message_t *SM_Bus_TakeAll(SM_BusScheduler_t *pSched)
+{
+  SM_Message_t *head;
 
-  for (;;)
+  do
   {
-    evt = osMessageGet(*(pvParams->comReqQueue_id), osWaitForever);
-    uint8_t autoInc = 0;
+    head = (SM_Message_t *) __LDREXW((volatile uint32_t *) &pSched->incoming);
+  } while (__STREXW(0U, (volatile uint32_t *) &pSched->incoming) != 0U);
 
-    SM_Message_t *msg = evt.value.p;
+  return head;
+}
 
-    /**
-      * HTS221 Auto-Increment is controlled by asserting the MSB of the register
-      * address. This logic can/should be pulled into the individual sensor
-      * driver as it is device-dependent.
-      *
-      **/
-    if ((msg->sensorHandler->WhoAmI == 0xBCU) && (msg->readSize > 1))
+/**
+  * @brief  Take the ownership of an idle bus
+  * @param  pSched: bus scheduler
+  * @retval 1 if the bus was idle and is now owned by the caller, 0 otherwise
+  */
+static uint8_t SM_Bus_Acquire(SM_BusScheduler_t *pSched)
+{
+  do
+  {
+    if (__LDREXW(&pSched->busy) != 0U)
     {
-      autoInc = 0x80;
+      __CLREX();
+      return 0;
     }
+  } while (__STREXW(1U, &pSched->busy) != 0U);
+  __DMB();
 
-    if (msg->isRead)
+  return 1;
+}
+
+/**
+  * @brief  Release the ownership of a bus
+  * @param  pSched: bus scheduler
+  * @retval None
+  */
+static void SM_Bus_Release(SM_BusScheduler_t *pSched)
+{
+  __DMB();
+  pSched->busy = 0U;
+}
+
+/**
+  * @brief  Set the request time and the deadline of a bus request, from the slack of its sensor
+  * @param  msg: request
+  * @retval None
+  */
+static void SM_Bus_Stamp(SM_Message_t *msg)
+{
+  uint32_t slackUs = msg->sensorHandler->slackUs;
+
+  if (slackUs == 0U)
+  {
+    slackUs = SM_BUS_DEFAULT_SLACK_US;
+  }
+  slackUs = HSD_MIN(slackUs, SM_BUS_MAX_SLACK_US);
+
+  msg->requestTime = (uint32_t) SM_GetTicks();
+  msg->deadline = msg->requestTime + slackUs * (SystemCoreClock / 1000000U);
+}
+
+/**
+  * @brief  Bus scheduler, run by the owner of the bus: take the new requests of a bus and pick the one to serve,
+  *         earliest deadline first (arrival order between equal deadlines). A request for the device just served is
+  *         coalesced with the previous transaction, i.e. served first, if it ends before the earliest deadline.
+  *         Queueing delay, deadline misses and queue peak are accounted in the bus statistics.
+  * @param  pBus: bus
+  * @retval Request to serve, NULL if there is none
+  */
+static SM_Message_t *SM_Bus_Next(SM_BusContext_t *pBus)
+{
+  SM_BusScheduler_t *pSched = &pBus->sched;
+  COM_BusStats_t *pStats = COM_GetBusStats(pBus->bus);
+  SM_Message_t *newest = SM_Bus_TakeAll(pSched);
+  SM_Message_t *oldest = NULL;
+  SM_Message_t **pLink;
+  SM_Message_t **pNext;
+  SM_Message_t *msg;
+  uint32_t now;
+
+  /* Append the new requests to the pending ones, in arrival order */
+  while (newest != NULL)
+  {
+    msg = newest;
+    newest = msg->next;
+    msg->next = oldest;
+    oldest = msg;
+    pSched->nPending++;
+  }
+  pLink = &pSched->pending;
+  while (*pLink != NULL)
+  {
+    pLink = &(*pLink)->next;
+  }
+  *pLink = oldest;
+
+  if (pSched->pending == NULL)
+  {
+    return NULL;
+  }
+
+  if (pSched->nPending > pStats->pendingPeak)
+  {
+    pStats->pendingPeak = pSched->nPending;
+  }
+
+  pNext = &pSched->pending;
+  for (pLink = &pSched->pending->next; *pLink != NULL; pLink = &(*pLink)->next)
+  {
+    if ((int32_t)((*pLink)->deadline - (*pNext)->deadline) < 0)
     {
-      HAL_I2C_Mem_Read_DMA((I2C_HandleTypeDef *) pvParams->hcom, ((sensor_handle_t *) msg->sensorHandler)->I2C_address,
-                           (uint16_t)(msg->regAddr | autoInc),
-                           I2C_MEMADD_SIZE_8BIT,
-                           msg->dataPtr, msg->readSize);
+      pNext = pLink;
+    }
+  }
+
+  /* SM_GetTicks_fromISR also works from a thread */
+  now = (uint32_t) SM_GetTicks_fromISR();
+
+  if ((*pNext)->sensorHandler != pSched->lastDevice)
+  {
+    for (pLink = &pSched->pending; *pLink != NULL; pLink = &(*pLink)->next)
+    {
+      if (((*pLink)->sensorHandler == pSched->lastDevice)
+          && ((int32_t)((*pNext)->deadline - (now + SM_Bus_Duration(pBus->bus, *pLink))) > 0))
+      {
+        pNext = pLink;
+        pStats->coalesced++;
+        break;
+      }
+    }
+  }
+
+  msg = *pNext;
+  *pNext = msg->next;
+  pSched->nPending--;
+  pSched->lastDevice = msg->sensorHandler;
+
+  pStats->transactions++;
+  if ((int32_t)(now - msg->deadline) > 0)
+  {
+    pStats->deadlineMisses++;
+  }
+  COM_AddLatencySample(&pStats->queueDelay, SM_TICKS_TO_US(now - msg->requestTime));
+
+  return msg;
+}
+
+/**
+  * @brief  Get a transaction for a request of a sensor: the slot reserved to the sensor or, if it is in use, one of
+  *         the overflow slots. Never blocks.
+  * @param  handle: sensor
+  * @retval Transaction, NULL if no slot is free
+  */
+static SM_Message_t *SM_Bus_Alloc(sensor_handle_t *handle)
+{
+  COM_SlotStats_t *pStats = COM_GetSlotStats();
+  SM_Message_t *msg = NULL;
+
+  taskENTER_CRITICAL();
+  if (handle->slotBusy == 0U)
+  {
+    handle->slotBusy = 1U;
+    msg = &handle->slot;
+  }
+  taskEXIT_CRITICAL();
+
+  if (msg == NULL)
+  {
+    msg = osPoolAlloc(overflowPool_id);
+
+    taskENTER_CRITICAL();
+    if (msg == NULL)
+    {
+      pStats->allocFailures++;
     }
     else
     {
-      HAL_I2C_Mem_Write_DMA((I2C_HandleTypeDef *) pvParams->hcom, ((sensor_handle_t *) msg->sensorHandler)->I2C_address,
-                            (uint16_t)(msg->regAddr | autoInc),
-                            I2C_MEMADD_SIZE_8BIT,
-                            msg->dataPtr, msg->readSize);
+      pStats->overflowAllocs++;
+      overflowInUse++;
+      if (overflowInUse > pStats->overflowPeak)
+      {
+        pStats->overflowPeak = overflowInUse;
+      }
     }
+    taskEXIT_CRITICAL();
+  }
 
-    osSemaphoreWait(*(pvParams->comThreadSem_id), osWaitForever);
+  return msg;
+}
 
-    osSemaphoreId *sem = ((sensor_handle_t *) msg->sensorHandler)->sem;
-    osPoolFree(*(pvParams->comPool_id), msg);
-    osSemaphoreRelease(*sem);
+/**
+  * @brief  Release a transaction got with SM_Bus_Alloc, from a thread or from an interrupt
+  * @param  msg: transaction
+  * @retval None
+  */
+static void SM_Bus_Free(SM_Message_t *msg)
+{
+  sensor_handle_t *handle = msg->sensorHandler;
+  uint32_t isr_mask;
+
+  if (msg == &handle->slot)
+  {
+    handle->slotBusy = 0U;
+  }
+  else
+  {
+    osPoolFree(overflowPool_id, msg);
+
+    isr_mask = taskENTER_CRITICAL_FROM_ISR();
+    overflowInUse--;
+    taskEXIT_CRITICAL_FROM_ISR(isr_mask);
   }
 }
 
 /**
-  * @brief  SPI read function: it adds a request on the SPI read queue (which will be handled by the SPI thread)
+  * @brief  Estimated duration of a bus transaction: register address and data bytes at the bus clock
+  * @param  bus: COM_BUS_xxx
+  * @param  msg: request
+  * @retval Duration [ticks]
+  */
+static uint32_t SM_Bus_Duration(uint8_t bus, const SM_Message_t *msg)
+{
+  if ((bus == COM_BUS_SPI1) || (bus == COM_BUS_SPI3))
+  {
+    return ((uint32_t) msg->readSize + 1U) * 8U * (SystemCoreClock / SM_SPI_BITRATE);
+  }
+  return ((uint32_t) msg->readSize + 3U) * 9U * (SystemCoreClock / SM_I2C_BITRATE); /* device address, register */
+}
+
+/**
+  * @brief  SPI read function: it submits a read request to the SPI bus and waits for its end
   * @param  handle : handle to a sensor context
   *         reg    : register of sensor to read
   *         data   : pointer to the read destination memory
@@ -546,29 +938,35 @@ static void i2c_Thread(void const *argument)
   * @note   When the function is used and linked to the sensor context, all the calls made by the
   *         PID driver will result in a call to this function. If this is the case, be sure to make
   *         all the calls to the PID driver functions from a freeRTOS thread
-  * @retval None
+  * @retval 0, -1 if no transaction slot is free or the transaction failed
   */
 int32_t SM_SPI1_Read_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(spi1Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 1;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&spi1Bus, msg);
 
-  osMessagePut(spi1ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
 
 /**
-  * @brief  SPI write function: it adds a request on the SPI write queue (which will be handled by the SPI thread)
+  * @brief  SPI write function: it submits a write request to the SPI bus and waits for its end
   * @param  handle : handle to a sensor context
   *         reg    : register of sensor to read
   *         data   : pointer to the read destination memory
@@ -576,49 +974,61 @@ int32_t SM_SPI1_Read_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
   * @note   When the function is used and linked to the sensor context, all the calls made by the
   *         PID driver will result in a call to this function. If this is the case, be sure to make
   *         all the calls to the PID driver functions from a freeRTOS thread
-  * @retval None
+  * @retval 0, -1 if no transaction slot is free or the transaction failed
   */
 int32_t SM_SPI1_Write_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(spi1Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 0;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&spi1Bus, msg);
 
-  osMessagePut(spi1ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
 /**
-  * @brief  SPI read function: it adds a request on the SPI read queue (which will be handled by the SPI read thread)
+  * @brief  SPI read function: it submits a read request to the SPI bus and waits for its end
   * @param  argument not used
   * @note   When the function is used and linked to the sensor context, all the calls made by the
   *         PID driver will result in a call to this function. If this is the case, be sure to make
   *         all the calls to the PID driver functions from a freeRTOS thread
-  * @retval None
+  * @retval 0, -1 if no transaction slot is free or the transaction failed
   */
 int32_t SM_SPI3_Read_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(spi3Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 1;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&spi3Bus, msg);
 
-  osMessagePut(spi3ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
@@ -627,23 +1037,29 @@ int32_t SM_SPI3_Write_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(spi3Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 0;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&spi3Bus, msg);
 
-  osMessagePut(spi3ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
 
 /**
-  * @brief  I2C read function: it adds a request on the I2C read queue (which will be handled by the I2C read thread)
+  * @brief  I2C read function: it submits a read request to the I2C bus and waits for its end
   * @param  argument not used
   * @retval None
   * @note   When the function is used and linked to the sensor context, all the calls made by the
@@ -654,17 +1070,23 @@ int32_t SM_I2C1_Read_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(i2c1Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 1;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&i2c1Bus, msg);
 
-  osMessagePut(i2c1ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
@@ -673,23 +1095,29 @@ int32_t SM_I2C1_Write_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(i2c1Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 0;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&i2c1Bus, msg);
 
-  osMessagePut(i2c1ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
 
 /**
-  * @brief  I2C read function: it adds a request on the I2C read queue (which will be handled by the I2C read thread)
+  * @brief  I2C read function: it submits a read request to the I2C bus and waits for its end
   * @param  argument not used
   * @retval None
   * @note   When the function is used and linked to the sensor context, all the calls made by the
@@ -700,17 +1128,23 @@ int32_t SM_I2C3_Read_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(i2c3Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 1;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&i2c3Bus, msg);
 
-  osMessagePut(i2c3ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
@@ -719,17 +1153,23 @@ int32_t SM_I2C3_Write_Os(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 {
   SM_Message_t *msg;
 
-  msg = osPoolAlloc(i2c3Pool_id);
-
+  msg = SM_Bus_Alloc((sensor_handle_t *) handle);
+  if (msg == NULL)
+  {
+    return -1;
+  }
   msg->isRead = 0;
   msg->sensorHandler = handle;
   msg->regAddr = reg;
   msg->readSize = len;
   msg->dataPtr = data;
+  SM_Bus_Submit(&i2c3Bus, msg);
 
-  osMessagePut(i2c3ReqQueue_id, (uint32_t) msg, osWaitForever);
-
-  osSemaphoreWait(*(((sensor_handle_t *) handle)->sem), osWaitForever);
+  if ((SM_Wait(((sensor_handle_t *) handle)->notifier, SM_NOTIFY_READ_CPLT | SM_NOTIFY_BUS_ERROR)
+       & SM_NOTIFY_BUS_ERROR) != 0U)
+  {
+    return -1;
+  }
 
   return 0;
 }
@@ -1099,74 +1539,47 @@ int32_t SM_I2C3_Write(void *handle, uint8_t reg, uint8_t *data, uint16_t len)
 }
 
 /**
-  * @brief  Sensor manager OS functionalities initialization: for each BUS (I2C
-  *         and SPI) it initializes a queue to collect read/write request, a
-  *         thread (blocking on the queue) to handle read/write requests and a
-  *         semaphore used to wait for DMA transfer complete
+  * @brief  Sensor manager OS functionalities initialization: it creates the pool of the overflow transactions and
+  *         the contexts of the buses, served from their interrupts or, for SPI3 in 3-wire mode, by a thread
   * @param  None
   * @retval None
   */
 void SM_OS_Init(void)
 {
-  /* Bus read semaphores */
-  spi1ThreadSem_id = osSemaphoreCreate(osSemaphore(spi1ThreadSem), 1);
-  spi3ThreadSem_id = osSemaphoreCreate(osSemaphore(spi3ThreadSem), 1);
-  i2c1ThreadSem_id = osSemaphoreCreate(osSemaphore(i2c1ThreadSem), 1);
-  i2c3ThreadSem_id = osSemaphoreCreate(osSemaphore(i2c3ThreadSem), 1);
-
-  osSemaphoreWait(spi1ThreadSem_id, osWaitForever);
-  osSemaphoreWait(spi3ThreadSem_id, osWaitForever);
-  osSemaphoreWait(i2c1ThreadSem_id, osWaitForever);
-  osSemaphoreWait(i2c3ThreadSem_id, osWaitForever);
-
-  /* Bus read functions memory pools */
-  spi1Pool_id = osPoolCreate(osPool(spi1Pool));
-  spi3Pool_id = osPoolCreate(osPool(spi3Pool));
-  i2c1Pool_id = osPoolCreate(osPool(i2c1Pool));
-  i2c3Pool_id = osPoolCreate(osPool(i2c3Pool));
-
-  /* Bus read queues */
-  spi1ReqQueue_id = osMessageCreate(osMessageQ(spi1reqqueue), NULL);
-  spi3ReqQueue_id = osMessageCreate(osMessageQ(spi3reqqueue), NULL);
-  i2c1ReqQueue_id = osMessageCreate(osMessageQ(i2c1reqqueue), NULL);
-  i2c3ReqQueue_id = osMessageCreate(osMessageQ(i2c3reqqueue), NULL);
-
-  i2c1ThreadParams.comThreadSem_id = &i2c1ThreadSem_id;
-  i2c1ThreadParams.comReqQueue_id = &i2c1ReqQueue_id;
-  i2c1ThreadParams.comPool_id = &i2c1Pool_id;
-  i2c1ThreadParams.hcom = (void *) &hi2c1;
-
-  osThreadDef(I2C1_THREAD, i2c_Thread, HSD_I2C1_RD_THREAD_PRIO, 1, 300 / 4);
-  i2c1ThreadId = osThreadCreate(osThread(I2C1_THREAD), (void *) &i2c1ThreadParams);
-
-  i2c3ThreadParams.comThreadSem_id = &i2c3ThreadSem_id;
-  i2c3ThreadParams.comReqQueue_id = &i2c3ReqQueue_id;
-  i2c3ThreadParams.comPool_id = &i2c3Pool_id;
-  i2c3ThreadParams.hcom = (void *) &hi2c3;
-
-  osThreadDef(I2C3_THREAD, i2c_Thread, HSD_I2C3_RD_THREAD_PRIO, 1, 300 / 4);
-  i2c3ThreadId = osThreadCreate(osThread(I2C3_THREAD), (void *) &i2c3ThreadParams);
-
-  spi1ThreadParams.comThreadSem_id = &spi1ThreadSem_id;
-  spi1ThreadParams.comReqQueue_id = &spi1ReqQueue_id;
-  spi1ThreadParams.comPool_id = &spi1Pool_id;
-  spi1ThreadParams.hcom = (void *) &hspi1;
-
-  osThreadDef(SPI1_THREAD, spi_Thread, HSD_SPI1_RD_THREAD_PRIO, 1, 300 / 4);
-  spi1ThreadId = osThreadCreate(osThread(SPI1_THREAD), (void *) &spi1ThreadParams);
-
-  spi3ThreadParams.comThreadSem_id = &spi3ThreadSem_id;
-  spi3ThreadParams.comReqQueue_id = &spi3ReqQueue_id;
-  spi3ThreadParams.comPool_id = &spi3Pool_id;
-  spi3ThreadParams.hcom = (void *) &hspi3;
+  /* Bus transactions beyond the slots reserved to the sensors */
+  overflowPool_id = osPoolCreate(osPool(overflowPool));
+
+  /* Buses served from their interrupts */
+  i2c1Bus.hcom = (void *) &hi2c1;
+  i2c1Bus.bus = COM_BUS_I2C1;
+  i2c1Bus.i2cTransfer = &i2c1Transfer;
+  i2c1Bus.start = SM_I2C_Start;
+
+  i2c3Bus.hcom = (void *) &hi2c3;
+  i2c3Bus.bus = COM_BUS_I2C3;
+  i2c3Bus.i2cTransfer = &i2c3Transfer;
+  i2c3Bus.start = SM_I2C_Start;
+
+  spi1Bus.hcom = (void *) &hspi1;
+  spi1Bus.bus = COM_BUS_SPI1;
+  spi1Bus.spiTransfer = &spi1Transfer;
+  spi1Bus.start = SM_SPI_Start;
+  spi1Bus.end = SM_SPI_EndTransfer;
+
+  spi3Bus.hcom = (void *) &hspi3;
+  spi3Bus.bus = COM_BUS_SPI3;
+  spi3Bus.spiTransfer = &spi3Transfer;
 
 #if( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_4_WIRE )
-  osThreadDef(SPI3_THREAD, spi_Thread, HSD_SPI3_RD_THREAD_PRIO, 1, 300 / 4);
+  spi3Bus.start = SM_SPI_Start;
+  spi3Bus.end = SM_SPI_EndTransfer;
 #elif( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_3_WIRE )
+  /* 3-wire transfers are polled: SPI3 is served by a thread */
+  spi3Bus.comThread_id = &spi3ThreadId;
+
   osThreadDef(SPI3_THREAD, spi3_Thread, HSD_SPI3_RD_THREAD_PRIO, 1, 300 / 4);
+  spi3ThreadId = osThreadCreate(osThread(SPI3_THREAD), (void *) &spi3Bus);
 #endif /* ( LIS2MDL_COM_MODE == LIS2MDL_COM_SPI_4_WIRE ) */
-
-  spi3ThreadId = osThreadCreate(osThread(SPI3_THREAD), (void *) &spi3ThreadParams);
 }
 
 /**
@@ -1373,14 +1786,79 @@ static void SM_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi)
 {
   if (hspi->Instance == SPI1)
   {
-    osSemaphoreRelease(spi1ThreadSem_id);
+    SM_SPI_DMA_Complete(&spi1Bus);
   }
   else if (hspi->Instance == SPI3)
   {
-    osSemaphoreRelease(spi3ThreadSem_id);
+    SM_SPI_DMA_Complete(&spi3Bus);
   }
 }
 
+static void SM_SPI_ErrorCallback(SPI_HandleTypeDef *hspi)
+{
+  if (hspi->Instance == SPI1)
+  {
+    spi1Transfer.addressPhase = 0;
+    SM_Bus_Complete(&spi1Bus, SM_NOTIFY_BUS_ERROR);
+  }
+  else if (hspi->Instance == SPI3)
+  {
+    spi3Transfer.addressPhase = 0;
+    SM_Bus_Complete(&spi3Bus, SM_NOTIFY_BUS_ERROR);
+  }
+}
+
+/**
+  * @brief  SPI DMA complete: start the data DMA of a split transaction, with the chip select still low, or end the
+  *         transaction
+  * @param  pBus: SPI bus
+  * @retval None
+  */
+static void SM_SPI_DMA_Complete(SM_BusContext_t *pBus)
+{
+  SM_SPI_Transfer_t *xfer = pBus->spiTransfer;
+  SM_Message_t *msg = pBus->sched.current;
+
+  if ((xfer->addressPhase != 0U) && (msg != NULL))
+  {
+    xfer->addressPhase = 0;
+    if (HAL_SPI_TransmitReceive_DMA((SPI_HandleTypeDef *) pBus->hcom, msg->dataPtr, msg->dataPtr, msg->readSize)
+        == HAL_OK)
+    {
+      return;
+    }
+    SM_Bus_Complete(pBus, SM_NOTIFY_BUS_ERROR);
+    return;
+  }
+  SM_Bus_Complete(pBus, 0);
+}
+
+/**
+  * @brief  End of a 4-wire SPI transaction, in the DMA complete interrupt: raise the chip select, copy the data read
+  *         after the address byte and record the transaction time and the CPU time of the copy
+  * @param  pBus: SPI bus
+  * @param  msg: request
+  * @retval None
+  */
+static void SM_SPI_EndTransfer(SM_BusContext_t *pBus, SM_Message_t *msg)
+{
+  SM_SPI_Transfer_t *xfer = pBus->spiTransfer;
+  COM_BusStats_t *bus_stats = COM_GetBusStats(pBus->bus);
+  uint64_t end;
+
+  HAL_GPIO_WritePin(((sensor_handle_t *) msg->sensorHandler)->GPIOx,
+                    ((sensor_handle_t *) msg->sensorHandler)->GPIO_Pin, GPIO_PIN_SET);
+  end = SM_GetTicks_fromISR();
+#if (HSD_SPI_SINGLE_DMA == 1)
+  if ((xfer->singleDma != 0U) && (msg->isRead != 0))
+  {
+    HSD_memcpy(msg->dataPtr, &xfer->buffer[1], msg->readSize);
+  }
+#endif /* HSD_SPI_SINGLE_DMA */
+  COM_AddLatencySample(&bus_stats->transfer, SM_TICKS_TO_US(end - xfer->start));
+  bus_stats->endTicks += SM_GetTicks_fromISR() - end;
+}
+
 /**
   * @brief I2C MSP Initialization
   *         This function configures the I2C hardware resources used
@@ -1523,41 +2001,78 @@ static void SM_I2C_MspInit(I2C_HandleTypeDef *hi2c)
   }
 }
 
-void SM_I2C_MemRxCpltCallback(I2C_HandleTypeDef *hi2c)
+/**
+  * @brief  I2C transfer complete: after the register address, start the data DMA, or end the transaction
+  * @param  pBus: I2C bus
+  * @retval None
+  */
+static void SM_I2C_Complete(SM_BusContext_t *pBus)
+{
+  SM_Message_t *msg = pBus->sched.current;
+  HAL_StatusTypeDef status;
+
+  if ((pBus->i2cTransfer->addressPhase != 0U) && (msg != NULL))
+  {
+    pBus->i2cTransfer->addressPhase = 0;
+    if (msg->isRead)
+    {
+      status = HAL_I2C_Master_Seq_Receive_DMA((I2C_HandleTypeDef *) pBus->hcom,
+                                              ((sensor_handle_t *) msg->sensorHandler)->I2C_address,
+                                              msg->dataPtr, msg->readSize, I2C_LAST_FRAME);
+    }
+    else
+    {
+      status = HAL_I2C_Master_Seq_Transmit_DMA((I2C_HandleTypeDef *) pBus->hcom,
+                                               ((sensor_handle_t *) msg->sensorHandler)->I2C_address,
+                                               msg->dataPtr, msg->readSize, I2C_LAST_FRAME);
+    }
+    if (status == HAL_OK)
+    {
+      return;
+    }
+    SM_Bus_Complete(pBus, SM_NOTIFY_BUS_ERROR);
+    return;
+  }
+  SM_Bus_Complete(pBus, 0);
+}
+
+static void SM_I2C_MasterRxCpltCallback(I2C_HandleTypeDef *hi2c)
 {
   if (hi2c->Instance == I2C1)
   {
-    osSemaphoreRelease(i2c1ThreadSem_id);
     reg_after_release = hi2c1.Instance->CR1 & 0x00000040;
+    SM_I2C_Complete(&i2c1Bus);
   }
   else if (hi2c->Instance == I2C3)
   {
-    osSemaphoreRelease(i2c3ThreadSem_id);
     reg_after_release = hi2c3.Instance->CR1 & 0x00000040;
+    SM_I2C_Complete(&i2c3Bus);
   }
 }
 
-void SM_I2C_MemTxCpltCallback(I2C_HandleTypeDef *hi2c)
+static void SM_I2C_MasterTxCpltCallback(I2C_HandleTypeDef *hi2c)
 {
   if (hi2c->Instance == I2C1)
   {
-    osSemaphoreRelease(i2c1ThreadSem_id);
+    SM_I2C_Complete(&i2c1Bus);
   }
   else if (hi2c->Instance == I2C3)
   {
-    osSemaphoreRelease(i2c3ThreadSem_id);
+    SM_I2C_Complete(&i2c3Bus);
   }
 }
 
-void SM_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
+static void SM_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
 {
   if (hi2c->Instance == I2C1)
   {
-    errors++;
+    i2c1Transfer.addressPhase = 0;
+    SM_Bus_Complete(&i2c1Bus, SM_NOTIFY_BUS_ERROR);
   }
   else if (hi2c->Instance == I2C3)
   {
-    errors++;
+    i2c3Transfer.addressPhase = 0;
+    SM_Bus_Complete(&i2c3Bus, SM_NOTIFY_BUS_ERROR);
   }
 }
 
@@ -1566,44 +2081,112 @@ void SM_I2C_ErrorCallback(I2C_HandleTypeDef *hi2c)
 /******************************************************************************/
 
 /**
-  * @brief  Retrieve the current time stamp from outside of an interrupt context
+  * @brief  Retrieve the current TIM5 tick count, extended to 64 bits, from outside of an interrupt context
   * @param  None
-  * @retval Time stamp
+  * @retval Ticks since the timer start, at SystemCoreClock Hz
   */
-double SM_GetTimeStamp(void)
+uint64_t SM_GetTicks(void)
 {
-  uint32_t tim_counter;
-  uint64_t timestamp;
-  double timestamp_seconds;
+  uint64_t ticks;
 
   /* -------- Start critical section -----------*/
   taskENTER_CRITICAL();
+  ticks = SM_ReadTicks();
+  taskEXIT_CRITICAL();
+  /* -------- End critical section -----------*/
 
-  tim_counter = htim5.Instance->CNT;
+  return ticks;
+}
 
-  if (__HAL_TIM_GET_FLAG(&htim5, TIM_FLAG_UPDATE)) /* Update Event happened while already in critical section */
+/**
+  * @brief  Retrieve the current TIM5 tick count, extended to 64 bits, from within an interrupt context
+  * @param  None
+  * @retval Ticks since the timer start, at SystemCoreClock Hz
+  */
+uint64_t SM_GetTicks_fromISR(void)
+{
+  uint64_t ticks;
+  uint32_t isr_mask;
+
+  /* -------- Start critical section -----------*/
+  isr_mask = taskENTER_CRITICAL_FROM_ISR();
+  ticks = SM_ReadTicks();
+  taskEXIT_CRITICAL_FROM_ISR(isr_mask);
+  /* -------- End critical section -----------*/
+
+  return ticks;
+}
+
+/**
+  * @brief  Notify a sensor thread, from outside of an interrupt context
+  * @param  pNotifier: notifications of the thread
+  * @param  bits: SM_NOTIFY_xxx bits to be set
+  * @retval None
+  */
+void SM_Notify(SM_Notifier_t *pNotifier, uint32_t bits)
+{
+  xTaskNotify((TaskHandle_t) *(pNotifier->thread), bits, eSetBits);
+}
+
+/**
+  * @brief  Notify a sensor thread from within an interrupt context. SM_NOTIFY_DATA_READY also records the time of
+  *         the interrupt, so that SM_Wait measures the interrupt to thread latency.
+  * @param  pNotifier: notifications of the thread
+  * @param  bits: SM_NOTIFY_xxx bits to be set
+  * @retval None
+  */
+void SM_Notify_fromISR(SM_Notifier_t *pNotifier, uint32_t bits)
+{
+  BaseType_t woken = pdFALSE;
+
+  if ((bits & SM_NOTIFY_DATA_READY) != 0U)
   {
-    /* Evaluate if the timer was read before or after the "UPDATE" event */
-    if (tim_counter < ((SystemCoreClock * SM_TS_UPDATE_PERIOD_S) / 2)) /* After */
-    {
-      timestamp = SM_TimeStamp + tim_counter + (SystemCoreClock * SM_TS_UPDATE_PERIOD_S);
-    }
-    else /* Before */
-    {
-      timestamp = SM_TimeStamp + tim_counter;
-    }
+    pNotifier->irqTime = (uint32_t) SM_GetTicks_fromISR();
   }
-  else
+  xTaskNotifyFromISR((TaskHandle_t) *(pNotifier->thread), bits, eSetBits, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+/**
+  * @brief  Wait for some notifications of the calling thread. The other bits received meanwhile are kept for the next
+  *         calls, so a data ready arriving during a bus transaction is not lost.
+  * @param  pNotifier: notifications of the calling thread
+  * @param  bits: SM_NOTIFY_xxx bits to wait for
+  * @retval Bits among the requested ones that were received, cleared
+  */
+uint32_t SM_Wait(SM_Notifier_t *pNotifier, uint32_t bits)
+{
+  uint32_t value;
+  uint32_t events;
+
+  while ((pNotifier->pending & bits) == 0U)
   {
-    /* No Update Event, just sum the timer value to the global TimeStamp */
-    timestamp = SM_TimeStamp + tim_counter;
+    xTaskNotifyWait(0, 0xFFFFFFFFU, &value, portMAX_DELAY);
+    pNotifier->pending |= value;
   }
+  events = pNotifier->pending & bits;
+  pNotifier->pending &= ~events;
 
-  timestamp_seconds = ((double) timestamp / (double) SystemCoreClock);
+  if ((events & SM_NOTIFY_DATA_READY) != 0U)
+  {
+    uint32_t latency_us = SM_TICKS_TO_US((uint32_t) SM_GetTicks() - pNotifier->irqTime);
 
-  taskEXIT_CRITICAL();
-  /* -------- End critical section -----------*/
-  return timestamp_seconds;
+    taskENTER_CRITICAL();
+    COM_AddLatencySample(COM_GetIrqLatency(), latency_us);
+    taskEXIT_CRITICAL();
+  }
+
+  return events;
+}
+
+/**
+  * @brief  Retrieve the current time stamp from outside of an interrupt context
+  * @param  None
+  * @retval Time stamp
+  */
+double SM_GetTimeStamp(void)
+{
+  return ((double) SM_GetTicks() / (double) SystemCoreClock);
 }
 
 /**
@@ -1613,13 +2196,17 @@ double SM_GetTimeStamp(void)
   */
 double SM_GetTimeStamp_fromISR(void)
 {
-  uint32_t tim_counter;
-  uint64_t timestamp;
-  double timestamp_seconds;
-  uint32_t isr_mask;
+  return ((double) SM_GetTicks_fromISR() / (double) SystemCoreClock);
+}
 
-  /* -------- Start critical section -----------*/
-  isr_mask = taskENTER_CRITICAL_FROM_ISR();
+/**
+  * @brief  Read TIM5 and extend it with the global TimeStamp. To be called in a critical section
+  * @param  None
+  * @retval Ticks since the timer start
+  */
+static uint64_t SM_ReadTicks(void)
+{
+  uint32_t tim_counter;
 
   tim_counter = htim5.Instance->CNT;
 
@@ -1628,25 +2215,12 @@ double SM_GetTimeStamp_fromISR(void)
     /* Evaluate if the timer was read before or after the "UPDATE" event */
     if (tim_counter < ((SystemCoreClock * SM_TS_UPDATE_PERIOD_S) / 2)) /* After */
     {
-      timestamp = SM_TimeStamp + tim_counter + (SystemCoreClock * SM_TS_UPDATE_PERIOD_S);
+      return SM_TimeStamp + tim_counter + (SystemCoreClock * SM_TS_UPDATE_PERIOD_S);
     }
-    else /* Before */
-    {
-      timestamp = SM_TimeStamp + tim_counter;
-    }
-  }
-  else
-  {
-    /* No Update Event, just sum the timer value to the global TimeStamp */
-    timestamp = SM_TimeStamp + tim_counter;
   }
 
-  timestamp_seconds = ((double) timestamp / (double) SystemCoreClock);
-
-  taskEXIT_CRITICAL_FROM_ISR(isr_mask);
-  /* -------- End critical section -----------*/
-
-  return timestamp_seconds;
+  /* No Update Event (or counter read before it), just sum the timer value to the global TimeStamp */
+  return SM_TimeStamp + tim_counter;
 }
 
 /**
@@ -1759,6 +2333,55 @@ uint8_t SM_StopSensorAcquisition(void)
   return 0;
 }
 
+/**
+  * @brief  Get the smallest amount of stack a sensor thread has left since it was created
+  * @param  sId: Sensor id
+  * @retval free stack high water mark [bytes], -1 for sensors without a thread
+  */
+int32_t SM_GetSensorStackFree(uint8_t sensorId)
+{
+  osThreadId thread_id = NULL;
+
+  if (sensorId == LIS3DHH_Get_Id())
+  {
+    thread_id = LIS3DHH_Thread_Id;
+  }
+  else if (sensorId == HTS221_Get_Id())
+  {
+    thread_id = HTS221_Thread_Id;
+  }
+  else if (sensorId == LIS2DW12_Get_Id())
+  {
+    thread_id = LIS2DW12_Thread_Id;
+  }
+  else if (sensorId == LIS2MDL_Get_Id())
+  {
+    thread_id = LIS2MDL_Thread_Id;
+  }
+  else if (sensorId == MP23ABS1_Get_Id())
+  {
+    thread_id = MP23ABS1_Thread_Id;
+  }
+  else if (sensorId == LSM6DSOX_Get_Id())
+  {
+    thread_id = LSM6DSOX_Thread_Id;
+  }
+  else if (sensorId == LPS22HH_Get_Id())
+  {
+    thread_id = LPS22HH_Thread_Id;
+  }
+  else if (sensorId == STTS751_Get_Id())
+  {
+    thread_id = STTS751_Thread_Id;
+  }
+
+  if (thread_id == NULL)
+  {
+    return -1;
+  }
+  return (int32_t)(uxTaskGetStackHighWaterMark((TaskHandle_t) thread_id) * sizeof(StackType_t));
+}
+
 /**
   * @brief  Stop sensor thread
   * @param  sId: Sensor id
@@ -1801,6 +2424,85 @@ uint8_t SM_StartSensorThread(uint8_t sensorId)
   return 0;
 }
 
+/**
+  * @brief  Wait until the threads stopped by SM_StopSensorAcquisition() are suspended, so that
+  *         none of them is still writing data of the acquisition
+  * @param  timeout: maximum wait in ms
+  * @retval 0: all the threads are suspended, 1: timeout
+  */
+uint8_t SM_WaitSensorAcquisitionStopped(uint32_t timeout)
+{
+  uint32_t sensorId = 0;
+  uint32_t subSensorId = 0;
+  uint32_t elapsed = 0;
+  COM_DeviceDescriptor_t *pDeviceDescriptor = COM_GetDeviceDescriptor();
+  COM_SensorDescriptor_t *pSensorDescriptor;
+
+  for (sensorId = 0; sensorId < pDeviceDescriptor->nSensor; sensorId++)
+  {
+    pSensorDescriptor = COM_GetSensorDescriptor(sensorId);
+
+    for (subSensorId = 0; subSensorId < pSensorDescriptor->nSubSensors; subSensorId++)
+    {
+      if (COM_GetSubSensorStatus(sensorId, subSensorId)->isActive == 1)
+      {
+        while (SM_GetSensorThreadState(sensorId) == SM_SENSOR_STATE_SUSPENDING)
+        {
+          if (elapsed++ >= timeout)
+          {
+            return 1;
+          }
+          osDelay(1);
+        }
+        break;
+      }
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Get the state of a sensor thread
+  * @param  sId: Sensor id
+  * @retval thread state, SM_SENSOR_STATE_SUSPENDED for sensors without a thread
+  */
+SM_Sensor_State_t SM_GetSensorThreadState(uint8_t sensorId)
+{
+  if (sensorId == LIS3DHH_Get_Id())
+  {
+    return LIS3DHH_Get_State();
+  }
+  else if (sensorId == HTS221_Get_Id())
+  {
+    return HTS221_Get_State();
+  }
+  else if (sensorId == LIS2DW12_Get_Id())
+  {
+    return LIS2DW12_Get_State();
+  }
+  else if (sensorId == LIS2MDL_Get_Id())
+  {
+    return LIS2MDL_Get_State();
+  }
+  else if (sensorId == MP23ABS1_Get_Id())
+  {
+    return MP23ABS1_Get_State();
+  }
+  else if (sensorId == LSM6DSOX_Get_Id())
+  {
+    return LSM6DSOX_Get_State();
+  }
+  else if (sensorId == LPS22HH_Get_Id())
+  {
+    return LPS22HH_Get_State();
+  }
+  else if (sensorId == STTS751_Get_Id())
+  {
+    return STTS751_Get_State();
+  }
+  return SM_SENSOR_STATE_SUSPENDED;
+}
+
 /**
   * @brief  Stop sensor thread
   * @param  sId: Sensor id
@@ -22,6 +22,7 @@
 #include "main.h"
 #include "stts751_reg.h"
 #include "com_manager.h"
+#include "HSD_watermark.h"
 #include <string.h>
 
 /* Private includes ----------------------------------------------------------*/
@@ -33,16 +34,25 @@
 /* Private variables ---------------------------------------------------------*/
 static int32_t s_nSTTS751_id = -1;
 
-static volatile double TimeStamp_stts751;
+static const HSD_WTM_Fifo_t stts751_wtm_fifo =
+{
+  0, 0, 0, 2, 0x01U, 0, HSD_WTM_BUS_I2C3, 0
+};
+
+static volatile HSD_TimeStamp_t TimeStamp_stts751;
 
 SM_Init_Param_t STTS751_Init_Param;
 SM_Sensor_State_t STTS751_Sensor_State = SM_SENSOR_STATE_INITIALIZING;
 
 static uint16_t taskDelay = 1000;
 
-/* Semaphore used to wait on BUS data read complete, managed by lower layer */
-static osSemaphoreId stts751_read_cplt_sem_id;
-static osSemaphoreDef(stts751_read_cplt_sem);
+osThreadId STTS751_Thread_Id;
+
+/* Notifications of the thread: bus read complete, managed by lower layer */
+static SM_Notifier_t stts751_notifier =
+{
+  &STTS751_Thread_Id
+};
 
 static sensor_handle_t stts751_hdl_instance =
 {
@@ -50,7 +60,7 @@ static sensor_handle_t stts751_hdl_instance =
   STTS751_0xxxx_ADD_20K,
   NULL,
   0,
-  &stts751_read_cplt_sem_id
+  &stts751_notifier
 };
 static stmdev_ctx_t stts751_ctx_instance =
 {
@@ -62,7 +72,6 @@ static stmdev_ctx_t stts751_ctx_instance =
 
 /* Private function prototypes -----------------------------------------------*/
 
-osThreadId STTS751_Thread_Id;
 static void STTS751_Thread(void const *argument);
 
 static void STTS751_Sensor_Init(void);
@@ -84,12 +93,8 @@ void STTS751_Peripheral_Init(void)
   */
 void STTS751_OS_Init(void)
 {
-  /* Data read complete semaphore initialization */
-  stts751_read_cplt_sem_id = osSemaphoreCreate(osSemaphore(stts751_read_cplt_sem), 1);
-  osSemaphoreWait(stts751_read_cplt_sem_id, osWaitForever);
-
   /* Thread definition: read data */
-  osThreadDef(STTS751_Aquisition_Thread, STTS751_Thread, HSD_STTS751_THREAD_PRIO, 1, configMINIMAL_STACK_SIZE);
+  osThreadDef(STTS751_Aquisition_Thread, STTS751_Thread, HSD_STTS751_THREAD_PRIO, 1, 1024 / 4);
   /* Start thread */
   STTS751_Thread_Id = osThreadCreate(osThread(STTS751_Aquisition_Thread), NULL);
 }
@@ -126,7 +131,7 @@ static void STTS751_Thread(void const *argument)
         int16_t temperature;
         float temperature_celsius;
 
-        TimeStamp_stts751 = SM_GetTimeStamp();
+        TimeStamp_stts751 = SM_GetSensorTimeStamp();
 
         stts751_temperature_raw_get(&stts751_ctx_instance, (int16_t *) &temperature);
         temperature_celsius = ((float) temperature) / 256.0f;
@@ -169,6 +174,9 @@ static void STTS751_Sensor_Init(void)
   {
     taskDelay = 250;
   }
+
+  /* Time the sensor can wait for the bus, used by the bus scheduler */
+  stts751_hdl_instance.slackUs = HSD_WTM_Get_Slack(s_nSTTS751_id, 0);
 }
 
 void STTS751_Set_State(SM_Sensor_State_t state)
@@ -176,6 +184,11 @@ void STTS751_Set_State(SM_Sensor_State_t state)
   STTS751_Sensor_State = state;
 }
 
+SM_Sensor_State_t STTS751_Get_State(void)
+{
+  return STTS751_Sensor_State;
+}
+
 void STTS751_Start(void)
 {
   STTS751_Set_State(SM_SENSOR_STATE_INITIALIZING);
@@ -187,7 +200,7 @@ void STTS751_Stop(void)
   STTS751_Set_State(SM_SENSOR_STATE_SUSPENDING);
 }
 
-__weak void STTS751_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+__weak void STTS751_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
 
 }
@@ -218,6 +231,8 @@ uint8_t STTS751_Create_Sensor(const SM_Init_Param_t *pxParams)
     return 1; /* error */
   }
 
+  HSD_WTM_Register(s_nSTTS751_id, &stts751_wtm_fifo);
+
   pSensor = COM_GetSensor(s_nSTTS751_id);
 
   /* SENSOR DESCRIPTOR */
@@ -99,13 +99,22 @@ extern void HSD_traceTASK_SWITCHED_OUT(int32_t pxTaskTag);
 #define configUSE_16_BIT_TICKS                  0
 #define configIDLE_SHOULD_YIELD                 1
 #define configUSE_MUTEXES                       1
-#define configQUEUE_REGISTRY_SIZE               100
+#define configQUEUE_REGISTRY_SIZE               4   /* sdThreadQueue, bleSendThreadQueue, AM_Q */
 #define configUSE_RECURSIVE_MUTEXES             0
 #define configUSE_MALLOC_FAILED_HOOK            0
 #define configUSE_COUNTING_SEMAPHORES           1
 #define configGENERATE_RUN_TIME_STATS           0
 
+/* Debug builds (DEBUG defined) check the end of each task stack at every context switch,
+ * an overflow ends in vApplicationStackOverflowHook(). The free stack of the sensor threads
+ * is reported in the "stackFree" field of the performance status. */
+#ifndef configCHECK_FOR_STACK_OVERFLOW
+#ifdef DEBUG
+#define configCHECK_FOR_STACK_OVERFLOW          2
+#else
 #define configCHECK_FOR_STACK_OVERFLOW          0
+#endif /* DEBUG */
+#endif /* configCHECK_FOR_STACK_OVERFLOW */
 
 /* Tasks debug through STMOD+ pins. */
 #define configUSE_APPLICATION_TASK_TAG          1
@@ -132,6 +141,7 @@ extern void HSD_traceTASK_SWITCHED_OUT(int32_t pxTaskTag);
 #define INCLUDE_xQueueGetMutexHolder            1
 #define INCLUDE_xTaskGetSchedulerState          1
 #define INCLUDE_eTaskGetState                   1
+#define INCLUDE_uxTaskGetStackHighWaterMark     1
 
 /* Cortex-M specific definitions. */
 #ifdef __NVIC_PRIO_BITS
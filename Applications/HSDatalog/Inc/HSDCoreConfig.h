@@ -23,7 +23,10 @@
 extern "C" {
 #endif
 
+#include "stdint.h"
+
 #define HSD_MIN(a, b)             (((a) < (b)) ? (a) : (b))
+#define HSD_MAX(a, b)             (((a) > (b)) ? (a) : (b))
 
 #define MAX_SPTS 1000
 
@@ -36,6 +39,135 @@ extern "C" {
  */
 #define HSD_USE_DUMMY_DATA       0
 
+/*
+ * HSD_TIMESTAMP_TICKS, if enabled, keeps timestamps as raw 64-bit TIM5 ticks through the whole
+ * pipeline: sensor IRQ capture, ODR estimation and timestamps written in the data stream, which
+ * become uint64_t instead of double (same size). The tick frequency is written in the device JSON
+ * as "timestampFrequency" and the conversion to seconds is left to the host.
+ * This avoids the software double arithmetic in every IRQ and data ready call.
+ */
+#ifndef HSD_TIMESTAMP_TICKS
+#define HSD_TIMESTAMP_TICKS      0
+#endif /* HSD_TIMESTAMP_TICKS */
+
+#if (HSD_TIMESTAMP_TICKS == 1)
+typedef uint64_t HSD_TimeStamp_t;
+#else
+typedef double HSD_TimeStamp_t;
+#endif /* HSD_TIMESTAMP_TICKS */
+
+/*
+ * HSD_COMPACT_TIMESTAMPS, if enabled, selects the "HSD_2.0.0" format for the .dat files on SD card:
+ * instead of an 8 byte timestamp every samplesPerTimestamp samples, each chunk of a file starts with
+ * a SDM_CompactHeader_t (time of its first sample and number of samples) followed by contiguous samples.
+ * Header time is in units of 2^HSD_COMPACT_TS_SHIFT TIM5 ticks since the acquisition start; its
+ * frequency is written in the device JSON as "chunkTimestampFrequency". USB streaming is not affected.
+ */
+#ifndef HSD_COMPACT_TIMESTAMPS
+#define HSD_COMPACT_TIMESTAMPS   0
+#endif /* HSD_COMPACT_TIMESTAMPS */
+#define HSD_COMPACT_TS_SHIFT     7U
+
+/*
+ * HSD_FIFO_TIMESTAMP, if enabled, batches the timestamp counter of LSM6DSOX and ISM330DHCX in their FIFO every 8
+ * sample sets. The time of the latest sample of each subsensor is then read from the sensor clock and mapped to the
+ * TIM5 timebase by an online linear fit (HSD_fifo_ts.c), instead of being the FIFO IRQ timestamp: IRQ latency and
+ * jitter are averaged out and the subsensors of a batch get their own timestamps.
+ * Disabled by default: the timestamp words take FIFO room and SPI bandwidth, ODR / 8 words per second.
+ */
+#ifndef HSD_FIFO_TIMESTAMP
+#define HSD_FIFO_TIMESTAMP       0
+#endif /* HSD_FIFO_TIMESTAMP */
+#if (HSD_FIFO_TIMESTAMP == 1)
+#define HSD_FIFO_TS_DECIMATION   8U   /* sample sets per timestamp word */
+#else
+#define HSD_FIFO_TS_DECIMATION   0U
+#endif /* (HSD_FIFO_TIMESTAMP == 1) */
+
+/*
+ * HSD_CODEC_ENABLE allows the int16 subsensors with "compression" set in their status to be stored on SD card
+ * as HSD_codec blocks of up to HSD_CODEC_BLOCK_FRAMES frames. Blocks are also closed before each timestamp,
+ * so in the .dat file a timestamp follows the block that completes samplesPerTs samples.
+ * Disabled by default: it cannot be built with SDM_CONTAINER_MODE or HSD_COMPACT_TIMESTAMPS.
+ */
+#ifndef HSD_CODEC_ENABLE
+#define HSD_CODEC_ENABLE         0
+#endif /* HSD_CODEC_ENABLE */
+#ifndef HSD_CODEC_BLOCK_FRAMES
+#define HSD_CODEC_BLOCK_FRAMES   256U
+#endif /* HSD_CODEC_BLOCK_FRAMES */
+
+/*
+ * HSD_FEATURES_ENABLE adds the "FEATURES" virtual sensor (HSD_features.c): mean, RMS, peak-to-peak, crest factor,
+ * skewness and kurtosis of each axis of a source subsensor, over windows of HSD_FEATURES_WINDOW_HOPS window periods.
+ * HSD_FEATURES_WINDOW_HOPS = 1 gives tumbling windows, higher values give windows overlapping by (hops - 1) / hops.
+ * Disabled by default: every sample of the sources goes through it in the sensor threads.
+ */
+#ifndef HSD_FEATURES_ENABLE
+#define HSD_FEATURES_ENABLE      0
+#endif /* HSD_FEATURES_ENABLE */
+#ifndef HSD_FEATURES_WINDOW_HOPS
+#define HSD_FEATURES_WINDOW_HOPS 1U
+#endif /* HSD_FEATURES_WINDOW_HOPS */
+
+/*
+ * HSD_TRIGGER_ENABLE allows event-based SD logging (HSD_trigger.c): when a trigger is configured, sensors keep
+ * sampling but each subsensor is written on SD card only around the events, from preTriggerMs before the trigger
+ * to postTriggerMs after it. Up to HSD_TRIGGER_MAX_EVENTS events are listed in AcquisitionInfo.json.
+ * Disabled by default: it cannot be built with SDM_CONTAINER_MODE or HSD_COMPACT_TIMESTAMPS.
+ */
+#ifndef HSD_TRIGGER_ENABLE
+#define HSD_TRIGGER_ENABLE       0
+#endif /* HSD_TRIGGER_ENABLE */
+#define HSD_TRIGGER_MAX_EVENTS   64U
+
+/*
+ * HSD_DECIMATOR_ENABLE allows the subsensors with "decimation" set in their status to be low-pass filtered and
+ * decimated (HSD_decimator.c) before being sent. "ODREffective" in the status is the rate of the data sent.
+ */
+#ifndef HSD_DECIMATOR_ENABLE
+#define HSD_DECIMATOR_ENABLE     1
+#endif /* HSD_DECIMATOR_ENABLE */
+
+/*
+ * HSD_WTM_ADAPTIVE, if enabled, sets the FIFO watermarks at each acquisition start from the whole sensor configuration
+ * (HSD_watermark.c), instead of a fixed level or a fixed batch period per sensor: the sensor threads wake up about
+ * HSD_WTM_TARGET_WAKEUPS times per second in total, no sample waits more than HSD_WTM_LATENCY_MS in a FIFO and each
+ * FIFO keeps room for the samples arriving while it waits HSD_WTM_SERVICE_MS plus the bursts of the sensors on its bus.
+ * Disabled by default: the fixed watermarks of each sensor are used.
+ */
+#ifndef HSD_WTM_ADAPTIVE
+#define HSD_WTM_ADAPTIVE         0
+#endif /* HSD_WTM_ADAPTIVE */
+#ifndef HSD_WTM_TARGET_WAKEUPS
+#define HSD_WTM_TARGET_WAKEUPS   50U
+#endif /* HSD_WTM_TARGET_WAKEUPS */
+#ifndef HSD_WTM_LATENCY_MS
+#define HSD_WTM_LATENCY_MS       1000U
+#endif /* HSD_WTM_LATENCY_MS */
+#ifndef HSD_WTM_SERVICE_MS
+#define HSD_WTM_SERVICE_MS       2U
+#endif /* HSD_WTM_SERVICE_MS */
+
+/*
+ * HSD_SPI_SINGLE_DMA, if enabled, runs each 4-wire SPI transaction as a single full duplex DMA: the register address is
+ * copied in front of the data in a per-bus scratch buffer and the chip select is raised by the DMA complete callback.
+ * If disabled, or if the request does not fit the scratch buffer, the address byte and the data are sent by two DMAs.
+ * "setupCycles", "endCycles" and "transfer" in the bus statistics of the two builds measure the difference.
+ */
+#ifndef HSD_SPI_SINGLE_DMA
+#define HSD_SPI_SINGLE_DMA       1
+#endif /* HSD_SPI_SINGLE_DMA */
+
+/*
+ * Each sensor has one reserved bus transaction slot, used by its thread. HSD_BUS_OVERFLOW_SLOTS slots shared by all
+ * buses serve the requests made while the slot of their sensor is in use (configuration from other threads).
+ * A request finding no free slot fails with an error and is counted in the performance status.
+ */
+#ifndef HSD_BUS_OVERFLOW_SLOTS
+#define HSD_BUS_OVERFLOW_SLOTS   8U
+#endif /* HSD_BUS_OVERFLOW_SLOTS */
+
 /*
  The watermark defines the level of the sensor queue that triggers the IRQ.
  LSM6DSOX_MAX_WTM_LEVEL is used to compute the the watermark.
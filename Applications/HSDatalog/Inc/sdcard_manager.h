@@ -28,11 +28,10 @@ extern "C" {
 #endif
 
 #include "cmsis_os.h"
+#include "HSDCoreConfig.h"
 
 #define SDM_CMD_MASK                (0x00008000)
 #define SDM_DATA_READY_MASK         (0x00004000)
-#define SDM_DATA_FIRST_HALF_MASK    (0x00002000)
-#define SDM_DATA_SECOND_HALF_MASK   (0x00000000)
 #define SDM_SENSOR_ID_MASK          (0x000000FF)
 #define SDM_SUBSENSOR_ID_MASK       (0x00000700)
 
@@ -46,10 +45,82 @@ extern "C" {
 #define SDM_BUFFER_RAM_USAGE    400000
 #define SDM_MIN_BUFFER_SIZE     1024
 
+/* SD data are staged in one arena of SDM_BUFFER_RAM_USAGE bytes shared by all the subsensors,
+ * split in blocks of SDM_ARENA_BLOCK_SIZE bytes taken on demand. Full blocks are written by the
+ * SD task; data are dropped (and counted as overrun) only when the whole arena is in use */
+#ifndef SDM_ARENA_BLOCK_SIZE
+#define SDM_ARENA_BLOCK_SIZE    8192U
+#endif
+#define SDM_ARENA_N_BLOCKS      (SDM_BUFFER_RAM_USAGE / SDM_ARENA_BLOCK_SIZE)
+
+/* Set to 1 to write all the subsensors in a single container file of chunks instead of one
+ * .dat file per subsensor. Each chunk is one arena block (a whole number of clusters):
+ * a SDM_ChunkHeader_t followed by the same byte stream that would go in the .dat file */
+#ifndef SDM_CONTAINER_MODE
+#define SDM_CONTAINER_MODE      0
+#endif
+#define SDM_CONTAINER_FILE_NAME "HSD_Container.dat"
+#define SDM_CHUNK_MAGIC         0x43445348U /* "HSDC" */
+
+/* Set to 1 to pre-allocate a contiguous region (f_expand) for each data file, sized from the
+ * expected file duration and the subsensor data rate, so that no cluster is allocated while
+ * streaming. Files are truncated to their real length when closed. A file without contiguous
+ * free space grows cluster by cluster: "preallocationFailures" in the SD stats counts them */
+#ifndef SDM_PREALLOCATE_FILES
+#define SDM_PREALLOCATE_FILES   0
+#endif
+#define SDM_PREALLOC_MARGIN     1.1f
+
+/* RAM shared by the pre-trigger histories of event-based logging (HSD_TRIGGER_ENABLE):
+ * histories are shortened when the configured preTriggerMs does not fit */
+#ifndef SDM_EVENT_RAM_USAGE
+#define SDM_EVENT_RAM_USAGE     96000U
+#endif
+
+#if (SDM_CONTAINER_MODE == 1) && (HSD_COMPACT_TIMESTAMPS == 1)
+#error "SDM_CONTAINER_MODE and HSD_COMPACT_TIMESTAMPS cannot be enabled at the same time"
+#endif
+
+/* Chunk headers count raw samples: codec blocks can only go in plain .dat files */
+#if (HSD_CODEC_ENABLE == 1) && ((SDM_CONTAINER_MODE == 1) || (HSD_COMPACT_TIMESTAMPS == 1))
+#error "HSD_CODEC_ENABLE cannot be used with SDM_CONTAINER_MODE or HSD_COMPACT_TIMESTAMPS"
+#endif
+
+/* Events are cut on timestamps: chunk headers would not tell where the gaps are */
+#if (HSD_TRIGGER_ENABLE == 1) && ((SDM_CONTAINER_MODE == 1) || (HSD_COMPACT_TIMESTAMPS == 1))
+#error "HSD_TRIGGER_ENABLE cannot be used with SDM_CONTAINER_MODE or HSD_COMPACT_TIMESTAMPS"
+#endif
+
 #define SDM_DEFAULT_CONFIG      (uint8_t)(0x00)
 #define SDM_MLC_CONFIG          (uint8_t)(0x01)
 #define SDM_JSON_CONFIG         (uint8_t)(0x10)
 
+/**
+  * Header of a chunk of the container file (SDM_CONTAINER_MODE == 1).
+  * The chunk size is the arena block size; unused payload bytes are padding.
+  */
+typedef struct
+{
+  uint32_t magic;         /* SDM_CHUNK_MAGIC */
+  uint8_t sID;            /* stream id: sensor id... */
+  uint8_t ssID;           /* ...and subsensor id, as in DeviceConfig.json */
+  uint16_t headerSize;    /* sizeof(SDM_ChunkHeader_t), payload starts here */
+  uint32_t length;        /* valid payload bytes */
+  uint32_t firstSample;   /* index in the stream of the first sample of the payload */
+  HSD_TimeStamp_t timeStamp; /* timestamp of the latest sensor batch when the chunk was opened */
+} SDM_ChunkHeader_t;
+
+/**
+  * Header of each chunk of a .dat file in "HSD_2.0.0" format (HSD_COMPACT_TIMESTAMPS == 1).
+  * A chunk holds the samples of one arena block, never split across chunks.
+  * tickDelta wraps around: the host adds 2^32 each time it decreases along the file.
+  */
+typedef struct
+{
+  uint32_t tickDelta;     /* time of the first sample, in chunkTimestampFrequency ticks since the acquisition start */
+  uint32_t nSamples;      /* number of samples in the chunk */
+} SDM_CompactHeader_t;
+
 extern osMessageQId sdThreadQueue_id;
 
 extern char *g_prgUcfFileBuffer;
@@ -76,6 +147,10 @@ uint8_t SDM_WriteBuffer(uint8_t sID, uint8_t ssID, uint8_t *buffer, uint32_t siz
 uint8_t SDM_WriteConfigBuffer(uint8_t *buffer, uint32_t size);
 uint8_t SDM_Flush_Buffer(uint8_t sID, uint8_t ssID);
 uint8_t SDM_Fill_Buffer(uint8_t sID, uint8_t ssID, uint8_t *src, uint16_t srcSize);
+uint8_t SDM_Write_Samples(uint8_t sID, uint8_t ssID, uint8_t *src, uint16_t srcSize);
+uint8_t SDM_Codec_Flush(uint8_t sID, uint8_t ssID);
+uint8_t *SDM_Reserve(uint8_t sID, uint8_t ssID, uint32_t *nBytes);
+uint8_t SDM_Commit(uint8_t sID, uint8_t ssID, uint32_t nBytes);
 
 uint32_t SDM_CreateJSON(char **serialized_string);
 uint32_t SDM_ReadJSON(char *serialized_string);
@@ -545,6 +545,7 @@ static uint32_t BLE_CM_ConfigConsole_BuildResponse(uint32_t comRequest, char **p
       break;
     }
     case COM_REQUEST_STATUS_PERFORMANCE :
+    case COM_REQUEST_STATUS_PERF_FULL :
     {
       uint32_t mV = 0;
       uint32_t level = 0;
@@ -554,8 +555,10 @@ static uint32_t BLE_CM_ConfigConsole_BuildResponse(uint32_t comRequest, char **p
       BSP_BC_GetVoltageAndLevel(&mV, &level);
       BSP_BC_GetState(&BC_State);
       cpu_usage = osGetCPUUsage();
+      /* the periodic status carries counts and max only, the histograms are sent on request */
       serializedJsonSize = HSD_JSON_serialize_FWStatus_Performance(pSerializedJson, (char *) &BC_State.Name, mV,
-                                                                   level, cpu_usage);
+                                                                   level, cpu_usage,
+                                                                   comRequest == COM_REQUEST_STATUS_PERF_FULL);
       break;
     }
     case COM_REQUEST_STATUS_LOGGING :
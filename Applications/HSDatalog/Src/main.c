@@ -45,6 +45,10 @@
 #include "cpu_utils.h"
 #include "HSD_tags.h"
 #include "HSD_json.h"
+#include "HSD_features.h"
+#include "HSD_trigger.h"
+#include "HSD_decimator.h"
+#include "HSD_clockfit.h"
 #include "HSDCore.h"
 #include "AutoModeTask.h"
 
@@ -288,6 +292,34 @@ static uint8_t Create_Sensors(void)
     return ret;
   }
 
+#if (HSD_FEATURES_ENABLE == 1)
+  /* FEATURES: one subsensor for each source, all inactive by default */
+  uint8_t featuresSensorId[] = {LSM6DSOX_Get_Id(), LSM6DSOX_Get_Id(), LIS2DW12_Get_Id(), MP23ABS1_Get_Id()};
+  uint8_t featuresSubSensorId[] = {0, 1, 0, 0};
+
+  ret = HSD_FEATURES_Create_Sensor(featuresSensorId, featuresSubSensorId, sizeof(featuresSensorId));
+  if (ret)
+  {
+    return ret;
+  }
+#endif /* (HSD_FEATURES_ENABLE == 1) */
+
+#if (HSD_TRIGGER_ENABLE == 1)
+  /* Event-based SD logging, set mode to HSD_TRIGGER_MODE_LEVEL, _RMS or _CLASS to enable it */
+  HSD_Trigger_Config_t xTriggerConfig =
+  {
+    .mode = HSD_TRIGGER_MODE_NONE,
+    .sensorId = LSM6DSOX_Get_Id(),
+    .subSensorId = 0, /* accelerometer */
+    .axis = HSD_TRIGGER_ANY_AXIS,
+    .threshold = 2.0f, /* g */
+    .rmsWindow = 64,
+    .preTriggerMs = 500,
+    .postTriggerMs = 2000
+  };
+  HSD_TRIGGER_Set_Config(&xTriggerConfig);
+#endif /* (HSD_TRIGGER_ENABLE == 1) */
+
   return 0;
 }
 
@@ -498,6 +530,7 @@ void HSD_traceTASK_SWITCHED_IN(int32_t pxTaskTag)
   BSP_DEBUG_PIN_On((Debug_Pin_TypeDef)pxTaskTag);
 #endif /* (HSD_TASK_DEBUG_PINS_ENABLE) */
 
+  COM_CountContextSwitch();
   StartIdleMonitor();
 }
 
@@ -543,6 +576,197 @@ uint32_t StopExecutionPhases(void)
   return bRes;
 }
 
+/**
+  * @brief  Update the clock model of a subsensor with a new batch of samples: the timestamp
+  *         of the latest sample is fitted against the number of samples received, which
+  *         gives the measured ODR. The initial offset and the timestamp jitter are taken
+  *         from the fit when the status is serialized
+  * @param  sensorId: Sensor Id
+  * @param  subSensorId: Subsensor Id
+  * @param  nSamples: number of samples in the batch
+  * @param  timeStamp: timestamp of the latest sample in the batch
+  * @retval None
+  */
+static void SENSOR_Generic_Update_ODR(uint8_t sensorId, uint8_t subSensorId, uint16_t nSamples,
+                                      HSD_TimeStamp_t timeStamp)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sensorId, subSensorId);
+  HSD_ClockFit_t *pFit = &pSubSensorContext->clock_fit;
+
+  pSubSensorContext->n_samples_total += nSamples;
+  pSubSensorContext->old_time_stamp = timeStamp;
+
+  /* measuredODR has no meaning for MLC subsensor in LSM6DSOX, its samples are events */
+  if (sensorId == LSM6DSOX_Get_Id() && subSensorId == 2)
+  {
+    pSubSensorStatus->measuredODR = COM_GetEffectiveODR(pSubSensorStatus);
+    return;
+  }
+
+  pSubSensorStatus->timestampOutliers += HSD_CLOCKFIT_Add(pFit, pSubSensorContext->n_samples_total, timeStamp);
+
+  /* Analog microphones are sampled using STM32 clock (DFSDM or ADC) so the measuredODR should be put equal to ODR */
+  if (sensorId == MP23ABS1_Get_Id())
+  {
+    pSubSensorStatus->measuredODR = COM_GetEffectiveODR(pSubSensorStatus);
+  }
+  else if (pFit->slope > 0.0f)
+  {
+    pSubSensorStatus->measuredODR = (float) SM_SENSOR_TIMESTAMP_FREQ / pFit->slope;
+  }
+}
+
+/**
+  * @brief  Estimate the timestamp of the sample acquired nSamples before the latest one
+  *         received, from the clock model of the subsensor
+  * @param  pSubSensorContext: subsensor context
+  * @param  timeStamp: timestamp of the latest sample
+  * @param  nSamples: number of samples to go back
+  * @retval Estimated timestamp
+  */
+static HSD_TimeStamp_t SENSOR_Generic_TimeStamp_Before(COM_SubSensorContext_t *pSubSensorContext,
+                                                       HSD_TimeStamp_t timeStamp, uint16_t nSamples)
+{
+  HSD_ClockFit_t *pFit = &pSubSensorContext->clock_fit;
+
+  if (HSD_CLOCKFIT_Is_Locked(pFit))
+  {
+    return HSD_CLOCKFIT_Map(pFit, pSubSensorContext->n_samples_total - nSamples);
+  }
+  /* Not enough batches yet (or MLC events): nominal ODR */
+#if (HSD_TIMESTAMP_TICKS == 1)
+  return timeStamp - (uint64_t)((float) nSamples * pFit->slope);
+#else
+  return timeStamp - ((float) nSamples * pFit->slope);
+#endif /* HSD_TIMESTAMP_TICKS */
+}
+
+/**
+  * @brief  Start a zero-copy batch: the sensor writes its samples straight into
+  *         the SD arena blocks through SENSOR_Generic_Data_Reserve/Commit.
+  * @param  sensorId: Sensor Id
+  * @param  subSensorId: Subsensor Id
+  * @param  nSamples: number of samples in the batch
+  * @param  timeStamp: timestamp of the latest sample in the batch
+  * @retval 1 if the batch has to be written with Reserve/Commit,
+  *         0 if the caller must use SENSOR_Generic_Data_Ready instead
+  */
+uint8_t SENSOR_Generic_Data_Begin(uint8_t sensorId, uint8_t subSensorId, uint16_t nSamples,
+                                  HSD_TimeStamp_t timeStamp)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sensorId, subSensorId);
+
+  /* USB streaming, the first (discarded) batch, the compressed or decimated subsensors, the sources
+   * of features and event-based logging keep using the copy path */
+  if (com_status != HS_DATALOG_SD_STARTED || pSubSensorContext->first_dataReady
+      || pSubSensorContext->codec_buffer != NULL || HSD_FEATURES_Is_Source(sensorId, subSensorId)
+      || HSD_TRIGGER_Is_Enabled() || COM_GetSubSensorStatus(sensorId, subSensorId)->decimation > 1U)
+  {
+    return 0;
+  }
+
+  SENSOR_Generic_Update_ODR(sensorId, subSensorId, nSamples, timeStamp);
+  pSubSensorContext->batch_time_stamp = timeStamp;
+  pSubSensorContext->batch_samples_left = nSamples;
+  pSubSensorContext->sd_wrap_staged = 0;
+  pSubSensorContext->sd_batch_dropped = 0;
+  return 1;
+}
+
+/**
+  * @brief  Reserve a contiguous slot in the current SD arena block for the current batch.
+  *         The slot never crosses the next timestamp position, so timestamps
+  *         are still inserted every samplesPerTimestamp samples on commit.
+  *         If the arena is exhausted the rest of the batch is dropped at once,
+  *         as a single overrun.
+  * @param  sensorId: Sensor Id
+  * @param  subSensorId: Subsensor Id
+  * @param  nSamples: [in] samples requested, [out] samples granted (at least 1),
+  *         or samples left in the batch, to be dropped, if NULL is returned
+  * @retval pointer to the slot, NULL if the rest of the batch is dropped
+  */
+uint8_t *SENSOR_Generic_Data_Reserve(uint8_t sensorId, uint8_t subSensorId, uint16_t *nSamples)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sensorId, subSensorId);
+  uint32_t nBytesPerSample = COM_GetnBytesPerSample(sensorId, subSensorId);
+  uint32_t nBytes;
+  uint16_t n = *nSamples;
+  uint8_t *dst;
+
+  if (pSubSensorContext->n_samples_to_timestamp != 0 && n > pSubSensorContext->n_samples_to_timestamp)
+  {
+    n = pSubSensorContext->n_samples_to_timestamp;
+  }
+
+  nBytes = n * nBytesPerSample;
+  dst = SDM_Reserve(sensorId, subSensorId, &nBytes);
+
+  if (dst == NULL)
+  {
+    /* The SD task is late: no retry per sample, the whole remainder of the batch is one overrun */
+    pSubSensorContext->sd_overrun_count++;
+    pSubSensorContext->sd_dropped_bytes += pSubSensorContext->batch_samples_left * nBytesPerSample;
+    pSubSensorContext->sd_batch_dropped = 1;
+    *nSamples = pSubSensorContext->batch_samples_left;
+    return NULL;
+  }
+  if (nBytes < nBytesPerSample)
+  {
+    /* The next sample straddles the end of the block: stage it and
+     * let SDM_Fill_Buffer copy it, or drop it as an overrun, on commit */
+    pSubSensorContext->sd_wrap_staged = 1;
+    *nSamples = 1;
+    return pSubSensorContext->sd_wrap_sample;
+  }
+
+  *nSamples = nBytes / nBytesPerSample;
+  return dst;
+}
+
+/**
+  * @brief  Commit samples written in the slot returned by SENSOR_Generic_Data_Reserve
+  *         and append the timestamp when the samplesPerTimestamp boundary is reached.
+  *         Nothing is committed after the batch has been dropped.
+  * @param  sensorId: Sensor Id
+  * @param  subSensorId: Subsensor Id
+  * @param  nSamples: number of samples actually written in the slot
+  * @retval None
+  */
+void SENSOR_Generic_Data_Commit(uint8_t sensorId, uint8_t subSensorId, uint16_t nSamples)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sensorId, subSensorId);
+  uint32_t nBytesPerSample = COM_GetnBytesPerSample(sensorId, subSensorId);
+
+  if (pSubSensorContext->sd_batch_dropped)
+  {
+    return;
+  }
+  if (pSubSensorContext->sd_wrap_staged)
+  {
+    SDM_Fill_Buffer(sensorId, subSensorId, pSubSensorContext->sd_wrap_sample, nSamples * nBytesPerSample);
+    pSubSensorContext->sd_wrap_staged = 0;
+  }
+  else
+  {
+    SDM_Commit(sensorId, subSensorId, nSamples * nBytesPerSample);
+  }
+  pSubSensorContext->batch_samples_left -= nSamples;
+
+  if (pSubSensorContext->n_samples_to_timestamp != 0)
+  {
+    pSubSensorContext->n_samples_to_timestamp -= nSamples;
+    if (pSubSensorContext->n_samples_to_timestamp == 0)
+    {
+      HSD_TimeStamp_t newTS = SENSOR_Generic_TimeStamp_Before(pSubSensorContext, pSubSensorContext->batch_time_stamp,
+                                                              pSubSensorContext->batch_samples_left);
+      SDM_Fill_Buffer(sensorId, subSensorId, (uint8_t *) &newTS, 8);
+      pSubSensorContext->n_samples_to_timestamp = pSubSensorStatus->samplesPerTimestamp;
+    }
+  }
+}
+
 /**
   * @brief  Sensor Data Ready generic callback. Takes the latest data coming from
   *         a sensor and send it to the active communication interface.
@@ -552,39 +776,61 @@ uint32_t StopExecutionPhases(void)
   * @param  timeStamp: timestamp of the latest sample in the input buffer
   * @retval
   */
-void SENSOR_Generic_Data_Ready(uint8_t sensorId, uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void SENSOR_Generic_Data_Ready(uint8_t sensorId, uint8_t subSensorId, uint8_t *buf, uint16_t size,
+                               HSD_TimeStamp_t timeStamp)
 {
   COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sensorId, subSensorId);
   COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sensorId, subSensorId);
   uint16_t samplesToSend = 0;
   uint16_t nBytesPerSample = 0;
 
+#if (HSD_DECIMATOR_ENABLE == 1)
+  if (HSD_DECIM_Process(sensorId, subSensorId, buf, &size, &timeStamp) == 0 && size == 0)
+  {
+    return; /* no output sample yet */
+  }
+#endif /* (HSD_DECIMATOR_ENABLE == 1) */
+
+#if (HSD_FEATURES_ENABLE == 1)
+  HSD_FEATURES_Process(sensorId, subSensorId, buf, size, timeStamp);
+#endif /* (HSD_FEATURES_ENABLE == 1) */
+#if (HSD_TRIGGER_ENABLE == 1)
+  if (com_status == HS_DATALOG_SD_STARTED)
+  {
+    HSD_TRIGGER_Process(sensorId, subSensorId, buf, size, timeStamp);
+  }
+#endif /* (HSD_TRIGGER_ENABLE == 1) */
+
   if (pSubSensorContext->first_dataReady) /* Discard first set of sensor data */
   {
+#if (HSD_TIMESTAMP_TICKS == 1)
+    pSubSensorStatus->initialOffset = (float) timeStamp / (float) SystemCoreClock;
+#else
     pSubSensorStatus->initialOffset = (float) timeStamp;
+#endif /* HSD_TIMESTAMP_TICKS */
     pSubSensorContext->first_dataReady = 0;
-    pSubSensorContext->n_samples_acc = 0.0f;
+    pSubSensorContext->n_samples_total = 0;
     pSubSensorContext->old_time_stamp = timeStamp;
+    /* Clock model: sample count 0 is the latest sample of the discarded batch */
+    HSD_CLOCKFIT_Init(&pSubSensorContext->clock_fit, (COM_GetEffectiveODR(pSubSensorStatus) > 0.0f)
+                      ? SM_SENSOR_TIMESTAMP_FREQ / (double) COM_GetEffectiveODR(pSubSensorStatus) : 0.0);
+    (void) HSD_CLOCKFIT_Add(&pSubSensorContext->clock_fit, 0, timeStamp);
     pSubSensorContext->n_samples_to_timestamp = pSubSensorStatus->samplesPerTimestamp;
+#if (HSD_COMPACT_TIMESTAMPS == 1)
+    /* on SD card the time is carried by the chunk headers: no inline timestamps */
+    if (com_status == HS_DATALOG_SD_STARTED)
+    {
+      pSubSensorContext->n_samples_to_timestamp = 0;
+    }
+#endif /* (HSD_COMPACT_TIMESTAMPS == 1) */
   }
   else
   {
     nBytesPerSample = COM_GetnBytesPerSample(sensorId, subSensorId);
-    pSubSensorContext->n_samples_acc = (float)(size / nBytesPerSample);
-
-    /* Analog microphones are sampled using STM32 clock (DFSDM or ADC) so the measuredODR should be put equal to ODR */
-    /* measuredODR has no meaning for MLC subsensor in LSM6DSOX */
-    if (sensorId == MP23ABS1_Get_Id() || (sensorId == LSM6DSOX_Get_Id() && subSensorId == 2))
-    {
-      pSubSensorStatus->measuredODR = pSubSensorStatus->ODR;
-    }
-    else
-    {
-      pSubSensorStatus->measuredODR = pSubSensorContext->n_samples_acc 
-	                                  / (timeStamp - pSubSensorContext->old_time_stamp);
-    }
-    pSubSensorContext->old_time_stamp = timeStamp;
+    SENSOR_Generic_Update_ODR(sensorId, subSensorId, size / nBytesPerSample, timeStamp);
     samplesToSend = size / nBytesPerSample;
+    pSubSensorContext->batch_time_stamp = timeStamp;
+    pSubSensorContext->batch_samples_left = samplesToSend;
 
     while (samplesToSend > 0)
     {
@@ -593,7 +839,7 @@ void SENSOR_Generic_Data_Ready(uint8_t sensorId, uint8_t subSensorId, uint8_t *b
         /* Pass the complete buffer at once since there is enough space before next Timestamp */
         if (com_status == HS_DATALOG_SD_STARTED)
         {
-          SDM_Fill_Buffer(sensorId, subSensorId, (uint8_t *) buf, samplesToSend * nBytesPerSample);
+          SDM_Write_Samples(sensorId, subSensorId, (uint8_t *) buf, samplesToSend * nBytesPerSample);
         }
         else if (com_status == HS_DATALOG_USB_STARTED)
         {
@@ -613,7 +859,7 @@ void SENSOR_Generic_Data_Ready(uint8_t sensorId, uint8_t subSensorId, uint8_t *b
          * then pass the TimeStamp, remaining part (if any) is managed in the next iteration of the loop */
         if (com_status == HS_DATALOG_SD_STARTED)
         {
-          SDM_Fill_Buffer(sensorId, subSensorId, (uint8_t *) buf, 
+          SDM_Write_Samples(sensorId, subSensorId, (uint8_t *) buf, 
 		                  pSubSensorContext->n_samples_to_timestamp * nBytesPerSample);
         }
         else if (com_status == HS_DATALOG_USB_STARTED)
@@ -625,18 +871,11 @@ void SENSOR_Generic_Data_Ready(uint8_t sensorId, uint8_t subSensorId, uint8_t *b
         buf += pSubSensorContext->n_samples_to_timestamp * nBytesPerSample;
         samplesToSend -= pSubSensorContext->n_samples_to_timestamp;
 
-        double newTS;
-        if (pSubSensorStatus->measuredODR != 0.0f)
-        {
-          newTS = timeStamp - ((1.0 / (double) pSubSensorStatus->measuredODR) * samplesToSend);
-        }
-        else
-        {
-          newTS = timeStamp;
-        }
+        HSD_TimeStamp_t newTS = SENSOR_Generic_TimeStamp_Before(pSubSensorContext, timeStamp, samplesToSend);
 
         if (com_status == HS_DATALOG_SD_STARTED)
         {
+          SDM_Codec_Flush(sensorId, subSensorId);
           SDM_Fill_Buffer(sensorId, subSensorId, (uint8_t *) &newTS, 8);
         }
         else if (com_status == HS_DATALOG_USB_STARTED)
@@ -650,27 +889,27 @@ void SENSOR_Generic_Data_Ready(uint8_t sensorId, uint8_t subSensorId, uint8_t *b
 }
 
 /*  ---------- Sensors data ready functions ----------- */
-void LIS3DHH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void LIS3DHH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(LIS3DHH_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
-void HTS221_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void HTS221_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(HTS221_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
-void LIS2DW12_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void LIS2DW12_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(LIS2DW12_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
-void LIS2MDL_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void LIS2MDL_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(LIS2MDL_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
-void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(LSM6DSOX_Get_Id(), subSensorId, buf, size, timeStamp);
 
@@ -681,21 +920,41 @@ void LSM6DSOX_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, doubl
   }
 }
 
-void LPS22HH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+uint8_t LSM6DSOX_Data_Begin(uint8_t subSensorId, uint16_t nSamples, HSD_TimeStamp_t timeStamp)
+{
+  return SENSOR_Generic_Data_Begin(LSM6DSOX_Get_Id(), subSensorId, nSamples, timeStamp);
+}
+
+uint8_t *LSM6DSOX_Data_Reserve(uint8_t subSensorId, uint16_t *nSamples)
+{
+  return SENSOR_Generic_Data_Reserve(LSM6DSOX_Get_Id(), subSensorId, nSamples);
+}
+
+void LSM6DSOX_Data_Commit(uint8_t subSensorId, uint16_t nSamples)
+{
+  SENSOR_Generic_Data_Commit(LSM6DSOX_Get_Id(), subSensorId, nSamples);
+}
+
+void LPS22HH_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(LPS22HH_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
-void MP23ABS1_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void MP23ABS1_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(MP23ABS1_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
-void STTS751_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, double timeStamp)
+void STTS751_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
 {
   SENSOR_Generic_Data_Ready(STTS751_Get_Id(), subSensorId, buf, size, timeStamp);
 }
 
+void HSD_FEATURES_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
+{
+  SENSOR_Generic_Data_Ready(HSD_FEATURES_Get_Id(), subSensorId, buf, size, timeStamp);
+}
+
 void Peripheral_MSP_Init_All(void)
 {
   LIS3DHH_Peripheral_Init();
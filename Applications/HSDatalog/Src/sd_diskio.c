@@ -32,8 +32,17 @@
 #include <string.h>
 #include <stdio.h>
 #include "cmsis_os.h"
+#include "com_manager.h"
+#include "sensors_manager.h"
 
 /* Private typedef -----------------------------------------------------------*/
+/* Pending asynchronous write: destination of one driver-owned slot */
+typedef struct
+{
+  DWORD sector;
+  UINT count;
+} SD_WriteReq_t;
+
 /* Private define ------------------------------------------------------------*/
 
 #define QUEUE_SIZE         (uint32_t) 10
@@ -60,6 +69,51 @@
 
 #define SD_DEFAULT_BLOCK_SIZE 512
 
+/*
+ * Asynchronous write path: SD_write() copies the sectors into one of
+ * SD_WRITE_QUEUE_DEPTH driver-owned slots and returns, while SD_WriteThread
+ * streams the slots to the card. FatFs and the SD manager can then prepare
+ * the next buffer while the previous one is on the bus or being programmed.
+ * Write errors are reported by the next SD_write() or by CTRL_SYNC; the
+ * sectors of the failed write are kept in the SD stats ("writeErrors").
+ * Set SD_WRITE_ASYNC to 0 to restore the blocking write of the template.
+ */
+#ifndef SD_WRITE_ASYNC
+#define SD_WRITE_ASYNC          1
+#endif
+
+/* Number of slots, i.e. writes that can be outstanding at the same time */
+#ifndef SD_WRITE_QUEUE_DEPTH
+#define SD_WRITE_QUEUE_DEPTH    2U
+#endif
+
+/* Sectors per slot: longer writes are split over several slots */
+#ifndef SD_WRITE_SLOT_SECTORS
+#define SD_WRITE_SLOT_SECTORS   32U
+#endif
+
+/* Send ACMD23 (SET_WR_BLK_ERASE_COUNT) before each multi-block write */
+#ifndef SD_WRITE_PRE_ERASE
+#define SD_WRITE_PRE_ERASE      1
+#endif
+
+/*
+ * The write thread polls the card while it is programming, so it shares
+ * the SD task priority instead of preempting it
+ */
+#ifndef SD_WRITE_THREAD_PRIO
+#define SD_WRITE_THREAD_PRIO    osPriorityNormal
+#endif
+
+/* ACMD23 response timeout, in ms */
+#define SD_PRE_ERASE_TIMEOUT    10U
+
+/* The write thread relies on the CMSIS-RTOS v1 message API */
+#if (osCMSIS >= 0x20000U) || (_USE_WRITE == 0)
+#undef SD_WRITE_ASYNC
+#define SD_WRITE_ASYNC          0
+#endif
+
 /*
  * Depending on the use case, the SD card initialization could be done at the
  * application level: if it is the case define the flag below to disable
@@ -105,6 +159,19 @@ static osMessageQId SDQueueID = NULL;
 #else
 static osMessageQueueId_t SDQueueID = NULL;
 #endif /* osCMSIS */
+
+#if (SD_WRITE_ASYNC == 1)
+extern SD_HandleTypeDef hsd1;
+
+static uint32_t SD_WriteSlot[SD_WRITE_QUEUE_DEPTH][SD_WRITE_SLOT_SECTORS * BLOCKSIZE / 4U];
+static SD_WriteReq_t SD_WriteReq[SD_WRITE_QUEUE_DEPTH];
+static uint32_t SD_WriteHead = 0;
+static volatile DRESULT SD_WriteError = RES_OK;
+
+static osMessageQId SD_WriteReqQueueID = NULL;
+static osSemaphoreId SD_WriteFreeSemID = NULL;
+static osThreadId SD_WriteThreadID = NULL;
+#endif /* SD_WRITE_ASYNC == 1 */
 /* Private function prototypes -----------------------------------------------*/
 static DSTATUS SD_CheckStatus(BYTE lun);
 DSTATUS SD_initialize(BYTE);
@@ -116,6 +183,14 @@ DRESULT SD_write(BYTE, const BYTE *, DWORD, UINT);
 #if _USE_IOCTL == 1
 DRESULT SD_ioctl(BYTE, BYTE, void *);
 #endif  /* _USE_IOCTL == 1 */
+#if (SD_WRITE_ASYNC == 1)
+static DRESULT SD_write_sync(BYTE, const BYTE *, DWORD, UINT);
+static DRESULT SD_WriteDrain(void);
+static void SD_WriteThread(void const *argument);
+#if (SD_WRITE_PRE_ERASE == 1)
+static void SD_PreErase(uint32_t count);
+#endif /* SD_WRITE_PRE_ERASE == 1 */
+#endif /* SD_WRITE_ASYNC == 1 */
 
 const Diskio_drvTypeDef SD_Driver =
 {
@@ -189,6 +264,14 @@ DSTATUS SD_initialize(BYTE lun)
   if (osKernelGetState() == osKernelRunning)
 #endif /* osCMSIS */
   {
+#if (SD_WRITE_ASYNC == 1)
+    /* never re-initialize the card under a pending write */
+    if (SD_WriteFreeSemID != NULL)
+    {
+      (void)SD_WriteDrain();
+    }
+#endif /* SD_WRITE_ASYNC == 1 */
+
 #if !defined(DISABLE_SD_INIT)
 
     if (BSP_SD_Init() == MSD_OK)
@@ -221,6 +304,31 @@ DSTATUS SD_initialize(BYTE lun)
       {
         Stat |= STA_NOINIT;
       }
+
+#if (SD_WRITE_ASYNC == 1)
+      if (SD_WriteFreeSemID == NULL)
+      {
+        osSemaphoreDef(SD_WriteFreeSem);
+        SD_WriteFreeSemID = osSemaphoreCreate(osSemaphore(SD_WriteFreeSem), SD_WRITE_QUEUE_DEPTH);
+      }
+
+      if (SD_WriteReqQueueID == NULL)
+      {
+        osMessageQDef(SD_WriteReqQueue, SD_WRITE_QUEUE_DEPTH, uint32_t);
+        SD_WriteReqQueueID = osMessageCreate(osMessageQ(SD_WriteReqQueue), NULL);
+      }
+
+      if ((SD_WriteThreadID == NULL) && (SD_WriteFreeSemID != NULL) && (SD_WriteReqQueueID != NULL))
+      {
+        osThreadDef(SD_Write_Thread, SD_WriteThread, SD_WRITE_THREAD_PRIO, 1, 1024 / 4);
+        SD_WriteThreadID = osThreadCreate(osThread(SD_Write_Thread), NULL);
+      }
+
+      if (SD_WriteThreadID == NULL)
+      {
+        Stat |= STA_NOINIT;
+      }
+#endif /* SD_WRITE_ASYNC == 1 */
     }
   }
 
@@ -262,6 +370,15 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
 #if (ENABLE_SD_DMA_CACHE_MAINTENANCE == 1)
   uint32_t alignedAddr;
 #endif /*(ENABLE_SD_DMA_CACHE_MAINTENANCE == 1)*/
+
+#if (SD_WRITE_ASYNC == 1)
+  /* read after write: the queued sectors must reach the card first */
+  if (SD_WriteDrain() != RES_OK)
+  {
+    return res;
+  }
+#endif /* SD_WRITE_ASYNC == 1 */
+
   /*
    * ensure the SDCard is ready for a new operation
    */
@@ -412,7 +529,11 @@ DRESULT SD_read(BYTE lun, BYTE *buff, DWORD sector, UINT count)
   */
 #if _USE_WRITE == 1
 
+#if (SD_WRITE_ASYNC == 1)
+static DRESULT SD_write_sync(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+#else
 DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+#endif /* SD_WRITE_ASYNC == 1 */
 {
   DRESULT res = RES_ERROR;
   uint32_t timer;
@@ -567,6 +688,174 @@ DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
 
   return res;
 }
+
+#if (SD_WRITE_ASYNC == 1)
+/**
+  * @brief  Queues Sector(s) for writing
+  * @param  lun : not used
+  * @param  *buff: Data to be written, it can be reused as soon as the function returns
+  * @param  sector: Sector address (LBA)
+  * @param  count: Number of sectors to write (1..128)
+  * @retval DRESULT: RES_OK if the sectors have been queued, RES_ERROR on timeout
+  *         or if a previously queued write has failed
+  */
+DRESULT SD_write(BYTE lun, const BYTE *buff, DWORD sector, UINT count)
+{
+  DRESULT res = RES_OK;
+  uint32_t slot;
+  UINT n;
+  uint64_t t0 = SM_GetTicks();
+
+  while (count > 0U)
+  {
+    /* wait for a free slot: it is recycled once the card has programmed it */
+    if (osSemaphoreWait(SD_WriteFreeSemID, SD_TIMEOUT) != osOK)
+    {
+      res = RES_ERROR;
+      break;
+    }
+
+    if (SD_WriteError != RES_OK)
+    {
+      res = SD_WriteError;
+      SD_WriteError = RES_OK;
+      osSemaphoreRelease(SD_WriteFreeSemID);
+      break;
+    }
+
+    n = (count > SD_WRITE_SLOT_SECTORS) ? SD_WRITE_SLOT_SECTORS : count;
+
+    /* slots are recycled in FIFO order, the one at the head is free */
+    slot = SD_WriteHead;
+    SD_WriteHead = (SD_WriteHead + 1U) % SD_WRITE_QUEUE_DEPTH;
+
+    memcpy((void *)SD_WriteSlot[slot], buff, n * BLOCKSIZE);
+    SD_WriteReq[slot].sector = sector;
+    SD_WriteReq[slot].count = n;
+    osMessagePut(SD_WriteReqQueueID, slot, 0);
+
+    buff += n * BLOCKSIZE;
+    sector += n;
+    count -= n;
+  }
+
+  /* time spent by the caller, including the wait for a free slot */
+  COM_AddLatencySample(&COM_GetSDStats()->diskWrite, SM_TICKS_TO_US(SM_GetTicks() - t0));
+  return res;
+}
+
+/**
+  * @brief  Waits for all the queued writes to be programmed
+  * @param  None
+  * @retval DRESULT: RES_ERROR if any queued write failed since the last call
+  */
+static DRESULT SD_WriteDrain(void)
+{
+  DRESULT res;
+  uint32_t i;
+
+  if (SD_WriteFreeSemID == NULL)
+  {
+    return RES_OK;
+  }
+
+  /* all the slots are free only when the write thread is idle */
+  for (i = 0; i < SD_WRITE_QUEUE_DEPTH; i++)
+  {
+    osSemaphoreWait(SD_WriteFreeSemID, osWaitForever);
+  }
+  for (i = 0; i < SD_WRITE_QUEUE_DEPTH; i++)
+  {
+    osSemaphoreRelease(SD_WriteFreeSemID);
+  }
+
+  res = SD_WriteError;
+  SD_WriteError = RES_OK;
+  return res;
+}
+
+/**
+  * @brief  Write thread: moves the queued slots to the card in order and
+  *         recycles each slot once its transfer is complete
+  * @param  argument: not used
+  * @retval None
+  */
+static void SD_WriteThread(void const *argument)
+{
+  osEvent evt;
+  uint32_t slot;
+  uint64_t t0;
+
+  (void)argument;
+
+  for (;;)
+  {
+    evt = osMessageGet(SD_WriteReqQueueID, osWaitForever);
+    if (evt.status == osEventMessage)
+    {
+      slot = evt.value.v;
+      t0 = SM_GetTicks();
+
+#if (SD_WRITE_PRE_ERASE == 1)
+      if ((SD_WriteReq[slot].count > 1U) && (SD_CheckStatusWithTimeout(SD_TIMEOUT) == 0))
+      {
+        SD_PreErase(SD_WriteReq[slot].count);
+      }
+#endif /* SD_WRITE_PRE_ERASE == 1 */
+
+      if (SD_write_sync(0, (const BYTE *)SD_WriteSlot[slot], SD_WriteReq[slot].sector, SD_WriteReq[slot].count) != RES_OK)
+      {
+        /* the caller only learns about it on its next write: keep what failed */
+        COM_GetSDStats()->writeErrors++;
+        COM_GetSDStats()->writeErrorSector = SD_WriteReq[slot].sector;
+        COM_GetSDStats()->writeErrorCount = SD_WriteReq[slot].count;
+        SD_WriteError = RES_ERROR;
+      }
+
+      COM_AddLatencySample(&COM_GetSDStats()->cardWrite, SM_TICKS_TO_US(SM_GetTicks() - t0));
+      osSemaphoreRelease(SD_WriteFreeSemID);
+    }
+  }
+}
+
+#if (SD_WRITE_PRE_ERASE == 1)
+/**
+  * @brief  Sends ACMD23 so that the card can erase the next "count" blocks
+  *         before the CMD25 that follows. The hint is optional: failures
+  *         are ignored and the write proceeds as usual
+  * @param  count: Number of blocks of the next multi-block write
+  * @retval None
+  */
+static void SD_PreErase(uint32_t count)
+{
+  SDMMC_CmdInitTypeDef sdmmc_cmdinit;
+  uint32_t timer;
+
+  if (SDMMC_CmdAppCommand(hsd1.Instance, (uint32_t)(hsd1.SdCard.RelCardAdd << 16U)) != SDMMC_ERROR_NONE)
+  {
+    return;
+  }
+
+  sdmmc_cmdinit.Argument = count;
+  sdmmc_cmdinit.CmdIndex = SDMMC_CMD_SD_APP_SET_WR_BLK_ERASE_COUNT;
+  sdmmc_cmdinit.Response = SDMMC_RESPONSE_SHORT;
+  sdmmc_cmdinit.WaitForInterrupt = SDMMC_WAIT_NO;
+  sdmmc_cmdinit.CPSM = SDMMC_CPSM_ENABLE;
+  (void)SDMMC_SendCommand(hsd1.Instance, &sdmmc_cmdinit);
+
+  timer = osKernelSysTick();
+  while (!__SDMMC_GET_FLAG(hsd1.Instance, SDMMC_FLAG_CCRCFAIL | SDMMC_FLAG_CMDREND | SDMMC_FLAG_CTIMEOUT))
+  {
+    if (osKernelSysTick() - timer >= SD_PRE_ERASE_TIMEOUT)
+    {
+      break;
+    }
+  }
+
+  __SDMMC_CLEAR_FLAG(hsd1.Instance, SDMMC_STATIC_CMD_FLAGS);
+}
+#endif /* SD_WRITE_PRE_ERASE == 1 */
+#endif /* SD_WRITE_ASYNC == 1 */
 #endif /* _USE_WRITE == 1 */
 
 /* USER CODE BEGIN beforeIoctlSection */
@@ -594,7 +883,11 @@ DRESULT SD_ioctl(BYTE lun, BYTE cmd, void *buff)
   {
     /* Make sure that no pending write process */
     case CTRL_SYNC:
+#if (SD_WRITE_ASYNC == 1)
+      res = SD_WriteDrain();
+#else
       res = RES_OK;
+#endif /* SD_WRITE_ASYNC == 1 */
       break;
 
     /* Get number of sectors on the disk (DWORD) */
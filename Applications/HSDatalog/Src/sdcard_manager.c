@@ -34,6 +34,8 @@
 #include "stts751_app.h"
 
 #include "HSD_json.h"
+#include "HSD_codec.h"
+#include "HSD_trigger.h"
 #include "HSDCore.h"
 #include "AutoMode.h"
 
@@ -44,10 +46,24 @@
 
 /* Private includes ----------------------------------------------------------*/
 /* Private typedef -----------------------------------------------------------*/
+
+/* Descriptor of a block of the shared SD write arena */
+typedef struct
+{
+  uint32_t deadline;      /* kernel tick by which the block should be written on SD */
+  uint32_t seq;           /* position of the block in the stream of its subsensor */
+  uint8_t sID;
+  uint8_t ssID;
+  volatile uint8_t ready; /* block full, waiting for the SD task */
+} SDM_ArenaBlock_t;
+
 /* Private define ------------------------------------------------------------*/
 
 #define LOG_DIR_PREFIX    "STBOX_"
 #define SD_CHECK_TIME     600000
+#define SD_THREAD_STOP_TIMEOUT  1000 /* ms */
+
+#define SDM_ARENA_NULL_BLOCK  0xFFFFFFFFU
 
 /* Private macro -------------------------------------------------------------*/
 /* Private variables ---------------------------------------------------------*/
@@ -75,6 +91,20 @@ volatile uint8_t BatteryLow = 0;
 float activeBaudRate;
 float activeSubSensors;
 
+/* Shared SD write arena: blocks are taken on demand by the subsensors from a lock-free free list */
+static uint8_t *SDM_Arena = NULL;
+static volatile uint32_t SDM_ArenaFreeHead = SDM_ARENA_NULL_BLOCK;
+static uint32_t SDM_ArenaNext[SDM_ARENA_N_BLOCKS];
+static SDM_ArenaBlock_t SDM_ArenaBlock[SDM_ARENA_N_BLOCKS];
+static uint32_t SDM_ArenaBlockSize = SDM_ARENA_BLOCK_SIZE; /* whole number of clusters */
+static uint32_t SDM_ArenaNBlocks = SDM_ARENA_N_BLOCKS;
+static uint32_t SDM_BlockDataOffset = 0; /* room for the chunk header in container and compact mode */
+static uint32_t SDM_BlockDataSize = SDM_ARENA_BLOCK_SIZE;
+
+#if (SDM_CONTAINER_MODE == 1)
+static FIL SDM_ContainerFile;
+#endif /* (SDM_CONTAINER_MODE == 1) */
+
 /**
   * Specifies the duration in ms of the next phase (datalog).
   */
@@ -129,7 +159,24 @@ static void Activate_Sensor(uint32_t id);
 
 static void SDM_Boot(void);
 static void SDM_DataReady(osEvent evt);
-static void SDM_NewFiles(osEvent evt);
+static uint32_t SDM_Arena_Alloc(void);
+static void SDM_Arena_Free(uint32_t block);
+static uint32_t SDM_Arena_Next_Block(uint8_t sID, uint8_t ssID);
+static uint8_t SDM_Arena_Write_Block(uint32_t block);
+static uint8_t SDM_Arena_Store_Block(uint32_t block, uint32_t length);
+#if (SDM_CONTAINER_MODE == 1)
+static uint32_t SDM_Stream_Sample_Index(uint8_t sID, uint8_t ssID, uint32_t streamByte);
+#endif /* (SDM_CONTAINER_MODE == 1) */
+static uint8_t SDM_Open_Block(uint8_t sID, uint8_t ssID, uint32_t block, uint32_t batchOffset);
+static void SDM_Codec_Init(uint8_t sID, uint8_t ssID);
+static void SDM_Event_Init(void);
+static void SDM_Event_Start(uint8_t sID, uint8_t ssID);
+static uint8_t SDM_Event_Gate(uint8_t sID, uint8_t ssID, uint8_t *src, uint16_t srcSize);
+#if (HSD_COMPACT_TIMESTAMPS == 1)
+static uint32_t SDM_Chunk_Ticks(uint8_t sID, uint8_t ssID, uint32_t batchOffset);
+#endif /* (HSD_COMPACT_TIMESTAMPS == 1) */
+static void SDM_Commit_Block(uint8_t sID, uint8_t ssID);
+static void SDM_NewFiles(void);
 static void SDM_StartStopAcquisition(void);
 static void SDM_StartAcquisition(void);
 static void SDM_StopAcquisition(void);
@@ -147,6 +194,7 @@ static uint32_t SDM_SaveData(void);
 static uint32_t SDM_SaveDeviceConfig(char *dir_name);
 static uint32_t SDM_SaveAcquisitionInfo(char *dir_name);
 static uint32_t SDM_SaveUCF(char *dir_name);
+static void SDM_UpdateQueuePeak(void);
 
 /**
   * Function called when the Stop timer expires.
@@ -178,6 +226,26 @@ static inline void SDM_EndSDOperation(void);
   */
 static int16_t SDM_SplitFileNameAndExt(char *pcFilename, char **ppcName, char **ppcExtension);
 
+#if (SDM_PREALLOCATE_FILES == 1)
+/**
+  * Estimate the size of a data file at the end of the current file period.
+  *
+  * @param sID [IN] sensor id
+  * @param ssID [IN] subsensor id
+  * @return expected size in bytes
+  */
+static uint32_t SDM_ExpectedFileSize(uint8_t sID, uint8_t ssID);
+
+/**
+  * Pre-allocate a contiguous region, rounded to whole clusters, for a file just created.
+  * On failure (no contiguous space) the file simply grows cluster by cluster.
+  *
+  * @param fp [IN] file object
+  * @param size [IN] expected size in bytes
+  */
+static void SDM_PreallocateFile(FIL *fp, uint32_t size);
+#endif /* (SDM_PREALLOCATE_FILES == 1) */
+
 /*----------------------------------------------------------------------------*/
 /**
   * @brief  Default enabled sensors
@@ -291,6 +359,7 @@ static void SDM_Thread(void const *argument)
       StopExecutionPhases();
     }
     evt = osMessageGet(sdThreadQueue_id, osWaitForever); /* wait for message */
+    SDM_UpdateQueuePeak();
 
     if (com_status == HS_DATALOG_IDLE || com_status == HS_DATALOG_SD_STARTED)
     {
@@ -308,7 +377,7 @@ static void SDM_Thread(void const *argument)
         }
         if (evt.value.v == SDM_NEWFILE_SIGNAL)
         {
-          SDM_NewFiles(evt);
+          SDM_NewFiles();
         }
         if (evt.value.v == SDM_START_STOP) /* start/stop acquisition command */
         {
@@ -387,6 +456,9 @@ static void SDM_StartAcquisition(void)
   osTimerStart(SDM_NewFiles_Timer_Id,SD_CHECK_TIME);
 
   COM_GenerateAcquisitionUUID();
+  COM_ResetSDStats();
+  COM_ResetBusStats();
+  HSD_TRIGGER_Reset();
 
   if (BSP_SD_IsDetected())
   {
@@ -435,36 +507,157 @@ static void SDM_StopAcquisition(void)
   */
 static void SDM_DataReady(osEvent evt)
 {
-  COM_SubSensorStatus_t *pSubSensorStatus;
-  COM_SubSensorContext_t *pSubSensorContext;
-  uint32_t buf_size;
-  uint8_t sID = (uint8_t)(evt.value.v & SDM_SENSOR_ID_MASK);
-  uint8_t ssID = (uint8_t)((evt.value.v & SDM_SUBSENSOR_ID_MASK) >> 8);
+  uint32_t block;
 
-  pSubSensorStatus = COM_GetSubSensorStatus(sID, ssID);
-  pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  /* The message only wakes the task up: every full block of the arena is written,
+   * earliest deadline first, whatever subsensor posted it */
+  while ((block = SDM_Arena_Next_Block(COM_MAX_SENSORS, 0)) != SDM_ARENA_NULL_BLOCK)
+  {
+    SDM_Arena_Write_Block(block);
+  }
+}
 
-  buf_size = pSubSensorStatus->sdWriteBufferSize;
+/**
+  * @brief  Select the next arena block to be written on SD card. Only the oldest
+  *         full block of each subsensor is eligible, so every file is written in order;
+  *         among eligible blocks the one with the earliest deadline is chosen.
+  * @param  sID: sensor id, COM_MAX_SENSORS to consider all the subsensors
+  * @param  ssID: subsensor id (ignored if sID == COM_MAX_SENSORS)
+  * @retval block index, SDM_ARENA_NULL_BLOCK if no block is ready
+  */
+static uint32_t SDM_Arena_Next_Block(uint8_t sID, uint8_t ssID)
+{
+  uint32_t i;
+  uint32_t next = SDM_ARENA_NULL_BLOCK;
+  SDM_ArenaBlock_t *pBlock;
 
-  if (evt.value.v & SDM_DATA_FIRST_HALF_MASK) /* Data available on first half of the circular buffer */
+  for (i = 0; i < SDM_ArenaNBlocks; i++)
   {
-    SDM_WriteBuffer(sID, ssID, pSubSensorContext->sd_write_buffer, buf_size);
+    pBlock = &SDM_ArenaBlock[i];
+    if (!pBlock->ready)
+    {
+      continue;
+    }
+    if (sID != COM_MAX_SENSORS && (pBlock->sID != sID || pBlock->ssID != ssID))
+    {
+      continue;
+    }
+    if (pBlock->seq != COM_GetSubSensorContext(pBlock->sID, pBlock->ssID)->sd_write_seg)
+    {
+      continue;
+    }
+    if (next == SDM_ARENA_NULL_BLOCK || (int32_t)(pBlock->deadline - SDM_ArenaBlock[next].deadline) < 0)
+    {
+      next = i;
+    }
   }
-  else /* Data available on second half of the circular buffer */
+  return next;
+}
+
+/**
+  * @brief  Write a full arena block to the file of its subsensor and give it back to the free list
+  * @param  block: block index
+  * @retval 1 for f_write error, else 0
+  */
+static uint8_t SDM_Arena_Write_Block(uint32_t block)
+{
+  SDM_ArenaBlock_t *pBlock = &SDM_ArenaBlock[block];
+  uint8_t ret;
+
+  ret = SDM_Arena_Store_Block(block, COM_GetSubSensorContext(pBlock->sID, pBlock->ssID)->sd_block_data_size);
+  COM_GetSubSensorContext(pBlock->sID, pBlock->ssID)->sd_write_seg++;
+  pBlock->ready = 0;
+  SDM_Arena_Free(block);
+  return ret;
+}
+
+/**
+  * @brief  Write the content of an arena block on SD card. In container mode the whole
+  *         chunk (header, payload and padding) is written to keep cluster alignment,
+  *         in compact mode the header is written followed by the payload.
+  * @param  block: block index
+  * @param  length: valid payload bytes
+  * @retval 1 for f_write error, else 0
+  */
+static uint8_t SDM_Arena_Store_Block(uint32_t block, uint32_t length)
+{
+  SDM_ArenaBlock_t *pBlock = &SDM_ArenaBlock[block];
+  uint8_t *pData = &SDM_Arena[block * SDM_ArenaBlockSize];
+
+#if (SDM_CONTAINER_MODE == 1)
+  ((SDM_ChunkHeader_t *) pData)->length = length;
+  return SDM_WriteBuffer(pBlock->sID, pBlock->ssID, pData, SDM_ArenaBlockSize);
+#elif (HSD_COMPACT_TIMESTAMPS == 1)
+  ((SDM_CompactHeader_t *) pData)->nSamples = length / COM_GetnBytesPerSample(pBlock->sID, pBlock->ssID);
+  return SDM_WriteBuffer(pBlock->sID, pBlock->ssID, pData, SDM_BlockDataOffset + length);
+#else
+  return SDM_WriteBuffer(pBlock->sID, pBlock->ssID, pData, length);
+#endif /* (SDM_CONTAINER_MODE == 1) */
+}
+
+/**
+  * @brief  Take a block from the arena free list. Safe against preemption (LDREX/STREX).
+  * @param  None
+  * @retval block index, SDM_ARENA_NULL_BLOCK if the arena is exhausted
+  */
+static uint32_t SDM_Arena_Alloc(void)
+{
+  uint32_t head;
+
+  do
   {
-    SDM_WriteBuffer(sID, ssID, (uint8_t *)(pSubSensorContext->sd_write_buffer + buf_size), buf_size);
-  }
+    head = __LDREXW((uint32_t *) &SDM_ArenaFreeHead);
+    if (head == SDM_ARENA_NULL_BLOCK)
+    {
+      __CLREX();
+      return SDM_ARENA_NULL_BLOCK;
+    }
+  } while (__STREXW(SDM_ArenaNext[head], (uint32_t *) &SDM_ArenaFreeHead) != 0U);
+
+  return head;
 }
 
-static void SDM_NewFiles(osEvent evt)
+/**
+  * @brief  Give a block back to the arena free list. Safe against preemption (LDREX/STREX).
+  * @param  block: block index
+  * @retval None
+  */
+static void SDM_Arena_Free(uint32_t block)
 {
-  uint8_t sID = (uint8_t)(evt.value.v & SDM_SENSOR_ID_MASK);
-  uint8_t ssID = (uint8_t)((evt.value.v & SDM_SUBSENSOR_ID_MASK) >> 8);
+  uint32_t head;
+
+  do
+  {
+    head = __LDREXW((uint32_t *) &SDM_ArenaFreeHead);
+    SDM_ArenaNext[block] = head;
+  } while (__STREXW(block, (uint32_t *) &SDM_ArenaFreeHead) != 0U);
+}
+
+/**
+  * @brief  Handle SDM_NEWFILE_SIGNAL task message: close the files and go on logging in a new folder.
+  *         Closing flushes every subsensor and releases the arena, so the sensor threads are stopped
+  *         and waited for first. SDM_InitFiles() restarts them.
+  * @param  None
+  * @retval None
+  */
+static void SDM_NewFiles(void)
+{
+  /* the timer may fire while a stop request is queued */
+  if (com_status != HS_DATALOG_SD_STARTED || SD_Logging_Active == 0)
+  {
+    return;
+  }
+
+  SM_StopSensorAcquisition();
+  if (SM_WaitSensorAcquisitionStopped(SD_THREAD_STOP_TIMEOUT) != 0)
+  {
+    SDM_Error_Handler();
+  }
 
-  SDM_Flush_Buffer(sID,ssID);
   SDM_CloseFiles();
+  SM_TIM_Start();
+  HSD_TAGS_timer_start();
   SDM_InitFiles();
-
 }
 
 
@@ -651,8 +844,8 @@ void HAL_PWR_PVDCallback(void)
 }
 
 /**
-  * @brief  SD Card Manager memory initialization. Performs the dynamic allocation for
-  *         the sd_write_buffer associated to each active subsensor.
+  * @brief  SD Card Manager memory initialization. Allocates the shared SD write arena
+  *         and resets the SD context of each active subsensor.
   * @param
   * @retval 1: no error
   */
@@ -664,7 +857,47 @@ uint8_t SDM_Memory_Init(void)
   COM_SubSensorContext_t *pSubSensorContext;
   uint32_t sID;
   uint32_t ssID;
+  uint32_t i;
   uint32_t nBytesPerSample;
+  uint32_t clusterSize = (uint32_t) SDFatFs.csize * _MIN_SS;
+
+  /* Blocks are written with a single f_write: round them to a whole number of clusters */
+  if (clusterSize == 0 || clusterSize >= SDM_ARENA_BLOCK_SIZE)
+  {
+    SDM_ArenaBlockSize = (clusterSize == 0) ? SDM_ARENA_BLOCK_SIZE : clusterSize;
+  }
+  else
+  {
+    SDM_ArenaBlockSize = SDM_ARENA_BLOCK_SIZE - (SDM_ARENA_BLOCK_SIZE % clusterSize);
+  }
+  SDM_ArenaNBlocks = HSD_MIN(SDM_BUFFER_RAM_USAGE / SDM_ArenaBlockSize, SDM_ARENA_N_BLOCKS);
+#if (SDM_CONTAINER_MODE == 1)
+  SDM_BlockDataOffset = sizeof(SDM_ChunkHeader_t);
+#elif (HSD_COMPACT_TIMESTAMPS == 1)
+  SDM_BlockDataOffset = sizeof(SDM_CompactHeader_t);
+#else
+  SDM_BlockDataOffset = 0;
+#endif /* (SDM_CONTAINER_MODE == 1) */
+  SDM_BlockDataSize = SDM_ArenaBlockSize - SDM_BlockDataOffset;
+
+  SDM_Arena = HSD_malloc(SDM_ArenaNBlocks * SDM_ArenaBlockSize);
+  if (SDM_Arena == NULL)
+  {
+    HSD_PRINTF("Mem alloc error [%ld]: %d@%s\r\n", SDM_ArenaNBlocks * SDM_ArenaBlockSize, __LINE__, __FILE__);
+    SDM_Error_Handler();
+  }
+  else
+  {
+    HSD_PRINTF("Mem alloc ok [%ld]: %d@%s\r\n", SDM_ArenaNBlocks * SDM_ArenaBlockSize, __LINE__, __FILE__);
+  }
+
+  /* Chain all the blocks in the free list */
+  for (i = 0; i < SDM_ArenaNBlocks; i++)
+  {
+    SDM_ArenaBlock[i].ready = 0;
+    SDM_ArenaNext[i] = (i + 1 < SDM_ArenaNBlocks) ? (i + 1) : SDM_ARENA_NULL_BLOCK;
+  }
+  SDM_ArenaFreeHead = 0;
 
   for (sID = 0; sID < pDeviceDescriptor->nSensor; sID++)
   {
@@ -678,64 +911,47 @@ uint8_t SDM_Memory_Init(void)
       {
         nBytesPerSample = COM_GetnBytesPerSample(sID, ssID);
         SDM_CalculateSdWriteBufferSize(pSubSensorStatus, nBytesPerSample);
-        pSubSensorContext->sd_write_buffer = HSD_malloc(pSubSensorStatus->sdWriteBufferSize * 2);
-        if (pSubSensorContext->sd_write_buffer == NULL)
-        {
-          HSD_PRINTF("Mem alloc error [%ld]: %d@%s\r\n", pSubSensorStatus->sdWriteBufferSize * 2, __LINE__, __FILE__);
-          SDM_Error_Handler();
-        }
-        else
-        {
-          HSD_PRINTF("Mem alloc ok [%ld]: %d@%s\r\n", pSubSensorStatus->sdWriteBufferSize * 2, __LINE__, __FILE__);
-        }
-      }
-      else
-      {
-        pSubSensorContext->sd_write_buffer = 0;
+        SDM_Codec_Init(sID, ssID);
+        pSubSensorContext->sd_commit_seg = 0;
+        pSubSensorContext->sd_write_seg = 0;
+#if (HSD_COMPACT_TIMESTAMPS == 1)
+        /* chunks hold whole samples only */
+        pSubSensorContext->sd_block_data_size = SDM_BlockDataSize - (SDM_BlockDataSize % nBytesPerSample);
+#else
+        pSubSensorContext->sd_block_data_size = SDM_BlockDataSize;
+#endif /* (HSD_COMPACT_TIMESTAMPS == 1) */
       }
+      /* blocks are taken from the arena when the first data arrive */
+      pSubSensorContext->sd_write_buffer = NULL;
+      pSubSensorContext->sd_write_buffer_idx = 0;
     }
   }
 
+  SDM_Event_Init();
+
   return 1;
 }
 
 /**
-  * @brief  Calculate SdWriteBufferSize for each active subSensor.
-  *       SdWriteBufferSize is proportional to subSensor effective baud rate.
+  * @brief  Set SdWriteBufferSize for each active subSensor: data are written on SD card
+  *       one arena block at a time. samplesPerTimestamp is clipped accordingly.
   * @param
   * @retval 1: no error
   */
 void SDM_CalculateSdWriteBufferSize(COM_SubSensorStatus_t *pSubSensorStatus, uint32_t nBytesPerSample)
 {
-  uint32_t bufferSize; /* Amount of data written on SD card for each fwrite */
-  /* fixedRAM = total miminum data used by the active subSensors. Each subSensor should use at least 
-  SDM_MIN_BUFFER_SIZE bytes */
-  float fixedRAM = SDM_MIN_BUFFER_SIZE * activeSubSensors;
-  /* variableRAM = data space available. Can be assigned to each subSensor in base of its effective baudrate */
-  float variableRAM = SDM_BUFFER_RAM_USAGE - fixedRAM;
-
-  if (pSubSensorStatus->ODR != 0) /* Setup bufferSize in base of the subSensor ODR and the RAM available */
-  {
-    /* nBytesPerSecond = # bytes used by the subSensor for each second */
-    float nBytesPerSecond = pSubSensorStatus->ODR * nBytesPerSample;
-    /* activeBaudRate = sum of nBytesPerSecond for all active subSensors */
-    /* bufferSize = weighted average of the RAM available in base of effective baud rate */
-    bufferSize = (uint32_t)((nBytesPerSecond * (variableRAM / activeBaudRate)) / 2.0f);
-    /* bufferSize = mod(bufferSize,SDM_MIN_BUFFER_SIZE) */
-    bufferSize = bufferSize - (bufferSize % SDM_MIN_BUFFER_SIZE) + SDM_MIN_BUFFER_SIZE;
-
-    /* Data are written on SD card when half buffer is available */
-    /* enter here if bufferSize > SDM_MAX_WRITE_TIME seconds of data */
-    /* so to avoid not to writing for more than SDM_MAX_WRITE_TIME seconds */
-    if (bufferSize > SDM_MAX_WRITE_TIME * pSubSensorStatus->ODR * nBytesPerSample)
-    {
-      /* clip bufferSize to SDM_MAX_WRITE_TIME seconds of data */
-      bufferSize = SDM_MAX_WRITE_TIME * (uint32_t)(pSubSensorStatus->ODR * nBytesPerSample);
+  uint32_t bufferSize = SDM_ArenaBlockSize; /* Amount of data written on SD card for each fwrite */
+  float odr = COM_GetEffectiveODR(pSubSensorStatus);
 
+  if (odr != 0)
+  {
+    /* enter here if a block holds more than SDM_MAX_WRITE_TIME seconds of data */
+    if (bufferSize > SDM_MAX_WRITE_TIME * odr * nBytesPerSample)
+    {
       /* check samplesPerTimestamp is valid (set SDM_MAX_WRITE_TIME seconds of data or clip to 1000) */
       if (pSubSensorStatus->samplesPerTimestamp != 0)
       {
-        uint32_t samplesPerTS = (uint32_t)(SDM_MAX_WRITE_TIME * pSubSensorStatus->ODR);
+        uint32_t samplesPerTS = (uint32_t)(SDM_MAX_WRITE_TIME * odr);
         if (samplesPerTS > MAX_SPTS)
         {
           pSubSensorStatus->samplesPerTimestamp = MAX_SPTS;
@@ -749,7 +965,6 @@ void SDM_CalculateSdWriteBufferSize(COM_SubSensorStatus_t *pSubSensorStatus, uin
   }
   else /* ODR = 0 is used for not sampled subSensors (i.e.: virtual sensors, MLC) */
   {
-    bufferSize = nBytesPerSample; /* Buffer size = length of the subSensor output */
     pSubSensorStatus->samplesPerTimestamp = 1; /* write a timestamp for each sample */
   }
 
@@ -765,8 +980,6 @@ uint8_t SDM_Memory_Deinit(void)
 {
   COM_DeviceDescriptor_t *pDeviceDescriptor = COM_GetDeviceDescriptor();
   COM_SensorDescriptor_t *pSensorDescriptor;
-  COM_SubSensorStatus_t *pSubSensorStatus;
-  COM_SubSensorContext_t *pSubSensorContext;
   uint32_t sID;
   uint32_t ssID;
 
@@ -776,16 +989,27 @@ uint8_t SDM_Memory_Deinit(void)
 
     for (ssID = 0; ssID < pSensorDescriptor->nSubSensors; ssID++)
     {
-      pSubSensorStatus = COM_GetSubSensorStatus(sID, ssID);
-      pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
-      if (pSubSensorStatus->isActive && pSubSensorContext->sd_write_buffer != 0)
+      COM_GetSubSensorContext(sID, ssID)->sd_write_buffer = NULL;
+      if (COM_GetSubSensorContext(sID, ssID)->codec_buffer != NULL)
+      {
+        HSD_free(COM_GetSubSensorContext(sID, ssID)->codec_buffer);
+        COM_GetSubSensorContext(sID, ssID)->codec_buffer = NULL;
+      }
+      if (COM_GetSubSensorContext(sID, ssID)->event_ring != NULL)
       {
-        HSD_free(pSubSensorContext->sd_write_buffer);
-        pSubSensorContext->sd_write_buffer = NULL;
+        HSD_free(COM_GetSubSensorContext(sID, ssID)->event_ring);
+        COM_GetSubSensorContext(sID, ssID)->event_ring = NULL;
       }
     }
   }
 
+  if (SDM_Arena != NULL)
+  {
+    HSD_free(SDM_Arena);
+    SDM_Arena = NULL;
+  }
+  SDM_ArenaFreeHead = SDM_ARENA_NULL_BLOCK;
+
   return 1;
 }
 
@@ -900,15 +1124,72 @@ uint8_t SDM_OpenDatFile(uint8_t sID, uint8_t ssID, const char *sensorName)
   {
     return 1;
   }
+#if (SDM_PREALLOCATE_FILES == 1)
+  SDM_PreallocateFile(p, SDM_ExpectedFileSize(sID, ssID));
+#endif /* (SDM_PREALLOCATE_FILES == 1) */
   return 0;
 }
 
 uint8_t SDM_CloseFile(uint8_t sID, uint8_t ssID)
 {
   FIL *p = &(COM_GetSubSensorContext(sID, ssID)->file_handler);
+#if (SDM_PREALLOCATE_FILES == 1)
+  /* drop the pre-allocated space not used */
+  f_truncate(p);
+#endif /* (SDM_PREALLOCATE_FILES == 1) */
   return f_close(p);
 }
 
+#if (SDM_PREALLOCATE_FILES == 1)
+static uint32_t SDM_ExpectedFileSize(uint8_t sID, uint8_t ssID)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sID, ssID);
+  float durationS = SD_CHECK_TIME / 1000.0f; /* files are renewed every SD_CHECK_TIME ms */
+  float bytesPerSecond;
+
+  if (s_nTimerPeriodMS != 0 && s_nTimerPeriodMS < SD_CHECK_TIME)
+  {
+    durationS = s_nTimerPeriodMS / 1000.0f;
+  }
+
+  if (pSubSensorStatus->ODR == 0) /* event driven subsensors (i.e.: MLC): nothing to estimate */
+  {
+    return 0;
+  }
+
+  bytesPerSecond = COM_GetEffectiveODR(pSubSensorStatus) * COM_GetnBytesPerSample(sID, ssID);
+  if (pSubSensorStatus->samplesPerTimestamp != 0)
+  {
+    bytesPerSecond += 8.0f * COM_GetEffectiveODR(pSubSensorStatus) / pSubSensorStatus->samplesPerTimestamp;
+  }
+
+  return (uint32_t)(bytesPerSecond * durationS * SDM_PREALLOC_MARGIN);
+}
+
+static void SDM_PreallocateFile(FIL *fp, uint32_t size)
+{
+  uint32_t clusterSize = (uint32_t) SDFatFs.csize * _MIN_SS;
+
+  if (size == 0 || clusterSize == 0)
+  {
+    return;
+  }
+
+  /* whole clusters, no extra one when size is already aligned */
+  size = ((size + clusterSize - 1U) / clusterSize) * clusterSize;
+  /* the SD stats tell whether writeBuffer latencies come from pre-allocated files */
+  if (f_expand(fp, size, 1) != FR_OK)
+  {
+    COM_GetSDStats()->preallocFailures++;
+    HSD_PRINTF("f_expand failed [%ld]: %d@%s\r\n", size, __LINE__, __FILE__);
+  }
+  else
+  {
+    COM_GetSDStats()->preallocatedFiles++;
+  }
+}
+#endif /* (SDM_PREALLOCATE_FILES == 1) */
+
 /**
   * @brief  Scan SD Card file system to find the latest directory number that includes to the LOG_DIR_PREFIX
   * @param  None
@@ -985,6 +1266,18 @@ uint8_t SDM_InitFiles(void)
     return 1;
   }
 
+#if (SDM_CONTAINER_MODE == 1)
+  /* All the subsensors are written in a single container file */
+  sprintf(file_name, "%s/%s", dir_name, SDM_CONTAINER_FILE_NAME);
+  if (f_open(&SDM_ContainerFile, (const char *) file_name, FA_CREATE_ALWAYS | FA_WRITE) != FR_OK)
+  {
+    return 1;
+  }
+#endif /* (SDM_CONTAINER_MODE == 1) */
+#if (SDM_CONTAINER_MODE == 1) && (SDM_PREALLOCATE_FILES == 1)
+  uint32_t containerSize = 0;
+#endif /* (SDM_CONTAINER_MODE == 1) && (SDM_PREALLOCATE_FILES == 1) */
+
   for (sID = 0; sID < pDeviceDescriptor->nSensor; sID++)
   {
     pSensorDescriptor = COM_GetSensorDescriptor(sID);
@@ -1024,17 +1317,25 @@ uint8_t SDM_InitFiles(void)
             sprintf(subSensorName, "NA");
             break;
         }
+#if (SDM_CONTAINER_MODE == 0)
         sprintf(file_name, "%s/%s_%s", dir_name, pSensorDescriptor->name, subSensorName);
         if (SDM_OpenDatFile(sID, ssID, file_name) != 0)
         {
           return 1;
         }
-        activeBaudRate += COM_GetSubSensorStatus(sID, ssID)->ODR * COM_GetnBytesPerSample(sID, ssID);
+#elif (SDM_PREALLOCATE_FILES == 1)
+        containerSize += SDM_ExpectedFileSize(sID, ssID);
+#endif /* (SDM_CONTAINER_MODE == 0) */
+        activeBaudRate += COM_GetEffectiveODR(COM_GetSubSensorStatus(sID, ssID)) * COM_GetnBytesPerSample(sID, ssID);
         activeSubSensors += 1;
       }
     }
   }
 
+#if (SDM_CONTAINER_MODE == 1) && (SDM_PREALLOCATE_FILES == 1)
+  SDM_PreallocateFile(&SDM_ContainerFile, containerSize);
+#endif /* (SDM_CONTAINER_MODE == 1) && (SDM_PREALLOCATE_FILES == 1) */
+
   SDM_Memory_Init();
 
   for (sID = 0; sID < pDeviceDescriptor->nSensor; sID++)
@@ -1146,15 +1447,28 @@ static uint32_t SDM_SaveData(void)
     {
       if (COM_GetSubSensorStatus(ii, nn)->isActive)
       {
+        SDM_Codec_Flush(ii, nn);
         SDM_Flush_Buffer(ii, nn);
+#if (SDM_CONTAINER_MODE == 0)
         if (SDM_CloseFile(ii, nn) != 0)
         {
           return 1;
         }
+#endif /* (SDM_CONTAINER_MODE == 0) */
       }
     }
   }
 
+#if (SDM_CONTAINER_MODE == 1)
+#if (SDM_PREALLOCATE_FILES == 1)
+  f_truncate(&SDM_ContainerFile);
+#endif /* (SDM_PREALLOCATE_FILES == 1) */
+  if (f_close(&SDM_ContainerFile) != FR_OK)
+  {
+    return 1;
+  }
+#endif /* (SDM_CONTAINER_MODE == 1) */
+
   /* Deallocate here SD buffers to have enough memory for next section */
   SDM_Memory_Deinit();
   return 0;
@@ -1315,9 +1629,21 @@ uint8_t SDM_WriteConfigBuffer(uint8_t *buffer, uint32_t size)
 uint8_t SDM_WriteBuffer(uint8_t sID, uint8_t ssID, uint8_t *buffer, uint32_t size)
 {
   uint32_t byteswritten;
+  COM_SDStats_t *pStats = COM_GetSDStats();
+  uint64_t t0 = SM_GetTicks();
+  FRESULT res;
+#if (SDM_CONTAINER_MODE == 1)
+  FIL *p = &SDM_ContainerFile;
+#else
   FIL *p = &(COM_GetSubSensorContext(sID, ssID)->file_handler);
+#endif /* (SDM_CONTAINER_MODE == 1) */
+
+  res = f_write(p, buffer, size, (void *) &byteswritten);
 
-  if (f_write(p, buffer, size, (void *) &byteswritten) != FR_OK)
+  COM_AddLatencySample(&pStats->writeBuffer, SM_TICKS_TO_US(SM_GetTicks() - t0));
+  pStats->bytesWritten += byteswritten;
+
+  if (res != FR_OK)
   {
     return 1;
   }
@@ -1332,24 +1658,40 @@ uint8_t SDM_WriteBuffer(uint8_t sID, uint8_t ssID, uint8_t *buffer, uint32_t siz
 /* Write remaining data to file */
 uint8_t SDM_Flush_Buffer(uint8_t sID, uint8_t ssID)
 {
-  uint8_t ret = 1;
-  uint32_t bufSize = COM_GetSubSensorStatus(sID, ssID)->sdWriteBufferSize;
+  uint8_t ret = 0;
+  uint32_t block;
+  uint64_t t0 = SM_GetTicks();
   COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
 
-  if (pSubSensorContext->sd_write_buffer_idx > 0 && pSubSensorContext->sd_write_buffer_idx < (bufSize - 1))
+  /* write the full blocks not yet written by the SD task */
+  while ((block = SDM_Arena_Next_Block(sID, ssID)) != SDM_ARENA_NULL_BLOCK)
+  {
+    ret |= SDM_Arena_Write_Block(block);
+  }
+
+  /* then the block being filled */
+  if (pSubSensorContext->sd_write_buffer != NULL)
   {
-    /* flush from the beginning */
-    ret = SDM_WriteBuffer(sID, ssID, pSubSensorContext->sd_write_buffer, pSubSensorContext->sd_write_buffer_idx + 1);
+    block = (pSubSensorContext->sd_write_buffer - SDM_BlockDataOffset - SDM_Arena) / SDM_ArenaBlockSize;
+    if (pSubSensorContext->sd_write_buffer_idx > 0)
+    {
+      ret |= SDM_Arena_Store_Block(block, pSubSensorContext->sd_write_buffer_idx);
+    }
+    SDM_Arena_Free(block);
   }
-  else if (pSubSensorContext->sd_write_buffer_idx > (bufSize - 1)
-           && pSubSensorContext->sd_write_buffer_idx < (bufSize * 2 - 1))
+
+  if (pSubSensorContext->sd_overrun_count != 0)
   {
-    /* flush from half buffer */
-    ret = SDM_WriteBuffer(sID, ssID, (uint8_t *)(pSubSensorContext->sd_write_buffer + bufSize), 
-                        pSubSensorContext->sd_write_buffer_idx + 1 - bufSize);
+    HSD_PRINTF("SD buffer overrun %d.%d: %ld events, %ld bytes dropped\r\n", sID, ssID,
+               pSubSensorContext->sd_overrun_count, pSubSensorContext->sd_dropped_bytes);
   }
 
+  pSubSensorContext->sd_write_buffer = NULL;
   pSubSensorContext->sd_write_buffer_idx = 0;
+  pSubSensorContext->sd_commit_seg = 0;
+  pSubSensorContext->sd_write_seg = 0;
+
+  COM_AddLatencySample(&COM_GetSDStats()->flushBuffer, SM_TICKS_TO_US(SM_GetTicks() - t0));
   return ret;
 }
 
@@ -1362,51 +1704,605 @@ uint8_t SDM_Flush_Buffer(uint8_t sID, uint8_t ssID)
   */
 uint8_t SDM_Fill_Buffer(uint8_t sID, uint8_t ssID, uint8_t *src, uint16_t srcSize)
 {
-  uint8_t *dst;
-  uint32_t dstP = 0;
-  uint32_t srcP = 0;
-  uint32_t dstSize;
-  uint32_t bufSize;
+  uint32_t blocks[(0xFFFFU / (SDM_ARENA_BLOCK_SIZE / 2U)) + 2U];
+  uint32_t nBlocks;
+  uint32_t i;
+  uint32_t span;
+  uint32_t blockSize;
+  uint16_t size = srcSize;
   COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
 
-  bufSize = COM_GetSubSensorStatus(sID, ssID)->sdWriteBufferSize;
-  dstSize = bufSize * 2;
+  if (srcSize == 0)
+  {
+    return 0;
+  }
 
-  dst = pSubSensorContext->sd_write_buffer;
-  dstP = pSubSensorContext->sd_write_buffer_idx;
+  /* Between events data only go in the pre-trigger history */
+  if (pSubSensorContext->event_ring != NULL && SDM_Event_Gate(sID, ssID, src, srcSize))
+  {
+    return 0;
+  }
 
-  /* byte per byte copy to SD buffer, automatic wrap */
-  while (srcP < srcSize)
+  /* Take up front all the blocks needed, so that data are either stored entirely or dropped */
+  blockSize = pSubSensorContext->sd_block_data_size;
+  if (pSubSensorContext->sd_write_buffer == NULL)
+  {
+    nBlocks = (srcSize + blockSize - 1U) / blockSize;
+  }
+  else
   {
-    dst[dstP] = src[srcP];
-    dstP++;
-    srcP++;
-    if (dstP >= dstSize)
+    nBlocks = (pSubSensorContext->sd_write_buffer_idx + srcSize - 1U) / blockSize;
+  }
+  if (nBlocks > sizeof(blocks) / sizeof(blocks[0]))
+  {
+    pSubSensorContext->sd_overrun_count++;
+    pSubSensorContext->sd_dropped_bytes += srcSize;
+    return 1;
+  }
+  for (i = 0; i < nBlocks; i++)
+  {
+    blocks[i] = SDM_Arena_Alloc();
+    if (blocks[i] == SDM_ARENA_NULL_BLOCK)
     {
-      dstP = 0;
+      /* arena exhausted, the SD task is late: drop data instead of overwriting blocks not yet written */
+      while (i > 0)
+      {
+        SDM_Arena_Free(blocks[--i]);
+      }
+      pSubSensorContext->sd_overrun_count++;
+      pSubSensorContext->sd_dropped_bytes += srcSize;
+      return 1;
     }
   }
-  if (pSubSensorContext->sd_write_buffer_idx < (dstSize / 2) && dstP >= (dstSize / 2)) /* first half full */
+
+  /* bulk copy to SD blocks: one contiguous span per block */
+  i = 0;
+  while (srcSize > 0)
   {
-    /* unlock write task */
-    if (osMessagePut(sdThreadQueue_id, sID | ssID << 8 | SDM_DATA_READY_MASK | SDM_DATA_FIRST_HALF_MASK, 0) != osOK)
+    if (pSubSensorContext->sd_write_buffer == NULL)
     {
-      SDM_Error_Handler();
+      SDM_Open_Block(sID, ssID, blocks[i++], size - srcSize);
+    }
+    span = blockSize - pSubSensorContext->sd_write_buffer_idx;
+    if (srcSize < span)
+    {
+      span = srcSize;
     }
-    /* check for buffer consistency */
+    HSD_memcpy(&pSubSensorContext->sd_write_buffer[pSubSensorContext->sd_write_buffer_idx], src, span);
+    src += span;
+    srcSize -= span;
+    pSubSensorContext->sd_write_buffer_idx += span;
+    if (pSubSensorContext->sd_write_buffer_idx == blockSize)
+    {
+      SDM_Commit_Block(sID, ssID);
+    }
+  }
+  return 0;
+}
+
+/**
+  * @brief  Store samples of a subsensor: straight into the SD buffer, or through
+  *         the lossless codec if compression is enabled for the subsensor
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  src: pointer to the samples
+  * @param  srcSize: size in bytes, a whole number of samples
+  * @retval 0: ok
+  */
+uint8_t SDM_Write_Samples(uint8_t sID, uint8_t ssID, uint8_t *src, uint16_t srcSize)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t blockSize;
+  uint32_t span;
+  uint8_t ret = 0;
+
+  if (pSubSensorContext->codec_buffer == NULL)
+  {
+    return SDM_Fill_Buffer(sID, ssID, src, srcSize);
   }
-  else if (dstP < pSubSensorContext->sd_write_buffer_idx) /* second half full */
+
+  blockSize = HSD_CODEC_BLOCK_FRAMES * COM_GetnBytesPerSample(sID, ssID);
+  while (srcSize > 0)
   {
-    if (osMessagePut(sdThreadQueue_id, sID | ssID << 8 | SDM_DATA_READY_MASK | SDM_DATA_SECOND_HALF_MASK, 0) != osOK)
+    span = blockSize - pSubSensorContext->codec_buffer_idx;
+    if (srcSize < span)
     {
-      SDM_Error_Handler();
+      span = srcSize;
+    }
+    HSD_memcpy(&pSubSensorContext->codec_buffer[pSubSensorContext->codec_buffer_idx], src, span);
+    src += span;
+    srcSize -= span;
+    pSubSensorContext->codec_buffer_idx += span;
+    if (pSubSensorContext->codec_buffer_idx == blockSize)
+    {
+      ret |= SDM_Codec_Flush(sID, ssID);
     }
   }
+  return ret;
+}
+
+/**
+  * @brief  Encode the samples collected so far by the codec of a subsensor and
+  *         put the block in the SD buffer. Called when the block is full, before
+  *         each timestamp and when the data file is closed.
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @retval 0: ok
+  */
+uint8_t SDM_Codec_Flush(uint8_t sID, uint8_t ssID)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t nBytesPerSample;
+  uint32_t nFrames;
+  uint32_t size;
+  uint64_t t0;
+  uint8_t *pOut;
+
+  if (pSubSensorContext->codec_buffer == NULL || pSubSensorContext->codec_buffer_idx == 0)
+  {
+    return 0;
+  }
+
+  nBytesPerSample = COM_GetnBytesPerSample(sID, ssID);
+  nFrames = pSubSensorContext->codec_buffer_idx / nBytesPerSample;
+  pOut = &pSubSensorContext->codec_buffer[HSD_CODEC_BLOCK_FRAMES * nBytesPerSample];
+
+  t0 = SM_GetTicks();
+  size = HSD_Codec_Encode((int16_t *) pSubSensorContext->codec_buffer, nFrames, nBytesPerSample / 2U, pOut);
+  pSubSensorContext->codec_cycles += SM_GetTicks() - t0;
+  pSubSensorContext->codec_in_bytes += pSubSensorContext->codec_buffer_idx;
+  pSubSensorContext->codec_out_bytes += size;
+  pSubSensorContext->codec_buffer_idx = 0;
+
+  return SDM_Fill_Buffer(sID, ssID, pOut, size);
+}
+
+/**
+  * @brief  Allocate the codec buffers of a subsensor if compression is enabled.
+  *         Compression is turned off if it can't be used, so that DeviceConfig.json
+  *         always tells how the data file has to be read.
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @retval None
+  */
+static void SDM_Codec_Init(uint8_t sID, uint8_t ssID)
+{
+  COM_SubSensorStatus_t *pSubSensorStatus = COM_GetSubSensorStatus(sID, ssID);
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t nChannels = COM_GetSubSensorDescriptor(sID, ssID)->dimensions;
+  uint32_t size;
+
+  pSubSensorContext->codec_buffer = NULL;
+  pSubSensorContext->codec_buffer_idx = 0;
+
+#if (HSD_CODEC_ENABLE == 1)
+  /* events are cut on timestamps, codec blocks would have to be decoded to find them */
+  if (pSubSensorStatus->compression != 0 && HSD_TRIGGER_Is_Enabled())
+  {
+    pSubSensorStatus->compression = 0;
+  }
+  if (pSubSensorStatus->compression != 0)
+  {
+    if (COM_GetSubSensorDescriptor(sID, ssID)->dataType != DATA_TYPE_INT16
+        || HSD_CODEC_BLOCK_FRAMES > HSD_CODEC_MAX_FRAMES)
+    {
+      pSubSensorStatus->compression = 0;
+      return;
+    }
+    size = HSD_CODEC_BLOCK_FRAMES * 2U * nChannels + HSD_CODEC_OUT_SIZE(HSD_CODEC_BLOCK_FRAMES, nChannels);
+    pSubSensorContext->codec_buffer = HSD_malloc(size);
+    if (pSubSensorContext->codec_buffer == NULL)
+    {
+      HSD_PRINTF("Mem alloc error [%ld]: %d@%s\r\n", size, __LINE__, __FILE__);
+      pSubSensorStatus->compression = 0;
+    }
+  }
+#else
+  (void) nChannels;
+  (void) size;
+  pSubSensorStatus->compression = 0;
+#endif /* (HSD_CODEC_ENABLE == 1) */
+}
+
+/**
+  * @brief  Allocate the pre-trigger history of each active subsensor if a trigger is configured.
+  *         A history holds whole periods of the SD stream (samplesPerTimestamp samples followed
+  *         by their timestamp), so that events start and end on a timestamp. Histories are
+  *         shortened to fit SDM_EVENT_RAM_USAGE; a subsensor without history is logged continuously.
+  * @param  None
+  * @retval None
+  */
+static void SDM_Event_Init(void)
+{
+  COM_DeviceDescriptor_t *pDeviceDescriptor = COM_GetDeviceDescriptor();
+  COM_SubSensorStatus_t *pSubSensorStatus;
+  COM_SubSensorContext_t *pSubSensorContext;
+  uint32_t preTriggerMs = HSD_TRIGGER_Get_Config()->preTriggerMs;
+  uint32_t total = 0;
+  uint32_t nPeriods;
+  uint32_t sID;
+  uint32_t ssID;
+
+  for (sID = 0; sID < pDeviceDescriptor->nSensor; sID++)
+  {
+    for (ssID = 0; ssID < COM_GetSensorDescriptor(sID)->nSubSensors; ssID++)
+    {
+      pSubSensorStatus = COM_GetSubSensorStatus(sID, ssID);
+      pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+      pSubSensorContext->event_ring = NULL;
+      pSubSensorContext->event_ring_size = 0;
+      pSubSensorContext->event_ring_bytes = 0;
+      pSubSensorContext->event_live_bytes = 0;
+      pSubSensorContext->event_live = 0;
+      pSubSensorContext->event_seq = HSD_TRIGGER_Get_Sequence();
+
+      if (pSubSensorStatus->isActive && HSD_TRIGGER_Is_Enabled())
+      {
+        pSubSensorContext->event_period = COM_GetnBytesPerSample(sID, ssID);
+        nPeriods = (uint32_t) ceilf((float) preTriggerMs * COM_GetEffectiveODR(pSubSensorStatus) / 1000.0f);
+        if (pSubSensorStatus->samplesPerTimestamp != 0)
+        {
+          pSubSensorContext->event_period *= pSubSensorStatus->samplesPerTimestamp;
+          pSubSensorContext->event_period += 8U; /* timestamp */
+          nPeriods = (nPeriods + pSubSensorStatus->samplesPerTimestamp - 1U) / pSubSensorStatus->samplesPerTimestamp;
+        }
+        /* one more period: the one being filled when the trigger comes */
+        pSubSensorContext->event_ring_size = HSD_MAX(nPeriods + 1U, 2U);
+        total += pSubSensorContext->event_ring_size * pSubSensorContext->event_period;
+      }
+    }
+  }
+
+  for (sID = 0; sID < pDeviceDescriptor->nSensor; sID++)
+  {
+    for (ssID = 0; ssID < COM_GetSensorDescriptor(sID)->nSubSensors; ssID++)
+    {
+      pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+      if (pSubSensorContext->event_ring_size == 0)
+      {
+        continue;
+      }
+
+      nPeriods = pSubSensorContext->event_ring_size;
+      if (total > SDM_EVENT_RAM_USAGE)
+      {
+        nPeriods = HSD_MAX((uint32_t)((uint64_t) nPeriods * SDM_EVENT_RAM_USAGE / total), 2U);
+      }
+      pSubSensorContext->event_ring_size = nPeriods * pSubSensorContext->event_period;
+      pSubSensorContext->event_ring = HSD_malloc(pSubSensorContext->event_ring_size);
+      if (pSubSensorContext->event_ring == NULL)
+      {
+        HSD_PRINTF("Mem alloc error [%ld]: %d@%s\r\n", pSubSensorContext->event_ring_size, __LINE__, __FILE__);
+        pSubSensorContext->event_ring_size = 0;
+      }
+    }
+  }
+}
 
-  pSubSensorContext->sd_write_buffer_idx = dstP;
+/**
+  * @brief  Start an event for a subsensor: write its history on SD card, from the oldest
+  *         complete period to the data of the period in progress
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @retval None
+  */
+static void SDM_Event_Start(uint8_t sID, uint8_t ssID)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t ringSize = pSubSensorContext->event_ring_size;
+  uint32_t nBytes = pSubSensorContext->event_ring_bytes;
+  uint32_t pos;
+  uint32_t span;
+  uint8_t *pRing;
+
+  if (nBytes > ringSize - pSubSensorContext->event_period)
+  {
+    nBytes = ringSize - pSubSensorContext->event_period + (nBytes % pSubSensorContext->event_period);
+  }
+  pos = (pSubSensorContext->event_ring_bytes - nBytes) % ringSize;
+
+  pSubSensorContext->event_live = 1;
+  pSubSensorContext->event_live_bytes = nBytes % pSubSensorContext->event_period;
+
+  /* detach the history while it is copied, so that SDM_Fill_Buffer doesn't route it back */
+  pRing = pSubSensorContext->event_ring;
+  pSubSensorContext->event_ring = NULL;
+  while (nBytes > 0)
+  {
+    span = HSD_MIN(HSD_MIN(nBytes, ringSize - pos), 0x8000U);
+    SDM_Fill_Buffer(sID, ssID, &pRing[pos], span);
+    pos = (pos + span) % ringSize;
+    nBytes -= span;
+  }
+  pSubSensorContext->event_ring = pRing;
+}
+
+/**
+  * @brief  Route data of a subsensor with a pre-trigger history. Data go on SD card during
+  *         an event, in the history otherwise. An event of the subsensor ends at the first
+  *         timestamp after the end of the post-trigger interval.
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  src: pointer to data
+  * @param  srcSize: size in bytes, never across a timestamp
+  * @retval 1 if data have been kept in the history, 0 if they have to be written on SD card
+  */
+static uint8_t SDM_Event_Gate(uint8_t sID, uint8_t ssID, uint8_t *src, uint16_t srcSize)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t seq = HSD_TRIGGER_Get_Sequence();
+  uint32_t ringSize = pSubSensorContext->event_ring_size;
+  uint32_t size = srcSize;
+  uint32_t pos;
+  uint32_t span;
+
+  if (pSubSensorContext->event_live)
+  {
+    if (pSubSensorContext->event_live_bytes != 0 || seq != pSubSensorContext->event_seq
+        || HSD_TRIGGER_Is_Recording(pSubSensorContext->batch_time_stamp))
+    {
+      pSubSensorContext->event_seq = seq;
+      pSubSensorContext->event_live_bytes = (pSubSensorContext->event_live_bytes + size)
+                                            % pSubSensorContext->event_period;
+      return 0;
+    }
+    pSubSensorContext->event_live = 0;
+    pSubSensorContext->event_ring_bytes = 0;
+  }
+  else if (seq != pSubSensorContext->event_seq)
+  {
+    pSubSensorContext->event_seq = seq;
+    SDM_Event_Start(sID, ssID);
+    pSubSensorContext->event_live_bytes = (pSubSensorContext->event_live_bytes + size)
+                                          % pSubSensorContext->event_period;
+    return 0;
+  }
+
+  /* only the latest ringSize bytes are kept */
+  if (size > ringSize)
+  {
+    src += size - ringSize;
+    pSubSensorContext->event_ring_bytes += size - ringSize;
+    size = ringSize;
+  }
+  pos = pSubSensorContext->event_ring_bytes % ringSize;
+  pSubSensorContext->event_ring_bytes += size;
+  while (size > 0)
+  {
+    span = HSD_MIN(size, ringSize - pos);
+    HSD_memcpy(&pSubSensorContext->event_ring[pos], src, span);
+    src += span;
+    size -= span;
+    pos = 0;
+  }
+  /* keep the count bounded, modulo the ring size */
+  if (pSubSensorContext->event_ring_bytes >= 2U * ringSize)
+  {
+    pSubSensorContext->event_ring_bytes = ringSize + pSubSensorContext->event_ring_bytes % ringSize;
+  }
+  return 1;
+}
+
+/**
+  * @brief  Reserve a contiguous slot at the write position of the SD buffer,
+  *         so that data can be produced in place without an intermediate copy
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  nBytes: [in] requested size, [out] granted size (clipped at the end of the current block)
+  * @retval pointer to the reserved slot, NULL if the arena is exhausted
+  */
+uint8_t *SDM_Reserve(uint8_t sID, uint8_t ssID, uint32_t *nBytes)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t span;
+
+  if (pSubSensorContext->sd_write_buffer == NULL)
+  {
+    if (SDM_Open_Block(sID, ssID, SDM_Arena_Alloc(), 0))
+    {
+      *nBytes = 0;
+      return NULL;
+    }
+  }
+
+  span = pSubSensorContext->sd_block_data_size - pSubSensorContext->sd_write_buffer_idx;
+  if (*nBytes > span)
+  {
+    *nBytes = span;
+  }
+  return &pSubSensorContext->sd_write_buffer[pSubSensorContext->sd_write_buffer_idx];
+}
+
+/**
+  * @brief  Commit data written in a slot obtained with SDM_Reserve
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  nBytes: number of bytes written in the slot
+  * @retval 0: ok
+  */
+uint8_t SDM_Commit(uint8_t sID, uint8_t ssID, uint32_t nBytes)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+
+  pSubSensorContext->sd_write_buffer_idx += nBytes;
+  if (pSubSensorContext->sd_write_buffer_idx >= pSubSensorContext->sd_block_data_size)
+  {
+    SDM_Commit_Block(sID, ssID);
+  }
+  return 0;
+}
+
+/**
+  * @brief  Start filling a new arena block for a subsensor
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  block: block taken from the free list
+  * @param  batchOffset: offset in bytes, in the current sensor batch, of the first data of the block
+  * @retval 0: ok, 1: no block available (overrun counted by the caller)
+  */
+static uint8_t SDM_Open_Block(uint8_t sID, uint8_t ssID, uint32_t block, uint32_t batchOffset)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  SDM_ArenaBlock_t *pBlock;
+
+  if (block == SDM_ARENA_NULL_BLOCK)
+  {
+    return 1;
+  }
+
+  pBlock = &SDM_ArenaBlock[block];
+  pBlock->sID = sID;
+  pBlock->ssID = ssID;
+  pBlock->seq = pSubSensorContext->sd_commit_seg;
+  /* data in the block should not wait more than SDM_MAX_WRITE_TIME seconds */
+  pBlock->deadline = osKernelSysTick() + pdMS_TO_TICKS(SDM_MAX_WRITE_TIME * 1000U);
+
+#if (SDM_CONTAINER_MODE == 1)
+  SDM_ChunkHeader_t *pHeader = (SDM_ChunkHeader_t *) &SDM_Arena[block * SDM_ArenaBlockSize];
+  pHeader->magic = SDM_CHUNK_MAGIC;
+  pHeader->sID = sID;
+  pHeader->ssID = ssID;
+  pHeader->headerSize = sizeof(SDM_ChunkHeader_t);
+  pHeader->length = 0;
+  /* all the previous blocks of the stream are full */
+  pHeader->firstSample = SDM_Stream_Sample_Index(sID, ssID, pBlock->seq * SDM_BlockDataSize);
+  pHeader->timeStamp = pSubSensorContext->old_time_stamp;
+  (void) batchOffset;
+#elif (HSD_COMPACT_TIMESTAMPS == 1)
+  SDM_CompactHeader_t *pHeader = (SDM_CompactHeader_t *) &SDM_Arena[block * SDM_ArenaBlockSize];
+  pHeader->tickDelta = SDM_Chunk_Ticks(sID, ssID, batchOffset);
+  pHeader->nSamples = 0;
+#else
+  (void) batchOffset;
+#endif /* (SDM_CONTAINER_MODE == 1) */
+
+  pSubSensorContext->sd_write_buffer = &SDM_Arena[block * SDM_ArenaBlockSize + SDM_BlockDataOffset];
+  pSubSensorContext->sd_write_buffer_idx = 0;
   return 0;
 }
 
+/**
+  * @brief  Hand the full block of a subsensor to the SD task
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @retval None
+  */
+static void SDM_Commit_Block(uint8_t sID, uint8_t ssID)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  uint32_t block = (pSubSensorContext->sd_write_buffer - SDM_BlockDataOffset - SDM_Arena) / SDM_ArenaBlockSize;
+
+  pSubSensorContext->sd_write_buffer = NULL;
+  pSubSensorContext->sd_write_buffer_idx = 0;
+  pSubSensorContext->sd_commit_seg++;
+  __DMB();
+  SDM_ArenaBlock[block].ready = 1;
+
+  /* blocks of the subsensor waiting for the SD task */
+  if (pSubSensorContext->sd_commit_seg - pSubSensorContext->sd_write_seg > pSubSensorContext->sd_ring_hwm)
+  {
+    pSubSensorContext->sd_ring_hwm = pSubSensorContext->sd_commit_seg - pSubSensorContext->sd_write_seg;
+  }
+
+  /* unlock write task. If the queue is full the block is written with the next message */
+  osMessagePut(sdThreadQueue_id, sID | ssID << 8 | SDM_DATA_READY_MASK, 0);
+}
+
+/**
+  * @brief  Track the peak depth of the SD task queue, including the message just received
+  * @param  None
+  * @retval None
+  */
+static void SDM_UpdateQueuePeak(void)
+{
+  COM_SDStats_t *pStats = COM_GetSDStats();
+  uint32_t depth = osMessageWaiting(sdThreadQueue_id) + 1U;
+
+  if (depth > pStats->queuePeak)
+  {
+    pStats->queuePeak = depth;
+  }
+}
+
+#if (HSD_COMPACT_TIMESTAMPS == 1)
+/**
+  * @brief  Time of a sample of the current sensor batch, from the clock model of the subsensor
+  *         or, until it is locked, back-computed from the timestamp of the latest sample of the
+  *         batch and the measured ODR
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  batchOffset: offset in bytes of the sample in the batch
+  * @retval time since the acquisition start, in 2^HSD_COMPACT_TS_SHIFT TIM5 ticks (wraps around)
+  */
+static uint32_t SDM_Chunk_Ticks(uint8_t sID, uint8_t ssID, uint32_t batchOffset)
+{
+  COM_SubSensorContext_t *pSubSensorContext = COM_GetSubSensorContext(sID, ssID);
+  float measuredODR = COM_GetSubSensorStatus(sID, ssID)->measuredODR;
+  uint32_t first = batchOffset / COM_GetnBytesPerSample(sID, ssID);
+  uint32_t samplesAfter = 0;
+  uint64_t ticks;
+  uint64_t back;
+
+  if (pSubSensorContext->batch_samples_left > first)
+  {
+    samplesAfter = pSubSensorContext->batch_samples_left - first - 1U;
+  }
+  if (HSD_CLOCKFIT_Is_Locked(&pSubSensorContext->clock_fit))
+  {
+    HSD_TimeStamp_t timeStamp = HSD_CLOCKFIT_Map(&pSubSensorContext->clock_fit,
+                                                 pSubSensorContext->n_samples_total - samplesAfter);
+#if (HSD_TIMESTAMP_TICKS == 1)
+    return (uint32_t)(timeStamp >> HSD_COMPACT_TS_SHIFT);
+#else
+    return (uint32_t)((uint64_t)(timeStamp * (double) SystemCoreClock) >> HSD_COMPACT_TS_SHIFT);
+#endif /* HSD_TIMESTAMP_TICKS */
+  }
+
+#if (HSD_TIMESTAMP_TICKS == 1)
+  ticks = pSubSensorContext->batch_time_stamp;
+#else
+  ticks = (uint64_t)(pSubSensorContext->batch_time_stamp * (double) SystemCoreClock);
+#endif /* HSD_TIMESTAMP_TICKS */
+  if (measuredODR > 0.0f)
+  {
+    back = (uint64_t)((float) samplesAfter * (float) SystemCoreClock / measuredODR);
+    ticks = (back < ticks) ? (ticks - back) : 0;
+  }
+  return (uint32_t)(ticks >> HSD_COMPACT_TS_SHIFT);
+}
+#endif /* (HSD_COMPACT_TIMESTAMPS == 1) */
+
+#if (SDM_CONTAINER_MODE == 1)
+/**
+  * @brief  Index of the sample found at a byte offset of a subsensor stream, taking into
+  *         account the timestamps inserted every samplesPerTimestamp samples
+  * @param  sID: sensor id
+  * @param  ssID: subsensor id
+  * @param  streamByte: byte offset in the stream
+  * @retval sample index
+  */
+static uint32_t SDM_Stream_Sample_Index(uint8_t sID, uint8_t ssID, uint32_t streamByte)
+{
+  uint32_t nBytesPerSample = COM_GetnBytesPerSample(sID, ssID);
+  uint32_t spts = COM_GetSubSensorStatus(sID, ssID)->samplesPerTimestamp;
+  uint32_t period;
+  uint32_t inPeriod;
+
+  if (nBytesPerSample == 0)
+  {
+    return 0;
+  }
+  if (spts == 0)
+  {
+    return streamByte / nBytesPerSample;
+  }
+
+  period = spts * nBytesPerSample + 8U;
+  inPeriod = HSD_MIN((streamByte % period) / nBytesPerSample, spts);
+  return (streamByte / period) * spts + inPeriod;
+}
+#endif /* (SDM_CONTAINER_MODE == 1) */
+
 /**
   * @brief  Read and parse Json string and update device model
   * @param  serialized_string: pointer to Json string
@@ -1462,7 +2358,7 @@ uint32_t SDM_CreateAcquisitionJSON(char **serialized_string)
   uint32_t size;
 
   acquisition = COM_GetAcquisitionDescriptor();
-  size = HSD_JSON_serialize_Acquisition(acquisition, serialized_string, PRETTY_JSON);
+  size = HSD_JSON_serialize_AcquisitionInfo(acquisition, COM_GetSDStats(), serialized_string, PRETTY_JSON);
 
   return size;
 }
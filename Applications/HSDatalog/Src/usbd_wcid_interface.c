@@ -298,6 +298,7 @@ static uint32_t WCID_STREAMING_Itf_StartStreaming(void)
   com_status = HS_DATALOG_USB_STARTED;
   pDeviceDescriptor = COM_GetDeviceDescriptor();
   COM_GenerateAcquisitionUUID();
+  COM_ResetBusStats();
   SM_TIM_Start();
 
   osTimerStop(bleAdvUpdaterTim_id);
@@ -438,7 +439,8 @@ static uint32_t WCID_STREAMING_Itf_SerializeRequest(COM_Command_t command, char
       else
       {
         pSubSensorStatus = COM_GetSubSensorStatus(command.sensorId, command.subSensorId);
-        *size = HSD_JSON_serialize_SubSensorStatus(pSubSensorStatus, serialized_json);
+        *size = HSD_JSON_serialize_SubSensorStatus(command.sensorId, command.subSensorId, pSubSensorStatus,
+                                                   serialized_json);
       }
       break;
     }
@@ -598,7 +600,7 @@ void WCID_CalculateUsbWriteBufferSize(COM_SubSensorStatus_t *pSubSensorStatus, u
   if (pSubSensorStatus->ODR != 0)
   {
     /* 500ms of sensor data; when there's a timestamp packets will be sent fastly */
-    bufferSize = (uint32_t)(pSubSensorStatus->ODR * nBytesPerSample * 0.5f);
+    bufferSize = (uint32_t)(COM_GetEffectiveODR(pSubSensorStatus) * nBytesPerSample * 0.5f);
 
     if (bufferSize > 4096)
     {
@@ -619,7 +621,7 @@ void WCID_CalculateUsbWriteBufferSize(COM_SubSensorStatus_t *pSubSensorStatus, u
   /* check samplesPerTimestamp is valid (set SDM_MAX_WRITE_TIME seconds of data or clip to 1000) */
   if (pSubSensorStatus->samplesPerTimestamp != 0)
   {
-    uint32_t samplesPerTS = (uint32_t)(pSubSensorStatus->ODR);
+    uint32_t samplesPerTS = (uint32_t)(COM_GetEffectiveODR(pSubSensorStatus));
     if (samplesPerTS > MAX_SPTS)
     {
       pSubSensorStatus->samplesPerTimestamp = MAX_SPTS;
@@ -0,0 +1,49 @@
+/**
+  ******************************************************************************
+  * @file    sdm_compact_reader.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host reader of the "HSD_2.0.0" data files (HSD_COMPACT_TIMESTAMPS == 1)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SDM_COMPACT_READER_H
+#define __SDM_COMPACT_READER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#include "stdio.h"
+#include "sdcard_manager.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* A chunk of the file, with the wrap-arounds of tickDelta added */
+typedef struct
+{
+  uint64_t ticks;         /* time of the first sample, in chunkTimestampFrequency ticks */
+  uint64_t firstSample;   /* index in the file of the first sample of the chunk */
+  uint32_t nSamples;      /* number of samples in the chunk */
+} SDM_CompactChunk_t;
+
+/* Called for every chunk, in file order, with its samples and their time in seconds */
+typedef int32_t (*SDM_Compact_Sink_t)(void *ctx, const SDM_CompactChunk_t *chunk, const uint8_t *samples,
+                                      const double *timeStamps);
+
+/* Exported functions ------------------------------------------------------- */
+int32_t SDM_Compact_Read(FILE *f, uint32_t nBytesPerSample, double tickFrequency, SDM_Compact_Sink_t sink,
+                         void *ctx);
+double SDM_Compact_Sample_Period(const SDM_CompactChunk_t *chunk, const SDM_CompactChunk_t *next);
+
+#endif /* __SDM_COMPACT_READER_H */
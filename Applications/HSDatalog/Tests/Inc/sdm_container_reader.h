@@ -0,0 +1,40 @@
+/**
+  ******************************************************************************
+  * @file    sdm_container_reader.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host reader of the SD container file (SDM_CONTAINER_MODE == 1)
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __SDM_CONTAINER_READER_H
+#define __SDM_CONTAINER_READER_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#include "stdio.h"
+#include "sdcard_manager.h"
+
+/* Exported types ------------------------------------------------------------*/
+/* Called for every chunk, in file order, with the valid part of its payload */
+typedef int32_t (*SDM_Reader_Sink_t)(void *ctx, const SDM_ChunkHeader_t *header, const uint8_t *payload);
+
+/* Exported functions ------------------------------------------------------- */
+uint32_t SDM_Container_Chunk_Size(FILE *f);
+int32_t SDM_Container_Read(FILE *f, uint32_t chunkSize, SDM_Reader_Sink_t sink, void *ctx);
+uint32_t SDM_Container_Sample_Index(uint32_t streamByte, uint32_t nBytesPerSample, uint32_t samplesPerTs);
+
+#endif /* __SDM_CONTAINER_READER_H */
@@ -0,0 +1,112 @@
+/**
+  ******************************************************************************
+  * @file    test_utils.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Check macros and cycle counter shared by the host tests
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __TEST_UTILS_H
+#define __TEST_UTILS_H
+
+/* Includes ------------------------------------------------------------------*/
+#include "stdint.h"
+#include "stdio.h"
+#include "stdlib.h"
+#include "time.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include "x86intrin.h"
+#endif
+
+/* Exported variables --------------------------------------------------------*/
+static int test_failures = 0;
+
+/* Exported macro ------------------------------------------------------------*/
+/* Record a failure and keep going, so that one run reports every broken case */
+#define TEST_CHECK(cond)                                                         \
+  do                                                                             \
+  {                                                                              \
+    if (!(cond))                                                                 \
+    {                                                                            \
+      printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);            \
+      test_failures++;                                                           \
+    }                                                                            \
+  } while (0)
+
+/* Process exit status of a test */
+#define TEST_RESULT()   ((test_failures == 0) ? EXIT_SUCCESS : EXIT_FAILURE)
+
+/* Exported functions ------------------------------------------------------- */
+/**
+  * @brief  Read a free running counter: TSC cycles on x86, nanoseconds elsewhere
+  * @param  None
+  * @retval counter value
+  */
+static inline uint64_t TEST_Cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/**
+  * @brief  Unit printed next to TEST_Cycles() figures
+  * @param  None
+  * @retval unit name
+  */
+static inline const char *TEST_Cycles_Unit(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return "cycles";
+#else
+  return "ns";
+#endif
+}
+
+/**
+  * @brief  Benchmark repeat factor from the command line (1 when ctest runs it)
+  * @param  argc: argument count
+  * @param  argv: arguments
+  * @param  def: value used when no argument is given
+  * @retval repeat factor, at least 1
+  */
+static inline uint32_t TEST_Repeat(int argc, char **argv, uint32_t def)
+{
+  uint32_t r = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : def;
+  return (r == 0U) ? 1U : r;
+}
+
+/**
+  * @brief  Simple deterministic pseudo random generator (xorshift32)
+  * @param  state: generator state, must not be 0
+  * @retval next value
+  */
+static inline uint32_t TEST_Rand(uint32_t *state)
+{
+  uint32_t x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+#endif /* __TEST_UTILS_H */
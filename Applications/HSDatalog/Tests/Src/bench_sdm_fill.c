@@ -0,0 +1,174 @@
+/**
+  ******************************************************************************
+  * @file    bench_sdm_fill.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host benchmark of the SD buffer fill paths: the former byte loop
+  *          against the two span copy used by SDM_Fill_Buffer()
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSDCoreConfig.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Ring of two 8 KiB halves, the size of one SD arena block */
+#define RING_SIZE       (2U * 8192U)
+#define MAX_CHUNK       3072U
+#define BYTES_PER_RUN   (4U * 1024U * 1024U)
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t ring_old[RING_SIZE];
+static uint8_t ring_new[RING_SIZE];
+static uint8_t src[MAX_CHUNK];
+
+static const uint32_t chunk_sizes[] = {6, 12, 14, 24, 96, 192, 384, 768, 1536, 2048, 3072};
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Former fill path: byte per byte copy, wrap checked after each byte
+  * @param  dst: ring buffer
+  * @param  dstSize: ring size
+  * @param  dstP: write index
+  * @param  src: data to copy
+  * @param  srcSize: number of bytes
+  * @retval new write index
+  */
+static __attribute__((noinline)) uint32_t Fill_Old(uint8_t *dst, uint32_t dstSize, uint32_t dstP,
+                                                   const uint8_t *src, uint32_t srcSize)
+{
+  uint32_t srcP = 0;
+
+  while (srcP < srcSize)
+  {
+    dst[dstP] = src[srcP];
+    dstP++;
+    srcP++;
+    if (dstP >= dstSize)
+    {
+      dstP = 0;
+    }
+  }
+  return dstP;
+}
+
+/**
+  * @brief  Current fill path: at most two contiguous spans, split at the wrap point
+  * @param  dst: ring buffer
+  * @param  dstSize: ring size
+  * @param  dstP: write index
+  * @param  src: data to copy
+  * @param  srcSize: number of bytes
+  * @retval new write index
+  */
+static __attribute__((noinline)) uint32_t Fill_New(uint8_t *dst, uint32_t dstSize, uint32_t dstP,
+                                                   const uint8_t *src, uint32_t srcSize)
+{
+  uint32_t span = dstSize - dstP;
+
+  if (srcSize < span)
+  {
+    span = srcSize;
+  }
+  HSD_memcpy(&dst[dstP], src, span);
+  dstP += span;
+  if (dstP >= dstSize)
+  {
+    dstP = srcSize - span;
+    HSD_memcpy(dst, &src[span], dstP);
+  }
+  return dstP;
+}
+
+/**
+  * @brief  Time one fill path over BYTES_PER_RUN bytes in chunks of a given size
+  * @param  fill: fill path
+  * @param  ring: destination ring
+  * @param  chunk: chunk size in bytes
+  * @param  repeat: number of runs, the fastest one is kept
+  * @retval bytes per cycle (or per ns)
+  */
+static double Bench(uint32_t (*fill)(uint8_t *, uint32_t, uint32_t, const uint8_t *, uint32_t), uint8_t *ring,
+                    uint32_t chunk, uint32_t repeat)
+{
+  uint64_t best = UINT64_MAX;
+  uint32_t nChunks = BYTES_PER_RUN / chunk;
+
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint32_t idx = 0;
+    uint64_t t0 = TEST_Cycles();
+    for (uint32_t i = 0; i < nChunks; i++)
+    {
+      idx = fill(ring, RING_SIZE, idx, src, chunk);
+    }
+    uint64_t t = TEST_Cycles() - t0;
+    if (t < best)
+    {
+      best = t;
+    }
+  }
+  return (double)nChunks * chunk / (double)best;
+}
+
+/**
+  * @brief  Both paths must leave the same ring content and index, wrap included
+  * @param  None
+  * @retval None
+  */
+static void Check_Equivalence(void)
+{
+  uint32_t seed = 0x1234567U;
+  uint32_t idxOld = 0;
+  uint32_t idxNew = 0;
+
+  memset(ring_old, 0, sizeof(ring_old));
+  memset(ring_new, 0, sizeof(ring_new));
+  for (uint32_t i = 0; i < 20000U; i++)
+  {
+    uint32_t n = 1U + TEST_Rand(&seed) % MAX_CHUNK;
+    for (uint32_t j = 0; j < n; j++)
+    {
+      src[j] = (uint8_t)TEST_Rand(&seed);
+    }
+    idxOld = Fill_Old(ring_old, RING_SIZE, idxOld, src, n);
+    idxNew = Fill_New(ring_new, RING_SIZE, idxNew, src, n);
+    TEST_CHECK(idxOld == idxNew);
+  }
+  TEST_CHECK(memcmp(ring_old, ring_new, RING_SIZE) == 0);
+
+  /* chunk ending exactly on the wrap point */
+  idxNew = Fill_New(ring_new, RING_SIZE, RING_SIZE - 16U, src, 16U);
+  TEST_CHECK(idxNew == 0U);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 50);
+
+  Check_Equivalence();
+
+  printf("SD buffer fill, bytes/%s (best of %u runs)\n", TEST_Cycles_Unit(), repeat);
+  printf("%8s %10s %10s %8s\n", "chunk", "old", "new", "speedup");
+  for (uint32_t i = 0; i < sizeof(chunk_sizes) / sizeof(chunk_sizes[0]); i++)
+  {
+    double bOld = Bench(Fill_Old, ring_old, chunk_sizes[i], repeat);
+    double bNew = Bench(Fill_New, ring_new, chunk_sizes[i], repeat);
+    printf("%8u %10.3f %10.3f %7.1fx\n", chunk_sizes[i], bOld, bNew, bNew / bOld);
+  }
+  return TEST_RESULT();
+}
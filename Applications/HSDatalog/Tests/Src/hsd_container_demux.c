@@ -0,0 +1,106 @@
+/**
+  ******************************************************************************
+  * @file    hsd_container_demux.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Split an SD container file into one .dat stream per subsensor:
+  *          hsd_container_demux HSD_Container.dat <output folder>
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sdm_container_reader.h"
+#include "stdlib.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_SENSORS     256U
+#define MAX_SUBSENSORS  8U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *outDir;
+  FILE *out[MAX_SENSORS][MAX_SUBSENSORS];
+  uint32_t nChunks[MAX_SENSORS][MAX_SUBSENSORS];
+} Demux_t;
+
+/* Private functions ---------------------------------------------------------*/
+static int32_t Demux_Sink(void *ctx, const SDM_ChunkHeader_t *header, const uint8_t *payload)
+{
+  Demux_t *d = (Demux_t *) ctx;
+  FILE **out;
+  char name[512];
+
+  if (header->ssID >= MAX_SUBSENSORS)
+  {
+    return -1;
+  }
+  out = &d->out[header->sID][header->ssID];
+  if (*out == NULL)
+  {
+    snprintf(name, sizeof(name), "%s/stream_%u_%u.dat", d->outDir, header->sID, header->ssID);
+    *out = fopen(name, "wb");
+    if (*out == NULL)
+    {
+      return -1;
+    }
+  }
+  d->nChunks[header->sID][header->ssID]++;
+  return (fwrite(payload, 1, header->length, *out) == header->length) ? 0 : -1;
+}
+
+int main(int argc, char **argv)
+{
+  static Demux_t d;
+  uint32_t chunkSize;
+  int32_t n;
+  FILE *f;
+
+  if (argc != 3)
+  {
+    fprintf(stderr, "usage: %s HSD_Container.dat <output folder>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  f = fopen(argv[1], "rb");
+  if (f == NULL)
+  {
+    perror(argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  d.outDir = argv[2];
+  chunkSize = SDM_Container_Chunk_Size(f);
+  n = SDM_Container_Read(f, chunkSize, Demux_Sink, &d);
+  fclose(f);
+
+  for (uint32_t s = 0; s < MAX_SENSORS; s++)
+  {
+    for (uint32_t ss = 0; ss < MAX_SUBSENSORS; ss++)
+    {
+      if (d.out[s][ss] != NULL)
+      {
+        printf("stream %u.%u: %u chunks\n", s, ss, d.nChunks[s][ss]);
+        fclose(d.out[s][ss]);
+      }
+    }
+  }
+  if (n < 0)
+  {
+    fprintf(stderr, "%s: malformed container (chunk size %u)\n", argv[1], chunkSize);
+    return EXIT_FAILURE;
+  }
+  printf("%d chunks of %u bytes\n", n, chunkSize);
+  return EXIT_SUCCESS;
+}
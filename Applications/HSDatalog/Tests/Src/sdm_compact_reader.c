@@ -0,0 +1,158 @@
+/**
+  ******************************************************************************
+  * @file    sdm_compact_reader.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host reader of the "HSD_2.0.0" data files (HSD_COMPACT_TIMESTAMPS == 1).
+  *          A file is a sequence of chunks of one subsensor: a SDM_CompactHeader_t
+  *          followed by nSamples contiguous samples. The time of each sample is
+  *          rebuilt from the tickDelta of its chunk and of the next one.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sdm_compact_reader.h"
+#include "stdlib.h"
+#include "string.h"
+
+/* Private define ------------------------------------------------------------*/
+/* A chunk is the payload of one arena block, at most 64 KiB in the firmware */
+#define SDM_READER_MAX_CHUNK    65536U
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Read the header of the next chunk
+  * @param  f: data file
+  * @param  chunk: chunk to fill
+  * @param  prev: previous chunk of the file, NULL for the first one
+  * @param  nBytesPerSample: sample size
+  * @retval 1 if a chunk was read, 0 at the end of the file, -1 for a malformed or truncated header
+  */
+static int32_t SDM_Compact_Next(FILE *f, SDM_CompactChunk_t *chunk, const SDM_CompactChunk_t *prev,
+                                uint32_t nBytesPerSample)
+{
+  SDM_CompactHeader_t h;
+  size_t n = fread(&h, 1, sizeof(h), f);
+
+  if (n == 0U && feof(f))
+  {
+    return 0;
+  }
+  if (n != sizeof(h) || h.nSamples > SDM_READER_MAX_CHUNK / nBytesPerSample)
+  {
+    return -1;
+  }
+
+  chunk->nSamples = h.nSamples;
+  if (prev == NULL)
+  {
+    chunk->ticks = h.tickDelta;
+    chunk->firstSample = 0;
+  }
+  else
+  {
+    /* tickDelta wraps around every 2^32 ticks; a small step back (time of the first chunks
+     * back-computed before the clock model of the subsensor locks) is not a wrap-around */
+    chunk->ticks = prev->ticks + (int64_t)(int32_t)(h.tickDelta - (uint32_t) prev->ticks);
+    chunk->firstSample = prev->firstSample + prev->nSamples;
+  }
+  return 1;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Sample period of a chunk, from its time and the time of the next chunk
+  * @param  chunk: chunk
+  * @param  next: next chunk of the file
+  * @retval period in ticks, 0 if it cannot be known
+  */
+double SDM_Compact_Sample_Period(const SDM_CompactChunk_t *chunk, const SDM_CompactChunk_t *next)
+{
+  if (chunk->nSamples == 0U || next->ticks <= chunk->ticks)
+  {
+    return 0.0;
+  }
+  return (double)(next->ticks - chunk->ticks) / (double) chunk->nSamples;
+}
+
+/**
+  * @brief  Read every chunk of a data file and pass it to a sink with the time of its samples.
+  *         The samples of a chunk are evenly spaced up to the first sample of the next chunk;
+  *         the last chunk of the file keeps the sample period of the previous one.
+  * @param  f: data file, read from the current position
+  * @param  nBytesPerSample: sample size, from DeviceConfig.json
+  * @param  tickFrequency: "chunkTimestampFrequency" from DeviceConfig.json
+  * @param  sink: chunk consumer; a non-zero return stops the reading
+  * @param  ctx: sink context
+  * @retval number of chunks read, -1 for a malformed or truncated chunk or a sink error
+  */
+int32_t SDM_Compact_Read(FILE *f, uint32_t nBytesPerSample, double tickFrequency, SDM_Compact_Sink_t sink,
+                         void *ctx)
+{
+  SDM_CompactChunk_t chunk;
+  SDM_CompactChunk_t next;
+  uint8_t *samples;
+  double *timeStamps;
+  double period = 0.0;
+  int32_t nChunks = 0;
+  int32_t more;
+
+  if (nBytesPerSample == 0U || nBytesPerSample > SDM_READER_MAX_CHUNK || tickFrequency <= 0.0)
+  {
+    return -1;
+  }
+  samples = malloc(SDM_READER_MAX_CHUNK);
+  timeStamps = malloc((SDM_READER_MAX_CHUNK / nBytesPerSample) * sizeof(double));
+  if (samples == NULL || timeStamps == NULL)
+  {
+    free(samples);
+    free(timeStamps);
+    return -1;
+  }
+
+  more = SDM_Compact_Next(f, &chunk, NULL, nBytesPerSample);
+  while (more == 1)
+  {
+    if (fread(samples, nBytesPerSample, chunk.nSamples, f) != chunk.nSamples)
+    {
+      more = -1;
+      break;
+    }
+    more = SDM_Compact_Next(f, &next, &chunk, nBytesPerSample);
+    if (more < 0)
+    {
+      break;
+    }
+    if (more == 1 && SDM_Compact_Sample_Period(&chunk, &next) > 0.0)
+    {
+      period = SDM_Compact_Sample_Period(&chunk, &next);
+    }
+    for (uint32_t i = 0; i < chunk.nSamples; i++)
+    {
+      timeStamps[i] = ((double) chunk.ticks + (double) i * period) / tickFrequency;
+    }
+    if (sink(ctx, &chunk, samples, timeStamps) != 0)
+    {
+      more = -1;
+      break;
+    }
+    nChunks++;
+    chunk = next;
+  }
+
+  free(samples);
+  free(timeStamps);
+  return (more < 0) ? -1 : nChunks;
+}
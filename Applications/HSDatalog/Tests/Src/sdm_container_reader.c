@@ -0,0 +1,160 @@
+/**
+  ******************************************************************************
+  * @file    sdm_container_reader.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host reader of the SD container file (SDM_CONTAINER_MODE == 1).
+  *          The file is a sequence of chunks of one arena block each: a
+  *          SDM_ChunkHeader_t, the payload and padding up to the block size.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sdm_container_reader.h"
+#include "stdlib.h"
+#include "string.h"
+
+/* Private define ------------------------------------------------------------*/
+/* Arena blocks are whole clusters: 512 B sectors, at most 64 KiB in the firmware */
+#define SDM_READER_SECTOR       512U
+#define SDM_READER_MAX_CHUNK    65536U
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Check a chunk header
+  * @param  h: header
+  * @param  chunkSize: chunk size, 0 if not known yet
+  * @retval 1 if valid, else 0
+  */
+static int32_t SDM_Container_Header_Valid(const SDM_ChunkHeader_t *h, uint32_t chunkSize)
+{
+  if (h->magic != SDM_CHUNK_MAGIC || h->headerSize != sizeof(SDM_ChunkHeader_t))
+  {
+    return 0;
+  }
+  if (chunkSize != 0U && h->length > chunkSize - h->headerSize)
+  {
+    return 0;
+  }
+  return 1;
+}
+
+/* Exported functions --------------------------------------------------------*/
+/**
+  * @brief  Find the chunk size of a container file: the offset of the second chunk header.
+  *         The file position is left at the start of the file.
+  * @param  f: container file
+  * @retval chunk size in bytes, 0 if the file does not start with a chunk header.
+  *         A file with a single chunk returns its size.
+  */
+uint32_t SDM_Container_Chunk_Size(FILE *f)
+{
+  SDM_ChunkHeader_t h;
+  uint32_t offset;
+  uint32_t size = 0;
+
+  if (fseek(f, 0, SEEK_SET) != 0 || fread(&h, sizeof(h), 1, f) != 1 || !SDM_Container_Header_Valid(&h, 0))
+  {
+    (void) fseek(f, 0, SEEK_SET);
+    return 0;
+  }
+
+  for (offset = SDM_READER_SECTOR; offset <= SDM_READER_MAX_CHUNK; offset += SDM_READER_SECTOR)
+  {
+    if (fseek(f, (long) offset, SEEK_SET) != 0 || fread(&h, sizeof(h), 1, f) != 1)
+    {
+      /* end of file: single chunk */
+      size = offset;
+      break;
+    }
+    if (SDM_Container_Header_Valid(&h, offset))
+    {
+      size = offset;
+      break;
+    }
+  }
+  (void) fseek(f, 0, SEEK_SET);
+  return size;
+}
+
+/**
+  * @brief  Read every chunk of a container file and pass it to a sink
+  * @param  f: container file, read from the current position
+  * @param  chunkSize: chunk size (see SDM_Container_Chunk_Size())
+  * @param  sink: chunk consumer; a non-zero return stops the reading
+  * @param  ctx: sink context
+  * @retval number of chunks read, -1 for a malformed chunk or a sink error
+  */
+int32_t SDM_Container_Read(FILE *f, uint32_t chunkSize, SDM_Reader_Sink_t sink, void *ctx)
+{
+  SDM_ChunkHeader_t h;
+  uint8_t *chunk;
+  int32_t nChunks = 0;
+
+  if (chunkSize <= sizeof(SDM_ChunkHeader_t))
+  {
+    return -1;
+  }
+  chunk = malloc(chunkSize);
+  if (chunk == NULL)
+  {
+    return -1;
+  }
+
+  while (fread(chunk, 1, chunkSize, f) == chunkSize)
+  {
+    memcpy(&h, chunk, sizeof(h));
+    if (!SDM_Container_Header_Valid(&h, chunkSize) || sink(ctx, &h, &chunk[h.headerSize]) != 0)
+    {
+      nChunks = -1;
+      break;
+    }
+    nChunks++;
+  }
+
+  free(chunk);
+  return nChunks;
+}
+
+/**
+  * @brief  Index of the sample at a byte offset of a subsensor stream, as written in the
+  *         firstSample field: the stream holds a timestamp after every samplesPerTs samples
+  * @param  streamByte: byte offset in the stream
+  * @param  nBytesPerSample: sample size
+  * @param  samplesPerTs: samples between timestamps, 0 if there are none
+  * @retval sample index
+  */
+uint32_t SDM_Container_Sample_Index(uint32_t streamByte, uint32_t nBytesPerSample, uint32_t samplesPerTs)
+{
+  uint32_t period;
+  uint32_t inPeriod;
+
+  if (nBytesPerSample == 0U)
+  {
+    return 0;
+  }
+  if (samplesPerTs == 0U)
+  {
+    return streamByte / nBytesPerSample;
+  }
+
+  period = samplesPerTs * nBytesPerSample + sizeof(HSD_TimeStamp_t);
+  inPeriod = (streamByte % period) / nBytesPerSample;
+  if (inPeriod > samplesPerTs)
+  {
+    inPeriod = samplesPerTs;
+  }
+  return (streamByte / period) * samplesPerTs + inPeriod;
+}
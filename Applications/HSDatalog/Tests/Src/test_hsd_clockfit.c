@@ -0,0 +1,172 @@
+/**
+  ******************************************************************************
+  * @file    test_hsd_clockfit.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Clock model of the subsensors (HSD_clockfit.c) against simulated
+  *          sensors: ODR error, IRQ latency, late batches and lost samples,
+  *          over acquisitions of several hours
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_clockfit.h"
+#include "math.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+/* SM_SENSOR_TIMESTAMP_FREQ */
+#if (HSD_TIMESTAMP_TICKS == 1)
+#define TIMEBASE_FREQ   120000000.0
+#else
+#define TIMEBASE_FREQ   1.0
+#endif /* HSD_TIMESTAMP_TICKS */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const char *name;
+  double odr;             /* nominal ODR */
+  double error;           /* relative error of the sensor clock */
+  uint32_t batch;         /* mean batch size [samples] */
+  double latency;         /* mean IRQ latency [s], exponential */
+  uint32_t latePercent;   /* batches served 10x late */
+  double hours;
+  uint64_t lostAt;        /* samples lost at this batch, 0 for none */
+} Sensor_t;
+
+typedef struct
+{
+  double slopeError;      /* relative */
+  double mapError;        /* max |Map(latest sample) - true time| once locked [s] */
+  double offsetError;     /* |Map(0) - true time of sample 0| at the end [s] */
+  double jitter;          /* RMS residual [s] */
+  double latencyStd;      /* standard deviation of the simulated latency [s] */
+  uint32_t nOutliers;
+  uint32_t nLate;
+} Result_t;
+
+/* Private functions ---------------------------------------------------------*/
+static HSD_TimeStamp_t To_Timebase(double t)
+{
+#if (HSD_TIMESTAMP_TICKS == 1)
+  return (HSD_TimeStamp_t)(t * TIMEBASE_FREQ);
+#else
+  return t;
+#endif /* HSD_TIMESTAMP_TICKS */
+}
+
+static double To_Seconds(HSD_TimeStamp_t y)
+{
+  return (double) y / TIMEBASE_FREQ;
+}
+
+/**
+  * @brief  Feed the fit as SENSOR_Generic_Update_ODR does: sample count and timestamp of the
+  *         latest sample of each batch, the first batch giving sample 0
+  */
+static void Run(const Sensor_t *s, Result_t *r, uint32_t seed)
+{
+  HSD_ClockFit_t fit;
+  double period = 1.0 / (s->odr * (1.0 + s->error));
+  double start = 0.7;     /* time of sample 0 */
+  uint64_t total = 0;     /* samples received, as n_samples_total */
+  uint64_t lost = 0;      /* samples missing before the current one */
+  uint64_t nBatches = (uint64_t)(s->hours * 3600.0 * s->odr / s->batch);
+  double sum = 0.0;
+  double sumSquares = 0.0;
+
+  memset(r, 0, sizeof(*r));
+  HSD_CLOCKFIT_Init(&fit, TIMEBASE_FREQ / s->odr);
+  (void) HSD_CLOCKFIT_Add(&fit, 0, To_Timebase(start));
+
+  for (uint64_t b = 1; b <= nBatches; b++)
+  {
+    uint32_t n = s->batch / 2U + TEST_Rand(&seed) % s->batch;
+    double u = ((double)(TEST_Rand(&seed) >> 8) + 0.5) / 16777216.0;
+    double latency = -s->latency * log(u);
+
+    if (TEST_Rand(&seed) % 100U < s->latePercent)
+    {
+      latency *= 10.0;
+      r->nLate++;
+    }
+    sum += latency;
+    sumSquares += latency * latency;
+    if (b == s->lostAt)
+    {
+      lost += 1000U;
+    }
+    total += n;
+    /* the sensor clock is the truth: sample k is taken at start + k * period */
+    double t = start + (double)(total + lost) * period;
+    r->nOutliers += HSD_CLOCKFIT_Add(&fit, total, To_Timebase(t + latency));
+
+    if (HSD_CLOCKFIT_Is_Locked(&fit) && fit.nPairs > (1UL << HSD_CLOCKFIT_SHIFT) && b > s->lostAt + 200U)
+    {
+      double e = fabs(To_Seconds(HSD_CLOCKFIT_Map(&fit, total)) - (t + s->latency));
+      if (e > r->mapError)
+      {
+        r->mapError = e;
+      }
+    }
+  }
+
+  r->slopeError = fabs((double) fit.slope / TIMEBASE_FREQ - period) / period;
+  r->offsetError = fabs(To_Seconds(HSD_CLOCKFIT_Map(&fit, 0)) - (start + (double) lost * period + s->latency));
+  r->jitter = sqrt((double) fit.meanSquareResidual) / TIMEBASE_FREQ;
+  r->latencyStd = sqrt(sumSquares / (double) nBatches - (sum / (double) nBatches) * (sum / (double) nBatches));
+}
+
+static void Test_Sensor(const Sensor_t *s, uint32_t seed)
+{
+  Result_t r;
+
+  Run(s, &r, seed);
+  printf("%-10s %8.0f %6.1f %10.2e %10.2f %10.2f %10.2f %6u %6u\n", s->name, s->odr, s->hours, r.slopeError,
+         r.mapError * 1e6, r.offsetError * 1e6, r.jitter * 1e6, r.nOutliers, r.nLate);
+
+  /* the ODR error of the sensor is found */
+  TEST_CHECK(r.slopeError < 2e-5);
+  /* the latest sample is placed within a few mean latencies: the fit averages the IRQ jitter */
+  TEST_CHECK(r.mapError < 4.0 * s->latency + 2.0 / s->odr);
+  /* the time of sample 0 extrapolated back over hours, from the fitted slope */
+  TEST_CHECK(r.offsetError < 2e-5 * s->hours * 3600.0 + 4.0 * s->latency);
+  /* the residuals are the IRQ latency around its mean */
+  TEST_CHECK(r.jitter > 0.5 * r.latencyStd && r.jitter < 2.0 * r.latencyStd);
+  /* late batches within GAIN * (mean residual + one sample period) are kept, on time ones are never skipped */
+  TEST_CHECK(r.nOutliers <= r.nLate + (s->lostAt != 0U ? HSD_CLOCKFIT_MAX_OUTLIERS : 0U));
+}
+
+int main(void)
+{
+  static const Sensor_t sensors[] =
+  {
+    { "LSM6DSOX", 6667.0, 3e-3, 256, 20e-6, 2, 4.0, 0 },
+    { "IIS3DWB", 26667.0, -1e-3, 512, 10e-6, 2, 4.0, 0 },
+    { "MP23ABS1", 48000.0, 0.0, 1024, 5e-6, 0, 2.0, 0 },
+    { "HTS221", 12.5, 2e-2, 4, 50e-6, 0, 4.0, 0 },
+    { "lost", 6667.0, 1e-3, 256, 20e-6, 2, 1.0, 30000 },
+  };
+
+  printf("%-10s %8s %6s %10s %10s %10s %10s %6s %6s\n", "sensor", "ODR", "hours", "slope err", "map us",
+         "offset us", "jitter us", "outl", "late");
+  for (uint32_t i = 0; i < sizeof(sensors) / sizeof(sensors[0]); i++)
+  {
+    Test_Sensor(&sensors[i], i + 1U);
+  }
+  return TEST_RESULT();
+}
@@ -0,0 +1,244 @@
+/**
+  ******************************************************************************
+  * @file    test_hsd_codec.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Round trip of HSD_codec through a reference decoder, and encoder
+  *          cycles per sample
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_codec.h"
+#include "HSDCoreConfig.h"
+#include "math.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_CHANNELS    3U
+#define BENCH_BLOCKS    4096U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  const uint8_t *p;
+  uint32_t acc;
+  uint32_t n;
+} BitReader_t;
+
+typedef enum
+{
+  SIGNAL_NOISY_SINE,
+  SIGNAL_NOISE,
+  SIGNAL_SQUARE,
+  SIGNAL_FAST_SINE,
+  SIGNAL_RAMP,
+  SIGNAL_COUNT
+} Signal_t;
+
+/* Private variables ---------------------------------------------------------*/
+static int16_t in[HSD_CODEC_MAX_FRAMES * MAX_CHANNELS];
+static int16_t out[HSD_CODEC_MAX_FRAMES * MAX_CHANNELS];
+static uint8_t enc[HSD_CODEC_OUT_SIZE(HSD_CODEC_MAX_FRAMES, MAX_CHANNELS) + 16U];
+
+/* Private functions ---------------------------------------------------------*/
+static uint32_t Get_Bits(BitReader_t *br, uint32_t nBits)
+{
+  uint32_t v;
+
+  while (br->n < nBits)
+  {
+    br->acc |= (uint32_t)(*br->p++) << br->n;
+    br->n += 8U;
+  }
+  v = br->acc & ((1U << nBits) - 1U);
+  br->acc >>= nBits;
+  br->n -= nBits;
+  return v;
+}
+
+/**
+  * @brief  Reference decoder, written from the block layout in HSD_codec.h
+  * @param  src: encoded block
+  * @param  dst: nFrames * nChannels samples
+  * @param  nChannels: number of samples in each frame
+  * @param  nFrames: [out] frames in the block
+  * @retval size of the encoded block
+  */
+static uint32_t Decode(const uint8_t *src, int16_t *dst, uint32_t nChannels, uint32_t *nFrames)
+{
+  uint32_t size = (uint32_t) src[2] | ((uint32_t) src[3] << 8);
+  const uint8_t *pParam = &src[HSD_CODEC_HEADER_SIZE];
+  BitReader_t br = { pParam + nChannels, 0, 0 };
+
+  *nFrames = (uint32_t) src[0] | ((uint32_t) src[1] << 8);
+  if ((size & HSD_CODEC_RAW_FLAG) != 0U)
+  {
+    size &= ~HSD_CODEC_RAW_FLAG;
+    memcpy(dst, pParam, size);
+    return HSD_CODEC_HEADER_SIZE + size;
+  }
+
+  for (uint32_t ch = 0; ch < nChannels; ch++)
+  {
+    uint32_t k = pParam[ch] & 0x1FU;
+    uint32_t order = pParam[ch] >> 5;
+    int32_t a1 = (int32_t) order;
+    int32_t a2 = (order == 2U) ? -1 : 0;
+    int32_t x1 = 0;
+    int32_t x2 = 0;
+    uint32_t i;
+
+    for (i = 0; i < order && i < *nFrames; i++)
+    {
+      x2 = x1;
+      x1 = (int16_t) Get_Bits(&br, 16);
+      dst[i * nChannels + ch] = (int16_t) x1;
+    }
+    for (; i < *nFrames; i++)
+    {
+      uint32_t q = 0;
+      uint32_t u;
+      int32_t e;
+      int32_t v;
+
+      while (q < HSD_CODEC_ESCAPE && Get_Bits(&br, 1) != 0U)
+      {
+        q++;
+      }
+      u = (q < HSD_CODEC_ESCAPE) ? ((q << k) | Get_Bits(&br, k)) : Get_Bits(&br, HSD_CODEC_ESCAPE_BITS);
+      e = (int32_t)(u >> 1) ^ -(int32_t)(u & 1U);
+      v = e + a1 * x1 + a2 * x2;
+      x2 = x1;
+      x1 = v;
+      dst[i * nChannels + ch] = (int16_t) v;
+    }
+    TEST_CHECK(order <= 2U && k <= HSD_CODEC_MAX_K);
+  }
+  return HSD_CODEC_HEADER_SIZE + size;
+}
+
+static void Fill(Signal_t signal, int16_t *x, uint32_t nFrames, uint32_t nChannels, uint32_t *seed)
+{
+  for (uint32_t i = 0; i < nFrames * nChannels; i++)
+  {
+    double ph = (double)(i / nChannels) + 100.0 * (double)(i % nChannels);
+
+    switch (signal)
+    {
+      case SIGNAL_NOISY_SINE:
+        x[i] = (int16_t)(8000.0 * sin(ph * 0.05) + (double)(TEST_Rand(seed) % 64U) - 32.0);
+        break;
+      case SIGNAL_NOISE:
+        x[i] = (int16_t) TEST_Rand(seed);
+        break;
+      case SIGNAL_SQUARE:
+        x[i] = ((i / nChannels) % 2U) ? 32767 : -32768;
+        break;
+      case SIGNAL_FAST_SINE:
+        x[i] = (int16_t)(30000.0 * sin(ph * 0.9));
+        break;
+      default:
+        x[i] = (int16_t)(i * 97U);
+        break;
+    }
+  }
+}
+
+/**
+  * @brief  Random blocks of every signal: the decoder must give back the input exactly,
+  *         and the encoder must stay within HSD_CODEC_OUT_SIZE
+  */
+static void Test_Round_Trip(void)
+{
+  uint32_t seed = 1;
+  uint64_t inBytes = 0;
+  uint64_t outBytes = 0;
+
+  for (uint32_t t = 0; t < 5000U; t++)
+  {
+    Signal_t signal = (Signal_t)(t % SIGNAL_COUNT);
+    uint32_t nChannels = 1U + TEST_Rand(&seed) % MAX_CHANNELS;
+    uint32_t nFrames = 1U + TEST_Rand(&seed) % ((t % 50U == 0U) ? HSD_CODEC_MAX_FRAMES : 512U);
+    uint32_t decFrames = 0;
+    uint32_t n;
+
+    Fill(signal, in, nFrames, nChannels, &seed);
+    memset(enc, 0xEE, sizeof(enc));
+    n = HSD_Codec_Encode(in, nFrames, nChannels, enc);
+    TEST_CHECK(n <= HSD_CODEC_OUT_SIZE(nFrames, nChannels));
+    TEST_CHECK(enc[HSD_CODEC_OUT_SIZE(nFrames, nChannels)] == 0xEE);
+    TEST_CHECK(n <= HSD_CODEC_HEADER_SIZE + 2U * nFrames * nChannels);
+
+    memset(out, 0, sizeof(out));
+    TEST_CHECK(Decode(enc, out, nChannels, &decFrames) == n);
+    TEST_CHECK(decFrames == nFrames);
+    if (memcmp(in, out, 2U * nFrames * nChannels) != 0)
+    {
+      printf("mismatch: signal %d, %u frames, %u channels\n", (int) signal, nFrames, nChannels);
+      test_failures++;
+    }
+    if (signal == SIGNAL_NOISY_SINE)
+    {
+      inBytes += 2U * nFrames * nChannels;
+      outBytes += n;
+    }
+  }
+  printf("noisy sine: %.1f%% of the raw size\n", 100.0 * (double) outBytes / (double) inBytes);
+}
+
+static void Bench(Signal_t signal, const char *name, uint32_t nChannels, uint32_t repeat)
+{
+  uint32_t seed = 5;
+  uint32_t nFrames = HSD_CODEC_BLOCK_FRAMES;
+  uint64_t best = UINT64_MAX;
+  uint64_t outBytes = 0;
+
+  Fill(signal, in, nFrames, nChannels, &seed);
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint64_t t0 = TEST_Cycles();
+    outBytes = 0;
+    for (uint32_t b = 0; b < BENCH_BLOCKS; b++)
+    {
+      outBytes += HSD_Codec_Encode(in, nFrames, nChannels, enc);
+    }
+    uint64_t t = TEST_Cycles() - t0;
+    if (t < best)
+    {
+      best = t;
+    }
+  }
+  printf("%-12s %3u %10.2f %9.1f%%\n", name, nChannels,
+         (double) best / ((double) BENCH_BLOCKS * nFrames * nChannels),
+         100.0 * (double) outBytes / ((double) BENCH_BLOCKS * 2U * nFrames * nChannels));
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 10);
+
+  Test_Round_Trip();
+
+  printf("Encoder, %u frame blocks, %s/sample (best of %u runs)\n", HSD_CODEC_BLOCK_FRAMES, TEST_Cycles_Unit(),
+         repeat);
+  printf("%-12s %3s %10s %10s\n", "signal", "ch", "per sample", "size");
+  Bench(SIGNAL_NOISY_SINE, "noisy sine", 1, repeat);
+  Bench(SIGNAL_NOISY_SINE, "noisy sine", 3, repeat);
+  Bench(SIGNAL_NOISE, "noise", 3, repeat);
+  Bench(SIGNAL_SQUARE, "square", 3, repeat);
+  return TEST_RESULT();
+}
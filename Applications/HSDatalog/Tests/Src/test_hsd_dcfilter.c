@@ -0,0 +1,234 @@
+/**
+  ******************************************************************************
+  * @file    test_hsd_dcfilter.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   HSD_dcfilter block kernel against a bit-exact model of
+  *          y[n] = sat16((a * (x[n] - x[n-1] + y[n-1])) >> 14), and cycles per
+  *          sample against the per-sample division filter it replaced.
+  *          Built twice: plain C, and with the DSP path on emulated intrinsics.
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_dcfilter.h"
+#include "math.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_BLOCK       1024U
+#define BENCH_BLOCK     768U        /* 48 kHz, 16 ms */
+#define BENCH_BLOCKS    2000U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  int64_t lastIn;
+  int64_t lastOut;
+} Model_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* one spare sample in front, to start blocks on odd halfword addresses */
+static int16_t buf[MAX_BLOCK + 2U] __attribute__((aligned(4)));
+static int16_t ref[MAX_BLOCK];
+static int32_t reg32[BENCH_BLOCK];
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  The model, in 64 bits with an explicit floor division by 2^14
+  */
+static int16_t Model_Sample(Model_t *pModel, int16_t x)
+{
+  int64_t v = (int64_t) HSD_DCFILTER_COEFF * ((int64_t) x - pModel->lastIn + pModel->lastOut);
+  int64_t y = (v >= 0) ? (v / 16384) : -((-v + 16383) / 16384);
+
+  y = (y > INT16_MAX) ? INT16_MAX : ((y < INT16_MIN) ? INT16_MIN : y);
+  pModel->lastIn = x;
+  pModel->lastOut = y;
+  return (int16_t) y;
+}
+
+static void Fill(int16_t *x, uint32_t n, uint32_t kind, uint32_t *seed, uint32_t *phase)
+{
+  for (uint32_t i = 0; i < n; i++, (*phase)++)
+  {
+    switch (kind)
+    {
+      case 0:   /* full scale square: saturates the output */
+        x[i] = ((*phase / 37U) & 1U) ? INT16_MAX : INT16_MIN;
+        break;
+      case 1:   /* any value */
+        x[i] = (int16_t) TEST_Rand(seed);
+        break;
+      case 2:   /* tone on a DC offset */
+        x[i] = (int16_t)(3000.0 + 12000.0 * sin(0.01 * (double) *phase) + (double)(TEST_Rand(seed) % 64U));
+        break;
+      default:  /* extremes only */
+        x[i] = (TEST_Rand(seed) & 1U) ? INT16_MAX : ((TEST_Rand(seed) & 1U) ? INT16_MIN : 0);
+        break;
+    }
+  }
+}
+
+/**
+  * @brief  Random block lengths and alignments, the state carried across blocks
+  */
+static void Test_Bit_Exact(void)
+{
+  uint64_t nSamples = 0;
+  uint32_t seed = 11;
+
+  for (uint32_t kind = 0; kind < 4U; kind++)
+  {
+    HSD_DCFilter_t filter;
+    Model_t model = {0, 0};
+    uint32_t phase = 0;
+
+    HSD_DCFILTER_Reset(&filter);
+    for (uint32_t b = 0; b < 4000U; b++)
+    {
+      uint32_t n = TEST_Rand(&seed) % (MAX_BLOCK + 1U);
+      uint32_t offset = TEST_Rand(&seed) & 1U;
+      int16_t *x = &buf[offset];
+
+      Fill(x, n, kind, &seed, &phase);
+      buf[offset + n] = 0x5A5A;
+      for (uint32_t i = 0; i < n; i++)
+      {
+        ref[i] = Model_Sample(&model, x[i]);
+      }
+      HSD_DCFILTER_Process(&filter, x, n);
+      TEST_CHECK(buf[offset + n] == 0x5A5A);
+      if (memcmp(x, ref, n * sizeof(int16_t)) != 0)
+      {
+        printf("mismatch: signal %u, block %u, %u samples, offset %u\n", kind, b, n, offset);
+        test_failures++;
+        return;
+      }
+      TEST_CHECK(filter.lastIn == model.lastIn && filter.lastOut == model.lastOut);
+      nSamples += n;
+    }
+  }
+  printf("bit exact on %llu samples\n", (unsigned long long) nSamples);
+
+  /* the DC component is removed */
+  {
+    HSD_DCFilter_t filter;
+    double mean = 0.0;
+
+    HSD_DCFILTER_Reset(&filter);
+    for (uint32_t b = 0; b < 20U; b++)
+    {
+      for (uint32_t i = 0; i < MAX_BLOCK; i++)
+      {
+        buf[i] = 10000;
+      }
+      HSD_DCFILTER_Process(&filter, buf, MAX_BLOCK);
+    }
+    for (uint32_t i = 0; i < MAX_BLOCK; i++)
+    {
+      mean += buf[i];
+    }
+    TEST_CHECK(fabs(mean / MAX_BLOCK) < 1.0);
+  }
+}
+
+/**
+  * @brief  The filter before HSD_dcfilter: 32-bit DFSDM register, software shift, division by 0xFF
+  */
+static void Old_Process(int16_t *dst, const int32_t *src, uint32_t n, int32_t *oldIn, int32_t *oldOut)
+{
+  for (uint32_t i = 0; i < n; i++)
+  {
+    *dst++ = (int16_t)(*oldOut = (0xFC * (*oldOut + (src[i] >> 12) - *oldIn)) / 0xFF);
+    *oldIn = src[i] >> 12;
+  }
+}
+
+static void Bench(uint32_t repeat)
+{
+  HSD_DCFilter_t filter;
+  uint32_t seed = 5;
+  uint32_t phase = 0;
+  int32_t oldIn = 0;
+  int32_t oldOut = 0;
+  uint64_t best = UINT64_MAX;
+  uint64_t bestOld = UINT64_MAX;
+  int32_t maxDiff = 0;
+  static int16_t src16[BENCH_BLOCK];
+  static int16_t out16[BENCH_BLOCK];
+
+  Fill(src16, BENCH_BLOCK, 2, &seed, &phase);
+  for (uint32_t i = 0; i < BENCH_BLOCK; i++)
+  {
+    /* the old right bit shift was 4 lower: the sample is bits 27..12 of the data register */
+    reg32[i] = (int32_t) src16[i] * 4096 + (int32_t)(TEST_Rand(&seed) & 0xFFFU);
+  }
+
+  /* same input to both filters: the output differs by the rounding (floor instead of truncation, Q14 pole),
+   * errors of 1 LSB at most per sample accumulate with the gain 1 / (1 - a) of the recursion, 85 */
+  HSD_DCFILTER_Reset(&filter);
+  for (uint32_t b = 0; b < 50U; b++)
+  {
+    memcpy(buf, src16, sizeof(src16));
+    HSD_DCFILTER_Process(&filter, buf, BENCH_BLOCK);
+    Old_Process(out16, reg32, BENCH_BLOCK, &oldIn, &oldOut);
+  }
+  for (uint32_t i = 0; i < BENCH_BLOCK; i++)
+  {
+    int32_t d = abs(buf[i] - out16[i]);
+    maxDiff = (d > maxDiff) ? d : maxDiff;
+  }
+  printf("steady state difference from the division filter: %d LSB at most\n", (int) maxDiff);
+  TEST_CHECK(maxDiff <= 86);
+
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint64_t t0 = TEST_Cycles();
+    for (uint32_t b = 0; b < BENCH_BLOCKS; b++)
+    {
+      HSD_DCFILTER_Process(&filter, buf, BENCH_BLOCK);
+    }
+    uint64_t t = TEST_Cycles() - t0;
+    best = (t < best) ? t : best;
+
+    t0 = TEST_Cycles();
+    for (uint32_t b = 0; b < BENCH_BLOCKS; b++)
+    {
+      Old_Process(out16, reg32, BENCH_BLOCK, &oldIn, &oldOut);
+    }
+    t = TEST_Cycles() - t0;
+    bestOld = (t < bestOld) ? t : bestOld;
+  }
+  printf("%u sample blocks, %s/sample (best of %u runs): division filter %.2f, HSD_DCFILTER %.2f%s\n",
+         BENCH_BLOCK, TEST_Cycles_Unit(), repeat, (double) bestOld / ((double) BENCH_BLOCKS * BENCH_BLOCK),
+         (double) best / ((double) BENCH_BLOCKS * BENCH_BLOCK),
+#if defined(__ARM_FEATURE_DSP) && (__ARM_FEATURE_DSP == 1) && !defined(__arm__)
+         " (DSP path on emulated intrinsics, not a target figure)"
+#else
+         ""
+#endif
+        );
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 10);
+
+  Test_Bit_Exact();
+  Bench(repeat);
+  return TEST_RESULT();
+}
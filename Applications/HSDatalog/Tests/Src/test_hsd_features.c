@@ -0,0 +1,288 @@
+/**
+  ******************************************************************************
+  * @file    test_hsd_features.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   HSD_features windows against a double precision two-pass reference,
+  *          and cycles per value of HSD_FEATURES_Process
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_features.h"
+#include "com_manager.h"
+#include "math.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define N_SAMPLES       20000U
+#define MAX_BATCH       300U
+#define FIRST_BATCH     64U
+#define SOURCE_ODR      208.0f
+#define WINDOW_RATE     2.0f
+#define HOP             104U        /* SOURCE_ODR / WINDOW_RATE */
+#define WINDOW_LEN      (HOP * HSD_FEATURES_WINDOW_HOPS)
+#define SENSITIVITY     0.061f
+#define BENCH_BATCHES   2000U
+#define BENCH_BATCH     256U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t sensorId;
+  uint8_t dataType;
+  uint8_t nAxes;
+  uint32_t nEmitted;
+  uint32_t nSamples;          /* samples fed after the discarded first batch */
+  double lastTimeStamp;
+  double maxErr[HSD_FEATURES_N];
+} Source_t;
+
+/* Private variables ---------------------------------------------------------*/
+static int16_t data16[N_SAMPLES][3];
+static float dataFloat[N_SAMPLES];
+static Source_t sources[2];
+static uint8_t featuresId;
+static uint8_t checking;
+
+/* Private functions ---------------------------------------------------------*/
+static double Value(const Source_t *pSource, uint32_t i, uint32_t axis)
+{
+  return (pSource->dataType == DATA_TYPE_INT16) ? (double) data16[i][axis] : (double) dataFloat[i];
+}
+
+/**
+  * @brief  Features of samples [start, start + len) of an axis, two passes in double
+  */
+static void Reference(const Source_t *pSource, uint32_t start, uint32_t len, uint32_t axis, double sensitivity,
+                      double *out)
+{
+  double mean = 0.0;
+  double sq = 0.0;
+  double m2 = 0.0;
+  double m3 = 0.0;
+  double m4 = 0.0;
+  double minV = INFINITY;
+  double maxV = -INFINITY;
+  double rms;
+
+  for (uint32_t i = start; i < start + len; i++)
+  {
+    double x = Value(pSource, i, axis);
+    mean += x;
+    sq += x * x;
+    minV = fmin(minV, x);
+    maxV = fmax(maxV, x);
+  }
+  mean /= (double) len;
+  for (uint32_t i = start; i < start + len; i++)
+  {
+    double d = Value(pSource, i, axis) - mean;
+    m2 += d * d;
+    m3 += d * d * d;
+    m4 += d * d * d * d;
+  }
+  m2 /= (double) len;
+  m3 /= (double) len;
+  m4 /= (double) len;
+  rms = sqrt(sq / (double) len);
+
+  out[HSD_FEATURES_MEAN] = mean * sensitivity;
+  out[HSD_FEATURES_RMS] = rms * sensitivity;
+  out[HSD_FEATURES_P2P] = (maxV - minV) * sensitivity;
+  out[HSD_FEATURES_CREST] = fmax(fabs(minV), fabs(maxV)) / rms;
+  out[HSD_FEATURES_SKEWNESS] = m3 / pow(m2, 1.5);
+  out[HSD_FEATURES_KURTOSIS] = m4 / (m2 * m2);
+}
+
+/**
+  * @brief  Windows are emitted in order, the m-th one ends with sample (HOPS + m) * HOP - 1
+  */
+void HSD_FEATURES_Data_Ready(uint8_t subSensorId, uint8_t *buf, uint16_t size, HSD_TimeStamp_t timeStamp)
+{
+  Source_t *pSource = &sources[subSensorId];
+  const float *f = (const float *) buf;
+  uint32_t end = (HSD_FEATURES_WINDOW_HOPS + pSource->nEmitted) * HOP;
+  double sensitivity = COM_GetSubSensorStatus(pSource->sensorId, 0)->sensitivity;
+  double ref[HSD_FEATURES_N];
+
+  pSource->nEmitted++;
+  if (!checking)
+  {
+    return;
+  }
+  TEST_CHECK(subSensorId < 2U);
+  TEST_CHECK(size == pSource->nAxes * HSD_FEATURES_N * sizeof(float));
+  /* the batch holding the last sample of the window */
+  TEST_CHECK(end <= pSource->nSamples && timeStamp == (HSD_TimeStamp_t) pSource->nSamples);
+  TEST_CHECK(timeStamp >= pSource->lastTimeStamp);
+  pSource->lastTimeStamp = timeStamp;
+
+  for (uint32_t axis = 0; axis < pSource->nAxes; axis++)
+  {
+    Reference(pSource, FIRST_BATCH + end - WINDOW_LEN, WINDOW_LEN, axis, sensitivity, ref);
+    for (uint32_t k = 0; k < HSD_FEATURES_N; k++)
+    {
+      double err = fabs((double) f[axis * HSD_FEATURES_N + k] - ref[k]) / fmax(fabs(ref[k]), 1.0);
+      pSource->maxErr[k] = fmax(pSource->maxErr[k], err);
+    }
+  }
+}
+
+static uint8_t Add_Source(const char *name, uint8_t dataType, uint8_t nAxes)
+{
+  int32_t id = COM_AddSensor();
+  COM_Sensor_t *pSensor = COM_GetSensor((uint8_t) id);
+  COM_SubSensorDescriptor_t *pDescriptor = &pSensor->sensorDescriptor.subSensorDescriptor[0];
+  COM_SubSensorStatus_t *pStatus = &pSensor->sensorStatus.subSensorStatus[0];
+
+  strcpy(pSensor->sensorDescriptor.name, name);
+  pSensor->sensorDescriptor.nSubSensors = 1;
+  pDescriptor->dataType = dataType;
+  pDescriptor->dimensions = nAxes;
+  strcpy(pDescriptor->unit, "g");
+  pStatus->isActive = 1;
+  pStatus->ODR = SOURCE_ODR;
+  pStatus->sensitivity = (dataType == DATA_TYPE_INT16) ? SENSITIVITY : 1.0f;
+  return (uint8_t) id;
+}
+
+static void Feed(Source_t *pSource, uint32_t first, uint32_t n)
+{
+  const uint8_t *buf = (pSource->dataType == DATA_TYPE_INT16) ? (const uint8_t *) data16[first]
+                       : (const uint8_t *) &dataFloat[first];
+  uint32_t nBytes = n * COM_GetnBytesPerSample(pSource->sensorId, 0);
+
+  pSource->nSamples = first + n - FIRST_BATCH;
+  HSD_FEATURES_Process(pSource->sensorId, 0, buf, (uint16_t) nBytes, (HSD_TimeStamp_t) pSource->nSamples);
+}
+
+/**
+  * @brief  An int16 3-axis and a float 1-axis source, fed with random batch sizes
+  */
+static void Test_Windows(void)
+{
+  const double tolerance[HSD_FEATURES_N] = {1e-5, 1e-5, 1e-6, 1e-5, 1e-3, 5e-4};
+  const char *names[HSD_FEATURES_N] = {"avg", "rms", "p2p", "crs", "skw", "krt"};
+  uint32_t seed = 1;
+  uint8_t srcSensor[2];
+  uint8_t srcSubSensor[2] = {0, 0};
+
+  for (uint32_t i = 0; i < N_SAMPLES; i++)
+  {
+    for (uint32_t a = 0; a < 3U; a++)
+    {
+      /* gravity offset, vibration, noise and sparse shocks */
+      data16[i][a] = (int16_t)(4000.0 * (double) a - 2000.0 + 1500.0 * sin(0.05 * (double)(i * (a + 1U)))
+                               + (double)(TEST_Rand(&seed) % 801U) - 400.0 + ((i % 97U) == 0U ? 6000.0 : 0.0));
+    }
+    dataFloat[i] = 25.0f + 0.5f * (float) sin(0.01 * (double) i) + (float)(TEST_Rand(&seed) % 1000U) * 1e-4f;
+  }
+
+  sources[0].sensorId = srcSensor[0] = Add_Source("ACC", DATA_TYPE_INT16, 3);
+  sources[0].dataType = DATA_TYPE_INT16;
+  sources[0].nAxes = 3;
+  sources[1].sensorId = srcSensor[1] = Add_Source("TEMP", DATA_TYPE_FLOAT, 1);
+  sources[1].dataType = DATA_TYPE_FLOAT;
+  sources[1].nAxes = 1;
+
+  TEST_CHECK(HSD_FEATURES_Create_Sensor(srcSensor, srcSubSensor, 2) == 0U);
+  featuresId = HSD_FEATURES_Get_Id();
+  TEST_CHECK(COM_GetSensorDescriptor(featuresId)->nSubSensors == 2U);
+  TEST_CHECK(COM_GetSubSensorDescriptor(featuresId, 0)->dimensions == HSD_FEATURES_N);
+  TEST_CHECK(HSD_FEATURES_Is_Source(srcSensor[0], 0) == 0U);
+
+  for (uint32_t s = 0; s < 2U; s++)
+  {
+    COM_GetSubSensorStatus(featuresId, (uint8_t) s)->isActive = 1;
+    COM_GetSubSensorStatus(featuresId, (uint8_t) s)->ODR = WINDOW_RATE * (float) sources[s].nAxes;
+    TEST_CHECK(HSD_FEATURES_Is_Source(srcSensor[s], 0) == 1U);
+  }
+  TEST_CHECK(HSD_FEATURES_Is_Source(featuresId, 0) == 0U);
+
+  checking = 1;
+  for (uint32_t s = 0; s < 2U; s++)
+  {
+    Source_t *pSource = &sources[s];
+    uint32_t i = FIRST_BATCH;
+
+    /* the first batch is discarded and restarts the windows */
+    COM_GetSubSensorContext(pSource->sensorId, 0)->first_dataReady = 1;
+    Feed(pSource, 0, FIRST_BATCH);
+    COM_GetSubSensorContext(pSource->sensorId, 0)->first_dataReady = 0;
+    TEST_CHECK(pSource->nEmitted == 0U);
+
+    while (i < N_SAMPLES)
+    {
+      uint32_t n = 1U + TEST_Rand(&seed) % MAX_BATCH;
+      n = HSD_MIN(n, N_SAMPLES - i);
+      Feed(pSource, i, n);
+      i += n;
+    }
+    TEST_CHECK(pSource->nEmitted == (N_SAMPLES - FIRST_BATCH) / HOP + 1U - HSD_FEATURES_WINDOW_HOPS);
+
+    printf("%s, %u windows of %u samples, max relative error:", (s == 0U) ? "int16 x3" : "float x1",
+           pSource->nEmitted, WINDOW_LEN);
+    for (uint32_t k = 0; k < HSD_FEATURES_N; k++)
+    {
+      printf(" %s %.1e", names[k], pSource->maxErr[k]);
+      if (pSource->maxErr[k] > tolerance[k])
+      {
+        printf(" (> %.0e)", tolerance[k]);
+        test_failures++;
+      }
+    }
+    printf("\n");
+  }
+  checking = 0;
+
+  /* an inactive features subsensor is not fed */
+  COM_GetSubSensorStatus(featuresId, 1)->isActive = 0;
+  TEST_CHECK(HSD_FEATURES_Is_Source(sources[1].sensorId, 0) == 0U);
+  sources[1].nEmitted = 0;
+  Feed(&sources[1], FIRST_BATCH, MAX_BATCH);
+  TEST_CHECK(sources[1].nEmitted == 0U);
+}
+
+static void Bench(uint32_t repeat)
+{
+  Source_t *pSource = &sources[0];
+  uint64_t best = UINT64_MAX;
+
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint64_t t0 = TEST_Cycles();
+    for (uint32_t b = 0; b < BENCH_BATCHES; b++)
+    {
+      const int16_t *batch = data16[(b * BENCH_BATCH) % (N_SAMPLES - BENCH_BATCH)];
+      HSD_FEATURES_Process(pSource->sensorId, 0, (const uint8_t *) batch, BENCH_BATCH * 6U, 0);
+    }
+    uint64_t t = TEST_Cycles() - t0;
+    best = (t < best) ? t : best;
+  }
+  printf("HSD_FEATURES_Process, int16 x3, %u sample batches, %u overlapping window(s): %.2f %s/value "
+         "(best of %u runs)\n", BENCH_BATCH, HSD_FEATURES_WINDOW_HOPS,
+         (double) best / ((double) BENCH_BATCHES * BENCH_BATCH * 3U), TEST_Cycles_Unit(), repeat);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 10);
+
+  Test_Windows();
+  Bench(repeat);
+  return TEST_RESULT();
+}
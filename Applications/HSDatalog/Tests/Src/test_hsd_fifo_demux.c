@@ -0,0 +1,367 @@
+/**
+  ******************************************************************************
+  * @file    test_hsd_fifo_demux.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   HSD_fifo_demux on a LSM6DSOX FIFO dump and on random TAG mixes against a
+  *          reference split, and cycles per word against the per-subsensor scans it replaced
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_fifo_demux.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define MAX_WORDS       512U
+#define BENCH_WORDS     438U      /* whole LSM6DSOX FIFO, 3 kbyte */
+#define BENCH_BATCHES   100U
+
+/* Private variables ---------------------------------------------------------*/
+/* LSM6DSOX FIFO in continuous mode, XL at 1666 Hz and G at 833 Hz with timestamp and temperature batching:
+ * TAG byte (TAG_SENSOR << 3 | TAG_CNT << 1 | parity) followed by X, Y, Z little endian */
+static const uint8_t fifoDump[] =
+{
+  0x28, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,   /* CFG_CHANGE */
+  0x12, 0xF4, 0xFF, 0x1F, 0x00, 0x06, 0x40,   /* XL -12, 31, 16390 */
+  0x0C, 0x03, 0x00, 0xFB, 0xFF, 0x01, 0x00,   /* G 3, -5, 1 */
+  0x17, 0xF6, 0xFF, 0x1D, 0x00, 0x12, 0x40,   /* XL -10, 29, 16402 */
+  0x21, 0x10, 0x3A, 0x12, 0x00, 0x00, 0x00,   /* TIMESTAMP */
+  0x12, 0xF2, 0xFF, 0x21, 0x00, 0x01, 0x40,   /* XL -14, 33, 16385 */
+  0x0C, 0x02, 0x00, 0xFC, 0xFF, 0x00, 0x00,   /* G 2, -4, 0 */
+  0x17, 0xF5, 0xFF, 0x1E, 0x00, 0x0D, 0x40,   /* XL -11, 30, 16397 */
+  0x18, 0x40, 0x06, 0x00, 0x00, 0x00, 0x00,   /* TEMPERATURE 0x0640 */
+  0x12, 0xF7, 0xFF, 0x1B, 0x00, 0xFC, 0x3F,   /* XL -9, 27, 16380 */
+  0x0C, 0x04, 0x00, 0xFA, 0xFF, 0x02, 0x00,   /* G 4, -6, 2 */
+  0x17, 0xF3, 0xFF, 0x20, 0x00, 0x07, 0x40,   /* XL -13, 32, 16391 */
+  0x39, 0xF4, 0xFF, 0x1E, 0x00, 0x05, 0x40,   /* XL_NC_T_1 */
+  0x0A, 0x03, 0x00, 0xFB, 0xFF, 0x01, 0x00,   /* G 3, -5, 1 */
+};
+
+static const int16_t dumpAcc[][3] =
+{
+  {-12, 31, 16390}, {-10, 29, 16402}, {-14, 33, 16385}, {-11, 30, 16397}, {-9, 27, 16380}, {-13, 32, 16391}
+};
+static const int16_t dumpGyro[][3] = {{3, -5, 1}, {2, -4, 0}, {4, -6, 2}, {3, -5, 1}};
+
+static HSD_FIFO_Demux_t demux;
+static uint8_t fifo[MAX_WORDS * HSD_FIFO_WORD_SIZE] __attribute__((aligned(4)));
+static uint8_t out[HSD_FIFO_MAX_SINKS][MAX_WORDS * HSD_FIFO_WORD_DATA_SIZE] __attribute__((aligned(4)));
+static uint8_t ref[HSD_FIFO_MAX_SINKS][MAX_WORDS * HSD_FIFO_WORD_DATA_SIZE];
+static uint32_t refBytes[HSD_FIFO_MAX_SINKS];
+static uint16_t refDropped[HSD_FIFO_N_TAGS];
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Reference split: every word in order, its payload appended to its sink
+  */
+static void Reference(const uint8_t *src, uint16_t nWords, const uint8_t *route, const uint8_t *nBytes)
+{
+  memset(refBytes, 0, sizeof(refBytes));
+  memset(refDropped, 0, sizeof(refDropped));
+  for (uint32_t w = 0; w < nWords; w++)
+  {
+    uint8_t tag = src[w * HSD_FIFO_WORD_SIZE] >> 3;
+    uint8_t s = route[tag];
+    if (s == HSD_FIFO_SINK_NONE)
+    {
+      refDropped[tag]++;
+      continue;
+    }
+    memcpy(&ref[s][refBytes[s]], &src[w * HSD_FIFO_WORD_SIZE + 1U], nBytes[s]);
+    refBytes[s] += nBytes[s];
+  }
+}
+
+/**
+  * @brief  The dump through ACC and GYRO sinks, as LSM6DSOX_Init routes them; then ACC compacted in place
+  */
+static void Test_Dump(void)
+{
+  const uint16_t nWords = sizeof(fifoDump) / HSD_FIFO_WORD_SIZE;
+
+  HSD_FIFO_DEMUX_Init(&demux);
+  HSD_FIFO_DEMUX_Route(&demux, HSD_FIFO_TAG_XL_NC, 0, 6);
+  HSD_FIFO_DEMUX_Route(&demux, HSD_FIFO_TAG_GYRO_NC, 1, 6);
+  HSD_FIFO_DEMUX_Start(&demux, fifoDump, nWords);
+
+  TEST_CHECK(demux.sink[0].nSamples == 6U);
+  TEST_CHECK(demux.sink[1].nSamples == 4U);
+  TEST_CHECK(demux.single == HSD_FIFO_SINK_NONE);
+  TEST_CHECK(demux.dropped[HSD_FIFO_TAG_CFG_CHANGE] == 1U);
+  TEST_CHECK(demux.dropped[HSD_FIFO_TAG_TIMESTAMP] == 1U);
+  TEST_CHECK(demux.dropped[HSD_FIFO_TAG_TEMPERATURE] == 1U);
+  TEST_CHECK(demux.dropped[HSD_FIFO_TAG_XL_NC_T_1] == 1U);
+
+  HSD_FIFO_DEMUX_Set_Span(&demux, 0, out[0], 6);
+  HSD_FIFO_DEMUX_Set_Span(&demux, 1, out[1], 4);
+  TEST_CHECK(HSD_FIFO_DEMUX_Run(&demux) == HSD_FIFO_SINK_NONE);
+  TEST_CHECK(demux.sink[0].written == 6U && demux.sink[1].written == 4U);
+  TEST_CHECK(memcmp(out[0], dumpAcc, sizeof(dumpAcc)) == 0);
+  TEST_CHECK(memcmp(out[1], dumpGyro, sizeof(dumpGyro)) == 0);
+
+  /* the sink with more samples is compacted in the FIFO buffer itself, a span full halfway */
+  memcpy(fifo, fifoDump, sizeof(fifoDump));
+  HSD_FIFO_DEMUX_Start(&demux, fifo, nWords);
+  HSD_FIFO_DEMUX_Set_Span(&demux, 0, fifo, 6);
+  HSD_FIFO_DEMUX_Set_Span(&demux, 1, out[1], 2);
+  TEST_CHECK(HSD_FIFO_DEMUX_Run(&demux) == 1U);
+  TEST_CHECK(demux.sink[1].written == 2U);
+  HSD_FIFO_DEMUX_Set_Span(&demux, 1, &out[1][2U * 6U], 2);
+  TEST_CHECK(HSD_FIFO_DEMUX_Run(&demux) == HSD_FIFO_SINK_NONE);
+  TEST_CHECK(memcmp(fifo, dumpAcc, sizeof(dumpAcc)) == 0);
+  TEST_CHECK(memcmp(out[1], dumpGyro, sizeof(dumpGyro)) == 0);
+
+  /* temperature on its own sink, 2 bytes per sample */
+  HSD_FIFO_DEMUX_Route(&demux, HSD_FIFO_TAG_TEMPERATURE, 2, 2);
+  HSD_FIFO_DEMUX_Start(&demux, fifoDump, nWords);
+  TEST_CHECK(demux.sink[2].nSamples == 1U && demux.dropped[HSD_FIFO_TAG_TEMPERATURE] == 0U);
+  HSD_FIFO_DEMUX_Set_Span(&demux, 2, out[2], 1);
+  TEST_CHECK(HSD_FIFO_DEMUX_Run(&demux) == HSD_FIFO_SINK_NONE);
+  TEST_CHECK(out[2][0] == 0x40 && out[2][1] == 0x06);
+}
+
+static uint8_t Random_Tag(uint32_t *seed, uint32_t mix)
+{
+  static const uint8_t others[] =
+  {
+    HSD_FIFO_TAG_TEMPERATURE, HSD_FIFO_TAG_TIMESTAMP, HSD_FIFO_TAG_CFG_CHANGE, HSD_FIFO_TAG_XL_NC_T_1,
+    HSD_FIFO_TAG_GYRO_2XC, HSD_FIFO_TAG_SENSORHUB_SLAVE0, HSD_FIFO_TAG_STEP_COUNTER, 0x1FU
+  };
+  uint32_t r = TEST_Rand(seed) % 16U;
+
+  switch (mix)
+  {
+    case 0:
+      return HSD_FIFO_TAG_XL_NC;
+    case 1:
+      return (r < 11U) ? HSD_FIFO_TAG_XL_NC : HSD_FIFO_TAG_GYRO_NC;
+    default:
+      return (r < 8U) ? HSD_FIFO_TAG_XL_NC : ((r < 13U) ? HSD_FIFO_TAG_GYRO_NC : others[TEST_Rand(seed) % 8U]);
+  }
+}
+
+static void Fill(uint32_t *seed, uint16_t nWords, uint32_t mix)
+{
+  for (uint32_t w = 0; w < nWords; w++)
+  {
+    fifo[w * HSD_FIFO_WORD_SIZE] = (uint8_t)((Random_Tag(seed, mix) << 3) | (TEST_Rand(seed) & 0x7U));
+    for (uint32_t b = 1; b < HSD_FIFO_WORD_SIZE; b++)
+    {
+      fifo[w * HSD_FIFO_WORD_SIZE + b] = (uint8_t) TEST_Rand(seed);
+    }
+  }
+}
+
+/**
+  * @brief  Random batches, routes, span sizes, dropped sinks and in-place compaction
+  */
+static void Test_Random(void)
+{
+  static uint8_t src[MAX_WORDS * HSD_FIFO_WORD_SIZE];
+  uint32_t seed = 9;
+  uint32_t nChecked = 0;
+
+  for (uint32_t t = 0; t < 20000U; t++)
+  {
+    uint16_t nWords = (uint16_t)(TEST_Rand(&seed) % (MAX_WORDS + 1U));
+    uint8_t route[HSD_FIFO_N_TAGS];
+    uint8_t nBytes[HSD_FIFO_MAX_SINKS];
+    uint8_t *base[HSD_FIFO_MAX_SINKS];
+    uint32_t got[HSD_FIFO_MAX_SINKS] = {0};
+    uint8_t drop[HSD_FIFO_MAX_SINKS];
+    uint8_t inPlace = HSD_FIFO_SINK_NONE;
+    uint8_t s;
+
+    Fill(&seed, nWords, t % 3U);
+    memcpy(src, fifo, nWords * HSD_FIFO_WORD_SIZE);
+
+    memset(route, HSD_FIFO_SINK_NONE, sizeof(route));
+    HSD_FIFO_DEMUX_Init(&demux);
+    for (s = 0; s < HSD_FIFO_MAX_SINKS; s++)
+    {
+      nBytes[s] = (uint8_t)(2U * (1U + TEST_Rand(&seed) % 3U));
+      drop[s] = (TEST_Rand(&seed) % 8U) == 0U;
+    }
+    /* XL and G on two distinct sinks, sometimes others on the remaining ones */
+    route[HSD_FIFO_TAG_XL_NC] = (uint8_t)(TEST_Rand(&seed) % HSD_FIFO_MAX_SINKS);
+    route[HSD_FIFO_TAG_GYRO_NC] = (uint8_t)((route[HSD_FIFO_TAG_XL_NC] + 1U) % HSD_FIFO_MAX_SINKS);
+    if (t & 1U)
+    {
+      route[HSD_FIFO_TAG_TEMPERATURE] = (uint8_t)((route[HSD_FIFO_TAG_XL_NC] + 2U) % HSD_FIFO_MAX_SINKS);
+      route[HSD_FIFO_TAG_TIMESTAMP] = route[HSD_FIFO_TAG_TEMPERATURE];
+    }
+    for (uint32_t tag = 0; tag < HSD_FIFO_N_TAGS; tag++)
+    {
+      if (route[tag] != HSD_FIFO_SINK_NONE)
+      {
+        HSD_FIFO_DEMUX_Route(&demux, (uint8_t) tag, route[tag], nBytes[route[tag]]);
+      }
+    }
+    Reference(src, nWords, route, nBytes);
+
+    HSD_FIFO_DEMUX_Start(&demux, fifo, nWords);
+    for (s = 0; s < HSD_FIFO_MAX_SINKS; s++)
+    {
+      TEST_CHECK(demux.sink[s].nSamples * nBytes[s] == refBytes[s]);
+    }
+    TEST_CHECK(memcmp(demux.dropped, refDropped, sizeof(refDropped)) == 0);
+
+    /* the sink of the XL words is compacted in place one time out of four, with a single span */
+    if ((t % 4U) == 0U && !drop[route[HSD_FIFO_TAG_XL_NC]])
+    {
+      inPlace = route[HSD_FIFO_TAG_XL_NC];
+    }
+    for (s = 0; s < HSD_FIFO_MAX_SINKS; s++)
+    {
+      uint16_t room = (s == inPlace) ? demux.sink[s].nSamples
+                      : (uint16_t)(1U + TEST_Rand(&seed) % (demux.sink[s].nSamples + 1U));
+      base[s] = (s == inPlace) ? fifo : out[s];
+      if (!drop[s] && demux.sink[s].nSamples > 0U)
+      {
+        HSD_FIFO_DEMUX_Set_Span(&demux, s, base[s], room);
+      }
+    }
+
+    while ((s = HSD_FIFO_DEMUX_Run(&demux)) != HSD_FIFO_SINK_NONE)
+    {
+      uint16_t left;
+
+      TEST_CHECK(s < HSD_FIFO_MAX_SINKS && s != inPlace && demux.sink[s].room == 0U);
+      if (s >= HSD_FIFO_MAX_SINKS || s == inPlace)
+      {
+        break;
+      }
+      got[s] += demux.sink[s].written * nBytes[s];
+      left = (uint16_t)(demux.sink[s].nSamples - got[s] / nBytes[s]);
+      TEST_CHECK(left > 0U);
+      base[s] = &out[s][got[s]];
+      HSD_FIFO_DEMUX_Set_Span(&demux, s, base[s], (uint16_t)(1U + TEST_Rand(&seed) % left));
+    }
+    for (s = 0; s < HSD_FIFO_MAX_SINKS; s++)
+    {
+      uint8_t *result = (s == inPlace) ? fifo : out[s];
+
+      if (drop[s] || demux.sink[s].nSamples == 0U)
+      {
+        continue;
+      }
+      got[s] += demux.sink[s].written * nBytes[s];
+      if (got[s] != refBytes[s] || memcmp(result, ref[s], refBytes[s]) != 0)
+      {
+        printf("mismatch: batch %u, sink %u, %u of %u bytes\n", t, s, got[s], refBytes[s]);
+        test_failures++;
+        return;
+      }
+      nChecked += demux.sink[s].nSamples;
+    }
+  }
+  printf("random batches: %u samples checked\n", nChecked);
+}
+
+/**
+  * @brief  The split before HSD_fifo_demux (LSM6DSOX_FIFO_Count and LSM6DSOX_FIFO_Extract): a count pass and a
+  *         copy pass per subsensor, every word that is not accelerometer going to the gyroscope
+  */
+static void Old_Split(const uint8_t *src, uint16_t nWords, uint8_t subSensorId, uint8_t demuxOn, uint8_t *dst)
+{
+  const uint8_t *pTag = src;
+  uint16_t count = 0;
+  uint8_t *p8dest = dst;
+
+  if (!demuxOn)
+  {
+    count = nWords;
+  }
+  else
+  {
+    for (uint32_t i = 0; i < nWords; i++, pTag += HSD_FIFO_WORD_SIZE)
+    {
+      count += ((((*pTag) >> 3) == HSD_FIFO_TAG_XL_NC) == (subSensorId == 0U)) ? 1U : 0U;
+    }
+  }
+  pTag = src;
+  for (uint32_t i = 0; i < nWords && count > 0U; i++, pTag += HSD_FIFO_WORD_SIZE)
+  {
+    if (!demuxOn || ((((*pTag) >> 3) == HSD_FIFO_TAG_XL_NC) == (subSensorId == 0U)))
+    {
+      /* three int16 loads in the firmware: the payload is at an odd address */
+      memcpy(p8dest, pTag + 1, HSD_FIFO_WORD_DATA_SIZE);
+      p8dest += HSD_FIFO_WORD_DATA_SIZE;
+      count--;
+    }
+  }
+}
+
+static void Bench(const char *name, uint32_t mix, uint32_t repeat)
+{
+  uint32_t seed = 4;
+  uint64_t best = UINT64_MAX;
+  uint64_t bestOld = UINT64_MAX;
+  uint8_t gyro = (mix != 0U);
+
+  Fill(&seed, BENCH_WORDS, mix);
+  HSD_FIFO_DEMUX_Init(&demux);
+  HSD_FIFO_DEMUX_Route(&demux, HSD_FIFO_TAG_XL_NC, 0, 6);
+  if (gyro)
+  {
+    HSD_FIFO_DEMUX_Route(&demux, HSD_FIFO_TAG_GYRO_NC, 1, 6);
+  }
+
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint64_t t0 = TEST_Cycles();
+    for (uint32_t b = 0; b < BENCH_BATCHES; b++)
+    {
+      HSD_FIFO_DEMUX_Start(&demux, fifo, BENCH_WORDS);
+      HSD_FIFO_DEMUX_Set_Span(&demux, 0, out[0], demux.sink[0].nSamples);
+      HSD_FIFO_DEMUX_Set_Span(&demux, 1, out[1], demux.sink[1].nSamples);
+      (void) HSD_FIFO_DEMUX_Run(&demux);
+    }
+    uint64_t t = TEST_Cycles() - t0;
+    best = (t < best) ? t : best;
+
+    t0 = TEST_Cycles();
+    for (uint32_t b = 0; b < BENCH_BATCHES; b++)
+    {
+      Old_Split(fifo, BENCH_WORDS, 0, gyro, out[2]);
+      if (gyro)
+      {
+        Old_Split(fifo, BENCH_WORDS, 1, 1, out[3]);
+      }
+    }
+    t = TEST_Cycles() - t0;
+    bestOld = (t < bestOld) ? t : bestOld;
+  }
+  TEST_CHECK(memcmp(out[0], out[2], demux.sink[0].nSamples * 6U) == 0);
+  printf("%-22s %8.2f %8.2f\n", name, (double) bestOld / ((double) BENCH_BATCHES * BENCH_WORDS),
+         (double) best / ((double) BENCH_BATCHES * BENCH_WORDS));
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 200);
+
+  Test_Dump();
+  Test_Random();
+
+  printf("%u word batches, %s/word (best of %u runs)\n", BENCH_WORDS, TEST_Cycles_Unit(), repeat);
+  printf("%-22s %8s %8s\n", "FIFO content", "before", "demux");
+  Bench("XL only", 0, repeat);
+  Bench("XL + G", 1, repeat);
+  Bench("XL + G + temp, ts...", 2, repeat);
+  return TEST_RESULT();
+}
@@ -0,0 +1,303 @@
+/**
+  ******************************************************************************
+  * @file    test_hsd_psd.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   HSD_psd periodogram against a double precision DFT, scaling checks,
+  *          and cycles per segment against a complex N-point reference FFT
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "HSD_psd.h"
+#include "math.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define N_MAX           HSD_PSD_MAX_FFT_LEN
+#define BINS_MAX        (N_MAX / 2U + 1U)
+#define BENCH_SEGMENTS  2000U
+#define FS              26667.0f
+
+/* Private variables ---------------------------------------------------------*/
+static HSD_PSD_t psd;
+static int16_t x[N_MAX];
+static float acc[BINS_MAX + 1U];
+static double ref[BINS_MAX];
+static float refBuf[2U * N_MAX];
+static float refCos[N_MAX / 2U];
+static float refSin[N_MAX / 2U];
+
+/* Private functions ---------------------------------------------------------*/
+static void Fill(uint32_t n, uint32_t *seed, double amplitude, double cycles)
+{
+  for (uint32_t i = 0; i < n; i++)
+  {
+    double noise = (double)(TEST_Rand(seed) % 2001U) - 1000.0;
+    x[i] = (int16_t)(300.0 + amplitude * sin(2.0 * M_PI * cycles * (double) i / (double) n) + noise);
+  }
+}
+
+/**
+  * @brief  Periodogram of the zero mean, Hann windowed segment with a direct DFT in double
+  */
+static void Reference(uint32_t n, double *out, double *windowPower)
+{
+  double mean = 0.0;
+  double w;
+
+  *windowPower = 0.0;
+  for (uint32_t i = 0; i < n; i++)
+  {
+    mean += x[i];
+  }
+  mean /= (double) n;
+  for (uint32_t k = 0; k <= n / 2U; k++)
+  {
+    double re = 0.0;
+    double im = 0.0;
+    for (uint32_t i = 0; i < n; i++)
+    {
+      w = 0.5 - 0.5 * cos(2.0 * M_PI * (double) i / (double) n);
+      re += (x[i] - mean) * w * cos(2.0 * M_PI * (double)(k * i % n) / (double) n);
+      im -= (x[i] - mean) * w * sin(2.0 * M_PI * (double)(k * i % n) / (double) n);
+    }
+    out[k] = re * re + im * im;
+  }
+  for (uint32_t i = 0; i < n; i++)
+  {
+    w = 0.5 - 0.5 * cos(2.0 * M_PI * (double) i / (double) n);
+    *windowPower += w * w;
+  }
+}
+
+/**
+  * @brief  Only powers of 2 from 8 to HSD_PSD_MAX_FFT_LEN are accepted
+  */
+static void Test_Init(void)
+{
+  TEST_CHECK(HSD_PSD_Init(&psd, 0) == 1U);
+  TEST_CHECK(HSD_PSD_Init(&psd, 4) == 1U);
+  TEST_CHECK(HSD_PSD_Init(&psd, 12) == 1U);
+  TEST_CHECK(HSD_PSD_Init(&psd, 2U * N_MAX) == 1U);
+  for (uint32_t n = 8; n <= N_MAX; n <<= 1)
+  {
+    TEST_CHECK(HSD_PSD_Init(&psd, n) == 0U);
+  }
+}
+
+/**
+  * @brief  Every bin within 1e-5 of the spectrum peak, accumulation, windowPower and Parseval
+  */
+static void Test_Accuracy(void)
+{
+  uint32_t seed = 7;
+
+  for (uint32_t n = 8; n <= N_MAX; n <<= 1)
+  {
+    for (uint32_t t = 0; t < 20U; t++)
+    {
+      double windowPower;
+      double peak = 0.0;
+      double err = 0.0;
+      double sumRef = 0.0;
+      double sumAcc = 0.0;
+
+      Fill(n, &seed, (t & 1U) ? 20000.0 : 0.0, (double)(t % (n / 2U)) + 0.3);
+      Reference(n, ref, &windowPower);
+      TEST_CHECK(HSD_PSD_Init(&psd, n) == 0U);
+      TEST_CHECK(fabs(psd.windowPower - windowPower) <= 1e-5 * windowPower);
+
+      memset(acc, 0, sizeof(acc));
+      acc[n / 2U + 1U] = 12345.0f;
+      HSD_PSD_Accumulate(&psd, x, acc);
+      TEST_CHECK(acc[n / 2U + 1U] == 12345.0f);
+      for (uint32_t k = 0; k <= n / 2U; k++)
+      {
+        peak = fmax(peak, ref[k]);
+      }
+      for (uint32_t k = 0; k <= n / 2U; k++)
+      {
+        err = fmax(err, fabs((double) acc[k] - ref[k]));
+        sumRef += (k == 0U || k == n / 2U) ? ref[k] : 2.0 * ref[k];
+        sumAcc += (k == 0U || k == n / 2U) ? acc[k] : 2.0 * acc[k];
+      }
+      if (err > 1e-5 * peak)
+      {
+        printf("N = %u, case %u: error %.3g of the peak\n", n, t, err / peak);
+        test_failures++;
+      }
+      TEST_CHECK(fabs(sumAcc - sumRef) <= 1e-5 * sumRef);
+
+      /* a second segment adds to the first one */
+      HSD_PSD_Accumulate(&psd, x, acc);
+      for (uint32_t k = 0; k <= n / 2U; k++)
+      {
+        TEST_CHECK(fabs((double) acc[k] - 2.0 * ref[k]) <= 2e-5 * peak);
+      }
+    }
+  }
+}
+
+/**
+  * @brief  A sine of amplitude A must integrate to A^2 / 2 over the one-sided PSD
+  */
+static void Test_Scale(void)
+{
+  const uint32_t n = N_MAX;
+  const uint32_t nSegments = 4;
+  const double amplitude = 10000.0;
+  float scale;
+  double power = 0.0;
+
+  TEST_CHECK(HSD_PSD_Init(&psd, n) == 0U);
+  memset(acc, 0, sizeof(acc));
+  for (uint32_t s = 0; s < nSegments; s++)
+  {
+    for (uint32_t i = 0; i < n; i++)
+    {
+      x[i] = (int16_t)(amplitude * sin(2.0 * M_PI * 20.25 * (double)(i + s * n) / (double) n));
+    }
+    HSD_PSD_Accumulate(&psd, x, acc);
+  }
+  scale = HSD_PSD_Get_Scale(&psd, nSegments, FS);
+  for (uint32_t k = 0; k <= n / 2U; k++)
+  {
+    power += ((k == 0U || k == n / 2U) ? 1.0 : 2.0) * acc[k] * scale * (FS / (double) n);
+  }
+  printf("sine A = %.0f: integrated PSD %.1f, expected %.1f\n", amplitude, power, amplitude * amplitude / 2.0);
+  TEST_CHECK(fabs(power - amplitude * amplitude / 2.0) <= 0.02 * amplitude * amplitude / 2.0);
+}
+
+/**
+  * @brief  Reference: the same windowing followed by a textbook complex FFT of N points
+  */
+static void Ref_Init(uint32_t n)
+{
+  for (uint32_t i = 0; i < n / 2U; i++)
+  {
+    refCos[i] = cosf(2.0f * (float) M_PI * (float) i / (float) n);
+    refSin[i] = sinf(2.0f * (float) M_PI * (float) i / (float) n);
+  }
+}
+
+static void Ref_Accumulate(uint32_t n, const int16_t *in, float *out)
+{
+  float mean = 0.0f;
+  float tr, ti;
+  uint32_t i, j, k, len, a, b;
+
+  for (i = 0; i < n; i++)
+  {
+    mean += (float) in[i];
+  }
+  mean /= (float) n;
+  for (i = 0; i < n; i++)
+  {
+    refBuf[2U * i] = ((float) in[i] - mean) * psd.window[i];
+    refBuf[2U * i + 1U] = 0.0f;
+  }
+  for (i = 1, j = 0; i < n; i++)
+  {
+    k = n >> 1;
+    while (j & k)
+    {
+      j ^= k;
+      k >>= 1;
+    }
+    j |= k;
+    if (i < j)
+    {
+      tr = refBuf[2U * i];
+      refBuf[2U * i] = refBuf[2U * j];
+      refBuf[2U * j] = tr;
+    }
+  }
+  for (len = 2; len <= n; len <<= 1)
+  {
+    for (i = 0; i < n; i += len)
+    {
+      for (k = 0; k < len / 2U; k++)
+      {
+        float wr = refCos[k * (n / len)];
+        float wi = -refSin[k * (n / len)];
+        a = 2U * (i + k);
+        b = 2U * (i + k + len / 2U);
+        tr = refBuf[b] * wr - refBuf[b + 1U] * wi;
+        ti = refBuf[b] * wi + refBuf[b + 1U] * wr;
+        refBuf[b] = refBuf[a] - tr;
+        refBuf[b + 1U] = refBuf[a + 1U] - ti;
+        refBuf[a] += tr;
+        refBuf[a + 1U] += ti;
+      }
+    }
+  }
+  for (k = 0; k <= n / 2U; k++)
+  {
+    out[k] += refBuf[2U * k] * refBuf[2U * k] + refBuf[2U * k + 1U] * refBuf[2U * k + 1U];
+  }
+}
+
+static void Bench(uint32_t n, uint32_t repeat)
+{
+  uint32_t seed = 3;
+  uint64_t best = UINT64_MAX;
+  uint64_t bestRef = UINT64_MAX;
+  volatile float sink;
+
+  TEST_CHECK(HSD_PSD_Init(&psd, n) == 0U);
+  Ref_Init(n);
+  Fill(n, &seed, 20000.0, 9.5);
+  for (uint32_t r = 0; r < repeat; r++)
+  {
+    uint64_t t0 = TEST_Cycles();
+    for (uint32_t s = 0; s < BENCH_SEGMENTS; s++)
+    {
+      HSD_PSD_Accumulate(&psd, x, acc);
+    }
+    uint64_t t = TEST_Cycles() - t0;
+    best = (t < best) ? t : best;
+
+    t0 = TEST_Cycles();
+    for (uint32_t s = 0; s < BENCH_SEGMENTS; s++)
+    {
+      Ref_Accumulate(n, x, acc);
+    }
+    t = TEST_Cycles() - t0;
+    bestRef = (t < bestRef) ? t : bestRef;
+  }
+  sink = acc[1];
+  (void) sink;
+  printf("%5u %12.0f %12.0f %8.2f\n", n, (double) best / BENCH_SEGMENTS, (double) bestRef / BENCH_SEGMENTS,
+         (double) bestRef / (double) best);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 10);
+
+  Test_Init();
+  Test_Accuracy();
+  Test_Scale();
+
+  printf("Periodogram of one segment, %s (best of %u runs)\n", TEST_Cycles_Unit(), repeat);
+  printf("%5s %12s %12s %8s\n", "N", "HSD_PSD", "complex FFT", "speedup");
+  for (uint32_t n = 64; n <= N_MAX; n <<= 1)
+  {
+    Bench(n, repeat);
+  }
+  return TEST_RESULT();
+}
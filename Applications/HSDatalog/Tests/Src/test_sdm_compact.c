@@ -0,0 +1,249 @@
+/**
+  ******************************************************************************
+  * @file    test_sdm_compact.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Round trip of the "HSD_2.0.0" data file format through the host reader:
+  *          samples and their time rebuilt from the chunk headers
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sdm_compact_reader.h"
+#include "math.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define CORE_CLOCK      120000000.0
+#define TICK_FREQUENCY  (CORE_CLOCK / (double)(1U << HSD_COMPACT_TS_SHIFT))
+#define MAX_BATCH       512U    /* samples */
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint32_t nBytesPerSample;
+  double odr;             /* real data rate of the sensor */
+  double start;           /* time of the first sample, in header ticks */
+  uint32_t jitter;        /* error of the header times, in header ticks */
+  /* reader */
+  uint64_t nSamples;
+  uint32_t nChunks;
+  double maxError;        /* in header ticks */
+} Stream_t;
+
+/* Private variables ---------------------------------------------------------*/
+static uint8_t chunk[65536];
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Content of a sample byte
+  */
+static inline uint8_t Sample_Byte(uint64_t sample, uint32_t byte)
+{
+  return (uint8_t)(((uint32_t) sample * 2654435761U) >> 24) ^ (uint8_t)(byte * 31U);
+}
+
+/**
+  * @brief  Time of a sample, in header ticks
+  */
+static inline double Sample_Ticks(const Stream_t *st, uint64_t sample)
+{
+  return st->start + (double) sample * TICK_FREQUENCY / st->odr;
+}
+
+/**
+  * @brief  Write the open chunk as the SD task does: header and whole samples, no padding
+  */
+static void Writer_Emit(FILE *f, const Stream_t *st, uint64_t firstSample, uint32_t nSamples, uint32_t *seed)
+{
+  SDM_CompactHeader_t h;
+  double ticks = Sample_Ticks(st, firstSample);
+
+  /* SDM_Chunk_Ticks: clock model error, truncation to the header unit and wrap-around */
+  if (st->jitter != 0U)
+  {
+    ticks += (double)(int32_t)(TEST_Rand(seed) % (2U * st->jitter + 1U)) - (double) st->jitter;
+  }
+  h.tickDelta = (uint32_t)(uint64_t) ticks;
+  h.nSamples = nSamples;
+  memcpy(chunk, &h, sizeof(h));
+  TEST_CHECK(fwrite(chunk, 1, sizeof(h) + nSamples * st->nBytesPerSample, f)
+             == sizeof(h) + nSamples * st->nBytesPerSample);
+}
+
+/**
+  * @brief  Build a data file from random batches, split in chunks of whole samples
+  *         of an arena block as SDM_Fill does
+  * @retval number of chunks
+  */
+static uint32_t Writer_Run(FILE *f, Stream_t *st, uint32_t blockSize, uint64_t totalSamples, uint32_t seed)
+{
+  uint32_t dataSize = blockSize - sizeof(SDM_CompactHeader_t);
+  uint32_t chunkSamples = (dataSize - (dataSize % st->nBytesPerSample)) / st->nBytesPerSample;
+  uint64_t produced = 0;
+  uint64_t first = 0;
+  uint32_t fill = 0;
+  uint32_t nChunks = 0;
+
+  while (produced < totalSamples)
+  {
+    uint32_t n = 1U + TEST_Rand(&seed) % MAX_BATCH;
+    if (n > totalSamples - produced)
+    {
+      n = (uint32_t)(totalSamples - produced);
+    }
+    for (uint32_t i = 0; i < n; i++)
+    {
+      for (uint32_t b = 0; b < st->nBytesPerSample; b++)
+      {
+        chunk[sizeof(SDM_CompactHeader_t) + fill * st->nBytesPerSample + b] = Sample_Byte(produced + i, b);
+      }
+      fill++;
+      if (fill == chunkSamples)
+      {
+        Writer_Emit(f, st, first, fill, &seed);
+        nChunks++;
+        first += fill;
+        fill = 0;
+      }
+    }
+    produced += n;
+  }
+
+  /* SDM_Flush_Buffer: partially filled chunk */
+  if (fill != 0U)
+  {
+    Writer_Emit(f, st, first, fill, &seed);
+    nChunks++;
+  }
+  fflush(f);
+  rewind(f);
+  return nChunks;
+}
+
+/**
+  * @brief  Check every chunk against the writer: sample index, content and time
+  */
+static int32_t Verify_Sink(void *ctx, const SDM_CompactChunk_t *c, const uint8_t *samples, const double *timeStamps)
+{
+  Stream_t *st = ctx;
+
+  TEST_CHECK(c->firstSample == st->nSamples);
+  for (uint32_t i = 0; i < c->nSamples; i++)
+  {
+    for (uint32_t b = 0; b < st->nBytesPerSample; b++)
+    {
+      if (samples[i * st->nBytesPerSample + b] != Sample_Byte(c->firstSample + i, b))
+      {
+        TEST_CHECK(samples[i * st->nBytesPerSample + b] == Sample_Byte(c->firstSample + i, b));
+        return -1;
+      }
+    }
+    double error = fabs(timeStamps[i] * TICK_FREQUENCY - Sample_Ticks(st, c->firstSample + i));
+    if (error > st->maxError)
+    {
+      st->maxError = error;
+    }
+  }
+  st->nSamples += c->nSamples;
+  st->nChunks++;
+  return 0;
+}
+
+static void Test_Round_Trip(Stream_t *st, uint32_t blockSize, uint64_t totalSamples, uint32_t seed)
+{
+  FILE *f = tmpfile();
+  uint32_t nChunks;
+
+  TEST_CHECK(f != NULL);
+  if (f == NULL)
+  {
+    return;
+  }
+  nChunks = Writer_Run(f, st, blockSize, totalSamples, seed);
+  st->nSamples = 0;
+  st->nChunks = 0;
+  st->maxError = 0.0;
+  TEST_CHECK(SDM_Compact_Read(f, st->nBytesPerSample, TICK_FREQUENCY, Verify_Sink, st) == (int32_t) nChunks);
+  TEST_CHECK(st->nSamples == totalSamples);
+  TEST_CHECK(st->nChunks == nChunks);
+  /* truncation of the header times, plus the clock model error at both ends of a chunk;
+   * the last chunk extrapolates the previous period */
+  TEST_CHECK(st->maxError <= 3.0 * st->jitter + 2.0);
+  printf("%8u %6.0f %10u %10.2f\n", st->nBytesPerSample, st->odr, nChunks, st->maxError);
+  fclose(f);
+}
+
+static void Test_Malformed(void)
+{
+  Stream_t st = { .nBytesPerSample = 6, .odr = 6667.0, .start = 0.0 };
+  SDM_CompactHeader_t h = { .tickDelta = 0, .nSamples = 0xFFFFFFFFU };
+  FILE *f = tmpfile();
+  FILE *cut = tmpfile();
+  uint8_t *copy;
+  long size;
+
+  TEST_CHECK(f != NULL && cut != NULL);
+  if (f == NULL || cut == NULL)
+  {
+    return;
+  }
+  /* last chunk cut short */
+  (void) Writer_Run(f, &st, 8192, 10000, 5);
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  rewind(f);
+  copy = malloc((size_t) size);
+  TEST_CHECK(fread(copy, 1, (size_t) size, f) == (size_t) size);
+  TEST_CHECK(fwrite(copy, 1, (size_t) size - 3U, cut) == (size_t) size - 3U);
+  rewind(cut);
+  st.nSamples = 0;
+  TEST_CHECK(SDM_Compact_Read(cut, st.nBytesPerSample, TICK_FREQUENCY, Verify_Sink, &st) == -1);
+  fclose(cut);
+  fclose(f);
+  free(copy);
+
+  /* more samples than an arena block holds */
+  f = tmpfile();
+  TEST_CHECK(fwrite(&h, sizeof(h), 1, f) == 1);
+  rewind(f);
+  st.nSamples = 0;
+  TEST_CHECK(SDM_Compact_Read(f, st.nBytesPerSample, TICK_FREQUENCY, Verify_Sink, &st) == -1);
+  fclose(f);
+
+  /* empty file */
+  f = tmpfile();
+  TEST_CHECK(SDM_Compact_Read(f, st.nBytesPerSample, TICK_FREQUENCY, Verify_Sink, &st) == 0);
+  fclose(f);
+}
+
+int main(void)
+{
+  /* LSM6DSOX acc, 0.3% fast; MP23ABS1; HTS221 temperature; IIS3DWB */
+  Stream_t acc = { .nBytesPerSample = 6, .odr = 6667.0 * 1.003, .start = 1000.0, .jitter = 2 };
+  Stream_t mic = { .nBytesPerSample = 2, .odr = 16000.0, .start = 20.0, .jitter = 0 };
+  Stream_t temp = { .nBytesPerSample = 4, .odr = 12.5, .start = 5000.0, .jitter = 1 };
+  /* clock started just before tickDelta wraps around: as a record longer than 2^32 ticks */
+  Stream_t wrap = { .nBytesPerSample = 6, .odr = 26667.0, .start = 4294967296.0 - 30000.0, .jitter = 2 };
+
+  printf("%8s %6s %10s %10s\n", "bytes", "ODR", "chunks", "max err");
+  Test_Round_Trip(&acc, 8192, 500000, 1);
+  Test_Round_Trip(&mic, 32768, 1000000, 2);
+  Test_Round_Trip(&temp, 4096, 3000, 3);
+  Test_Round_Trip(&wrap, 8192, 200000, 4);
+  Test_Malformed();
+  return TEST_RESULT();
+}
@@ -0,0 +1,329 @@
+/**
+  ******************************************************************************
+  * @file    test_sdm_container.c
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Round trip of the SD container format through the host reader,
+  *          and reader throughput
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Includes ------------------------------------------------------------------*/
+#include "sdm_container_reader.h"
+#include "string.h"
+#include "test_utils.h"
+
+/* Private define ------------------------------------------------------------*/
+#define N_STREAMS       5U
+#define MAX_BATCH       3072U
+#define BENCH_MB        8U
+
+/* Private typedef -----------------------------------------------------------*/
+typedef struct
+{
+  uint8_t sID;
+  uint8_t ssID;
+  uint32_t nBytesPerSample;
+  uint32_t samplesPerTs;
+  uint32_t weight;        /* share of the batches */
+  /* writer */
+  uint8_t *chunk;
+  uint32_t fill;
+  uint32_t seq;
+  uint64_t written;
+  /* reader */
+  uint64_t read;
+  uint32_t nChunks;
+} Stream_t;
+
+/* Private variables ---------------------------------------------------------*/
+/* LSM6DSOX acc and gyro, MP23ABS1, HTS221 temperature, a stream without timestamps */
+static Stream_t streams[N_STREAMS] =
+{
+  { .sID = 7, .ssID = 0, .nBytesPerSample = 6, .samplesPerTs = 1000, .weight = 16 },
+  { .sID = 7, .ssID = 1, .nBytesPerSample = 6, .samplesPerTs = 1000, .weight = 16 },
+  { .sID = 4, .ssID = 0, .nBytesPerSample = 2, .samplesPerTs = 8000, .weight = 48 },
+  { .sID = 1, .ssID = 0, .nBytesPerSample = 4, .samplesPerTs = 10, .weight = 1 },
+  { .sID = 9, .ssID = 2, .nBytesPerSample = 2, .samplesPerTs = 0, .weight = 3 },
+};
+
+static uint8_t batch[MAX_BATCH];
+static uint8_t sinkBuffer[65536];
+
+/* Private functions ---------------------------------------------------------*/
+/**
+  * @brief  Content of a stream at a byte offset
+  */
+static inline uint8_t Stream_Byte(uint32_t s, uint64_t pos)
+{
+  return (uint8_t)(((uint32_t) pos * 2654435761U) >> 24) ^ (uint8_t)(s * 31U);
+}
+
+/**
+  * @brief  Write the open chunk of a stream as the SD task does: header, payload, padding
+  */
+static void Writer_Emit(FILE *f, Stream_t *st, uint32_t chunkSize)
+{
+  SDM_ChunkHeader_t h;
+  uint32_t dataSize = chunkSize - sizeof(SDM_ChunkHeader_t);
+
+  memset(&h, 0, sizeof(h));
+  h.magic = SDM_CHUNK_MAGIC;
+  h.sID = st->sID;
+  h.ssID = st->ssID;
+  h.headerSize = sizeof(SDM_ChunkHeader_t);
+  h.length = st->fill;
+  h.firstSample = SDM_Container_Sample_Index(st->seq * dataSize, st->nBytesPerSample, st->samplesPerTs);
+  h.timeStamp = (HSD_TimeStamp_t) st->seq;
+  memcpy(st->chunk, &h, sizeof(h));
+  /* stale arena content in the padding */
+  memset(&st->chunk[sizeof(h) + st->fill], 0xA5, dataSize - st->fill);
+  TEST_CHECK(fwrite(st->chunk, 1, chunkSize, f) == chunkSize);
+  st->fill = 0;
+  st->seq++;
+}
+
+/**
+  * @brief  Build a container file from random batches of every stream
+  * @retval file size
+  */
+static uint64_t Writer_Run(FILE *f, uint32_t chunkSize, uint64_t totalBytes, uint32_t seed)
+{
+  uint32_t dataSize = chunkSize - sizeof(SDM_ChunkHeader_t);
+  uint32_t weights = 0;
+  uint64_t produced = 0;
+  uint64_t fileSize = 0;
+  uint32_t s;
+
+  for (s = 0; s < N_STREAMS; s++)
+  {
+    streams[s].chunk = malloc(chunkSize);
+    streams[s].fill = 0;
+    streams[s].seq = 0;
+    streams[s].written = 0;
+    weights += streams[s].weight;
+  }
+
+  while (produced < totalBytes)
+  {
+    uint32_t pick = TEST_Rand(&seed) % weights;
+    for (s = 0; pick >= streams[s].weight; s++)
+    {
+      pick -= streams[s].weight;
+    }
+    Stream_t *st = &streams[s];
+    uint32_t n = 1U + TEST_Rand(&seed) % MAX_BATCH;
+
+    for (uint32_t i = 0; i < n; i++)
+    {
+      batch[i] = Stream_Byte(s, st->written + i);
+    }
+    for (uint32_t i = 0; i < n;)
+    {
+      uint32_t span = dataSize - st->fill;
+      if (span > n - i)
+      {
+        span = n - i;
+      }
+      memcpy(&st->chunk[sizeof(SDM_ChunkHeader_t) + st->fill], &batch[i], span);
+      st->fill += span;
+      i += span;
+      if (st->fill == dataSize)
+      {
+        Writer_Emit(f, st, chunkSize);
+        fileSize += chunkSize;
+      }
+    }
+    st->written += n;
+    produced += n;
+  }
+
+  /* SDM_Flush_Buffer: partially filled chunks */
+  for (s = 0; s < N_STREAMS; s++)
+  {
+    if (streams[s].fill != 0U)
+    {
+      Writer_Emit(f, &streams[s], chunkSize);
+      fileSize += chunkSize;
+    }
+    free(streams[s].chunk);
+  }
+  fflush(f);
+  rewind(f);
+  return fileSize;
+}
+
+static Stream_t *Find_Stream(const SDM_ChunkHeader_t *h)
+{
+  for (uint32_t s = 0; s < N_STREAMS; s++)
+  {
+    if (streams[s].sID == h->sID && streams[s].ssID == h->ssID)
+    {
+      return &streams[s];
+    }
+  }
+  return NULL;
+}
+
+/**
+  * @brief  Check every chunk against the writer: stream order, first sample and content
+  */
+static int32_t Verify_Sink(void *ctx, const SDM_ChunkHeader_t *h, const uint8_t *payload)
+{
+  Stream_t *st = Find_Stream(h);
+  uint32_t s;
+
+  (void) ctx;
+  TEST_CHECK(st != NULL);
+  if (st == NULL)
+  {
+    return -1;
+  }
+  s = (uint32_t)(st - streams);
+  TEST_CHECK(h->firstSample == SDM_Container_Sample_Index((uint32_t) st->read, st->nBytesPerSample,
+                                                          st->samplesPerTs));
+  TEST_CHECK(h->timeStamp == (HSD_TimeStamp_t) st->nChunks);
+  for (uint32_t i = 0; i < h->length; i++)
+  {
+    if (payload[i] != Stream_Byte(s, st->read + i))
+    {
+      TEST_CHECK(payload[i] == Stream_Byte(s, st->read + i));
+      return -1;
+    }
+  }
+  st->read += h->length;
+  st->nChunks++;
+  return 0;
+}
+
+/**
+  * @brief  Demultiplex into memory, the cost a host tool has on top of the file reads
+  */
+static int32_t Copy_Sink(void *ctx, const SDM_ChunkHeader_t *h, const uint8_t *payload)
+{
+  Stream_t *st = Find_Stream(h);
+
+  (void) ctx;
+  memcpy(sinkBuffer, payload, h->length);
+  st->read += h->length;
+  return 0;
+}
+
+static void Test_Round_Trip(uint32_t chunkSize, uint64_t totalBytes, uint32_t seed)
+{
+  FILE *f = tmpfile();
+  uint64_t fileSize;
+  int32_t n;
+
+  TEST_CHECK(f != NULL);
+  if (f == NULL)
+  {
+    return;
+  }
+  fileSize = Writer_Run(f, chunkSize, totalBytes, seed);
+  TEST_CHECK(SDM_Container_Chunk_Size(f) == chunkSize);
+
+  for (uint32_t s = 0; s < N_STREAMS; s++)
+  {
+    streams[s].read = 0;
+    streams[s].nChunks = 0;
+  }
+  n = SDM_Container_Read(f, chunkSize, Verify_Sink, NULL);
+  TEST_CHECK(n >= 0 && (uint64_t) n * chunkSize == fileSize);
+  for (uint32_t s = 0; s < N_STREAMS; s++)
+  {
+    TEST_CHECK(streams[s].read == streams[s].written);
+    TEST_CHECK(streams[s].nChunks == streams[s].seq);
+  }
+  fclose(f);
+}
+
+static void Test_Malformed(void)
+{
+  FILE *f = tmpfile();
+  uint64_t fileSize;
+  uint8_t junk = 0;
+
+  TEST_CHECK(f != NULL);
+  if (f == NULL)
+  {
+    return;
+  }
+  fileSize = Writer_Run(f, 4096, 100000, 7);
+  /* damage the magic of the third chunk */
+  fseek(f, 2L * 4096L, SEEK_SET);
+  TEST_CHECK(fwrite(&junk, 1, 1, f) == 1);
+  rewind(f);
+  for (uint32_t s = 0; s < N_STREAMS; s++)
+  {
+    streams[s].read = 0;
+    streams[s].nChunks = 0;
+  }
+  TEST_CHECK(fileSize > 3U * 4096U);
+  TEST_CHECK(SDM_Container_Read(f, 4096, Verify_Sink, NULL) == -1);
+  fclose(f);
+
+  /* not a container */
+  f = tmpfile();
+  TEST_CHECK(fwrite(batch, 1, 1024, f) == 1024);
+  TEST_CHECK(SDM_Container_Chunk_Size(f) == 0U);
+  fclose(f);
+}
+
+static void Bench_Read(uint32_t chunkSize, uint32_t repeat)
+{
+  FILE *f = tmpfile();
+  uint64_t fileSize;
+  uint64_t best = UINT64_MAX;
+  struct timespec t0;
+  struct timespec t1;
+
+  if (f == NULL)
+  {
+    return;
+  }
+  fileSize = Writer_Run(f, chunkSize, (uint64_t) BENCH_MB * repeat * 1024U * 1024U, 99);
+  for (uint32_t r = 0; r < 3U; r++)
+  {
+    rewind(f);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    TEST_CHECK(SDM_Container_Read(f, chunkSize, Copy_Sink, NULL) > 0);
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    uint64_t ns = (uint64_t)(t1.tv_sec - t0.tv_sec) * 1000000000ULL + (uint64_t) t1.tv_nsec - (uint64_t) t0.tv_nsec;
+    if (ns < best)
+    {
+      best = ns;
+    }
+  }
+  printf("%8u %10.1f %12.1f\n", chunkSize, (double) fileSize / (1024.0 * 1024.0),
+         (double) fileSize * 1000.0 / (double) best);
+  fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t repeat = TEST_Repeat(argc, argv, 16);
+
+  Test_Round_Trip(8192, 4U * 1024U * 1024U, 1);
+  Test_Round_Trip(32768, 4U * 1024U * 1024U, 2);
+  Test_Round_Trip(4096, 5000, 3);
+  Test_Malformed();
+
+  printf("Container read and demultiplex, file in page cache\n");
+  printf("%8s %10s %12s\n", "chunk", "MiB", "MB/s");
+  Bench_Read(8192, repeat);
+  Bench_Read(32768, repeat);
+  return TEST_RESULT();
+}
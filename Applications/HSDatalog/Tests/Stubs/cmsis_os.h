@@ -0,0 +1,31 @@
+/**
+  ******************************************************************************
+  * @file    cmsis_os.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host stand-in for the CMSIS-RTOS types used by HSDatalog headers
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __CMSIS_OS_STUB_H
+#define __CMSIS_OS_STUB_H
+
+#include "stdint.h"
+
+typedef uint32_t TickType_t;
+typedef void *osMessageQId;
+
+#endif /* __CMSIS_OS_STUB_H */
@@ -0,0 +1,33 @@
+/**
+  ******************************************************************************
+  * @file    ff.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host stand-in for the FatFs types used by HSDatalog headers
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __FF_STUB_H
+#define __FF_STUB_H
+
+#include "stdint.h"
+
+typedef struct
+{
+  uint32_t fsize;
+} FIL;
+
+#endif /* __FF_STUB_H */
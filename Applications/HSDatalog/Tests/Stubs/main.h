@@ -0,0 +1,32 @@
+/**
+  ******************************************************************************
+  * @file    main.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host stand-in for the application header included by HSDCore modules
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __MAIN_STUB_H
+#define __MAIN_STUB_H
+
+#include <stdio.h>
+
+#ifndef __weak
+#define __weak   __attribute__((weak))
+#endif /* __weak */
+
+#endif /* __MAIN_STUB_H */
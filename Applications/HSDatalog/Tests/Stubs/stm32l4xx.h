@@ -0,0 +1,59 @@
+/**
+  ******************************************************************************
+  * @file    stm32l4xx.h
+  * @author  SRA - MCD
+  *
+  *
+  * @brief   Host emulation of the Cortex-M4 DSP intrinsics used by HSDCore kernels,
+  *          bit-exact for the operands they are given there
+  ******************************************************************************
+  * @attention
+  *
+  * Copyright (c) 2022 STMicroelectronics.
+  * All rights reserved.
+  *
+  * This software is licensed under terms that can be found in the LICENSE file
+  * in the root directory of this software component.
+  * If no LICENSE file comes with this software, it is provided AS-IS.
+  *
+  *
+  ******************************************************************************
+  */
+
+/* Define to prevent recursive inclusion -------------------------------------*/
+#ifndef __STM32L4XX_STUB_H
+#define __STM32L4XX_STUB_H
+
+#include "stdint.h"
+
+/* PKHBT: bottom half of a, top half of b << shift */
+static inline uint32_t __PKHBT(uint32_t a, uint32_t b, uint32_t shift)
+{
+  return (a & 0x0000FFFFU) | ((b << shift) & 0xFFFF0000U);
+}
+
+/* SMLSD: a.lo * b.lo - a.hi * b.hi + acc */
+static inline uint32_t __SMLSD(uint32_t a, uint32_t b, uint32_t acc)
+{
+  int32_t p0 = (int32_t)(int16_t) a * (int32_t)(int16_t) b;
+  int32_t p1 = (int32_t)(int16_t)(a >> 16) * (int32_t)(int16_t)(b >> 16);
+  return (uint32_t) p0 - (uint32_t) p1 + acc;
+}
+
+/* SMLSDX: a.lo * b.hi - a.hi * b.lo + acc */
+static inline uint32_t __SMLSDX(uint32_t a, uint32_t b, uint32_t acc)
+{
+  int32_t p0 = (int32_t)(int16_t) a * (int32_t)(int16_t)(b >> 16);
+  int32_t p1 = (int32_t)(int16_t)(a >> 16) * (int32_t)(int16_t) b;
+  return (uint32_t) p0 - (uint32_t) p1 + acc;
+}
+
+/* SSAT: saturate to a signed range of sat bits */
+static inline int32_t __SSAT(int32_t val, uint32_t sat)
+{
+  int32_t max = (int32_t)((1U << (sat - 1U)) - 1U);
+  int32_t min = -max - 1;
+  return (val > max) ? max : ((val < min) ? min : val);
+}
+
+#endif /* __STM32L4XX_STUB_H */